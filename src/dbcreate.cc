@@ -22,10 +22,10 @@ using namespace std;
 /* Steps:
     1) Create a subdirectory for the database
     4) Create the system catalogs
-        - Create RM files for relcat and attrcat
+        - Create RM files for relcat, attrcat, relstat and attrstat
         - Open the files
-        - Insert the relcat and attrcat as relations into relcat
-        - Insert the attributions of relcat and attrcat into attrcat
+        - Insert the catalogs as relations into relcat
+        - Insert the attributions of the catalogs into attrcat
         - Close the files
 */
 int main(int argc, char *argv[])
@@ -65,6 +65,8 @@ int main(int argc, char *argv[])
     // Create RM files for relcat and attrcat
     Try_RM(rmManager.CreateFile(relcatName, sizeof(SM_RelcatRecord)));
     Try_RM(rmManager.CreateFile(attrcatName, sizeof(SM_AttrcatRecord)));
+    Try_RM(rmManager.CreateFile("relstat", sizeof(SM_RelstatRecord)));
+    Try_RM(rmManager.CreateFile("attrstat", sizeof(SM_AttrstatRecord)));
 
     // Open the files
     RM_FileHandle relcatFH;
@@ -173,6 +175,81 @@ int main(int argc, char *argv[])
         -1};
     Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
 
+    // Insert the statistics catalogs in relcat,
+    // of which the bounds of histograms aren't listed as attributes
+    rcRecord = SM_RelcatRecord{
+        "relstat",
+        sizeof(SM_RelstatRecord),
+        SM_RELSTAT_ATTR_COUNT,
+        0};
+    Try_RM(relcatFH.InsertRec((char *)&rcRecord, rid));
+    rcRecord = SM_RelcatRecord{
+        "attrstat",
+        sizeof(SM_AttrstatRecord),
+        SM_ATTRSTAT_ATTR_COUNT,
+        0};
+    Try_RM(relcatFH.InsertRec((char *)&rcRecord, rid));
+
+    // Insert relstat attributes in attrcat
+    acRecord = SM_AttrcatRecord{
+        "relstat",
+        "relName",
+        offsetof(SM_RelstatRecord, relName),
+        STRING,
+        MAXNAME + 1,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+    acRecord = SM_AttrcatRecord{
+        "relstat",
+        "recordCount",
+        offsetof(SM_RelstatRecord, recordCount),
+        INT,
+        4,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+    acRecord = SM_AttrcatRecord{
+        "relstat",
+        "pageCount",
+        offsetof(SM_RelstatRecord, pageCount),
+        INT,
+        4,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+
+    // Insert attrstat attributes in attrcat
+    acRecord = SM_AttrcatRecord{
+        "attrstat",
+        "relName",
+        offsetof(SM_AttrstatRecord, relName),
+        STRING,
+        MAXNAME + 1,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+    acRecord = SM_AttrcatRecord{
+        "attrstat",
+        "attrName",
+        offsetof(SM_AttrstatRecord, attrName),
+        STRING,
+        MAXNAME + 1,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+    acRecord = SM_AttrcatRecord{
+        "attrstat",
+        "distinctCount",
+        offsetof(SM_AttrstatRecord, distinctCount),
+        INT,
+        4,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+    acRecord = SM_AttrcatRecord{
+        "attrstat",
+        "bucketCount",
+        offsetof(SM_AttrstatRecord, bucketCount),
+        INT,
+        4,
+        -1};
+    Try_RM(attrcatFH.InsertRec((char *)&acRecord, rid));
+
     // Close the files
     Try_RM(rmManager.CloseFile(relcatFH));
     Try_RM(rmManager.CloseFile(attrcatFH));
@@ -149,6 +149,12 @@ RC interp(NODE *n)
                                  n->u.DROPINDEX.attrname);
         break;
 
+    case N_COMPACTINDEX: /* for CompactIndex() */
+
+        errval = pSmm->CompactIndex(n->u.COMPACTINDEX.relname,
+                                    n->u.COMPACTINDEX.attrname);
+        break;
+
     case N_DROPTABLE: /* for DropTable() */
 
         errval = pSmm->DropTable(n->u.DROPTABLE.relname);
@@ -179,6 +185,11 @@ RC interp(NODE *n)
         errval = pSmm->Print(n->u.PRINT.relname);
         break;
 
+    case N_ANALYZE: /* for Analyze() */
+
+        errval = pSmm->Analyze(n->u.ANALYZE.relname);
+        break;
+
     case N_QUERY: /* for Query() */
     {
         int nSelAttrs = 0;
@@ -590,6 +601,10 @@ static void echo_query(NODE *n)
         printf("drop index %s(%s);\n", n->u.DROPINDEX.relname,
                n->u.DROPINDEX.attrname);
         break;
+    case N_COMPACTINDEX: /* for CompactIndex() */
+        printf("compact index %s(%s);\n", n->u.COMPACTINDEX.relname,
+               n->u.COMPACTINDEX.attrname);
+        break;
     case N_DROPTABLE: /* for DropTable() */
         printf("drop table %s;\n", n->u.DROPTABLE.relname);
         break;
@@ -606,6 +621,9 @@ static void echo_query(NODE *n)
     case N_PRINT: /* for Print() */
         printf("print %s;\n", n->u.PRINT.relname);
         break;
+    case N_ANALYZE: /* for Analyze() */
+        printf("analyze %s;\n", n->u.ANALYZE.relname);
+        break;
     case N_SET: /* for Set() */
         printf("set %s = \"%s\";\n", n->u.SET.paramName, n->u.SET.string);
         break;
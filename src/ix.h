@@ -12,8 +12,9 @@
 #include "purplebase.h" // Please don't change these lines
 #include "rm_rid.h"  // Please don't change these lines
 #include "pf.h"
+#include <cstdio>
 #include <utility>
-#include <list>
+#include <vector>
 
 // To make the volume of the bucket larger, we use [short] as [BucketNum].
 typedef short BucketNum;
@@ -48,22 +49,33 @@ struct IX_IndexHeader
     bool modified = false;
 };
 
+struct IX_Posting; // The RIDs of a key in a leaf
+
+// The percentage of a node filled by bulk loading and compaction
+const int IX_DEFAULT_FILL_FACTOR = 90;
+
 //
 // IX_IndexHandle: IX Index File interface
 //
 // 1) Differences with traditional B+ tree:
 //    1.1) here we adopt a structure of left-inclusive right-exclusive intervals: [l, r)
 //    The number of keys stored in the node is the same as children.
-//    1.2) keys of some nodes are possibly non-unique
+//    1.2) every key is stored once in the leaves, with all of its RIDs
 // 2) In one page, i.e. one node of B+ tree, we store following things:
 //    2.1) A bool that indicates if this node is a leaf
 //    2.2) The number of its children w.
 //    If this node is not a leaf:
 //      2.3_1) (key, pageNum) * w
 //    If this node is a leaf:
-//      2.3_2) (key, RID) * w, where [RID.viable == false] means that this index is deleted.
-// 3) Here we reuse [RID.viable] as tombstone.
-// 4) The private functions starting with [BPlus_] are recursive functions on the B+ tree.
+//      2.3_2) (key, IX_Posting) * w, the RIDs of the key, see ix_internal.h.
+//      2.4_2) The page numbers of the previous and the next leaves at the end of the page,
+//      which are 0 if there's none, since page 0 is the header page.
+// 3) A key whose RIDs are all deleted is removed from its leaf. A node left less than
+//    half full borrows entries from a sibling, or is merged into it, and a root with
+//    a single child is replaced by the child. Keys without RIDs left by older versions
+//    are skipped by scans, and dropped by Compact.
+// 4) The private functions starting with [BPlus_] are recursive functions on the B+ tree,
+//    and those starting with [Posting_] work on the RIDs of one key.
 class IX_IndexHandle
 {
     friend class IX_Manager;
@@ -82,6 +94,9 @@ public:
     // Force index files to disk
     RC ForcePages();
 
+    // Rebuild the nodes from the keys in order, filled to [fillFactor] percent
+    RC Compact(int fillFactor = IX_DEFAULT_FILL_FACTOR);
+
     PF_FileHandle pFFileHandle; // Underlying file handle
 
     bool open;
@@ -91,13 +106,29 @@ public:
     IX_IndexHeader header;
 
     // Fundamental operations of B+ tree
-    bool BPlus_Exists(PageNum nodePageNum, const void *pData, const RID &rid);
     const std::pair<const void *, PageNum> BPlus_Insert(PageNum nodePageNum, const void *pData, const RID &rid);
-    bool BPlus_Delete(PageNum nodePageNum, const void *pData, const RID &rid);
+    bool BPlus_Delete(PageNum nodePageNum, const void *pData, const RID &rid, bool &underflow);
+    void BPlus_Rebalance(char *nodePageData, int i);
+    void BPlus_CollapseRoot();
     bool BPlus_Update(PageNum nodePageNum, const void *pData, const RID &origin_rid, const RID &updated_rid);
 
     void BPlus_Print(PageNum nodePageNum) const;
 
+    // Operations on the RIDs of a key, where [posting] is in a pinned leaf
+    // Add [rid], and return false if it's there already
+    bool Posting_Insert(IX_Posting &posting, const RID &rid);
+    // Remove [rid], and return false if it isn't there
+    bool Posting_Delete(IX_Posting &posting, const RID &rid);
+    // Read the RIDs kept in the entry, and return the first bucket of the rest, or 0 if none
+    PageNum Posting_Read(const IX_Posting &posting, std::vector<RID> &rids) const;
+    // Read the RID of a key that has a single one, kept in the entry, and return false otherwise
+    bool Posting_ReadSingle(const IX_Posting &posting, RID &rid) const;
+    // Read the RIDs of a bucket, and return the next bucket, or 0 if none
+    PageNum Posting_ReadBucket(PageNum bucketPageNum, std::vector<RID> &rids) const;
+
+    // Allocate a page, which may be one disposed of before
+    PageNum AllocatePage(PF_PageHandle &pageHandle, RC ix_rc);
+
     // Utilities
     // Compare two key of the current index.
     // Return:
@@ -105,6 +136,11 @@ public:
     //        0,  if [data1] == [data2]
     //        1,  if [data1] > [data2]
     int cmp(const void *data1, const void *data2) const;
+    // Binary search in a node: the first entry whose key is not less than [pData],
+    // or greater than [pData] if [upper]
+    int Search(const char *nodePageData, const void *pData, bool upper) const;
+    // The child of an inner node which may hold [pData]
+    int Child(const char *nodePageData, const void *pData) const;
     void InnerEntry_Print(void *data) const;
     void LeafEntry_Print(void *data) const;
     void Attr_Print(const void *data) const;
@@ -113,6 +149,10 @@ public:
 //
 // IX_IndexScan: condition-based scan of index entries
 //
+// The scan is a cursor. Opening descends once to the first leaf that may hold
+// a satisfying entry, and then the leaves are walked by their links,
+// one pinned at a time, until an entry is past the bound.
+// Hence the index handle must be kept open until the scan is closed.
 class IX_IndexScan
 {
 public:
@@ -139,9 +179,72 @@ public:
 private:
     bool open;
 
-    std::list<RID> scan;
+    const IX_IndexHandle *indexHandle;
+    CompOp compOp;
+    char *value;        // A copy of the compared key
+    PageNum curPageNum; // The pinned leaf, or 0 if none
+    int curEntry;       // The next entry in the leaf
+    char *pageData;
+
+    std::vector<RID> rids; // The RIDs read from the entry or a bucket of the current key
+    size_t nextRID;        // The next one to return
+    PageNum nextBucket;    // The bucket to read after them, or 0 if none
+
+    // Is a key past the lower bound, and is it before the upper bound
+    bool AfterStart(const void *key) const;
+    bool BeforeEnd(const void *key) const;
+};
+
+//
+// IX_BulkLoader: builds an empty index bottom-up
+//
+// The (key, RID) entries may be added in any order. They are kept in memory and, once
+// IX_BULK_RUN_BYTES of them are there, sorted and spilled to a temporary file
+// as a run. Finish merges the runs and packs the sorted entries into linked
+// leaves, each filled up to [fillFactor] percent, and then every level of inner
+// nodes from the first keys of the level below, until one node is left as the root.
+// The RIDs of equal keys go to the posting list of the key.
+// Keys already in order may be added with their RIDs instead, as Compact does.
+// As by InsertEntry, an entry may only be added once.
+class IX_BulkLoader
+{
+public:
+    IX_BulkLoader();
+    ~IX_BulkLoader();
+
+    // Start building an index, which must hold no entry, not even a deleted one
+    RC Open(IX_IndexHandle &indexHandle, int fillFactor = IX_DEFAULT_FILL_FACTOR);
+
+    // Add an entry
+    RC AddEntry(const void *pData, const RID &rid);
+
+    // Add a key with its RIDs, after all the keys added before, instead of entries
+    RC AddPosting(const void *pData, const IX_Posting &posting);
+
+    // Sort the entries and write the B+ tree
+    RC Finish();
+
+private:
+    bool open;
 
-    void BPlus_Find(const IX_IndexHandle &indexHandle, PageNum nodePageNum, CompOp compOp, void *value);
+    IX_IndexHandle *indexHandle;
+    int entryLength;                // (key, page, slot)
+    int leafCap, innerCap;          // entries packed in a node
+    std::vector<char> entries;      // entries not spilled yet
+    std::vector<FILE *> runs;       // sorted runs spilled
+
+    PageNum leafPageNum;            // the pinned leaf, or 0 if none
+    char *leafData;
+    std::vector<char> level;        // (first key, page) of the nodes of a level
+
+    bool Less(const char *a, const char *b) const;
+    void SpillRun();
+    void SortEntries(std::vector<const char *> &sorted);
+    void PackEntry(const char *entry);
+    void PackKey(const char *pData, const IX_Posting &posting);
+    PageNum NewNode(bool isLeaf, char *&nodeData);
+    void PackInnerLevels();
+    void CloseRuns();
 };
 
 //
@@ -205,7 +308,12 @@ void IX_PrintError(RC rc);
 #define IX_HANDLE_INNER_SPLIT_FAIL (START_IX_WARN + 16)
 #define IX_HANDLE_INNER_NEW_ROOT_FAIL (START_IX_WARN + 17)
 #define IX_HANDLE_DELETE_FAIL (START_IX_WARN + 18)
-#define IX_LASTWARN IX_HANDLE_DELETE_FAIL
+#define IX_BULK_NOT_EMPTY (START_IX_WARN + 19)
+#define IX_BULK_FAIL (START_IX_WARN + 20)
+#define IX_BUCKET_FAIL (START_IX_WARN + 21)
+#define IX_HANDLE_REBALANCE_FAIL (START_IX_WARN + 22)
+#define IX_COMPACT_FAIL (START_IX_WARN + 23)
+#define IX_LASTWARN IX_COMPACT_FAIL
 
 // Errors
 #define IX_MANAGER_CREATE_OPEN_FILE_FAIL (START_IX_ERR - 0) // Invalid PC file name
@@ -252,10 +360,13 @@ void IX_PrintError(RC rc);
 #define IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_ROOT_FAIL (START_IX_ERR - 40)
 #define IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL (START_IX_ERR - 41)
 #define IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL (START_IX_ERR - 42)
+#define IX_BULK_FAIL_UNPIN_FAIL (START_IX_ERR - 43)
+#define IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL (START_IX_ERR - 44)
+#define IX_COMPACT_FAIL_UNPIN_FAIL (START_IX_ERR - 45)
 
 // The exact definition needs to be modified.
 // Error in UNIX system call or library routine
-#define IX_UNIX (START_IX_ERR - 43) // Unix error
+#define IX_UNIX (START_IX_ERR - 46) // Unix error
 #define IX_LASTERROR IX_UNIX
 
 #endif
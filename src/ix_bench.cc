@@ -0,0 +1,244 @@
+//
+// File:        ix_bench.cc
+// Description: Microbenchmark of the search within B+ tree nodes, and of
+//              lookups in an index
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <unistd.h>
+#include "purplebase.h"
+#include "pf.h"
+#include "ix.h"
+#include "ix_internal.h"
+#include "util_internal.h"
+
+using namespace std;
+
+#define IX_BENCH_FILE "ix_bench"
+#define IX_BENCH_LOOKUPS 1000000
+
+typedef int (*SearchFunc)(AttrType, int, const char *, int, int, const void *, bool);
+
+// The nanoseconds per operation of [n] operations since [start]
+static double NanosPerOp(chrono::steady_clock::time_point start, long long n)
+{
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return n ? elapsed.count() / n : 0;
+}
+
+// Search [probes] in a node of [fanout] entries by [search], and return ns per search
+template <typename T>
+static double TimeNode(SearchFunc search, AttrType attrType, int entryLength, int fanout,
+                       const vector<T> &probes, long long &checksum)
+{
+    vector<char> node((size_t)fanout * entryLength);
+    for (int i = 0; i < fanout; ++i)
+    {
+        T key = (T)(2 * i);
+        memcpy(node.data() + (size_t)i * entryLength, &key, sizeof(T));
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); ++i)
+        checksum += search(attrType, sizeof(T), node.data(), entryLength, fanout, &probes[i], i & 1);
+    return NanosPerOp(start, probes.size());
+}
+
+// Print a row of the three searches for every fanout
+template <typename T>
+static void BenchNodes(const char *name, AttrType attrType, int entryLength, const vector<int> &fanouts)
+{
+    mt19937 rng(17);
+    long long checksum = 0;
+    for (int fanout : fanouts)
+    {
+        vector<T> probes(IX_BENCH_LOOKUPS);
+        uniform_int_distribution<int> dist(-1, 2 * fanout);
+        for (T &probe : probes)
+            probe = (T)dist(rng);
+
+        double linear = TimeNode<T>(IX_SearchNodeLinear, attrType, entryLength, fanout, probes, checksum);
+        double binary = TimeNode<T>(IX_SearchNodeBinary, attrType, entryLength, fanout, probes, checksum);
+        double simd = TimeNode<T>(IX_SearchNode, attrType, entryLength, fanout, probes, checksum);
+        printf("%-6s %6d %12.1f %12.1f %12.1f\n", name, fanout, linear, binary, simd);
+    }
+    if (checksum == 42)
+        printf("\n"); // Keep the searches from being optimized away
+}
+
+// Look every key of [probes] up by an EQ scan, and return ns per key
+static double TimeLookups(const IX_IndexHandle &indexHandle, const vector<int> &probes, long long &found)
+{
+    IX_IndexScan indexScan;
+    RID rid;
+    auto start = chrono::steady_clock::now();
+    for (int key : probes)
+    {
+        Try_IX(indexScan.OpenScan(indexHandle, EQ_OP, (void *)&key));
+        for (RC rc; (rc = indexScan.GetNextEntry(rid)) != IX_EOF; ++found)
+            Try_IX(rc);
+        Try_IX(indexScan.CloseScan());
+    }
+    return NanosPerOp(start, probes.size());
+}
+
+//
+// main
+//
+/* Steps:
+    1) Search synthetic INT and FLOAT leaves of several fanouts,
+       one entry at a time, by binary search, and by SIMD
+    2) Insert [keys] INT keys into a temporary index in random order,
+       and bulk load them into another one
+    3) Look every key up by an EQ scan, and scan a range of a tenth of them
+    4) Bulk load as many RIDs over a thousandth as many keys,
+       and look every key up by an EQ scan, and over a quarter as many keys,
+       and scan them all
+    5) Delete nine tenths of the keys, and look the rest up before and after Compact
+    6) Print the nanoseconds per operation of every step, and destroy the indexes
+*/
+int main(int argc, char *argv[])
+{
+    int keys = argc > 1 ? atoi(argv[1]) : 200000;
+    if (argc > 2 || keys <= 0)
+    {
+        fprintf(stderr, "Usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    // 1) Nodes
+    int leafEntryLength = sizeof(int) + sizeof(IX_Posting);
+    int maxFanout = (PF_PAGE_SIZE - sizeof(bool) - sizeof(int) - IX_LEAF_LINK_SIZE) / leafEntryLength;
+    vector<int> fanouts = {8, 16, 32, 64, 128, maxFanout};
+    printf("Search in a leaf (%s), ns/search\n", IX_SearchSIMD());
+    printf("%-6s %6s %12s %12s %12s\n", "type", "fanout", "linear", "binary", "simd");
+    BenchNodes<int>("INT", INT, leafEntryLength, fanouts);
+    BenchNodes<float>("FLOAT", FLOAT, leafEntryLength, fanouts);
+
+    // 2) Insert
+    PF_Manager pfm;
+    IX_Manager ixm(pfm);
+    IX_IndexHandle indexHandle;
+    ixm.DestroyIndex(IX_BENCH_FILE, 0);
+    Try_IX(ixm.CreateIndex(IX_BENCH_FILE, 0, INT, sizeof(int)));
+    Try_IX(ixm.OpenIndex(IX_BENCH_FILE, 0, indexHandle));
+
+    vector<int> order(keys);
+    for (int i = 0; i < keys; ++i)
+        order[i] = i;
+    shuffle(order.begin(), order.end(), mt19937(17));
+    auto start = chrono::steady_clock::now();
+    for (int key : order)
+        Try_IX(indexHandle.InsertEntry(&key, RID(key / 100, key % 100)));
+    printf("\nInsertEntry:            %8.1f ns/key\n", NanosPerOp(start, keys));
+
+    IX_IndexHandle bulkHandle;
+    IX_BulkLoader bulkLoader;
+    ixm.DestroyIndex(IX_BENCH_FILE, 1);
+    Try_IX(ixm.CreateIndex(IX_BENCH_FILE, 1, INT, sizeof(int)));
+    Try_IX(ixm.OpenIndex(IX_BENCH_FILE, 1, bulkHandle));
+    start = chrono::steady_clock::now();
+    Try_IX(bulkLoader.Open(bulkHandle));
+    for (int key : order)
+        Try_IX(bulkLoader.AddEntry(&key, RID(key / 100, key % 100)));
+    Try_IX(bulkLoader.Finish());
+    printf("IX_BulkLoader:          %8.1f ns/key\n", NanosPerOp(start, keys));
+    Try_IX(ixm.CloseIndex(bulkHandle));
+    Try_IX(ixm.DestroyIndex(IX_BENCH_FILE, 1));
+
+    // 3) Look up
+    long long found = 0;
+    printf("EQ lookup:              %8.1f ns/key\n", TimeLookups(indexHandle, order, found));
+    IX_IndexScan indexScan;
+    RID rid;
+
+    int bound = keys / 10;
+    long long scanned = 0;
+    start = chrono::steady_clock::now();
+    Try_IX(indexScan.OpenScan(indexHandle, LT_OP, &bound));
+    for (RC rc; (rc = indexScan.GetNextEntry(rid)) != IX_EOF; ++scanned)
+        Try_IX(rc);
+    Try_IX(indexScan.CloseScan());
+    printf("LT range scan:          %8.1f ns/entry\n", NanosPerOp(start, scanned));
+
+    // 4) Duplicate keys
+    int distinct = max(keys / 1000, 1);
+    IX_IndexHandle dupHandle;
+    ixm.DestroyIndex(IX_BENCH_FILE, 2);
+    Try_IX(ixm.CreateIndex(IX_BENCH_FILE, 2, INT, sizeof(int)));
+    Try_IX(ixm.OpenIndex(IX_BENCH_FILE, 2, dupHandle));
+    Try_IX(bulkLoader.Open(dupHandle));
+    for (int key : order)
+    {
+        int dupKey = key % distinct;
+        Try_IX(bulkLoader.AddEntry(&dupKey, RID(key / 100, key % 100)));
+    }
+    Try_IX(bulkLoader.Finish());
+    printf("\nPages, unique keys:     %8lld\n", indexHandle.header.pageTot);
+    printf("Pages, %6d keys:     %8lld\n", distinct, dupHandle.header.pageTot);
+
+    vector<int> dupKeys(distinct);
+    for (int key = 0; key < distinct; ++key)
+        dupKeys[key] = key;
+    long long dupFound = 0;
+    start = chrono::steady_clock::now();
+    TimeLookups(dupHandle, dupKeys, dupFound);
+    printf("EQ scan of duplicates:  %8.1f ns/RID\n", NanosPerOp(start, dupFound));
+    Try_IX(ixm.CloseIndex(dupHandle));
+    Try_IX(ixm.DestroyIndex(IX_BENCH_FILE, 2));
+
+    // A few RIDs per key, kept in the leaves
+    Try_IX(ixm.CreateIndex(IX_BENCH_FILE, 2, INT, sizeof(int)));
+    Try_IX(ixm.OpenIndex(IX_BENCH_FILE, 2, dupHandle));
+    Try_IX(bulkLoader.Open(dupHandle));
+    for (int key : order)
+    {
+        int dupKey = key / 4;
+        Try_IX(bulkLoader.AddEntry(&dupKey, RID(key / 100, key % 100)));
+    }
+    Try_IX(bulkLoader.Finish());
+    printf("Pages, %6d keys:     %8lld\n", (keys + 3) / 4, dupHandle.header.pageTot);
+    long long fewScanned = 0;
+    start = chrono::steady_clock::now();
+    Try_IX(indexScan.OpenScan(dupHandle, NO_OP, nullptr));
+    for (RC rc; (rc = indexScan.GetNextEntry(rid)) != IX_EOF; ++fewScanned)
+        Try_IX(rc);
+    Try_IX(indexScan.CloseScan());
+    printf("Full scan, 4 RIDs/key:  %8.1f ns/RID\n", NanosPerOp(start, fewScanned));
+    Try_IX(ixm.CloseIndex(dupHandle));
+    Try_IX(ixm.DestroyIndex(IX_BENCH_FILE, 2));
+
+    // 5) Deletes
+    vector<int> kept;
+    start = chrono::steady_clock::now();
+    for (int key : order)
+        if (key % 10 != 0)
+            Try_IX(indexHandle.DeleteEntry(&key, RID(key / 100, key % 100)));
+        else
+            kept.push_back(key);
+    printf("\nDeleteEntry:            %8.1f ns/key\n", NanosPerOp(start, keys - kept.size()));
+    long long keptFound = 0;
+    printf("EQ lookup after:        %8.1f ns/key\n", TimeLookups(indexHandle, kept, keptFound));
+    start = chrono::steady_clock::now();
+    Try_IX(indexHandle.Compact());
+    printf("Compact:                %8.1f ns/key\n", NanosPerOp(start, kept.size()));
+    printf("EQ lookup compacted:    %8.1f ns/key\n", TimeLookups(indexHandle, kept, keptFound));
+
+    // 6) Clean up
+    Try_IX(ixm.CloseIndex(indexHandle));
+    Try_IX(ixm.DestroyIndex(IX_BENCH_FILE, 0));
+    if (found != keys || scanned != bound || dupFound != keys || fewScanned != keys || keptFound != 2 * (long long)kept.size())
+    {
+        fprintf(stderr, "Found %lld of %d keys, scanned %lld of %d, found %lld and %lld of %d duplicates, %lld of %d kept\n",
+                found, keys, scanned, bound, dupFound, fewScanned, keys, keptFound, 2 * (int)kept.size());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,356 @@
+//
+// File:        ix_bulkload.cc
+// Description: IX_BulkLoader class implementation
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include "ix_internal.h"
+#include "ix.h"
+using namespace std;
+
+// The RID of an entry, stored unaligned after its key as (page, slot)
+static inline RID EntryRID(const char *entry, int attrLength)
+{
+    PageNum pageNum;
+    SlotNum slotNum;
+    memcpy(&pageNum, entry + attrLength, sizeof(PageNum));
+    memcpy(&slotNum, entry + attrLength + sizeof(PageNum), sizeof(SlotNum));
+    return RID(pageNum, slotNum);
+}
+
+// Constructor
+IX_BulkLoader::IX_BulkLoader() : open(false), indexHandle(nullptr), leafPageNum(0), leafData(nullptr) {}
+
+// Destructor
+IX_BulkLoader::~IX_BulkLoader()
+{
+    CloseRuns();
+}
+
+RC IX_BulkLoader::Open(IX_IndexHandle &indexHandle, int fillFactor)
+{
+    try
+    {
+        if (!indexHandle.open)
+            throw RC{IX_HANDLE_CLOSED};
+        if (fillFactor <= 0 || fillFactor > 100)
+            throw RC{IX_BULK_FAIL};
+
+        // The index must be new, i.e. its root is a leaf without entries
+        IX_IndexHeader &header = indexHandle.header;
+        PF_PageHandle rootPageHandle;
+        char *rootData;
+        IX_Try(indexHandle.pFFileHandle.GetThisPage(header.rootPage, rootPageHandle), IX_BULK_FAIL);
+        IX_TryElseUnpin(rootPageHandle.GetData(rootData), IX_BULK_FAIL_UNPIN_FAIL, IX_BULK_FAIL, indexHandle.pFFileHandle, header.rootPage);
+        bool empty = *(bool *)rootData && *(int *)(rootData + sizeof(bool)) == 0;
+        IX_Try(indexHandle.pFFileHandle.UnpinPage(header.rootPage), IX_BULK_FAIL_UNPIN_FAIL);
+        if (!empty)
+            throw RC{IX_BULK_NOT_EMPTY};
+
+        this->indexHandle = &indexHandle;
+        entryLength = header.attrLength + sizeof(PageNum) + sizeof(SlotNum);
+        // At least two entries in a node, or the levels would never narrow down
+        leafCap = max(2, min(header.leafDeg, header.leafDeg * fillFactor / 100));
+        innerCap = max(2, min(header.innerDeg, header.innerDeg * fillFactor / 100));
+
+        CloseRuns();
+        entries.clear();
+        level.clear();
+        leafPageNum = 0;
+        open = true;
+    }
+    catch (RC rc)
+    {
+        return rc;
+    }
+    return OK_RC;
+}
+
+RC IX_BulkLoader::AddEntry(const void *pData, const RID &rid)
+{
+    try
+    {
+        if (!open)
+            throw RC{IX_HANDLE_CLOSED};
+
+        if (entries.size() + entryLength > IX_BULK_RUN_BYTES)
+            SpillRun();
+
+        int attrLength = indexHandle->header.attrLength;
+        size_t end = entries.size();
+        entries.resize(end + entryLength);
+        memcpy(&entries[end], pData, attrLength);
+        memcpy(&entries[end + attrLength], &rid.pageNum, sizeof(PageNum));
+        memcpy(&entries[end + attrLength + sizeof(PageNum)], &rid.slotNum, sizeof(SlotNum));
+    }
+    catch (RC rc)
+    {
+        return rc;
+    }
+    return OK_RC;
+}
+
+RC IX_BulkLoader::AddPosting(const void *pData, const IX_Posting &posting)
+{
+    try
+    {
+        if (!open)
+            throw RC{IX_HANDLE_CLOSED};
+        PackKey((const char *)pData, posting);
+    }
+    catch (RC rc)
+    {
+        return rc;
+    }
+    return OK_RC;
+}
+
+//
+// Finish
+//
+/* Steps:
+    1) If nothing is spilled, sort the entries in memory and pack them;
+       otherwise spill the rest too, and pack the runs merged by a heap
+    2) Unpin the last leaf
+    3) Pack the inner levels and set the root
+*/
+RC IX_BulkLoader::Finish()
+{
+    try
+    {
+        if (!open)
+            throw RC{IX_HANDLE_CLOSED};
+        open = false;
+
+        // 1) Sort and pack the leaves
+        if (runs.empty())
+        {
+            vector<const char *> sorted;
+            SortEntries(sorted);
+            for (const char *entry : sorted)
+                PackEntry(entry);
+        }
+        else
+        {
+            if (!entries.empty())
+                SpillRun();
+
+            // The heads of the runs, the least on the top
+            vector<vector<char>> heads(runs.size(), vector<char>(entryLength));
+            auto after = [this, &heads](size_t a, size_t b) {
+                return Less(heads[b].data(), heads[a].data());
+            };
+            priority_queue<size_t, vector<size_t>, decltype(after)> queue(after);
+            for (size_t i = 0; i < runs.size(); ++i)
+                if (fread(heads[i].data(), entryLength, 1, runs[i]) == 1)
+                    queue.push(i);
+
+            while (!queue.empty())
+            {
+                size_t i = queue.top();
+                queue.pop();
+                PackEntry(heads[i].data());
+                if (fread(heads[i].data(), entryLength, 1, runs[i]) == 1)
+                    queue.push(i);
+                else if (ferror(runs[i]))
+                    throw RC{IX_UNIX};
+            }
+        }
+        vector<char>().swap(entries);
+        CloseRuns();
+
+        // 2) The last leaf has no next one
+        if (leafPageNum != 0)
+        {
+            PageNum pageNum = leafPageNum;
+            leafPageNum = 0;
+            IX_Try(indexHandle->pFFileHandle.UnpinPage(pageNum), IX_BULK_FAIL_UNPIN_FAIL);
+        }
+
+        // 3) Inner levels
+        PackInnerLevels();
+    }
+    catch (RC rc)
+    {
+        if (leafPageNum != 0)
+        {
+            indexHandle->pFFileHandle.UnpinPage(leafPageNum);
+            leafPageNum = 0;
+        }
+        vector<char>().swap(entries);
+        CloseRuns();
+        return rc;
+    }
+    return OK_RC;
+}
+
+// The order of entries, by their keys, and then by their RIDs,
+// so that the RIDs of a key are appended to its posting list in order
+bool IX_BulkLoader::Less(const char *a, const char *b) const
+{
+    int c = indexHandle->cmp(a, b);
+    if (c != 0)
+        return c < 0;
+    RID ridA = EntryRID(a, indexHandle->header.attrLength);
+    RID ridB = EntryRID(b, indexHandle->header.attrLength);
+    return ridA.pageNum != ridB.pageNum ? ridA.pageNum < ridB.pageNum : ridA.slotNum < ridB.slotNum;
+}
+
+// Sort the entries in memory
+void IX_BulkLoader::SortEntries(vector<const char *> &sorted)
+{
+    sorted.clear();
+    sorted.reserve(entries.size() / entryLength);
+    for (size_t i = 0; i < entries.size(); i += entryLength)
+        sorted.push_back(&entries[i]);
+    sort(sorted.begin(), sorted.end(), [this](const char *a, const char *b) {
+        return Less(a, b);
+    });
+}
+
+// Sort the entries in memory and write them to a temporary file as a run
+void IX_BulkLoader::SpillRun()
+{
+    vector<const char *> sorted;
+    SortEntries(sorted);
+
+    FILE *run = tmpfile();
+    if (run == NULL)
+        throw RC{IX_UNIX};
+    runs.push_back(run);
+    for (const char *entry : sorted)
+        if (fwrite(entry, entryLength, 1, run) != 1)
+            throw RC{IX_UNIX};
+    if (fflush(run) != 0)
+        throw RC{IX_UNIX};
+    rewind(run);
+
+    entries.clear();
+}
+
+void IX_BulkLoader::CloseRuns()
+{
+    for (FILE *run : runs)
+        fclose(run);
+    runs.clear();
+}
+
+// Allocate a node and pin it, and return its page number.
+// The first leaf takes the place of the empty root.
+PageNum IX_BulkLoader::NewNode(bool isLeaf, char *&nodeData)
+{
+    PF_FileHandle &file = indexHandle->pFFileHandle;
+    IX_IndexHeader &header = indexHandle->header;
+    PF_PageHandle pageHandle;
+    PageNum pageNum;
+    if (isLeaf && level.empty())
+    {
+        IX_Try(file.GetThisPage(header.rootPage, pageHandle), IX_BULK_FAIL);
+        pageHandle.GetPageNum(pageNum);
+    }
+    else
+        pageNum = indexHandle->AllocatePage(pageHandle, IX_BULK_FAIL);
+    IX_TryElseUnpin(file.MarkDirty(pageNum), IX_BULK_FAIL_UNPIN_FAIL, IX_BULK_FAIL, file, pageNum);
+    IX_TryElseUnpin(pageHandle.GetData(nodeData), IX_BULK_FAIL_UNPIN_FAIL, IX_BULK_FAIL, file, pageNum);
+
+    *(bool *)nodeData = isLeaf;
+    *(int *)(nodeData + sizeof(bool)) = 0;
+    if (isLeaf)
+        IX_PrevLeaf(nodeData) = IX_NextLeaf(nodeData) = 0;
+    return pageNum;
+}
+
+// Add the RID of the next entry in order to the posting list of its key
+// if the key is packed already, and otherwise pack the key with it
+void IX_BulkLoader::PackEntry(const char *entry)
+{
+    IX_IndexHeader &header = indexHandle->header;
+    RID rid = EntryRID(entry, header.attrLength);
+
+    int childTot = leafPageNum != 0 ? *(int *)(leafData + sizeof(bool)) : 0;
+    if (childTot > 0)
+    {
+        char *last = leafData + sizeof(bool) + sizeof(int) + (childTot - 1) * header.leafEntryLength;
+        if (indexHandle->cmp(entry, last) == 0)
+        {
+            // As InsertEntry, refuse a RID added before
+            if (!indexHandle->Posting_Insert(*(IX_Posting *)(last + header.attrLength), rid))
+                throw RC{IX_HANDLE_INSERT_EXISTS};
+            return;
+        }
+    }
+    IX_Posting posting;
+    indexHandle->Posting_Insert(posting, rid);
+    PackKey(entry, posting);
+}
+
+// Append the next key in order to the pinned leaf, or to a new one linked
+// after it once it is full, whose first key goes to the level above
+void IX_BulkLoader::PackKey(const char *pData, const IX_Posting &posting)
+{
+    IX_IndexHeader &header = indexHandle->header;
+    int childTot = leafPageNum != 0 ? *(int *)(leafData + sizeof(bool)) : 0;
+    if (leafPageNum == 0 || childTot == leafCap)
+    {
+        char *nextData;
+        PageNum nextPageNum = NewNode(true, nextData);
+        PageNum prevPageNum = leafPageNum;
+        IX_PrevLeaf(nextData) = prevPageNum;
+        if (prevPageNum != 0)
+            IX_NextLeaf(leafData) = nextPageNum;
+        leafPageNum = nextPageNum;
+        leafData = nextData;
+        childTot = 0;
+        if (prevPageNum != 0)
+            IX_Try(indexHandle->pFFileHandle.UnpinPage(prevPageNum), IX_BULK_FAIL_UNPIN_FAIL);
+
+        size_t end = level.size();
+        level.resize(end + header.innerEntryLength);
+        memcpy(&level[end], pData, header.attrLength);
+        memcpy(&level[end + header.attrLength], &nextPageNum, sizeof(PageNum));
+    }
+
+    char *leafEntry = leafData + sizeof(bool) + sizeof(int) + childTot * header.leafEntryLength;
+    memcpy(leafEntry, pData, header.attrLength);
+    *(IX_Posting *)(leafEntry + header.attrLength) = posting;
+    *(int *)(leafData + sizeof(bool)) = childTot + 1;
+}
+
+// Pack the (first key, page) entries of a level into the nodes of the level above,
+// until a single node is left, which is the root
+void IX_BulkLoader::PackInnerLevels()
+{
+    IX_IndexHeader &header = indexHandle->header;
+    int innerEntryLength = header.innerEntryLength;
+    if (level.empty())
+        return; // Nothing is added, so the empty root is kept
+
+    while (level.size() > (size_t)innerEntryLength)
+    {
+        vector<char> upper;
+        int levelTot = level.size() / innerEntryLength;
+        for (int first = 0; first < levelTot; first += innerCap)
+        {
+            int childTot = min(innerCap, levelTot - first);
+            char *nodeData;
+            PageNum nodePageNum = NewNode(false, nodeData);
+            *(int *)(nodeData + sizeof(bool)) = childTot;
+            memcpy(nodeData + sizeof(bool) + sizeof(int), &level[(size_t)first * innerEntryLength], (size_t)childTot * innerEntryLength);
+
+            size_t end = upper.size();
+            upper.resize(end + innerEntryLength);
+            memcpy(&upper[end], nodeData + sizeof(bool) + sizeof(int), header.attrLength);
+            memcpy(&upper[end + header.attrLength], &nodePageNum, sizeof(PageNum));
+            IX_Try(indexHandle->pFFileHandle.UnpinPage(nodePageNum), IX_BULK_FAIL_UNPIN_FAIL);
+        }
+        level.swap(upper);
+    }
+
+    memcpy(&header.rootPage, &level[header.attrLength], sizeof(PageNum));
+    header.modified = true;
+    level.clear();
+}
@@ -35,6 +35,11 @@ static char *IX_WarnMsg[] = {
     (char *)"Failed to split an inner node of the B+ tree.", // IX_HANDLE_INNER_SPLIT_FAIL (START_IX_WARN + 16)
     (char *)"Failed to create a new root.",                  // IX_HANDLE_INNER_NEW_ROOT_FAIL (START_IX_WARN + 17)
     (char *)"Failed to delete some entry.",                  // IX_HANDLE_DELETE_FAIL
+    (char *)"Bulk loading an index which is not empty.",     // IX_BULK_NOT_EMPTY (START_IX_WARN + 19)
+    (char *)"Failed to bulk load an index.",                 // IX_BULK_FAIL (START_IX_WARN + 20)
+    (char *)"Failed to read or write a bucket of RIDs.",     // IX_BUCKET_FAIL (START_IX_WARN + 21)
+    (char *)"Failed to rebalance the nodes after a delete.", // IX_HANDLE_REBALANCE_FAIL (START_IX_WARN + 22)
+    (char *)"Failed to compact an index.",                   // IX_COMPACT_FAIL (START_IX_WARN + 23)
 };
 
 static char *IX_ErrorMsg[] = {
@@ -82,7 +87,10 @@ static char *IX_ErrorMsg[] = {
     (char *)"Create a new root when inserting some entry to an inner node, but fail to unpin the root node.", // IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_ROOT_FAIL (START_IX_ERR - 40)
     (char *)"A new root is created from a leaf root, but failed to unpin the right page.",                    // IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL (START_IX_ERR - 41)
     (char *)"A new root is created from an inner root, but failed to unpin the right page.",                  // IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL (START_IX_ERR - 42)
-    (char *)"Error in Unix system call or library routine.",                                                  // IX_UNIX (START_IX_ERR - 43)
+    (char *)"Failed to bulk load an index, and also failed to unpin.",                                        // IX_BULK_FAIL_UNPIN_FAIL (START_IX_ERR - 43)
+    (char *)"Failed to rebalance the nodes after a delete, and also failed to unpin.",                        // IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL (START_IX_ERR - 44)
+    (char *)"Failed to compact an index, and also failed to unpin.",                                          // IX_COMPACT_FAIL_UNPIN_FAIL (START_IX_ERR - 45)
+    (char *)"Error in Unix system call or library routine.",                                                  // IX_UNIX (START_IX_ERR - 46)
 };
 
 //
@@ -30,12 +30,9 @@ RC IX_IndexHandle::InsertEntry(const void *pData, const RID &rid)
         printf(" =====\n");
 #endif
 
-        if (BPlus_Exists(header.rootPage, pData, rid))
-            throw RC{IX_HANDLE_INSERT_EXISTS};
-        else
-        {
-            BPlus_Insert(header.rootPage, pData, rid);
-        }
+        // An existing key gets [rid] added to its RIDs,
+        // and IX_HANDLE_INSERT_EXISTS is thrown if it's there
+        BPlus_Insert(header.rootPage, pData, rid);
     }
     catch (RC rc)
     {
@@ -58,10 +55,12 @@ RC IX_IndexHandle::DeleteEntry(const void *pData, const RID &rid)
         printf(" =====\n");
 #endif
 
-        // It's not necessary that check if [BPlus_Exists],
-        // since the [BPlus_Delete] is almost the same as [BPlus_Exists].
-        if (!BPlus_Delete(header.rootPage, pData, rid))
+        bool underflow;
+        if (!BPlus_Delete(header.rootPage, pData, rid, underflow))
             throw RC{IX_HANDLE_DELETE_NOT_EXIST};
+        // The root may be left with a single child
+        if (underflow)
+            BPlus_CollapseRoot();
     }
     catch (RC rc)
     {
@@ -70,16 +69,87 @@ RC IX_IndexHandle::DeleteEntry(const void *pData, const RID &rid)
     return OK_RC;
 }
 
-RC IX_IndexHandle::ForcePages()
+//
+// Compact
+//
+// Desc: Rebuild the nodes from the keys in order, so that they're filled to
+//       [fillFactor] percent, and the keys without RIDs are dropped
+//
+// Note: The buckets of RIDs are kept as they are, and the disposed nodes are
+//       reused by the new ones, so the file doesn't grow.
+/* Steps:
+    1) Walk the tree depth first, copying the keys with RIDs of the leaves in order
+    2) Dispose of the nodes but the root, which becomes an empty leaf
+    3) Pack the keys into new nodes by IX_BulkLoader
+*/
+RC IX_IndexHandle::Compact(int fillFactor)
 {
     try
     {
         if (!open)
             throw RC{IX_HANDLE_CLOSED};
+        if (fillFactor <= 0 || fillFactor > 100)
+            throw RC{IX_COMPACT_FAIL};
 
-        IX_Try(pFFileHandle.ForcePages(), IX_HANDLE_FORCE_FAIL);
+        // 1) Collect the keys
+        vector<char> keys;
+        vector<PageNum> nodes, stack(1, header.rootPage);
+        while (!stack.empty())
+        {
+            PageNum nodePageNum = stack.back();
+            stack.pop_back();
+            nodes.push_back(nodePageNum);
+
+            PF_PageHandle nodePageHandle;
+            char *nodePageData;
+            IX_Try(pFFileHandle.GetThisPage(nodePageNum, nodePageHandle), IX_COMPACT_FAIL);
+            IX_TryElseUnpin(nodePageHandle.GetData(nodePageData), IX_COMPACT_FAIL_UNPIN_FAIL, IX_COMPACT_FAIL, pFFileHandle, nodePageNum);
+            int childTot = *(int *)(nodePageData + sizeof(bool));
+            char *entries = nodePageData + sizeof(bool) + sizeof(int);
+            if (*(bool *)nodePageData)
+            {
+                for (int i = 0; i < childTot; ++i)
+                {
+                    char *entry = entries + i * header.leafEntryLength;
+                    if (((IX_Posting *)(entry + header.attrLength))->count > 0)
+                        keys.insert(keys.end(), entry, entry + header.leafEntryLength);
+                }
+            }
+            else
+            { // The first child is visited first
+                for (int i = childTot - 1; i >= 0; --i)
+                    stack.push_back(*(PageNum *)(entries + i * header.innerEntryLength + header.attrLength));
+            }
+            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_COMPACT_FAIL_UNPIN_FAIL);
+        }
 
-        throw RC{OK_RC};
+        // 2) Dispose of the nodes
+        for (PageNum nodePageNum : nodes)
+            if (nodePageNum != header.rootPage)
+                IX_Try(pFFileHandle.DisposePage(nodePageNum), IX_COMPACT_FAIL);
+        PF_PageHandle rootPageHandle;
+        char *rootPageData;
+        IX_Try(pFFileHandle.GetThisPage(header.rootPage, rootPageHandle), IX_COMPACT_FAIL);
+        IX_TryElseUnpin(pFFileHandle.MarkDirty(header.rootPage), IX_COMPACT_FAIL_UNPIN_FAIL, IX_COMPACT_FAIL, pFFileHandle, header.rootPage);
+        IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_COMPACT_FAIL_UNPIN_FAIL, IX_COMPACT_FAIL, pFFileHandle, header.rootPage);
+        *(bool *)rootPageData = true;
+        *(int *)(rootPageData + sizeof(bool)) = 0;
+        IX_PrevLeaf(rootPageData) = IX_NextLeaf(rootPageData) = 0;
+        IX_Try(pFFileHandle.UnpinPage(header.rootPage), IX_COMPACT_FAIL_UNPIN_FAIL);
+
+        // 3) Pack the keys
+        IX_BulkLoader bulkLoader;
+        RC rc;
+        if ((rc = bulkLoader.Open(*this, fillFactor)))
+            throw rc;
+        for (size_t i = 0; i < keys.size(); i += header.leafEntryLength)
+            if ((rc = bulkLoader.AddPosting(&keys[i], *(IX_Posting *)&keys[i + header.attrLength])))
+            {
+                bulkLoader.Finish();
+                throw rc;
+            }
+        if ((rc = bulkLoader.Finish()))
+            throw rc;
     }
     catch (RC rc)
     {
@@ -88,76 +158,22 @@ RC IX_IndexHandle::ForcePages()
     return OK_RC;
 }
 
-bool IX_IndexHandle::BPlus_Exists(PageNum nodePageNum, const void *pData, const RID &rid)
+RC IX_IndexHandle::ForcePages()
 {
-#ifdef IX_LOG
-    // printf("IX_IndexHandle:: BPlus_Exists(nodePageNum = %lld)\n", nodePageNum);
-#endif
-
-    PF_PageHandle nodePageHandle;
-    char *nodePageData;
-    IX_Try(pFFileHandle.GetThisPage(nodePageNum, nodePageHandle), IX_HANDLE_EXISTS_FAIL);
-    IX_TryElseUnpin(nodePageHandle.GetData(nodePageData), IX_HANDLE_EXISTS_FAIL_UNPIN_FAIL, IX_HANDLE_EXISTS_FAIL, pFFileHandle, nodePageNum);
-
-    bool isLeaf = *(bool *)nodePageData;
-    int childTot = *(int *)(nodePageData + sizeof(bool));
-
-#ifdef IX_LOG
-    // printf("IX_IndexHandle::BPlus_Exsits(nodePageNum = %d) isLeaf = %d, childTot = %d\n", nodePageNum, isLeaf, childTot);
-#endif
-
-    if (!isLeaf)
+    try
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.innerEntryLength)
-        {
-#ifdef IX_LOG
-            // printf("IX_IndexHandle::BPlus_Exsits(nodePageNum = %d) isLeaf = %d, the page number of child %d is %lld\n", nodePageNum, isLeaf, i, *(nodePageData + j + header.attrLength));
-#endif
+        if (!open)
+            throw RC{IX_HANDLE_CLOSED};
 
-            if ((cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.innerEntryLength) < 0)) || (i != childTot - 1 && cmp(pData, nodePageData + j) == 0 && cmp(pData, nodePageData + j + header.innerEntryLength) == 0))
-            { // Regular condition: [, )
-                if (BPlus_Exists(*(PageNum *)(nodePageData + j + header.attrLength), pData, rid))
-                {
-                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INNER_EXISTS_BUT_UNPIN_FAIL);
-                    return true;
-                }
-            }
-        }
+        IX_Try(pFFileHandle.ForcePages(), IX_HANDLE_FORCE_FAIL);
     }
-    else
+    catch (RC rc)
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.leafEntryLength)
-        {
-            // For leaf, there's no segment more.
-            // Keys stored in the node are the exact keys.
-            if (cmp(pData, nodePageData + j) == 0 && ((RID *)(nodePageData + j + header.attrLength))->viable)
-            {
-                // if (header.attrType == STRING)
-                // {
-                //     printf("Find existing: ");
-                //     for (int i = 0; i < header.attrLength; ++i)
-                //         putchar(*((char *)pData + i));
-                //     printf(": STRING[%d]\n", header.attrLength);
-                // }
-
-                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_LEAF_EXISTS_BUT_UNPIN_FAIL);
-                return true;
-            }
-        }
+        return rc;
     }
-
-#ifdef IX_LOG
-    // printf("IX_IndexHandle::BPlus_Exists: does not exist!\n");
-#endif
-
-    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL);
-    return false;
+    return OK_RC;
 }
 
-//
-// Desc: Insert a (pData, rid) into the B+ tree.
-// Note: If there have existed some keys equal to the inserted key,
-// this one will inserted in some arbitrary place of them.
 const pair<const void *, PageNum> IX_IndexHandle::BPlus_Insert(PageNum nodePageNum, const void *pData, const RID &rid)
 {
     // printf("BPlus_Insert(nodePageNum = %lld)\n", nodePageNum);
@@ -174,183 +190,202 @@ const pair<const void *, PageNum> IX_IndexHandle::BPlus_Insert(PageNum nodePageN
     {
         // printf("Insert: Leaf node.\n");
 
-        for (int i = -1, j = sizeof(bool) + sizeof(int) - header.leafEntryLength; i < childTot; ++i, j += header.leafEntryLength)
-        {
-            // if (header.attrType == STRING && i >= 0 && i < childTot)
-            // {
-            //     printf("cmp(pData, %d) = %d\n", i, cmp(pData, nodePageData + j));
-            //     printf("The condition = %d, [i == childTot - 1] = %d\n", (int)((cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.innerEntryLength) < 0))), (int)(i == childTot - 1));
-            // }
-
-            if (childTot == 0 || (i == -1 && cmp(pData, nodePageData + j + header.leafEntryLength) < 0) || (i >= 0 && cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.leafEntryLength) < 0)))
+        // Find the key, or where to insert it
+        int i = Search(nodePageData, pData, false);
+        int j = sizeof(bool) + sizeof(int) + i * header.leafEntryLength;
+        if (i < childTot && cmp(pData, nodePageData + j) == 0)
+        { // The key is there, so add [rid] to its RIDs
+            bool inserted;
+            try
+            {
+                inserted = Posting_Insert(*(IX_Posting *)(nodePageData + j + header.attrLength), rid);
+            }
+            catch (RC rc)
             {
-                // printf("Find a place to insert.\n");
+                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_FAIL_UNPIN_FAIL);
+                throw;
+            }
+            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_JUST_INSERT_BUT_UNPIN_FAIL);
+            if (!inserted)
+                throw RC{IX_HANDLE_INSERT_EXISTS};
+            return make_pair(nullptr, -1);
+        }
+        // The RIDs of the new key, in a bucket only if [rid] doesn't fit in the entry
+        IX_Posting posting;
+        try
+        {
+            Posting_Insert(posting, rid);
+        }
+        catch (RC rc)
+        {
+            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_FAIL_UNPIN_FAIL);
+            throw;
+        }
+        // Now, the correct position has been found!
+        if (childTot + 1 <= header.leafDeg)
+        { // There's some empty room remaining, just insert it!
+            // ++childTot
+            ++*(int *)(nodePageData + sizeof(bool));
 
-                ++i, j += header.leafEntryLength;
-                // Now, the correct position has been found!
-                if (childTot + 1 <= header.leafDeg)
-                { // There's some empty room remaining, just insert it!
-                    // ++childTot
-                    ++*(int *)(nodePageData + sizeof(bool));
+            // Move the right ones by one unit
+            memmove(nodePageData + j + header.leafEntryLength, nodePageData + j, header.leafEntryLength * (childTot - i));
 
-                    // Move the right ones by one unit
-                    memmove(nodePageData + j + header.leafEntryLength, nodePageData + j, header.leafEntryLength * (childTot - i));
+            // Copy the inserting information
+            memcpy(nodePageData + j, pData, header.attrLength);
+            *(IX_Posting *)(nodePageData + j + header.attrLength) = posting;
 
-                    // Copy the inserting information
-                    memcpy(nodePageData + j, pData, header.attrLength);
-                    *(RID *)(nodePageData + j + header.attrLength) = rid;
-
-                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_JUST_INSERT_BUT_UNPIN_FAIL);
-                    return make_pair(nullptr, -1);
-                }
-                else
-                {   // No more room! A split is going on!
-                    // Create a new node as the right one: [0, (leafDeg + 1) / 2)
-                    // The original node will be the left one: [(leafDeg + 1) / 2, leafDeg + 1)
+            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_JUST_INSERT_BUT_UNPIN_FAIL);
+            return make_pair(nullptr, -1);
+        }
+        else
+        {   // No more room! A split is going on!
+            // Create a new node as the right one: [0, (leafDeg + 1) / 2)
+            // The original node will be the left one: [(leafDeg + 1) / 2, leafDeg + 1)
 
 #ifdef IX_LOG
-                    printf("A split of a CHILD starts!\n");
-                    printf("The data will be inserted at %d\n", i);
+            printf("A split of a CHILD starts!\n");
+            printf("The data will be inserted at %d\n", i);
 #endif
 
-                    // Allocate a new page
-                    PF_PageHandle rightPageHandle;
-                    char *rightPageData;
-                    PageNum rightPageNum = header.pageTot;
-                    // Since we never deallocate a page, the pagenum will be allocated sequentially here.
-                    IX_Try(pFFileHandle.AllocatePage(rightPageHandle), IX_HANDLE_LEAF_SPLIT_FAIL);
-                    ++header.pageTot;
-                    IX_TryElseUnpin(rightPageHandle.GetData(rightPageData), IX_HANDLE_LEAF_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_SPLIT_FAIL, pFFileHandle, rightPageNum);
-                    header.modified = true;
+            // Allocate a new page
+            PF_PageHandle rightPageHandle;
+            char *rightPageData;
+            PageNum rightPageNum = AllocatePage(rightPageHandle, IX_HANDLE_LEAF_SPLIT_FAIL);
+            IX_TryElseUnpin(rightPageHandle.GetData(rightPageData), IX_HANDLE_LEAF_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_SPLIT_FAIL, pFFileHandle, rightPageNum);
 
-                    PageNum correctRightPageNum;
-                    rightPageHandle.GetPageNum(correctRightPageNum);
+            // printf("Write data to the right page.\n");
 
-                    // printf("Guessed rightPageNum = %lld, correct rightPageNum = %lld\n", rightPageNum, correctRightPageNum);
+            // Write the right data to the new page
+            *(bool *)rightPageData = true;
+            *(int *)(rightPageData + sizeof(bool)) = (header.leafDeg + 1) - (header.leafDeg + 1) / 2;
+            if (i >= (header.leafDeg + 1) / 2)
+            { // The inserted entry located in the right page
+                // printf("Right page is inserted.\n");
 
-                    // printf("Write data to the right page.\n");
+                // Copy entries before the inserted entry
 
-                    // Write the right data to the new page
-                    *(bool *)rightPageData = true;
-                    *(int *)(rightPageData + sizeof(bool)) = (header.leafDeg + 1) - (header.leafDeg + 1) / 2;
-                    if (i >= (header.leafDeg + 1) / 2)
-                    { // The inserted entry located in the right page
-                        // printf("Right page is inserted.\n");
+                // printf("Copy the entry before.\n");
 
-                        // Copy entries before the inserted entry
+                memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + (header.leafDeg + 1) / 2 * header.leafEntryLength, (i - (header.leafDeg + 1) / 2) * header.leafEntryLength);
 
-                        // printf("Copy the entry before.\n");
+                // printf("Copy the inserted one.\n");
 
-                        memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + (header.leafDeg + 1) / 2 * header.leafEntryLength, (i - (header.leafDeg + 1) / 2) * header.leafEntryLength);
+                int j1 = sizeof(bool) + sizeof(int) + (i - (header.leafDeg + 1) / 2) * header.leafEntryLength; // The [j] in the right page
 
-                        // printf("Copy the inserted one.\n");
+                // printf("Insert key.\n");
 
-                        int j1 = sizeof(bool) + sizeof(int) + (i - (header.leafDeg + 1) / 2) * header.leafEntryLength; // The [j] in the right page
+                memcpy(rightPageData + j1, pData, header.attrLength);
 
-                        // printf("Insert key.\n");
+                // printf("Insert RID at (rightPageData + %d).\n", j1 + header.attrLength);
 
-                        memcpy(rightPageData + j1, pData, header.attrLength);
+                *(IX_Posting *)(rightPageData + j1 + header.attrLength) = posting;
 
-                        // printf("Insert RID at (rightPageData + %d).\n", j1 + header.attrLength);
+                // printf("Copy the entry after.\n");
 
-                        *(RID *)(rightPageData + j1 + header.attrLength) = rid;
+                // Copy entries after the inserted entry
+                memcpy(rightPageData + j1 + header.leafEntryLength, nodePageData + j, (childTot - i) * header.leafEntryLength);
+            }
+            else
+            { // The inserted entry located in the left page
+                // printf("Right page is not inserted.\n");
 
-                        // printf("Copy the entry after.\n");
+                memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + ((header.leafDeg + 1) / 2 - 1) * header.leafEntryLength, (header.leafDeg + 1 - (header.leafDeg + 1) / 2) * header.leafEntryLength);
+            }
 
-                        // Copy entries after the inserted entry
-                        memcpy(rightPageData + j1 + header.leafEntryLength, nodePageData + j, (childTot - i) * header.leafEntryLength);
-                    }
-                    else
-                    { // The inserted entry located in the left page
-                        // printf("Right page is not inserted.\n");
+            // Link the right page in between the original node and its next leaf
+            PageNum nextPageNum = IX_NextLeaf(nodePageData);
+            IX_PrevLeaf(rightPageData) = nodePageNum;
+            IX_NextLeaf(rightPageData) = nextPageNum;
+            IX_NextLeaf(nodePageData) = rightPageNum;
+            if (nextPageNum != 0)
+            {
+                PF_PageHandle nextPageHandle;
+                char *nextPageData;
+                IX_Try(pFFileHandle.GetThisPage(nextPageNum, nextPageHandle), IX_HANDLE_LEAF_SPLIT_FAIL);
+                IX_TryElseUnpin(pFFileHandle.MarkDirty(nextPageNum), IX_HANDLE_LEAF_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_SPLIT_FAIL, pFFileHandle, nextPageNum);
+                IX_TryElseUnpin(nextPageHandle.GetData(nextPageData), IX_HANDLE_LEAF_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_SPLIT_FAIL, pFFileHandle, nextPageNum);
+                IX_PrevLeaf(nextPageData) = rightPageNum;
+                IX_Try(pFFileHandle.UnpinPage(nextPageNum), IX_HANDLE_INSERT_LEAF_SPLIT_BUT_UNPIN_RIGHT_FAIL);
+            }
 
-                        memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + ((header.leafDeg + 1) / 2 - 1) * header.leafEntryLength, (header.leafDeg + 1 - (header.leafDeg + 1) / 2) * header.leafEntryLength);
-                    }
+            // printf("Bye~ My right page~\n");
+
+            // Adjust the data of the original node
+            *(int *)(nodePageData + sizeof(bool)) = (header.leafDeg + 1) / 2;
+            if (i < (header.leafDeg + 1) / 2)
+            { // The inserted entry needs inserting in the left page
+                // Move the right ones by one unit
+                memmove(nodePageData + j + header.leafEntryLength, nodePageData + j, header.leafEntryLength * ((header.leafDeg + 1) / 2 - 1 - i));
+                // Copy the inserting information
+                memcpy(nodePageData + j, pData, header.attrLength);
+                *(IX_Posting *)(nodePageData + j + header.attrLength) = posting;
+            }
+            else
+            { // The inserted entry needs inserting in the right page
+                // Nothing to do
+            }
 
-                    // printf("Bye~ My right page~\n");
-
-                    // Adjust the data of the original node
-                    *(int *)(nodePageData + sizeof(bool)) = (header.leafDeg + 1) / 2;
-                    if (i < (header.leafDeg + 1) / 2)
-                    { // The inserted entry needs inserting in the left page
-                        // Move the right ones by one unit
-                        memmove(nodePageData + j + header.leafEntryLength, nodePageData + j, header.leafEntryLength * ((header.leafDeg + 1) / 2 - 1 - i));
-                        // Copy the inserting information
-                        memcpy(nodePageData + j, pData, header.attrLength);
-                        *(RID *)(nodePageData + j + header.attrLength) = rid;
-                    }
-                    else
-                    { // The inserted entry needs inserting in the right page
-                        // Nothing to do
-                    }
+            // printf("The original node is adjusted.\n");
 
-                    // printf("The original node is adjusted.\n");
+            // printf("Now, header.rootPage = %lld\n", header.rootPage);
+            // printf("nodePageNum = %lld\n ", nodePageNum);
 
-                    // printf("Now, header.rootPage = %lld\n", header.rootPage);
-                    // printf("nodePageNum = %lld\n ", nodePageNum);
+            if (header.rootPage == nodePageNum)
+            { // If this is the root
+                // printf("Create a new root.\n");
 
-                    if (header.rootPage == nodePageNum)
-                    { // If this is the root
-                        // printf("Create a new root.\n");
+                // Create a new root
+                PF_PageHandle rootPageHandle;
+                char *rootPageData;
+                header.rootPage = AllocatePage(rootPageHandle, IX_HANDLE_LEAF_NEW_ROOT_FAIL);
+                IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_HANDLE_LEAF_NEW_ROOT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_NEW_ROOT_FAIL, pFFileHandle, header.rootPage);
+                // [header.modified] is assumed to be set to [true] in the executions above.
 
-                        // Create a new root
-                        PF_PageHandle rootPageHandle;
-                        char *rootPageData;
-                        // Since we never deallocate a page, the pagenum will be allocated sequentially here.
-                        IX_Try(pFFileHandle.AllocatePage(rootPageHandle), IX_HANDLE_LEAF_NEW_ROOT_FAIL);
-                        header.rootPage = header.pageTot;
-                        ++header.pageTot;
-                        IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_HANDLE_LEAF_NEW_ROOT_FAIL_UNPIN_FAIL, IX_HANDLE_LEAF_NEW_ROOT_FAIL, pFFileHandle, header.rootPage);
-                        // [header.modified] is assumed to be set to [true] in the executions above.
+                *(bool *)rootPageData = false;
+                *(int *)(rootPageData + sizeof(bool)) = 2;
 
-                        *(bool *)rootPageData = false;
-                        *(int *)(rootPageData + sizeof(bool)) = 2;
+                memcpy(rootPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int), header.attrLength);
+                *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.attrLength) = nodePageNum;
+                memcpy(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
+                *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength + header.attrLength) = rightPageNum;
 
-                        memcpy(rootPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int), header.attrLength);
-                        *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.attrLength) = nodePageNum;
-                        memcpy(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
-                        *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength + header.attrLength) = rightPageNum;
+                // printf("Unpin the right page %lld.\n", rightPageNum);
 
-                        // printf("Unpin the right page %lld.\n", rightPageNum);
+                IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL);
 
-                        IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL);
+                // printf("Unpin the root page %lld.\n", header.rootPage);
 
-                        // printf("Unpin the root page %lld.\n", header.rootPage);
+                IX_Try(pFFileHandle.UnpinPage(header.rootPage), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_ROOT_FAIL);
 
-                        IX_Try(pFFileHandle.UnpinPage(header.rootPage), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_ROOT_FAIL);
+                // printf("Unpin the node page %lld.\n", nodePageNum);
 
-                        // printf("Unpin the node page %lld.\n", nodePageNum);
+                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_FAIL);
+                return make_pair(nullptr, -1ll);
+            }
+            else
+            {
+                // printf("No new root is needed.\n");
 
-                        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_NEW_ROOT_BUT_UNPIN_FAIL);
-                        return make_pair(nullptr, -1ll);
-                    }
-                    else
-                    {
-                        // printf("No new root is needed.\n");
-
-                        void *key;
-                        switch (header.attrType)
-                        {
-                        case INT:
-                            key = new int(*(int *)(rightPageData + sizeof(bool) + sizeof(int)));
-                        case FLOAT:
-                            key = new double(*(double *)(rightPageData + sizeof(bool) + sizeof(int)));
-                        case STRING:
-                            key = new char[header.attrLength];
-                            memcpy(key, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
-                            break;
-                        case DATE:
-                            key = new char[10];
-                            memcpy(key, rightPageData + sizeof(bool) + sizeof(int), 10);
-                            break;
-                        }
-
-                        IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_LEAF_SPLIT_BUT_UNPIN_RIGHT_FAIL);
-                        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_SPLIT_BUT_UNPIN_FAIL);
-                        return make_pair(key, rightPageNum);
-                    }
+                void *key;
+                switch (header.attrType)
+                {
+                case INT:
+                    key = new int(*(int *)(rightPageData + sizeof(bool) + sizeof(int)));
+                case FLOAT:
+                    key = new double(*(double *)(rightPageData + sizeof(bool) + sizeof(int)));
+                case STRING:
+                    key = new char[header.attrLength];
+                    memcpy(key, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
+                    break;
+                case DATE:
+                    key = new char[10];
+                    memcpy(key, rightPageData + sizeof(bool) + sizeof(int), 10);
+                    break;
                 }
-                break;
+
+                IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_LEAF_SPLIT_BUT_UNPIN_RIGHT_FAIL);
+                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_LEAF_SPLIT_BUT_UNPIN_FAIL);
+                return make_pair(key, rightPageNum);
             }
         }
     }
@@ -359,178 +394,167 @@ const pair<const void *, PageNum> IX_IndexHandle::BPlus_Insert(PageNum nodePageN
         // printf("Insert: Inner node.\n");
 
         // Things here are similar to things above
-        for (int i = -1, j = sizeof(bool) + sizeof(int) - header.innerEntryLength; i < childTot; ++i, j += header.innerEntryLength)
-        {
-            // Find the correct child to insert
-            if ((i == -1 && cmp(pData, nodePageData + j + header.innerEntryLength) < 0) || (i >= 0 && cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.innerEntryLength) < 0)))
-            {
+        // Insert into the last child whose key is not greater than [pData],
+        // or into the first child, whose key becomes [pData]
+        int i = Search(nodePageData, pData, true) - 1;
+        int j = sizeof(bool) + sizeof(int) + i * header.innerEntryLength;
 #ifdef IX_LOG
-                printf("At page %d, insert in child %d (page %d).\n", nodePageNum, i, *(PageNum *)(nodePageData + j + (i == -1 ? header.innerEntryLength : 0) + header.attrLength));
+        printf("At page %d, insert in child %d (page %d).\n", nodePageNum, i, *(PageNum *)(nodePageData + j + (i == -1 ? header.innerEntryLength : 0) + header.attrLength));
 #endif
-                if (i == -1)
-                {
-                    ++i;
-                    j += header.innerEntryLength;
-                    memcpy(nodePageData + j, pData, header.attrLength);
-                }
+        if (i == -1)
+        {
+            ++i;
+            j += header.innerEntryLength;
+            memcpy(nodePageData + j, pData, header.attrLength);
+        }
 
-                pair<const void *, PageNum> insertedChild = BPlus_Insert(*(PageNum *)(nodePageData + j + header.attrLength), pData, rid);
-                if (insertedChild.first != nullptr)
-                { // If the inserted child splits
-                    ++i, j += header.innerEntryLength;
-
-                    const void *pData = insertedChild.first;
-                    PageNum pageNum = insertedChild.second;
-                    if (childTot + 1 <= header.innerDeg)
-                    { // There's some emtpy room
-                        // ++childTot
-                        ++*(int *)(nodePageData + sizeof(bool));
-                        // Move the right ones by one unit
-                        memmove(nodePageData + j + header.innerEntryLength, nodePageData + j, header.innerEntryLength * (childTot - i));
-                        // Copy the inserting information
-                        memcpy(nodePageData + j, pData, header.attrLength);
-                        *(PageNum *)(nodePageData + j + header.attrLength) = pageNum;
-
-                        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_JUST_INSERT_BUT_UNPIN_FAIL);
-                        return make_pair(nullptr, -1);
-                    }
-                    else
-                    { // No more room! A split is going on!
-                        // Create a new node as the right one: [0, (innerDeg + 1) / 2)
-                        // The original node will be left one: [(innerDeg + 1) / 2, innerDeg + 1)
-
-                        // printf("A split starts!\n");
-
-                        // Allocate a new page
-                        PF_PageHandle rightPageHandle;
-                        char *rightPageData;
-                        PageNum rightPageNum = header.pageTot;
-                        // Since we never deallocate a page, the pagenum will be allocated sequentially here.
-                        IX_Try(pFFileHandle.AllocatePage(rightPageHandle), IX_HANDLE_INNER_SPLIT_FAIL);
-                        ++header.pageTot;
-                        IX_TryElseUnpin(rightPageHandle.GetData(rightPageData), IX_HANDLE_INNER_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_INNER_SPLIT_FAIL, pFFileHandle, rightPageNum);
-                        header.modified = true;
+        pair<const void *, PageNum> insertedChild = BPlus_Insert(*(PageNum *)(nodePageData + j + header.attrLength), pData, rid);
+        if (insertedChild.first != nullptr)
+        { // If the inserted child splits
+            ++i, j += header.innerEntryLength;
+
+            const void *pData = insertedChild.first;
+            PageNum pageNum = insertedChild.second;
+            if (childTot + 1 <= header.innerDeg)
+            { // There's some emtpy room
+                // ++childTot
+                ++*(int *)(nodePageData + sizeof(bool));
+                // Move the right ones by one unit
+                memmove(nodePageData + j + header.innerEntryLength, nodePageData + j, header.innerEntryLength * (childTot - i));
+                // Copy the inserting information
+                memcpy(nodePageData + j, pData, header.attrLength);
+                *(PageNum *)(nodePageData + j + header.attrLength) = pageNum;
+
+                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_JUST_INSERT_BUT_UNPIN_FAIL);
+                return make_pair(nullptr, -1);
+            }
+            else
+            { // No more room! A split is going on!
+                // Create a new node as the right one: [0, (innerDeg + 1) / 2)
+                // The original node will be left one: [(innerDeg + 1) / 2, innerDeg + 1)
+
+                // printf("A split starts!\n");
+
+                // Allocate a new page
+                PF_PageHandle rightPageHandle;
+                char *rightPageData;
+                PageNum rightPageNum = AllocatePage(rightPageHandle, IX_HANDLE_INNER_SPLIT_FAIL);
+                IX_TryElseUnpin(rightPageHandle.GetData(rightPageData), IX_HANDLE_INNER_SPLIT_FAIL_UNPIN_FAIL, IX_HANDLE_INNER_SPLIT_FAIL, pFFileHandle, rightPageNum);
 
 #ifdef IX_LOG
-                        printf("Trying to split an inner node %lld.\n", nodePageNum);
-
-                        printf("Before split, the children of %lld are ", nodePageNum);
-                        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.innerEntryLength)
-                        {
-                            printf("%d ", *(nodePageData + j + header.attrLength));
-                        }
-                        puts("");
+                printf("Trying to split an inner node %lld.\n", nodePageNum);
+
+                printf("Before split, the children of %lld are ", nodePageNum);
+                for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.innerEntryLength)
+                {
+                    printf("%d ", *(nodePageData + j + header.attrLength));
+                }
+                puts("");
 #endif
 
-                        // Write the right data to the new page
-                        *(bool *)rightPageData = false;
-                        *(int *)(rightPageData + sizeof(bool)) = (header.innerDeg + 1) - (header.innerDeg + 1) / 2;
-                        if (i >= (header.innerDeg + 1) / 2)
-                        { // The inserted entry located in the right page
+                // Write the right data to the new page
+                *(bool *)rightPageData = false;
+                *(int *)(rightPageData + sizeof(bool)) = (header.innerDeg + 1) - (header.innerDeg + 1) / 2;
+                if (i >= (header.innerDeg + 1) / 2)
+                { // The inserted entry located in the right page
 #ifdef IX_LOG
-                            printf("IX_IndexHandle::BPlus_Insert(nodePageNum = %lld) The inserted entry located in the right page.\n", nodePageNum);
+                    printf("IX_IndexHandle::BPlus_Insert(nodePageNum = %lld) The inserted entry located in the right page.\n", nodePageNum);
 #endif
 
-                            // Copy entries before the inserted entry
-                            memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + (header.innerDeg + 1) / 2 * header.innerEntryLength, (i - (header.innerDeg + 1) / 2) * header.innerEntryLength);
+                    // Copy entries before the inserted entry
+                    memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + (header.innerDeg + 1) / 2 * header.innerEntryLength, (i - (header.innerDeg + 1) / 2) * header.innerEntryLength);
 
-                            int j1 = sizeof(bool) + sizeof(int) + (i - (header.innerDeg + 1) / 2) * header.innerEntryLength; // The [j] in the right page
-                            memcpy(rightPageData + j1, pData, header.attrLength);
-                            *(PageNum *)(rightPageData + j1 + header.attrLength) = pageNum;
+                    int j1 = sizeof(bool) + sizeof(int) + (i - (header.innerDeg + 1) / 2) * header.innerEntryLength; // The [j] in the right page
+                    memcpy(rightPageData + j1, pData, header.attrLength);
+                    *(PageNum *)(rightPageData + j1 + header.attrLength) = pageNum;
 
-                            // Copy entries after the inserted entry
-                            memcpy(rightPageData + j1 + header.innerEntryLength, nodePageData + j, (childTot - i) * header.innerEntryLength);
+                    // Copy entries after the inserted entry
+                    memcpy(rightPageData + j1 + header.innerEntryLength, nodePageData + j, (childTot - i) * header.innerEntryLength);
 
 #ifdef IX_LOG
-                            for (int i = 0, j = sizeof(bool) + sizeof(int); i < (header.innerDeg + 1) - (header.innerDeg + 1) / 2; ++i, j += header.innerEntryLength)
-                            {
-                                printf("IX_IndexHandle::BPlus_Insert(nodePageNum = %d) rightPageNum = %lld, after split, the child %d of page %lld is %d\n", nodePageNum, rightPageNum, i, rightPageNum, *(rightPageData + j + header.attrLength));
-                            }
-#endif
-                        }
-                        else
-                        { // The inserted entry located in the left page
-                            memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + ((header.innerDeg + 1) / 2 - 1) * header.innerEntryLength, (header.innerDeg + 1 - (header.innerDeg + 1) / 2) * header.innerEntryLength);
-                        }
-
-                        // printf("Split an inner node.\n");
-
-                        // Adjust the data of the original node
-                        *(int *)(nodePageData + sizeof(bool)) = (header.innerDeg + 1) / 2;
-                        if (i < (header.innerDeg + 1) / 2)
-                        { // The inserted entry needs inserting in the left page
-                            // Move the right ones by one unit
-                            memmove(nodePageData + j + header.innerEntryLength, nodePageData + j, header.innerEntryLength * ((header.innerDeg + 1) / 2 - 1 - i));
-                            // Copy the inserting information
-                            memcpy(nodePageData + j, pData, header.attrLength);
-                            *(PageNum *)(nodePageData + j + header.attrLength) = pageNum;
-                        }
-                        else
-                        { // The inserted entry needs inserting in the right page
-                            // Nothing to do
-                        }
-
-                        if (header.rootPage == nodePageNum)
-                        { // If this is the root
-                            // Create a new root
-                            PF_PageHandle rootPageHandle;
-                            char *rootPageData;
-                            // Since we never deallocate a page, the pagenum will be allocated sequentially here.
-                            IX_Try(pFFileHandle.AllocatePage(rootPageHandle), IX_HANDLE_INNER_NEW_ROOT_FAIL);
-                            header.rootPage = header.pageTot;
-                            ++header.pageTot;
-                            IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_HANDLE_INNER_NEW_ROOT_FAIL_UNPIN_FAIL, IX_HANDLE_INNER_NEW_ROOT_FAIL, pFFileHandle, header.rootPage);
-                            // [header.modified] is assumed to be set to [true] in the executions above.
-
-                            *(bool *)rootPageData = false;
-                            *(int *)(rootPageData + sizeof(bool)) = 2;
-
-                            memcpy(rootPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int), header.attrLength);
-                            *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.attrLength) = nodePageNum;
-                            memcpy(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
-                            *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength + header.attrLength) = rightPageNum;
-
-                            IX_Try(pFFileHandle.UnpinPage(header.rootPage), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_ROOT_FAIL);
-
-                            IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL);
-                            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_FAIL);
-                            return make_pair(nullptr, -1ll);
-                        }
-                        else
-                        {
-                            void *key;
-                            switch (header.attrType)
-                            {
-                            case INT:
-                                key = new int(*(int *)(rightPageData + sizeof(bool) + sizeof(int)));
-                                break;
-                            case FLOAT:
-                                key = new double(*(double *)(rightPageData + sizeof(bool) + sizeof(int)));
-                                break;
-                            case STRING:
-                                key = new char[header.attrLength];
-                                memcpy(key, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
-                                break;
-                            case DATE:
-                                key = new char[10];
-                                memcpy(key, rightPageData + sizeof(bool) + sizeof(int), 10);
-                                break;
-                            }
-
-                            IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_INNER_SPLIT_BUT_UNPIN_RIGHT_FAIL);
-                            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_SPLIT_BUT_UNPIN_FAIL);
-                            return make_pair(key, rightPageNum);
-                        }
+                    for (int i = 0, j = sizeof(bool) + sizeof(int); i < (header.innerDeg + 1) - (header.innerDeg + 1) / 2; ++i, j += header.innerEntryLength)
+                    {
+                        printf("IX_IndexHandle::BPlus_Insert(nodePageNum = %d) rightPageNum = %lld, after split, the child %d of page %lld is %d\n", nodePageNum, rightPageNum, i, rightPageNum, *(rightPageData + j + header.attrLength));
                     }
+#endif
+                }
+                else
+                { // The inserted entry located in the left page
+                    memcpy(rightPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int) + ((header.innerDeg + 1) / 2 - 1) * header.innerEntryLength, (header.innerDeg + 1 - (header.innerDeg + 1) / 2) * header.innerEntryLength);
+                }
+
+                // printf("Split an inner node.\n");
+
+                // Adjust the data of the original node
+                *(int *)(nodePageData + sizeof(bool)) = (header.innerDeg + 1) / 2;
+                if (i < (header.innerDeg + 1) / 2)
+                { // The inserted entry needs inserting in the left page
+                    // Move the right ones by one unit
+                    memmove(nodePageData + j + header.innerEntryLength, nodePageData + j, header.innerEntryLength * ((header.innerDeg + 1) / 2 - 1 - i));
+                    // Copy the inserting information
+                    memcpy(nodePageData + j, pData, header.attrLength);
+                    *(PageNum *)(nodePageData + j + header.attrLength) = pageNum;
+                }
+                else
+                { // The inserted entry needs inserting in the right page
+                    // Nothing to do
+                }
+
+                if (header.rootPage == nodePageNum)
+                { // If this is the root
+                    // Create a new root
+                    PF_PageHandle rootPageHandle;
+                    char *rootPageData;
+                    header.rootPage = AllocatePage(rootPageHandle, IX_HANDLE_INNER_NEW_ROOT_FAIL);
+                    IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_HANDLE_INNER_NEW_ROOT_FAIL_UNPIN_FAIL, IX_HANDLE_INNER_NEW_ROOT_FAIL, pFFileHandle, header.rootPage);
+                    // [header.modified] is assumed to be set to [true] in the executions above.
+
+                    *(bool *)rootPageData = false;
+                    *(int *)(rootPageData + sizeof(bool)) = 2;
+
+                    memcpy(rootPageData + sizeof(bool) + sizeof(int), nodePageData + sizeof(bool) + sizeof(int), header.attrLength);
+                    *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.attrLength) = nodePageNum;
+                    memcpy(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
+                    *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.innerEntryLength + header.attrLength) = rightPageNum;
+
+                    IX_Try(pFFileHandle.UnpinPage(header.rootPage), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_ROOT_FAIL);
+
+                    IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_RIGHT_FAIL);
+                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_NEW_ROOT_BUT_UNPIN_FAIL);
+                    return make_pair(nullptr, -1ll);
                 }
                 else
                 {
-                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_BUT_UNPIN_FAIL);
-                    return make_pair(nullptr, -1);
+                    void *key;
+                    switch (header.attrType)
+                    {
+                    case INT:
+                        key = new int(*(int *)(rightPageData + sizeof(bool) + sizeof(int)));
+                        break;
+                    case FLOAT:
+                        key = new double(*(double *)(rightPageData + sizeof(bool) + sizeof(int)));
+                        break;
+                    case STRING:
+                        key = new char[header.attrLength];
+                        memcpy(key, rightPageData + sizeof(bool) + sizeof(int), header.attrLength);
+                        break;
+                    case DATE:
+                        key = new char[10];
+                        memcpy(key, rightPageData + sizeof(bool) + sizeof(int), 10);
+                        break;
+                    }
+
+                    IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_INSERT_INNER_SPLIT_BUT_UNPIN_RIGHT_FAIL);
+                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_INNER_SPLIT_BUT_UNPIN_FAIL);
+                    return make_pair(key, rightPageNum);
                 }
-                break;
             }
         }
+        else
+        {
+            IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_BUT_UNPIN_FAIL);
+            return make_pair(nullptr, -1);
+        }
     }
     // Nothing happens,
     // which won't happen
@@ -542,8 +566,9 @@ const pair<const void *, PageNum> IX_IndexHandle::BPlus_Insert(PageNum nodePageN
 //
 // Desc: Delete some entry fromm B+ tree
 //
-// Note: Similar to [BPlus_Exists]
-bool IX_IndexHandle::BPlus_Delete(PageNum nodePageNum, const void *pData, const RID &rid)
+// Note: A key is removed from its leaf when no RID is left. [underflow] is set if
+//       the node is left less than half full, and it's rebalanced by its parent.
+bool IX_IndexHandle::BPlus_Delete(PageNum nodePageNum, const void *pData, const RID &rid, bool &underflow)
 {
     PF_PageHandle nodePageHandle;
     char *nodePageData;
@@ -553,44 +578,180 @@ bool IX_IndexHandle::BPlus_Delete(PageNum nodePageNum, const void *pData, const
 
     bool isLeaf = *(bool *)nodePageData;
     int childTot = *(int *)(nodePageData + sizeof(bool));
-    if (!isLeaf)
+    bool deleted = false;
+    underflow = false;
+    try
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.innerEntryLength)
+        if (!isLeaf)
         {
-            if ((cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.innerEntryLength) < 0)) || (cmp(pData, nodePageData + j) == 0 && cmp(pData, nodePageData + j + header.innerEntryLength) == 0))
-            { // Regular condition: [, )
-                if (BPlus_Delete(*(PageNum *)(nodePageData + j + header.attrLength), pData, rid))
-                {
-                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_DELETE_INNER_BUT_UNPIN_FAIL);
-                    return true;
+            int i = Child(nodePageData, pData), j = sizeof(bool) + sizeof(int) + i * header.innerEntryLength;
+            bool childUnderflow;
+            deleted = BPlus_Delete(*(PageNum *)(nodePageData + j + header.attrLength), pData, rid, childUnderflow);
+            if (childUnderflow)
+            {
+                BPlus_Rebalance(nodePageData, i);
+                underflow = *(int *)(nodePageData + sizeof(bool)) < header.innerDeg / 2;
+            }
+        }
+        else
+        {
+            // Keys stored in the leaf are unique, each with all of its RIDs.
+            int i = Search(nodePageData, pData, false), j = sizeof(bool) + sizeof(int) + i * header.leafEntryLength;
+            if (i < childTot && cmp(pData, nodePageData + j) == 0)
+            {
+                deleted = Posting_Delete(*(IX_Posting *)(nodePageData + j + header.attrLength), rid);
+                if (deleted && ((IX_Posting *)(nodePageData + j + header.attrLength))->count == 0)
+                { // No RID is left, so remove the key
+                    memmove(nodePageData + j, nodePageData + j + header.leafEntryLength, (childTot - i - 1) * header.leafEntryLength);
+                    *(int *)(nodePageData + sizeof(bool)) = childTot - 1;
+                    underflow = childTot - 1 < header.leafDeg / 2;
                 }
             }
         }
     }
+    catch (RC rc)
+    {
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_DELETE_FAIL_UNPIN_FAIL);
+        throw;
+    }
+
+    if (deleted)
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), isLeaf ? IX_HANDLE_DELETE_LEAF_BUT_UNPIN_FAIL : IX_HANDLE_DELETE_INNER_BUT_UNPIN_FAIL);
     else
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_DELETE_BUT_UNPIN_FAIL);
+    return deleted;
+}
+
+//
+// Desc: Rebalance the child [i] of an inner node, which is less than half full
+//
+// Note: The inner node is pinned and marked dirty by the caller.
+/* Steps:
+    1) Pair the child with its right sibling, or with its left one if it's the last
+    2) If both fit in one node, merge the right one into the left one,
+       unlink it from the leaves, dispose of it, and remove its entry
+    3) Otherwise, move entries over until each holds half of them,
+       and the key of the right one becomes its new first key
+*/
+void IX_IndexHandle::BPlus_Rebalance(char *nodePageData, int i)
+{
+    int childTot = *(int *)(nodePageData + sizeof(bool));
+    if (childTot < 2)
+        return; // Only the root may have a single child, which replaces it later
+
+    // 1) Pair and pin them
+    int l = i + 1 < childTot ? i : i - 1;
+    char *leftEntry = nodePageData + sizeof(bool) + sizeof(int) + l * header.innerEntryLength;
+    char *rightEntry = leftEntry + header.innerEntryLength;
+    PageNum leftPageNum = *(PageNum *)(leftEntry + header.attrLength);
+    PageNum rightPageNum = *(PageNum *)(rightEntry + header.attrLength);
+
+    PF_PageHandle leftPageHandle, rightPageHandle;
+    char *leftPageData, *rightPageData;
+    IX_Try(pFFileHandle.GetThisPage(leftPageNum, leftPageHandle), IX_HANDLE_REBALANCE_FAIL);
+    IX_TryElseUnpin(pFFileHandle.MarkDirty(leftPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, leftPageNum);
+    IX_TryElseUnpin(leftPageHandle.GetData(leftPageData), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, leftPageNum);
+    try
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.leafEntryLength)
+        IX_Try(pFFileHandle.GetThisPage(rightPageNum, rightPageHandle), IX_HANDLE_REBALANCE_FAIL);
+        IX_TryElseUnpin(pFFileHandle.MarkDirty(rightPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, rightPageNum);
+        IX_TryElseUnpin(rightPageHandle.GetData(rightPageData), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, rightPageNum);
+    }
+    catch (RC rc)
+    {
+        IX_Try(pFFileHandle.UnpinPage(leftPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+        throw;
+    }
+
+    bool isLeaf = *(bool *)leftPageData;
+    int entryLength = isLeaf ? header.leafEntryLength : header.innerEntryLength;
+    int leftTot = *(int *)(leftPageData + sizeof(bool));
+    int rightTot = *(int *)(rightPageData + sizeof(bool));
+    char *leftEntries = leftPageData + sizeof(bool) + sizeof(int);
+    char *rightEntries = rightPageData + sizeof(bool) + sizeof(int);
+
+    if (leftTot + rightTot <= (isLeaf ? header.leafDeg : header.innerDeg))
+    {
+        // 2) Merge
+        // The keys of the right one are not less than the last key of the left one,
+        // so its entries, even of an inner node, are just appended.
+        memcpy(leftEntries + leftTot * entryLength, rightEntries, rightTot * entryLength);
+        *(int *)(leftPageData + sizeof(bool)) = leftTot + rightTot;
+        PageNum nextPageNum = 0;
+        if (isLeaf)
+            nextPageNum = IX_NextLeaf(leftPageData) = IX_NextLeaf(rightPageData);
+        IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+        IX_Try(pFFileHandle.UnpinPage(leftPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+
+        if (nextPageNum != 0)
         {
-            // For leaf, there's no segment more.
-            // Keys stored in the node are the exact keys.
-            if (cmp(pData, nodePageData + j) == 0 && ((RID *)(nodePageData + j + header.attrLength))->viable)
-            {
-                ((RID *)(nodePageData + j + header.attrLength))->viable = false;
+            PF_PageHandle nextPageHandle;
+            char *nextPageData;
+            IX_Try(pFFileHandle.GetThisPage(nextPageNum, nextPageHandle), IX_HANDLE_REBALANCE_FAIL);
+            IX_TryElseUnpin(pFFileHandle.MarkDirty(nextPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, nextPageNum);
+            IX_TryElseUnpin(nextPageHandle.GetData(nextPageData), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, nextPageNum);
+            IX_PrevLeaf(nextPageData) = leftPageNum;
+            IX_Try(pFFileHandle.UnpinPage(nextPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+        }
+        IX_Try(pFFileHandle.DisposePage(rightPageNum), IX_HANDLE_REBALANCE_FAIL);
 
-                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_DELETE_LEAF_BUT_UNPIN_FAIL);
-                return true;
-            }
+        memmove(rightEntry, rightEntry + header.innerEntryLength, (childTot - l - 2) * header.innerEntryLength);
+        *(int *)(nodePageData + sizeof(bool)) = childTot - 1;
+    }
+    else
+    {
+        // 3) Redistribute
+        int newLeftTot = (leftTot + rightTot) / 2;
+        if (leftTot < newLeftTot)
+        { // Move the first ones of the right node to the left one
+            int n = newLeftTot - leftTot;
+            memcpy(leftEntries + leftTot * entryLength, rightEntries, n * entryLength);
+            memmove(rightEntries, rightEntries + n * entryLength, (rightTot - n) * entryLength);
         }
+        else
+        { // Move the last ones of the left node to the right one
+            int n = leftTot - newLeftTot;
+            memmove(rightEntries + n * entryLength, rightEntries, rightTot * entryLength);
+            memcpy(rightEntries, leftEntries + newLeftTot * entryLength, n * entryLength);
+        }
+        *(int *)(leftPageData + sizeof(bool)) = newLeftTot;
+        *(int *)(rightPageData + sizeof(bool)) = leftTot + rightTot - newLeftTot;
+        memcpy(rightEntry, rightEntries, header.attrLength);
+
+        IX_Try(pFFileHandle.UnpinPage(rightPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+        IX_Try(pFFileHandle.UnpinPage(leftPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+    }
+}
+
+//
+// Desc: Replace an inner root of a single child by the child, as long as there's one
+//
+void IX_IndexHandle::BPlus_CollapseRoot()
+{
+    while (true)
+    {
+        PF_PageHandle rootPageHandle;
+        char *rootPageData;
+        PageNum rootPageNum = header.rootPage;
+        IX_Try(pFFileHandle.GetThisPage(rootPageNum, rootPageHandle), IX_HANDLE_REBALANCE_FAIL);
+        IX_TryElseUnpin(rootPageHandle.GetData(rootPageData), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL, IX_HANDLE_REBALANCE_FAIL, pFFileHandle, rootPageNum);
+        bool isLeaf = *(bool *)rootPageData;
+        int childTot = *(int *)(rootPageData + sizeof(bool));
+        PageNum childPageNum = *(PageNum *)(rootPageData + sizeof(bool) + sizeof(int) + header.attrLength);
+        IX_Try(pFFileHandle.UnpinPage(rootPageNum), IX_HANDLE_REBALANCE_FAIL_UNPIN_FAIL);
+        if (isLeaf || childTot > 1)
+            return;
+
+        header.rootPage = childPageNum;
+        header.modified = true;
+        IX_Try(pFFileHandle.DisposePage(rootPageNum), IX_HANDLE_REBALANCE_FAIL);
     }
-    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_DELETE_BUT_UNPIN_FAIL);
-    return false;
 }
 
 //
 // Desc: Update some entry
 //
-// Even though an update can be decomposed to an insert and a deletion intuitionally,
-// but things are not like that because of the applied lazy deletion.
+// Replace [origin_rid] with [updated_rid] among the RIDs of [pData].
 bool IX_IndexHandle::BPlus_Update(PageNum nodePageNum, const void *pData, const RID &origin_rid, const RID &updated_rid)
 {
     PF_PageHandle nodePageHandle;
@@ -601,36 +762,35 @@ bool IX_IndexHandle::BPlus_Update(PageNum nodePageNum, const void *pData, const
 
     bool isLeaf = *(bool *)nodePageData;
     int childTot = *(int *)(nodePageData + sizeof(bool));
-    if (!isLeaf)
+    bool updated = false;
+    try
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.innerEntryLength)
+        if (!isLeaf)
         {
-            if ((cmp(pData, nodePageData + j) >= 0 && (i == childTot - 1 || cmp(pData, nodePageData + j + header.innerEntryLength) < 0)) || (cmp(pData, nodePageData + j) == 0 && cmp(pData, nodePageData + j + header.innerEntryLength) == 0))
-            { // Regular condition: [, )
-                if (BPlus_Update(*(PageNum *)(nodePageData + j + header.attrLength), pData, origin_rid, updated_rid))
-                {
-                    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_UPDATE_INNER_BUT_UNPIN_FAIL);
-                    return true;
-                }
-            }
+            int j = sizeof(bool) + sizeof(int) + Child(nodePageData, pData) * header.innerEntryLength;
+            updated = BPlus_Update(*(PageNum *)(nodePageData + j + header.attrLength), pData, origin_rid, updated_rid);
         }
-    }
-    else
-    {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += header.leafEntryLength)
+        else
         {
-            // For leaf, there's no segment more.
-            // Keys stored in the node are the exact keys.
-            if (cmp(pData, nodePageData + j) == 0 && ((RID *)(nodePageData + j + header.attrLength))->viable)
+            int i = Search(nodePageData, pData, false), j = sizeof(bool) + sizeof(int) + i * header.leafEntryLength;
+            if (i < childTot && cmp(pData, nodePageData + j) == 0)
             {
-                *((RID *)(nodePageData + j + header.attrLength)) = updated_rid;
-                IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_UPDATE_LEAF_BUT_UNPIN_FAIL);
-                return true;
+                IX_Posting &posting = *(IX_Posting *)(nodePageData + j + header.attrLength);
+                updated = Posting_Delete(posting, origin_rid) && Posting_Insert(posting, updated_rid);
             }
         }
     }
-    IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_UPDATE_BUT_UNPIN_FAIL);
-    return false;
+    catch (RC rc)
+    {
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_INSERT_FAIL_UNPIN_FAIL);
+        throw;
+    }
+
+    if (updated)
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), isLeaf ? IX_HANDLE_UPDATE_LEAF_BUT_UNPIN_FAIL : IX_HANDLE_UPDATE_INNER_BUT_UNPIN_FAIL);
+    else
+        IX_Try(pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_UPDATE_BUT_UNPIN_FAIL);
+    return updated;
 }
 
 void IX_IndexHandle::BPlus_Print(PageNum nodePageNum) const
@@ -690,27 +850,49 @@ int IX_IndexHandle::cmp(const void *data1, const void *data2) const
         else
             return 1;
     case STRING:
-        for (int i = 0; i < header.attrLength; ++i)
-        {
-            char char1 = ((const char *)data1)[i];
-            char char2 = ((const char *)data2)[i];
-            if (char1 != char2)
-                return char1 < char2 ? -1 : 1;
-        }
-        return 0;
     case DATE:
-        for (int i = 0; i < 10; ++i)
-        {
-            char char1 = ((const char *)data1)[i];
-            char char2 = ((const char *)data2)[i];
-            if (char1 != char2)
-                return char1 < char2 ? -1 : 1;
-        }
-        return 0;
+    {
+        int c = memcmp(data1, data2, header.attrType == DATE ? 10 : header.attrLength);
+        return (c > 0) - (c < 0);
+    }
     }
     return 0; // This command won't run if everything works normally
 }
 
+int IX_IndexHandle::Search(const char *nodePageData, const void *pData, bool upper) const
+{
+    bool isLeaf = *(bool *)nodePageData;
+    int childTot = *(int *)(nodePageData + sizeof(bool));
+    return IX_SearchNode(header.attrType, header.attrLength, nodePageData + sizeof(bool) + sizeof(int),
+                         isLeaf ? header.leafEntryLength : header.innerEntryLength, childTot, pData, upper);
+}
+
+//
+// Desc: Find the child of an inner node which may hold [pData]
+//
+// Note: The child [i] holds the keys in [key_i, key_{i + 1}), since every key is
+//       stored once, so it's the last child whose key is not greater than [pData],
+//       or the first one if there's none.
+int IX_IndexHandle::Child(const char *nodePageData, const void *pData) const
+{
+    return max(Search(nodePageData, pData, true) - 1, 0);
+}
+
+//
+// Desc: Allocate a page, and count it in the header
+//
+// Note: The page may be one disposed of before, so its number is not always [pageTot].
+PageNum IX_IndexHandle::AllocatePage(PF_PageHandle &pageHandle, RC ix_rc)
+{
+    PageNum pageNum;
+    IX_Try(pFFileHandle.AllocatePage(pageHandle), ix_rc);
+    pageHandle.GetPageNum(pageNum);
+    if (pageNum >= header.pageTot)
+        header.pageTot = pageNum + 1;
+    header.modified = true;
+    return pageNum;
+}
+
 void IX_IndexHandle::InnerEntry_Print(void *data) const
 {
     printf("(");
@@ -721,8 +903,17 @@ void IX_IndexHandle::LeafEntry_Print(void *data) const
 {
     printf("(");
     Attr_Print(data);
-    RID rid = *(RID *)(data + header.attrLength);
-    printf(", {pageNum = %lld, slotNum = %d, viable = %d}) ", rid.pageNum, rid.slotNum, rid.viable);
+    const IX_Posting &posting = *(IX_Posting *)(data + header.attrLength);
+    vector<RID> rids;
+    if (posting.InBuckets())
+        printf(", {count = %d, bucket = %lld}) ", posting.count, Posting_Read(posting, rids));
+    else
+    {
+        Posting_Read(posting, rids);
+        for (const RID &rid : rids)
+            printf(", {pageNum = %lld, slotNum = %d}", rid.pageNum, rid.slotNum);
+        printf(") ");
+    }
 }
 
 void IX_IndexHandle::Attr_Print(const void *data) const
@@ -8,34 +8,41 @@
 #include "ix.h"
 #include <iostream>
 #include <cstring>
-#include <list>
 using namespace std;
 
 // Constructor
-IX_IndexScan::IX_IndexScan() : open(false)
+IX_IndexScan::IX_IndexScan() : open(false), value(nullptr), curPageNum(0), nextRID(0), nextBucket(0)
 { // Set open scan flag to false
 }
 
 // Destructor
 IX_IndexScan::~IX_IndexScan()
 {
-    // Nothing to free
+    // Unpin the leaf if the scan is left open
+    if (open)
+        CloseScan();
 }
 
 //
-// Desc: Create a list containing rids of all satisfied entries
+// Desc: Descend to the first leaf that may hold a satisfying entry, and pin it
 //
-// Note: Rather than similar things to OpenScan in RM component,
-//       here we get all satisfied rids when opening.
-//       Simply, we just ignore [pinHint].
+// Note: Simply, we just ignore [pinHint].
+/* Steps:
+    1) Copy the key, since the scan outlives the caller's buffer
+    2) From the root, go to the leftmost child for LT, LE and NO_OP,
+       otherwise to the last child whose key is below the lower bound,
+       since the keys equal to a separator may be left of it
+    3) Keep the leaf pinned, and start at its first entry past the lower bound
+*/
 RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle, CompOp compOp,
                           void *value, ClientHint pinHint)
 {
-    // [scan] is assumed to be emtpy
     try
     {
         if (compOp == NE_OP)
             throw RC{IX_OPEN_SCAN_NE};
+        if (!indexHandle.open)
+            throw RC{IX_HANDLE_CLOSED};
 
 #ifdef IX_LOG
         printf("==== OpenScan: ");
@@ -45,14 +52,56 @@ RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle, CompOp compOp,
             printf("[EQ] ");
             break;
         }
-        indexHandle.Attr_Print(value);
+        if (compOp != NO_OP && value != nullptr)
+            indexHandle.Attr_Print(value);
         printf(" =====\n");
 #endif
 
-        BPlus_Find(indexHandle, indexHandle.header.rootPage, compOp, value);
+        // 1) Copy the key
+        const IX_IndexHeader &header = indexHandle.header;
+        this->indexHandle = &indexHandle;
+        this->compOp = compOp;
+        this->value = nullptr;
+        rids.clear();
+        nextRID = 0;
+        nextBucket = 0;
+        if (compOp != NO_OP)
+        {
+            this->value = new char[header.attrLength];
+            memcpy(this->value, value, header.attrLength);
+        }
+
+        // 2) Descend
+        PageNum nodePageNum = header.rootPage;
+        while (true)
+        {
+            PF_PageHandle nodePageHandle;
+            char *nodePageData;
+            IX_Try(indexHandle.pFFileHandle.GetThisPage(nodePageNum, nodePageHandle), IX_HANDLE_EXISTS_FAIL);
+            IX_TryElseUnpin(nodePageHandle.GetData(nodePageData), IX_HANDLE_EXISTS_FAIL_UNPIN_FAIL, IX_HANDLE_EXISTS_FAIL, indexHandle.pFFileHandle, nodePageNum);
+
+            // 3) Stop at the leaf, at its first entry past the lower bound
+            bool lowerBound = compOp == EQ_OP || compOp == GE_OP || compOp == GT_OP;
+            if (*(bool *)nodePageData)
+            {
+                curPageNum = nodePageNum;
+                curEntry = lowerBound ? indexHandle.Search(nodePageData, value, compOp == GT_OP) : 0;
+                pageData = nodePageData;
+                break;
+            }
+
+            int child = 0;
+            if (lowerBound)
+                child = max(indexHandle.Search(nodePageData, value, compOp == GT_OP) - 1, 0);
+            PageNum childPageNum = *(PageNum *)(nodePageData + sizeof(bool) + sizeof(int) + child * header.innerEntryLength + header.attrLength);
+            IX_Try(indexHandle.pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL);
+            nodePageNum = childPageNum;
+        }
     }
     catch (RC rc)
     {
+        delete[] this->value;
+        this->value = nullptr;
         return rc;
     }
 
@@ -60,110 +109,129 @@ RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle, CompOp compOp,
     return OK_RC;
 }
 
-// Similar to [BPlus_Exists]
-void IX_IndexScan::BPlus_Find(const IX_IndexHandle &indexHandle, PageNum nodePageNum, CompOp compOp, void *value)
+RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle,
+                          void *value,
+                          ClientHint pinHint)
 {
-    // printf("BPlus_Find(..., nodePageNum = %lld, ...)\n", nodePageNum);
-
-    PF_PageHandle nodePageHandle;
-    char *nodePageData;
-    IX_Try(indexHandle.pFFileHandle.GetThisPage(nodePageNum, nodePageHandle), IX_HANDLE_EXISTS_FAIL);
-    IX_TryElseUnpin(indexHandle.pFFileHandle.MarkDirty(nodePageNum), IX_HANDLE_EXISTS_FAIL_UNPIN_FAIL, IX_HANDLE_EXISTS_FAIL, indexHandle.pFFileHandle, nodePageNum);
-    IX_TryElseUnpin(nodePageHandle.GetData(nodePageData), IX_HANDLE_EXISTS_FAIL_UNPIN_FAIL, IX_HANDLE_EXISTS_FAIL, indexHandle.pFFileHandle, nodePageNum);
+    return OpenScan(indexHandle, EQ_OP, value, pinHint);
+}
 
-    bool isLeaf = *(bool *)nodePageData;
-    int childTot = *(int *)(nodePageData + sizeof(bool));
-    if (!isLeaf)
-    {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += indexHandle.header.innerEntryLength)
-        {
-            // De facto, no condition is also acceptable.
-            // We check here, just for speeding up.
-            if ([&compOp, &indexHandle, &i, &j, &childTot, &nodePageData, &value]() -> bool {
-                    switch (compOp)
-                    {
-                    case NO_OP:
-                        return true;
-                    case EQ_OP:
-                        return ((indexHandle.cmp(nodePageData + j, value) <= 0) && (i + 1 == childTot || indexHandle.cmp(nodePageData + j + indexHandle.header.innerEntryLength, value) > 0)) || (indexHandle.cmp(nodePageData + j, value) == 0 && indexHandle.cmp(nodePageData + j + indexHandle.header.innerEntryLength, value) == 0);
-                    case LT_OP:
-                        return indexHandle.cmp(nodePageData + j, value) < 0;
-                    case LE_OP:
-                        return indexHandle.cmp(nodePageData + j, value) <= 0;
-                    case GT_OP:
-                        return i + 1 == childTot || indexHandle.cmp(nodePageData + j + indexHandle.header.innerEntryLength, value) > 0;
-                    case GE_OP:
-                        return i + 1 == childTot || indexHandle.cmp(nodePageData + j + indexHandle.header.innerEntryLength, value) > 0;
-                    case NE_OP:
-                        throw RC{IX_OPEN_SCAN_NE};
-                    }
-                    return false; // meaningless return to avoid warning
-                }())
-            {
-                BPlus_Find(indexHandle, *(PageNum *)(nodePageData + j + indexHandle.header.attrLength), compOp, value);
-            }
-        }
-    }
-    else
+bool IX_IndexScan::AfterStart(const void *key) const
+{
+    switch (compOp)
     {
-        for (int i = 0, j = sizeof(bool) + sizeof(int); i < childTot; ++i, j += indexHandle.header.leafEntryLength)
-        {
-            if ([&compOp, &indexHandle, &value, &nodePageData, &j]() -> bool {
-                    switch (compOp)
-                    {
-                    case NO_OP:
-                        return true;
-                    case EQ_OP:
-                        return indexHandle.cmp(nodePageData + j, value) == 0;
-                    case LT_OP:
-                        return indexHandle.cmp(nodePageData + j, value) < 0;
-                    case GT_OP:
-                        return indexHandle.cmp(nodePageData + j, value) > 0;
-                    case LE_OP:
-                        return indexHandle.cmp(nodePageData + j, value) <= 0;
-                    case GE_OP:
-                        return indexHandle.cmp(nodePageData + j, value) >= 0;
-                    case NE_OP:
-                        throw RC{IX_OPEN_SCAN_NE};
-                    }
-                    return false; // meaningless return to avoid warning
-                }())
-            {
-                scan.push_back(*(RID *)(nodePageData + j + indexHandle.header.attrLength));
-            }
-        }
+    case EQ_OP:
+    case GE_OP:
+        return indexHandle->cmp(key, value) >= 0;
+    case GT_OP:
+        return indexHandle->cmp(key, value) > 0;
+    default:
+        return true;
     }
-    IX_Try(indexHandle.pFFileHandle.UnpinPage(nodePageNum), IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL);
 }
 
-RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle,
-                          void *value,
-                          ClientHint pinHint)
+bool IX_IndexScan::BeforeEnd(const void *key) const
 {
-    return OpenScan(indexHandle, EQ_OP, value, pinHint);
+    switch (compOp)
+    {
+    case EQ_OP:
+    case LE_OP:
+        return indexHandle->cmp(key, value) <= 0;
+    case LT_OP:
+        return indexHandle->cmp(key, value) < 0;
+    default:
+        return true;
+    }
 }
 
+//
+// Desc: Get the next RID of the satisfying keys
+//
+// Note: The RIDs of a key are read from its entry, or from its buckets one at
+//       a time, while the leaf stays pinned.  A deleted key has no RID.
+// Ret:  IX_EOF after the last one, when the last leaf is unpinned
 RC IX_IndexScan::GetNextEntry(RID &rid)
 {
+    if (!open || curPageNum == 0)
+        return IX_EOF;
+
     try
     {
-        while (!scan.empty() && !scan.front().viable)
-            scan.pop_front();
-        if (scan.empty())
-            throw RC{IX_EOF};
-        rid = scan.front();
-        scan.pop_front();
+        const IX_IndexHeader &header = indexHandle->header;
+        const PF_FileHandle &pFFileHandle = indexHandle->pFFileHandle;
+        while (true)
+        {
+            // The RIDs of the current key
+            if (nextRID < rids.size())
+            {
+                rid = rids[nextRID++];
+                return OK_RC;
+            }
+            if (nextBucket != 0)
+            {
+                nextBucket = indexHandle->Posting_ReadBucket(nextBucket, rids);
+                nextRID = 0;
+                continue;
+            }
+
+            // Move on to the next leaf
+            if (curEntry == *(int *)(pageData + sizeof(bool)))
+            {
+                PageNum nextPageNum = IX_NextLeaf(pageData);
+                PageNum pageNum = curPageNum;
+                curPageNum = 0;
+                IX_Try(pFFileHandle.UnpinPage(pageNum), IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL);
+                if (nextPageNum == 0)
+                    return IX_EOF;
+
+                PF_PageHandle pageHandle;
+                IX_Try(pFFileHandle.GetThisPage(nextPageNum, pageHandle), IX_HANDLE_EXISTS_FAIL);
+                IX_TryElseUnpin(pageHandle.GetData(pageData), IX_HANDLE_EXISTS_FAIL_UNPIN_FAIL, IX_HANDLE_EXISTS_FAIL, pFFileHandle, nextPageNum);
+                curPageNum = nextPageNum;
+                curEntry = 0;
+                continue;
+            }
+
+            char *entry = pageData + sizeof(bool) + sizeof(int) + curEntry++ * header.leafEntryLength;
+            if (!AfterStart(entry))
+                continue;
+            if (!BeforeEnd(entry))
+            {
+                PageNum pageNum = curPageNum;
+                curPageNum = 0;
+                IX_Try(pFFileHandle.UnpinPage(pageNum), IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL);
+                return IX_EOF;
+            }
+            const IX_Posting &posting = *(IX_Posting *)(entry + header.attrLength);
+            if (indexHandle->Posting_ReadSingle(posting, rid))
+                return OK_RC;
+            nextBucket = indexHandle->Posting_Read(posting, rids);
+            nextRID = 0;
+        }
     }
     catch (RC rc)
     {
         return rc;
     }
-    return OK_RC;
 }
 
 RC IX_IndexScan::CloseScan()
 {
+    RC rc = OK_RC;
+    if (open && curPageNum != 0)
+    {
+        if ((rc = indexHandle->pFFileHandle.UnpinPage(curPageNum)))
+        {
+            PF_PrintError(rc);
+            rc = IX_HANDLE_NOT_EXISTS_BUT_UNPIN_FAIL;
+        }
+    }
+    curPageNum = 0;
+    rids.clear();
+    nextRID = 0;
+    nextBucket = 0;
     open = false;
-    scan.clear();
-    return OK_RC;
-}
\ No newline at end of file
+    delete[] value;
+    value = nullptr;
+    return rc;
+}
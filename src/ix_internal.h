@@ -10,6 +10,80 @@
 #include "ix.h"
 #include "rm_rid.h"
 #include <algorithm>
+#include <cstring>
+
+// The links of a leaf to its siblings, stored at the end of its page.
+const int IX_LEAF_LINK_SIZE = 2 * sizeof(PageNum);
+inline PageNum &IX_PrevLeaf(char *nodePageData)
+{
+    return *(PageNum *)(nodePageData + PF_PAGE_SIZE - 2 * sizeof(PageNum));
+}
+inline PageNum &IX_NextLeaf(char *nodePageData)
+{
+    return *(PageNum *)(nodePageData + PF_PAGE_SIZE - sizeof(PageNum));
+}
+
+// The value of a leaf entry: the RIDs of its key, in ascending order.
+// As long as they fit in IX_POSTING_INLINE bytes, encoded as in a bucket,
+// they are kept in the entry itself, and otherwise in a list of bucket pages.
+// A key without RIDs is deleted.
+const int IX_POSTING_INLINE = 11;
+const unsigned char IX_POSTING_BUCKETS = 0xff; // [used] of RIDs in buckets
+
+struct IX_Posting
+{
+    IX_Posting() : count(0), used(0) {}
+
+    bool InBuckets() const { return used == IX_POSTING_BUCKETS; }
+    PageNum FirstBucket() const
+    {
+        PageNum pageNum;
+        memcpy(&pageNum, data, sizeof(PageNum));
+        return pageNum;
+    }
+    void SetFirstBucket(PageNum pageNum)
+    {
+        used = IX_POSTING_BUCKETS;
+        memcpy(data, &pageNum, sizeof(PageNum));
+    }
+
+    int count;                     // The number of RIDs
+    unsigned char used;            // The bytes of [data] taken, or IX_POSTING_BUCKETS
+    char data[IX_POSTING_INLINE];  // The RIDs, or the page of the first bucket
+};
+
+// The header of a bucket page, which is followed by its RIDs.
+// Each RID is encoded against the one before it, or (0, 0) for the first:
+//   on the same page: varint(slot delta << 1)
+//   otherwise:        varint(page delta << 1 | 1), varint(slot)
+// so that the RIDs of a key on consecutive slots take a byte each.
+struct IX_BucketHeader
+{
+    PageNum next;     // The next bucket, or 0 if none
+    PageNum tail;     // In the first bucket, the last one, to which RIDs are appended
+    PageNum lastPage; // The last RID in the bucket
+    SlotNum lastSlot;
+    int count;        // The number of RIDs in the bucket
+    int used;         // The bytes they take
+};
+const int IX_BUCKET_DATA_SIZE = PF_PAGE_SIZE - sizeof(IX_BucketHeader);
+
+// Search the [childTot] entries of a node, each [entryLength] bytes from [entries] on,
+// for the first one whose key is not less than [pData], or greater than it if [bUpper].
+// INT and FLOAT keys are compared by SIMD, once binary search has narrowed them down
+// to IX_SIMD_WINDOW entries.  The other two are for comparison.
+const int IX_SIMD_WINDOW = 32;
+int IX_SearchNode(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                  int childTot, const void *pData, bool bUpper);
+int IX_SearchNodeBinary(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                        int childTot, const void *pData, bool bUpper);
+int IX_SearchNodeLinear(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                        int childTot, const void *pData, bool bUpper);
+// The instruction set used by IX_SearchNode: "avx2", "sse2" or "none"
+const char *IX_SearchSIMD();
+
+// The entries an IX_BulkLoader sorts in memory, before spilling them as a run
+const size_t IX_BULK_RUN_BYTES = 32 << 20;
 
 // A wrapper to execute the API of PF.
 inline void IX_Try(RC pf_rc, RC ix_rc)
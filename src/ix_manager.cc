@@ -65,18 +65,17 @@ RC IX_Manager::CreateIndex(const char *fileName, int indexNo,
         IX_TryElseUnpin(indexFileHandle.MarkDirty(1ll), IX_MANAGER_CREATE_ROOT_FAIL_UNPIN_FAIL, IX_MANAGER_CREATE_ROOT_FAIL, indexFileHandle, 1ll);
         *(bool *)(rootData + 0) = true;
         *(int *)(rootData + 1) = 0;
+        IX_PrevLeaf(rootData) = IX_NextLeaf(rootData) = 0;
         IX_Try(indexFileHandle.UnpinPage(1ll), IX_MANAGER_CREATE_ROOT_BUT_UNPIN_FAIL);
 
         // Close the file
         IX_Try(pfm.CloseFile(indexFileHandle), IX_MANAGER_CREATE_BUT_CLOSE_FILE_FAIL);
-
-        // Everything is done.
-        throw RC{OK_RC};
     }
     catch (RC rc)
     {
         return rc;
     }
+    return OK_RC;
 }
 
 RC IX_Manager::DestroyIndex(const char *fileName, int indexNo)
@@ -92,13 +91,12 @@ RC IX_Manager::DestroyIndex(const char *fileName, int indexNo)
         strcat(indexFileName, fileName);
         sprintf(indexFileName + strlen(fileName), ".%d", indexNo);
         IX_Try(pfm.DestroyFile(indexFileName), IX_MANAGER_DESTROY_FAIL);
-
-        throw RC{OK_RC};
     }
     catch (RC rc)
     {
         return rc;
     }
+    return OK_RC;
 }
 
 RC IX_Manager::OpenIndex(const char *fileName, int indexNo, IX_IndexHandle &indexHandle)
@@ -127,9 +125,9 @@ RC IX_Manager::OpenIndex(const char *fileName, int indexNo, IX_IndexHandle &inde
         indexHandle.header.rootPage = *(PageNum *)(headerData + offsetof(IX_IndexHeader, rootPage));
         indexHandle.header.pageTot = *(PageNum *)(headerData + offsetof(IX_IndexHeader, pageTot));
         indexHandle.header.innerEntryLength = indexHandle.header.attrLength + sizeof(PageNum);
-        indexHandle.header.leafEntryLength = indexHandle.header.attrLength + sizeof(RID);
+        indexHandle.header.leafEntryLength = indexHandle.header.attrLength + sizeof(IX_Posting);
         indexHandle.header.innerDeg = (PF_PAGE_SIZE - sizeof(bool) - sizeof(int)) / indexHandle.header.innerEntryLength;
-        indexHandle.header.leafDeg = (PF_PAGE_SIZE - sizeof(bool) - sizeof(int)) / indexHandle.header.leafEntryLength;
+        indexHandle.header.leafDeg = (PF_PAGE_SIZE - sizeof(bool) - sizeof(int) - IX_LEAF_LINK_SIZE) / indexHandle.header.leafEntryLength;
         IX_Try(indexHandle.pFFileHandle.UnpinPage(0ll), IX_MANAGER_OPEN_BUT_UNPIN_FAIL);
 
 #ifdef IX_LOG
@@ -138,13 +136,12 @@ RC IX_Manager::OpenIndex(const char *fileName, int indexNo, IX_IndexHandle &inde
 #endif
 
         indexHandle.open = true;
-
-        throw RC{OK_RC};
     }
     catch (RC rc)
     {
         return rc;
     }
+    return OK_RC;
 }
 
 RC IX_Manager::CloseIndex(IX_IndexHandle &indexHandle)
@@ -177,11 +174,10 @@ RC IX_Manager::CloseIndex(IX_IndexHandle &indexHandle)
         // Close
         IX_Try(pfm.CloseFile(indexHandle.pFFileHandle), IX_MANAGER_CLOSE_FAIL);
         indexHandle.open = false;
-
-        throw RC{OK_RC};
     }
     catch (RC rc)
     {
         return rc;
     }
+    return OK_RC;
 }
\ No newline at end of file
@@ -0,0 +1,499 @@
+//
+// File:        ix_posting.cc
+// Description: The RIDs of a key in the index, delta-encoded: a few kept in its
+//              leaf entry, or more in a list of buckets
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "ix_internal.h"
+#include "ix.h"
+using namespace std;
+
+// The order of RIDs in a posting list
+static inline bool RIDLess(const RID &a, const RID &b)
+{
+    return a.pageNum != b.pageNum ? a.pageNum < b.pageNum : a.slotNum < b.slotNum;
+}
+
+static inline bool RIDEqual(const RID &a, const RID &b)
+{
+    return a.pageNum == b.pageNum && a.slotNum == b.slotNum;
+}
+
+static inline int PutVarint(char *out, unsigned long long value)
+{
+    int n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (char)value;
+    return n;
+}
+
+static inline unsigned long long GetVarint(const char *&in)
+{
+    unsigned long long value = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        unsigned char byte = *in++;
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+            return value;
+    }
+}
+
+// Encode [rid] against [prev], and return the bytes taken
+static int EncodeRID(char *out, const RID &prev, const RID &rid)
+{
+    if (rid.pageNum == prev.pageNum)
+        return PutVarint(out, (unsigned long long)(rid.slotNum - prev.slotNum) << 1);
+    int n = PutVarint(out, (unsigned long long)(rid.pageNum - prev.pageNum) << 1 | 1);
+    return n + PutVarint(out + n, (unsigned long long)rid.slotNum);
+}
+
+// Decode the RID after [rid]
+static inline void DecodeRID(const char *&in, RID &rid)
+{
+    unsigned long long code = GetVarint(in);
+    if (code & 1)
+    {
+        rid.pageNum += code >> 1;
+        rid.slotNum = GetVarint(in);
+    }
+    else
+        rid.slotNum += code >> 1;
+}
+
+// The longest encoding of a RID
+const int IX_MAX_RID_BYTES = 20;
+
+// Decode [n] RIDs from [in]
+static void DecodeRIDs(const char *in, int n, RID *rids)
+{
+    RID rid(0, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        DecodeRID(in, rid);
+        rids[i] = rid;
+    }
+}
+
+// Encode [n] RIDs, and return the bytes taken, or -1 if more than [capacity].
+// [out] must have IX_MAX_RID_BYTES more than [capacity].
+static int EncodeRIDs(char *out, int capacity, const RID *rids, size_t n)
+{
+    static const RID origin(0, 0);
+    int used = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        used += EncodeRID(out + used, i > 0 ? rids[i - 1] : origin, rids[i]);
+        if (used > capacity)
+            return -1;
+    }
+    return used;
+}
+
+// Keep [n] RIDs in [posting] itself, and return false if they don't fit,
+// when it's left as it was
+static bool WriteInline(IX_Posting &posting, const RID *rids, int n)
+{
+    char buffer[IX_POSTING_INLINE + IX_MAX_RID_BYTES];
+    int used = EncodeRIDs(buffer, IX_POSTING_INLINE, rids, n);
+    if (used < 0)
+        return false;
+    memcpy(posting.data, buffer, used);
+    posting.used = used;
+    posting.count = n;
+    return true;
+}
+
+//
+// IX_Bucket: a bucket page, pinned while the object lives
+//
+class IX_Bucket
+{
+public:
+    // Pin bucket [pageNum]
+    IX_Bucket(const PF_FileHandle &file, PageNum pageNum) : file(file), pageNum(pageNum)
+    {
+        PF_PageHandle pageHandle;
+        IX_Try(file.GetThisPage(pageNum, pageHandle), IX_BUCKET_FAIL);
+        IX_TryElseUnpin(pageHandle.GetData(pageData), IX_BUCKET_FAIL, IX_BUCKET_FAIL, file, pageNum);
+        pinned = true;
+    }
+
+    // Allocate an empty bucket
+    IX_Bucket(IX_IndexHandle &indexHandle) : file(indexHandle.pFFileHandle)
+    {
+        PF_PageHandle pageHandle;
+        pageNum = indexHandle.AllocatePage(pageHandle, IX_BUCKET_FAIL);
+        IX_TryElseUnpin(pageHandle.GetData(pageData), IX_BUCKET_FAIL, IX_BUCKET_FAIL, file, pageNum);
+        pinned = true;
+        MarkDirty();
+        memset(pageData, 0, sizeof(IX_BucketHeader));
+    }
+
+    // Unpin the bucket left pinned by an exception
+    ~IX_Bucket()
+    {
+        if (pinned)
+            file.UnpinPage(pageNum);
+    }
+
+    void MarkDirty() { IX_Try(file.MarkDirty(pageNum), IX_BUCKET_FAIL); }
+
+    void Unpin()
+    {
+        pinned = false;
+        IX_Try(file.UnpinPage(pageNum), IX_BUCKET_FAIL);
+    }
+
+    IX_BucketHeader &Header() { return *(IX_BucketHeader *)pageData; }
+    RID Last() { return RID(Header().lastPage, Header().lastSlot); }
+
+    // Decode all the RIDs
+    void Read(vector<RID> &rids)
+    {
+        rids.resize(Header().count);
+        DecodeRIDs(pageData + sizeof(IX_BucketHeader), Header().count, rids.data());
+    }
+
+    // Encode [rids] from [begin] to [end] as the content of the bucket,
+    // and return false if they don't fit, when the bucket is left as it was
+    bool Write(const vector<RID> &rids, size_t begin, size_t end)
+    {
+        char buffer[IX_BUCKET_DATA_SIZE + IX_MAX_RID_BYTES];
+        int used = EncodeRIDs(buffer, IX_BUCKET_DATA_SIZE, rids.data() + begin, end - begin);
+        if (used < 0)
+            return false;
+
+        MarkDirty();
+        memcpy(pageData + sizeof(IX_BucketHeader), buffer, used);
+        Header().count = end - begin;
+        Header().used = used;
+        Header().lastPage = end > begin ? rids[end - 1].pageNum : 0;
+        Header().lastSlot = end > begin ? rids[end - 1].slotNum : 0;
+        return true;
+    }
+
+    // Remove [rid] in place, and return false if it isn't there.
+    // The RID after it is encoded against the one before it instead,
+    // which never takes more bytes than the two codes did.
+    bool Remove(const RID &rid)
+    {
+        char *data = pageData + sizeof(IX_BucketHeader);
+        const char *in = data;
+        RID prev(0, 0), cur(0, 0);
+        for (int i = 0; i < Header().count; ++i)
+        {
+            int offset = in - data;
+            DecodeRID(in, cur);
+            if (RIDLess(cur, rid))
+            {
+                prev = cur;
+                continue;
+            }
+            if (!RIDEqual(cur, rid))
+                return false;
+
+            MarkDirty();
+            int end = in - data, n = 0;
+            if (i + 1 < Header().count)
+            {
+                RID next = cur;
+                DecodeRID(in, next);
+                n = EncodeRID(data + offset, prev, next);
+                end = in - data;
+            }
+            else
+            {
+                Header().lastPage = prev.pageNum;
+                Header().lastSlot = prev.slotNum;
+            }
+            memmove(data + offset + n, data + end, Header().used - end);
+            Header().used -= end - offset - n;
+            Header().count--;
+            return true;
+        }
+        return false;
+    }
+
+    // Append [rid], which is after the last one, and return false if it doesn't fit
+    bool Append(const RID &rid)
+    {
+        char buffer[IX_MAX_RID_BYTES];
+        int n = EncodeRID(buffer, Header().count ? Last() : RID(0, 0), rid);
+        if (Header().used + n > IX_BUCKET_DATA_SIZE)
+            return false;
+
+        MarkDirty();
+        memcpy(pageData + sizeof(IX_BucketHeader) + Header().used, buffer, n);
+        Header().count++;
+        Header().used += n;
+        Header().lastPage = rid.pageNum;
+        Header().lastSlot = rid.slotNum;
+        return true;
+    }
+
+    const PF_FileHandle &file;
+    PageNum pageNum;
+    char *pageData;
+    bool pinned;
+};
+
+//
+// Desc: Store [rids] in [bucket], splitting it in two halves if they don't fit
+//
+// Ret:  The page of the second half, linked after [bucket], or 0 if no split
+static PageNum StoreRIDs(IX_IndexHandle &indexHandle, IX_Bucket &bucket, const vector<RID> &rids)
+{
+    if (bucket.Write(rids, 0, rids.size()))
+        return 0;
+
+    IX_Bucket right(indexHandle);
+    size_t half = rids.size() / 2;
+    bucket.Write(rids, 0, half);
+    right.Write(rids, half, rids.size());
+    right.Header().next = bucket.Header().next;
+    bucket.Header().next = right.pageNum;
+    PageNum rightPageNum = right.pageNum;
+    right.Unpin();
+    return rightPageNum;
+}
+
+//
+// Desc: Move the RIDs of [posting] from its buckets back into the entry
+//       if they fit there, and dispose of the buckets
+//
+static void MoveInline(IX_IndexHandle &indexHandle, IX_Posting &posting)
+{
+    vector<PageNum> buckets;
+    vector<RID> rids, left;
+    for (PageNum next = posting.FirstBucket(); next != 0;)
+    {
+        buckets.push_back(next);
+        next = indexHandle.Posting_ReadBucket(next, rids);
+        left.insert(left.end(), rids.begin(), rids.end());
+    }
+    if (!WriteInline(posting, left.data(), left.size()))
+        return;
+    for (PageNum bucketPageNum : buckets)
+        IX_Try(indexHandle.pFFileHandle.DisposePage(bucketPageNum), IX_BUCKET_FAIL);
+}
+
+//
+// Desc: Add [rid] to the RIDs of a key
+//
+/* Steps:
+    1) RIDs in the entry are changed there, or all moved to a new bucket
+       once they don't fit any more
+    2) A RID after the last one is appended to the tail bucket,
+       or to a new tail if it's full
+    3) Otherwise, it's inserted into the first bucket whose last RID is after it,
+       which is split if it overflows
+*/
+bool IX_IndexHandle::Posting_Insert(IX_Posting &posting, const RID &rid)
+{
+    // 1) In the entry, which holds a byte per RID at least
+    if (posting.count == 0 && WriteInline(posting, &rid, 1))
+        return true;
+    if (!posting.InBuckets())
+    {
+        RID rids[IX_POSTING_INLINE + 1];
+        DecodeRIDs(posting.data, posting.count, rids);
+        RID *it = lower_bound(rids, rids + posting.count, rid, RIDLess);
+        if (it != rids + posting.count && RIDEqual(*it, rid))
+            return false;
+        copy_backward(it, rids + posting.count, rids + posting.count + 1);
+        *it = rid;
+        if (WriteInline(posting, rids, posting.count + 1))
+            return true;
+
+        IX_Bucket first(*this);
+        first.Write(vector<RID>(rids, rids + posting.count + 1), 0, posting.count + 1);
+        first.Header().tail = first.pageNum;
+        posting.SetFirstBucket(first.pageNum);
+        ++posting.count;
+        first.Unpin();
+        return true;
+    }
+
+    // 2) Append
+    IX_Bucket first(pFFileHandle, posting.FirstBucket());
+    IX_Bucket tail(pFFileHandle, first.Header().tail);
+    if (RIDLess(tail.Last(), rid))
+    {
+        if (!tail.Append(rid))
+        {
+            IX_Bucket next(*this);
+            next.Append(rid);
+            tail.MarkDirty();
+            tail.Header().next = next.pageNum;
+            first.MarkDirty();
+            first.Header().tail = next.pageNum;
+            next.Unpin();
+        }
+        tail.Unpin();
+        first.Unpin();
+        ++posting.count;
+        return true;
+    }
+    tail.Unpin();
+
+    // 3) Insert in the middle, before the last RID of the tail at the latest
+    for (PageNum pageNum = first.pageNum;;)
+    {
+        IX_Bucket bucket(pFFileHandle, pageNum);
+        if (RIDLess(bucket.Last(), rid))
+        {
+            pageNum = bucket.Header().next;
+            bucket.Unpin();
+            continue;
+        }
+
+        vector<RID> rids;
+        bucket.Read(rids);
+        auto it = lower_bound(rids.begin(), rids.end(), rid, RIDLess);
+        bool exists = it != rids.end() && RIDEqual(*it, rid);
+        if (!exists)
+        {
+            rids.insert(it, rid);
+            PageNum rightPageNum = StoreRIDs(*this, bucket, rids);
+            if (rightPageNum != 0 && first.Header().tail == bucket.pageNum)
+            {
+                first.MarkDirty();
+                first.Header().tail = rightPageNum;
+            }
+            ++posting.count;
+        }
+        bucket.Unpin();
+        first.Unpin();
+        return !exists;
+    }
+}
+
+//
+// Desc: Remove [rid] from the RIDs of a key
+//
+/* Steps:
+    1) RIDs in the entry are changed there, which never takes more bytes
+    2) Find the first bucket whose last RID is not before [rid], and remove it there,
+       unlinking the bucket if it's empty and others are left
+    3) Once few RIDs are left, move them back into the entry if they fit.
+       Half of IX_POSTING_INLINE keeps a key from moving back and forth.
+*/
+bool IX_IndexHandle::Posting_Delete(IX_Posting &posting, const RID &rid)
+{
+    // 1) In the entry
+    if (!posting.InBuckets())
+    {
+        RID rids[IX_POSTING_INLINE];
+        DecodeRIDs(posting.data, posting.count, rids);
+        RID *it = lower_bound(rids, rids + posting.count, rid, RIDLess);
+        if (it == rids + posting.count || !RIDEqual(*it, rid))
+            return false;
+        copy(it + 1, rids + posting.count, it);
+        WriteInline(posting, rids, posting.count - 1);
+        return true;
+    }
+
+    // 2) Find the bucket, and the one before it
+    IX_Bucket first(pFFileHandle, posting.FirstBucket());
+    PageNum prevPageNum = 0;
+    for (PageNum pageNum = first.pageNum; pageNum != 0;)
+    {
+        IX_Bucket bucket(pFFileHandle, pageNum);
+        if (RIDLess(bucket.Last(), rid))
+        {
+            prevPageNum = pageNum;
+            pageNum = bucket.Header().next;
+            bucket.Unpin();
+            continue;
+        }
+
+        if (!bucket.Remove(rid))
+        {
+            bucket.Unpin();
+            break;
+        }
+
+        if (bucket.Header().count == 0 && posting.count > 1)
+        {
+            // Unlink the empty bucket
+            PageNum nextPageNum = bucket.Header().next;
+            if (pageNum == first.pageNum)
+            {
+                IX_Bucket next(pFFileHandle, nextPageNum);
+                next.MarkDirty();
+                next.Header().tail = first.Header().tail;
+                next.Unpin();
+                posting.SetFirstBucket(nextPageNum);
+            }
+            else
+            {
+                IX_Bucket prev(pFFileHandle, prevPageNum);
+                prev.MarkDirty();
+                prev.Header().next = nextPageNum;
+                prev.Unpin();
+                if (first.Header().tail == pageNum)
+                {
+                    first.MarkDirty();
+                    first.Header().tail = prevPageNum;
+                }
+            }
+            bucket.Unpin();
+            first.Unpin();
+            IX_Try(pFFileHandle.DisposePage(pageNum), IX_BUCKET_FAIL);
+        }
+        else
+        {
+            bucket.Unpin();
+            first.Unpin();
+        }
+        --posting.count;
+
+        // 3) Back into the entry
+        if (posting.count <= IX_POSTING_INLINE / 2)
+            MoveInline(*this, posting);
+        return true;
+    }
+    first.Unpin();
+    return false;
+}
+
+PageNum IX_IndexHandle::Posting_Read(const IX_Posting &posting, vector<RID> &rids) const
+{
+    if (posting.InBuckets())
+    {
+        rids.clear();
+        return posting.FirstBucket();
+    }
+    rids.resize(posting.count);
+    DecodeRIDs(posting.data, posting.count, rids.data());
+    return 0;
+}
+
+bool IX_IndexHandle::Posting_ReadSingle(const IX_Posting &posting, RID &rid) const
+{
+    if (posting.count != 1 || posting.InBuckets())
+        return false;
+    const char *in = posting.data;
+    RID single(0, 0);
+    DecodeRID(in, single);
+    rid = single;
+    return true;
+}
+
+PageNum IX_IndexHandle::Posting_ReadBucket(PageNum bucketPageNum, vector<RID> &rids) const
+{
+    IX_Bucket bucket(pFFileHandle, bucketPageNum);
+    bucket.Read(rids);
+    PageNum next = bucket.Header().next;
+    bucket.Unpin();
+    return next;
+}
@@ -0,0 +1,237 @@
+//
+// File:        ix_search.cc
+// Description: Search of keys in a node of the B+ tree, with SSE2 and AVX2
+//              comparison of INT and FLOAT keys
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <cstring>
+#include "ix_internal.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define IX_HAVE_SIMD
+#endif
+
+using namespace std;
+
+// The key of entry [i], which may be unaligned
+template <typename T>
+static inline T KeyAt(const char *entries, int entryLength, int i)
+{
+    T key;
+    memcpy(&key, entries + i * entryLength, sizeof(T));
+    return key;
+}
+
+// Is the key of an entry before the bound,
+// i.e. less than [key], or not greater than it if [bUpper]
+template <typename T>
+static inline bool Before(T entryKey, T key, bool bUpper)
+{
+    return bUpper ? !(key < entryKey) : entryKey < key;
+}
+
+// Binary search of the entries in [lo, hi)
+template <typename T>
+static int BinarySearch(const char *entries, int entryLength, int lo, int hi, T key, bool bUpper)
+{
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (Before(KeyAt<T>(entries, entryLength, mid), key, bUpper))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+#ifdef IX_HAVE_SIMD
+
+//
+// The entries in [lo, hi) are counted rather than searched, since they are sorted.
+// The keys are at a stride of [entryLength], so AVX2 gathers 8 of them at once,
+// while SSE2 loads 4 of them one by one.  The few left are counted one by one.
+//
+
+static inline int CountLanes(int mask, int lanes, bool bUpper)
+{
+    return bUpper ? lanes - __builtin_popcount(mask) : __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2")))
+static int CountBeforeAVX2(const char *entries, int entryLength, int lo, int hi, int key, bool bUpper)
+{
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(entryLength));
+    const __m256i keys = _mm256_set1_epi32(key);
+    int count = 0, i = lo;
+    for (; i + 8 <= hi; i += 8)
+    {
+        __m256i lanes = _mm256_i32gather_epi32((const int *)(entries + i * entryLength), offsets, 1);
+        // Less than [key], or for [bUpper], greater than it
+        __m256i mask = bUpper ? _mm256_cmpgt_epi32(lanes, keys) : _mm256_cmpgt_epi32(keys, lanes);
+        count += CountLanes(_mm256_movemask_ps(_mm256_castsi256_ps(mask)), 8, bUpper);
+    }
+    for (; i < hi; ++i)
+        count += Before(KeyAt<int>(entries, entryLength, i), key, bUpper);
+    return count;
+}
+
+__attribute__((target("avx2")))
+static int CountBeforeAVX2(const char *entries, int entryLength, int lo, int hi, float key, bool bUpper)
+{
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(entryLength));
+    const __m256 keys = _mm256_set1_ps(key);
+    int count = 0, i = lo;
+    for (; i + 8 <= hi; i += 8)
+    {
+        __m256 lanes = _mm256_i32gather_ps((const float *)(entries + i * entryLength), offsets, 1);
+        __m256 mask = bUpper ? _mm256_cmp_ps(lanes, keys, _CMP_LE_OQ) : _mm256_cmp_ps(lanes, keys, _CMP_LT_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(mask));
+    }
+    for (; i < hi; ++i)
+        count += Before(KeyAt<float>(entries, entryLength, i), key, bUpper);
+    return count;
+}
+
+static int CountBeforeSSE2(const char *entries, int entryLength, int lo, int hi, int key, bool bUpper)
+{
+    const __m128i keys = _mm_set1_epi32(key);
+    int count = 0, i = lo;
+    for (; i + 4 <= hi; i += 4)
+    {
+        __m128i lanes = _mm_setr_epi32(KeyAt<int>(entries, entryLength, i), KeyAt<int>(entries, entryLength, i + 1),
+                                       KeyAt<int>(entries, entryLength, i + 2), KeyAt<int>(entries, entryLength, i + 3));
+        __m128i mask = bUpper ? _mm_cmpgt_epi32(lanes, keys) : _mm_cmpgt_epi32(keys, lanes);
+        count += CountLanes(_mm_movemask_ps(_mm_castsi128_ps(mask)), 4, bUpper);
+    }
+    for (; i < hi; ++i)
+        count += Before(KeyAt<int>(entries, entryLength, i), key, bUpper);
+    return count;
+}
+
+static int CountBeforeSSE2(const char *entries, int entryLength, int lo, int hi, float key, bool bUpper)
+{
+    const __m128 keys = _mm_set1_ps(key);
+    int count = 0, i = lo;
+    for (; i + 4 <= hi; i += 4)
+    {
+        __m128 lanes = _mm_setr_ps(KeyAt<float>(entries, entryLength, i), KeyAt<float>(entries, entryLength, i + 1),
+                                   KeyAt<float>(entries, entryLength, i + 2), KeyAt<float>(entries, entryLength, i + 3));
+        __m128 mask = bUpper ? _mm_cmple_ps(lanes, keys) : _mm_cmplt_ps(lanes, keys);
+        count += __builtin_popcount(_mm_movemask_ps(mask));
+    }
+    for (; i < hi; ++i)
+        count += Before(KeyAt<float>(entries, entryLength, i), key, bUpper);
+    return count;
+}
+
+static bool HasAVX2()
+{
+    static const bool bAVX2 = __builtin_cpu_supports("avx2");
+    return bAVX2;
+}
+
+#endif // IX_HAVE_SIMD
+
+// Narrow down by binary search, then count the window by SIMD
+template <typename T>
+static int SearchNumbers(const char *entries, int entryLength, int childTot, const void *pData, bool bUpper)
+{
+    T key;
+    memcpy(&key, pData, sizeof(T));
+    int lo = 0, hi = childTot;
+#ifdef IX_HAVE_SIMD
+    while (hi - lo > IX_SIMD_WINDOW)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (Before(KeyAt<T>(entries, entryLength, mid), key, bUpper))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (HasAVX2())
+        return lo + CountBeforeAVX2(entries, entryLength, lo, hi, key, bUpper);
+    return lo + CountBeforeSSE2(entries, entryLength, lo, hi, key, bUpper);
+#else
+    return BinarySearch<T>(entries, entryLength, lo, hi, key, bUpper);
+#endif
+}
+
+int IX_SearchNode(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                  int childTot, const void *pData, bool bUpper)
+{
+    switch (attrType)
+    {
+    case INT:
+        return SearchNumbers<int>(entries, entryLength, childTot, pData, bUpper);
+    case FLOAT:
+        return SearchNumbers<float>(entries, entryLength, childTot, pData, bUpper);
+    default:
+        return IX_SearchNodeBinary(attrType, attrLength, entries, entryLength, childTot, pData, bUpper);
+    }
+}
+
+int IX_SearchNodeBinary(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                        int childTot, const void *pData, bool bUpper)
+{
+    switch (attrType)
+    {
+    case INT:
+        return BinarySearch<int>(entries, entryLength, 0, childTot, *(const int *)pData, bUpper);
+    case FLOAT:
+        return BinarySearch<float>(entries, entryLength, 0, childTot, *(const float *)pData, bUpper);
+    default:
+    {
+        // Strings and dates are compared bytewise, as memcmp does
+        int length = attrType == DATE ? 10 : attrLength;
+        int lo = 0, hi = childTot;
+        while (lo < hi)
+        {
+            int mid = lo + (hi - lo) / 2;
+            int c = memcmp(entries + mid * entryLength, pData, length);
+            if (bUpper ? c <= 0 : c < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    }
+}
+
+int IX_SearchNodeLinear(AttrType attrType, int attrLength, const char *entries, int entryLength,
+                        int childTot, const void *pData, bool bUpper)
+{
+    int length = attrType == DATE ? 10 : attrLength;
+    for (int i = 0; i < childTot; ++i)
+    {
+        const char *entryKey = entries + i * entryLength;
+        int c;
+        switch (attrType)
+        {
+        case INT:
+            c = (*(const int *)entryKey > *(const int *)pData) - (*(const int *)entryKey < *(const int *)pData);
+            break;
+        case FLOAT:
+            c = (*(const float *)entryKey > *(const float *)pData) - (*(const float *)entryKey < *(const float *)pData);
+            break;
+        default:
+            c = memcmp(entryKey, pData, length);
+            break;
+        }
+        if (bUpper ? c > 0 : c >= 0)
+            return i;
+    }
+    return childTot;
+}
+
+const char *IX_SearchSIMD()
+{
+#ifdef IX_HAVE_SIMD
+    return HasAVX2() ? "avx2" : "sse2";
+#else
+    return "none";
+#endif
+}
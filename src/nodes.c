@@ -121,6 +121,19 @@ NODE *drop_index_node(char *relname, char *attrname)
     return n;
 }
 
+/*
+ * compact_index_node: allocates, initializes, and returns a pointer to a new
+ * compact index node having the indicated values.
+ */
+NODE *compact_index_node(char *relname, char *attrname)
+{
+    NODE *n = newnode(N_COMPACTINDEX);
+
+    n->u.COMPACTINDEX.relname = relname;
+    n->u.COMPACTINDEX.attrname = attrname;
+    return n;
+}
+
 /*
  * drop_table_node: allocates, initializes, and returns a pointer to a new
  * drop table node having the indicated values.
@@ -183,6 +196,18 @@ NODE *print_node(char *relname)
     return n;
 }
 
+/*
+ * analyze_node: allocates, initializes, and returns a pointer to a new
+ * analyze node having the indicated values.
+ */
+NODE *analyze_node(char *relname)
+{
+    NODE *n = newnode(N_ANALYZE);
+
+    n->u.ANALYZE.relname = relname;
+    return n;
+}
+
 /*
  * query_node: allocates, initializes, and returns a pointer to a new
  * query node having the indicated values.
@@ -66,6 +66,8 @@ PF_Manager *pPfm;          // PF component manager
 SM_Manager *pSmm;          // SM component manager
 QL_Manager *pQlm;          // QL component manager
 
+static void print_io();    // for "print io" and "show io"
+
 %}
 
 %union{
@@ -118,6 +120,8 @@ QL_Manager *pQlm;          // QL component manager
       RW_ON
       RW_OFF
       RW_DISTRIBUTED
+      RW_ANALYZE
+      RW_COMPACT
 
 %token   <ival>   T_INT
 
@@ -139,10 +143,12 @@ QL_Manager *pQlm;          // QL component manager
       createindex
       droptable
       dropindex
+      compactindex
       load
       set
       help
       print
+      analyze
       exit
       query
       insert
@@ -216,6 +222,7 @@ ddl
    | createindex
    | droptable
    | dropindex
+   | compactindex
    ;
 
 dml
@@ -231,6 +238,7 @@ utility
    | set
    | help
    | print
+   | analyze
    | buffer
    | statistics
    | queryplans
@@ -269,7 +277,9 @@ buffer
    }
    | RW_RESIZE RW_BUFFER T_INT
    {
-      pPfm->ResizeBuffer($3);
+      RC rc = pPfm->ResizeBuffer($3);
+      if (rc)
+         PrintError(rc);
       $$ = NULL;
    }
    ;
@@ -277,13 +287,12 @@ buffer
 statistics
    : RW_PRINT RW_IO
    {
-      #ifdef PF_STATS
-         cout << "Statistics\n";
-         cout << "----------\n";
-         pStatisticsMgr->Print();
-      #else
-         cout << "Statitisics not compiled.\n";
-      #endif
+      print_io();
+      $$ = NULL;
+   }
+   | RW_SHOW RW_IO
+   {
+      print_io();
       $$ = NULL;
    }
    | RW_RESET RW_IO
@@ -326,6 +335,13 @@ dropindex
    }
    ;
 
+compactindex
+   : RW_COMPACT RW_INDEX T_STRING '(' T_STRING ')'
+   {
+      $$ = compact_index_node($3, $5);
+   }
+   ;
+
 load
    : RW_LOAD T_STRING '(' T_QSTRING ')'
    {
@@ -367,6 +383,13 @@ print
    }
    ;
 
+analyze
+   : RW_ANALYZE T_STRING
+   {
+      $$ = analyze_node($2);
+   }
+   ;
+
 exit
    : RW_EXIT
    {
@@ -624,6 +647,25 @@ void PrintError(RC rc)
       cerr << "Error code out of range: " << rc << "\n";
 }
 
+//
+// print_io
+//
+// Desc: Print the statistics of the PF layer, with the hit ratio of the
+//       buffer under each replacement policy and the use of read-ahead
+//
+static void print_io()
+{
+#ifdef PF_STATS
+   cout << "Statistics\n";
+   cout << "----------\n";
+   pStatisticsMgr->Print();
+   PF_ReplacerStatistics();
+   PF_PrefetchStatistics();
+#else
+   cout << "Statitisics not compiled.\n";
+#endif
+}
+
 //
 // RBparse
 //
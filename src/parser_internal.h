@@ -51,12 +51,14 @@ typedef enum
     N_CREATEINDEX,
     N_DROPTABLE,
     N_DROPINDEX,
+    N_COMPACTINDEX,
     N_LOAD,
     N_SET,
     N_HELP,
     N_SHOWDATABASE,
     N_SHOWTABLE,
     N_PRINT,
+    N_ANALYZE,
     N_QUERY,
     N_INSERT,
     N_DELETE,
@@ -103,6 +105,13 @@ typedef struct node
             char *attrname;
         } DROPINDEX;
 
+        /* compact index node */
+        struct
+        {
+            char *relname;
+            char *attrname;
+        } COMPACTINDEX;
+
         /* drop table node */
         struct
         {
@@ -135,6 +144,12 @@ typedef struct node
             char *relname;
         } PRINT;
 
+        /* analyze node */
+        struct
+        {
+            char *relname;
+        } ANALYZE;
+
         /* QL component nodes */
         /* query node */
         struct
@@ -237,11 +252,13 @@ NODE *newnode(NODEKIND kind);
 NODE *create_table_node(char *relname, NODE *attrlist, NODE *distribute_data);
 NODE *create_index_node(char *relname, char *attrname);
 NODE *drop_index_node(char *relname, char *attrname);
+NODE *compact_index_node(char *relname, char *attrname);
 NODE *drop_table_node(char *relname);
 NODE *load_node(char *relname, char *filename);
 NODE *set_node(char *paramName, char *string);
 NODE *help_node(char *relname);
 NODE *print_node(char *relname);
+NODE *analyze_node(char *relname);
 NODE *query_node(NODE *relattrlist, NODE *rellist, NODE *conditionlist);
 NODE *insert_node(char *relname, NODE *valuelist);
 NODE *delete_node(char *relname, NODE *conditionlist);
@@ -71,7 +71,15 @@ struct PF_FileHdr
 //
 // PF_FileHandle: PF File interface
 //
+// A file opened read-only while mapping is on hands out its pages straight
+// from a read-only mapping of the file, so they must not be written.  New
+// pages, disposed pages and any page the buffer holds still go through the
+// buffer manager.  The mapping is only read while no writable handle of the
+// same file is open, see PF_Manager::OpenFile.
+//
 class PF_BufferMgr;
+struct PF_FileMap;
+struct PF_FileTable;
 
 class PF_FileHandle
 {
@@ -91,8 +99,9 @@ public:
     RC GetFirstPage(PF_PageHandle &pageHandle) const;
     // Get the next page after current
     RC GetNextPage(PageNum current, PF_PageHandle &pageHandle) const;
-    // Get a specific page
-    RC GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle) const;
+    // Get a specific page, bScan if it's read by a sequential scan
+    RC GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle,
+                   int bScan = FALSE) const;
     // Get the last page
     RC GetLastPage(PF_PageHandle &pageHandle) const;
     // Get the prev page after current
@@ -113,12 +122,15 @@ private:
     // IsValidPageNum will return TRUE if page number is valid and FALSE
     // otherwise
     int IsValidPageNum(PageNum pageNum) const;
+    // IsMapped will return TRUE if the page is read from the mapping
+    int IsMapped(PageNum pageNum) const;
 
     PF_BufferMgr *pBufferMgr; // pointer to buffer manager
     PF_FileHdr hdr;           // file header
     int bFileOpen;            // file open flag
     int bHdrChanged;          // dirty flag for file hdr
     int unixfd;               // OS file descriptor
+    PF_FileMap *pMap;         // read-only mapping of the file, or NULL
 };
 
 //
@@ -127,21 +139,32 @@ private:
 class PF_Manager
 {
 public:
-    PF_Manager();                         // Constructor
+    PF_Manager();                         // Constructor, with the default
+                                          //   number of buffer pages
+    PF_Manager(int numPages);             // Constructor, with numPages
+                                          //   buffer pages
     ~PF_Manager();                        // Destructor
     RC CreateFile(const char *fileName);  // Create a new file
     RC DestroyFile(const char *fileName); // Delete a file
 
-    // Open and close file methods
-    RC OpenFile(const char *fileName, PF_FileHandle &fileHandle);
+    // Open and close file methods.  bReadOnly promises that no page of
+    // the file is written through fileHandle, so it may be mapped.
+    // Handles of a file don't share buffer pages, so the dirty pages of a
+    // writable handle can't be seen by another one.  A file is therefore
+    // not mapped while a writable handle of it is open, and a mapped handle
+    // reads through the buffer instead while one is.
+    RC OpenFile(const char *fileName, PF_FileHandle &fileHandle,
+                int bReadOnly = FALSE);
     RC CloseFile(PF_FileHandle &fileHandle);
 
-    // Three methods that manipulate the buffer manager.  The calls are
+    // Methods that manipulate the buffer manager.  The calls are
     // forwarded to the PF_BufferMgr instance and are called by parse.y
-    // when the user types in a system command.
+    // or SM_Manager::Set when the user types in a system command.
     RC ClearBuffer();
     RC PrintBuffer();
     RC ResizeBuffer(int iNewSize);
+    RC SetReplacer(const char *name);
+    RC SetMapping(int bMapping); // Map files opened read-only from now on
 
     // Three Methods for manipulating raw memory buffers.  These memory
     // locations are handled by the buffer manager, but are not
@@ -164,6 +187,8 @@ public:
 
 private:
     PF_BufferMgr *pBufferMgr; // page-buffer manager
+    int bMapping;             // map files opened read-only
+    PF_FileTable *pFiles;     // writable handles open
 };
 
 //
@@ -180,7 +205,9 @@ void PF_PrintError(RC rc);
 #define PF_PAGEUNPINNED (START_PF_WARN + 6) // page already unpinned
 #define PF_EOF (START_PF_WARN + 7)          // end of file
 #define PF_TOOSMALL (START_PF_WARN + 8)     // Resize buffer too small
-#define PF_LASTWARN PF_TOOSMALL
+#define PF_BADREPLACER (START_PF_WARN + 9)  // unknown replacement policy
+#define PF_PAGEMAPPED (START_PF_WARN + 10)  // page is mapped read-only
+#define PF_LASTWARN PF_PAGEMAPPED
 
 #define PF_NOMEM (START_PF_ERR - 0)           // no memory
 #define PF_NOBUF (START_PF_ERR - 1)           // no buffer space
@@ -0,0 +1,335 @@
+//
+// File:        pf_aio.cc
+// Description: PF_AsyncIO class implementation, with io_uring, thread pool
+//              and synchronous engines
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <strings.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "pf_aio.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define PF_HAVE_IO_URING
+#endif
+#endif
+
+using namespace std;
+
+// Do one request right away
+static void RunRequest(PF_IORequest &request)
+{
+    if (request.bWrite)
+        request.result = pwritev(request.fd, request.iov, request.iovcnt, request.offset);
+    else
+        request.result = preadv(request.fd, request.iov, request.iovcnt, request.offset);
+    if (request.result < 0)
+        request.result = -errno;
+}
+
+//
+// PF_SyncIO: does every request within Submit, for systems or debugging
+// sessions without threads
+//
+class PF_SyncIO : public PF_AsyncIO
+{
+public:
+    const char *Name() const { return "sync"; }
+
+    void Submit(PF_IORequest *requests, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            RunRequest(requests[i]);
+    }
+
+    void Wait() {}
+};
+
+//
+// PF_ThreadIO: hands the requests to a pool of PF_AIO_THREADS threads,
+// which run them with blocking calls
+//
+class PF_ThreadIO : public PF_AsyncIO
+{
+public:
+    PF_ThreadIO()
+    {
+        for (int i = 0; i < PF_AIO_THREADS; ++i)
+            workers.emplace_back(&PF_ThreadIO::Work, this);
+    }
+
+    ~PF_ThreadIO()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            bStop = true;
+        }
+        hasWork.notify_all();
+        for (thread &worker : workers)
+            worker.join();
+    }
+
+    const char *Name() const { return "threads"; }
+
+    void Submit(PF_IORequest *requests, int count)
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            for (int i = 0; i < count; ++i)
+                queue.push_back(&requests[i]);
+            numPending += count;
+        }
+        hasWork.notify_all();
+    }
+
+    void Wait()
+    {
+        unique_lock<mutex> lock(mtx);
+        allDone.wait(lock, [this] { return numPending == 0; });
+    }
+
+private:
+    // Run requests from the queue until the engine is destroyed
+    void Work()
+    {
+        unique_lock<mutex> lock(mtx);
+        while (true)
+        {
+            hasWork.wait(lock, [this] { return bStop || !queue.empty(); });
+            if (queue.empty())
+                return;
+            PF_IORequest *request = queue.front();
+            queue.pop_front();
+
+            lock.unlock();
+            RunRequest(*request);
+            lock.lock();
+
+            if (--numPending == 0)
+                allDone.notify_all();
+        }
+    }
+
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable hasWork, allDone;
+    deque<PF_IORequest *> queue; // requests not started yet
+    int numPending = 0;          // requests not done yet
+    bool bStop = false;
+};
+
+#ifdef PF_HAVE_IO_URING
+
+//
+// PF_UringIO: submits the requests to an io_uring, so that a batch costs
+// one system call to start and the kernel keeps all of it in flight
+//
+// liburing is not required; the rings are mapped and driven directly.
+//
+class PF_UringIO : public PF_AsyncIO
+{
+public:
+    PF_UringIO() {}
+
+    ~PF_UringIO()
+    {
+        if (sqes != NULL)
+            munmap(sqes, sqesSize);
+        if (cqRing != NULL && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != NULL)
+            munmap(sqRing, sqRingSize);
+        if (ringFd >= 0)
+            close(ringFd);
+    }
+
+    // Set up the ring, returning false if the kernel doesn't allow it
+    bool Init()
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = syscall(__NR_io_uring_setup, PF_AIO_QUEUE_DEPTH, &params);
+        if (ringFd < 0)
+            return false;
+        numEntries = params.sq_entries;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool bSingleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (bSingleMap && cqRingSize > sqRingSize)
+            sqRingSize = cqRingSize;
+
+        sqRing = Map(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = bSingleMap ? sqRing : Map(cqRingSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = (struct io_uring_sqe *)Map(sqesSize, IORING_OFF_SQES);
+        if (sqRing == NULL || cqRing == NULL || sqes == NULL)
+            return false;
+
+        char *sq = (char *)sqRing, *cq = (char *)cqRing;
+        sqTail = (unsigned *)(sq + params.sq_off.tail);
+        sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned *)(sq + params.sq_off.array);
+        cqHead = (unsigned *)(cq + params.cq_off.head);
+        cqTail = (unsigned *)(cq + params.cq_off.tail);
+        cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    const char *Name() const { return "uring"; }
+
+    void Submit(PF_IORequest *requests, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            // Keep at most a ring of requests in flight, so neither the
+            // submission nor the completion queue overflows
+            while (numInFlight == numEntries)
+                Enter(1);
+
+            unsigned tail = *sqTail;
+            unsigned index = tail & sqMask;
+            struct io_uring_sqe *sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = requests[i].bWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = requests[i].fd;
+            sqe->off = requests[i].offset;
+            sqe->addr = (uintptr_t)requests[i].iov;
+            sqe->len = requests[i].iovcnt;
+            sqe->user_data = (uintptr_t)&requests[i];
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+            numToSubmit++;
+            numInFlight++;
+        }
+        if (numToSubmit > 0)
+            Enter(0);
+    }
+
+    void Wait()
+    {
+        while (numInFlight > 0)
+            Enter(1);
+    }
+
+private:
+    // Map a region of the ring, or return NULL
+    void *Map(size_t size, off_t offset)
+    {
+        void *map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        return map == MAP_FAILED ? NULL : map;
+    }
+
+    // Submit the queued requests, wait for minComplete of them to finish,
+    // and hand every finished one its result
+    void Enter(unsigned minComplete)
+    {
+        while (numToSubmit > 0 || minComplete > 0)
+        {
+            int numDone = syscall(__NR_io_uring_enter, ringFd, numToSubmit, minComplete,
+                                  minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+            if (numDone < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+                cerr << "io_uring_enter failed: " << strerror(errno) << "\n";
+                exit(1);
+            }
+            numToSubmit -= numDone;
+            unsigned numReaped = Reap();
+            minComplete = numReaped >= minComplete ? 0 : minComplete - numReaped;
+        }
+        Reap();
+    }
+
+    // Take the finished requests off the completion queue
+    unsigned Reap()
+    {
+        unsigned head = *cqHead, numReaped = 0;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head, ++numReaped)
+        {
+            struct io_uring_cqe *cqe = &cqes[head & cqMask];
+            ((PF_IORequest *)(uintptr_t)cqe->user_data)->result = cqe->res;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        numInFlight -= numReaped;
+        return numReaped;
+    }
+
+    int ringFd = -1;
+    unsigned numEntries = 0;
+    unsigned numToSubmit = 0; // requests queued but not handed to the kernel
+    unsigned numInFlight = 0; // requests queued or submitted, not reaped
+
+    void *sqRing = NULL, *cqRing = NULL;
+    size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+    struct io_uring_sqe *sqes = NULL;
+    unsigned *sqTail = NULL, *sqArray = NULL, sqMask = 0;
+    unsigned *cqHead = NULL, *cqTail = NULL, cqMask = 0;
+    struct io_uring_cqe *cqes = NULL;
+};
+
+#endif // PF_HAVE_IO_URING
+
+// Create the engine called name, or NULL if it can't start
+static PF_AsyncIO *NewEngine(const char *name)
+{
+#ifdef PF_HAVE_IO_URING
+    if (strcasecmp(name, "uring") == 0)
+    {
+        PF_UringIO *uring = new PF_UringIO();
+        if (uring->Init())
+            return uring;
+        delete uring;
+        return NULL;
+    }
+#endif
+    if (strcasecmp(name, "threads") == 0)
+    {
+        try
+        {
+            return new PF_ThreadIO();
+        }
+        catch (const system_error &)
+        {
+            return NULL;
+        }
+    }
+    if (strcasecmp(name, "sync") == 0)
+        return new PF_SyncIO();
+    return NULL;
+}
+
+PF_AsyncIO *PF_NewAsyncIO(const char *name)
+{
+    if (name != NULL)
+        return NewEngine(name);
+
+    // Fall back from io_uring, which may be missing or forbidden, to
+    // threads and at last to plain calls
+    const char *const engines[] = {"uring", "threads", "sync"};
+    for (const char *engine : engines)
+    {
+        PF_AsyncIO *aio = NewEngine(engine);
+        if (aio != NULL)
+            return aio;
+    }
+    return NULL;
+}
@@ -0,0 +1,52 @@
+//
+// File:        pf_aio.h
+// Description: PF_AsyncIO class interface, the asynchronous page I/O of
+//              the buffer manager
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#ifndef PF_AIO_H
+#define PF_AIO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "pf_internal.h"
+
+//
+// PF_IORequest - one vectored read or write at an offset of a file
+//
+struct PF_IORequest {
+    int                 fd;      // OS file descriptor
+    off_t               offset;  // offset in the file
+    const struct iovec  *iov;    // buffers to read into or write from
+    int                 iovcnt;  // number of buffers
+    int                 bWrite;  // TRUE to write, FALSE to read
+    ssize_t             result;  // bytes transferred, or -errno, once done
+};
+
+//
+// PF_AsyncIO: runs batches of page reads and writes
+//
+// A batch is handed to Submit, which returns as soon as the requests are
+// started, and is complete when Wait returns.  Only one batch is in flight
+// at a time, and the requests and their buffers must live until Wait.
+//
+class PF_AsyncIO
+{
+public:
+    virtual ~PF_AsyncIO() {}
+
+    // The name of the engine, as given in PF_AIO_ENGINE_ENV
+    virtual const char *Name() const = 0;
+
+    // Start the count requests
+    virtual void Submit(PF_IORequest *requests, int count) = 0;
+    // Wait until every submitted request has its result
+    virtual void Wait() = 0;
+};
+
+// Create the engine called name, or the best one this system supports if
+// name is NULL.  Return NULL if there is no such engine or it can't start.
+PF_AsyncIO *PF_NewAsyncIO(const char *name);
+
+#endif
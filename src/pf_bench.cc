@@ -0,0 +1,135 @@
+//
+// File:        pf_bench.cc
+// Description: Benchmark of the buffer replacement policies under a hot
+//              set of pages mixed with sequential scans
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unistd.h>
+#include "purplebase.h"
+#include "pf.h"
+#include "pf_replacer.h"
+#include "statistics.h"
+
+using namespace std;
+
+#define PF_BENCH_HOT_FILE "pf_bench_hot.tmp"
+#define PF_BENCH_SCAN_FILE "pf_bench_scan.tmp"
+
+#ifdef PF_STATS
+// This is defined within pf_buffermgr.cc
+extern StatisticsMgr *pStatisticsMgr;
+#endif
+
+// Exit with the error if rc isn't OK_RC
+static void Try_PF(RC rc)
+{
+    if (rc != OK_RC)
+    {
+        PF_PrintError(rc);
+        exit(1);
+    }
+}
+
+// Create fileName with numPages pages
+static void CreateFile(PF_Manager &pfm, const char *fileName, int numPages)
+{
+    PF_FileHandle fileHandle;
+    PF_PageHandle pageHandle;
+    PageNum pageNum;
+    unlink(fileName);
+    Try_PF(pfm.CreateFile(fileName));
+    Try_PF(pfm.OpenFile(fileName, fileHandle));
+    for (int i = 0; i < numPages; ++i)
+    {
+        Try_PF(fileHandle.AllocatePage(pageHandle));
+        Try_PF(pageHandle.GetPageNum(pageNum));
+        Try_PF(fileHandle.MarkDirty(pageNum));
+        Try_PF(fileHandle.UnpinPage(pageNum));
+    }
+    Try_PF(pfm.CloseFile(fileHandle));
+}
+
+// Pin and unpin pageNum of fileHandle
+static void Touch(PF_FileHandle &fileHandle, PageNum pageNum, int bScan)
+{
+    PF_PageHandle pageHandle;
+    Try_PF(fileHandle.GetThisPage(pageNum, pageHandle, bScan));
+    Try_PF(fileHandle.UnpinPage(pageNum));
+}
+
+//
+// main
+//
+/* Steps:
+    1) Create a hot file of [hot] pages and a scan file of [scan] pages
+    2) For each policy, with and without the scan hint on the scanned
+       pages, resize the buffer to [buffer] pages and, [rounds] times,
+       scan the scan file while reading a random hot page after every
+       scanned page
+    3) Print the hit ratio of all reads and the time of every run
+*/
+int main(int argc, char *argv[])
+{
+    int bufferPages = argc > 1 ? atoi(argv[1]) : 40;
+    int hotPages = argc > 2 ? atoi(argv[2]) : 30;
+    int scanPages = argc > 3 ? atoi(argv[3]) : 2000;
+    int rounds = argc > 4 ? atoi(argv[4]) : 5;
+    if (argc > 5 || bufferPages <= 0 || hotPages <= 0 || scanPages <= 0 || rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [buffer] [hot] [scan] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    // 1) Create the files
+    PF_Manager pfm;
+    CreateFile(pfm, PF_BENCH_HOT_FILE, hotPages);
+    CreateFile(pfm, PF_BENCH_SCAN_FILE, scanPages);
+    printf("buffer %d pages, hot %d pages, scan %d pages, %d rounds\n",
+           bufferPages, hotPages, scanPages, rounds);
+
+    // 2) Run every policy
+    for (int i = 0; i < PF_REPLACER_COUNT; ++i)
+        for (int bScan = FALSE; bScan <= TRUE; ++bScan)
+        {
+            PF_FileHandle hotFile, scanFile;
+            Try_PF(pfm.ResizeBuffer(bufferPages));
+            Try_PF(pfm.SetReplacer(PF_REPLACER_NAMES[i]));
+            Try_PF(pfm.OpenFile(PF_BENCH_HOT_FILE, hotFile));
+            Try_PF(pfm.OpenFile(PF_BENCH_SCAN_FILE, scanFile));
+#ifdef PF_STATS
+            pStatisticsMgr->Reset();
+#endif
+
+            mt19937 random(17);
+            auto start = chrono::steady_clock::now();
+            for (int r = 0; r < rounds; ++r)
+                for (int page = 0; page < scanPages; ++page)
+                {
+                    Touch(scanFile, page, bScan);
+                    Touch(hotFile, random() % hotPages, FALSE);
+                }
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+            // 3) Report
+            double hitRatio = 0;
+#ifdef PF_STATS
+            int *piHit = pStatisticsMgr->Get(PF_REPLACER_HIT_KEYS[i]);
+            hitRatio = piHit ? 100.0 * *piHit / (2.0 * scanPages * rounds) : 0;
+            delete piHit;
+#endif
+            printf("%-6s %-9s  hit ratio %6.2f%%  %8.1f ms\n", PF_REPLACER_NAMES[i],
+                   bScan ? "scan hint" : "", hitRatio, elapsed.count());
+
+            Try_PF(pfm.CloseFile(hotFile));
+            Try_PF(pfm.CloseFile(scanFile));
+        }
+
+    Try_PF(pfm.DestroyFile(PF_BENCH_HOT_FILE));
+    Try_PF(pfm.DestroyFile(PF_BENCH_SCAN_FILE));
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+// File:        pf_bgwriter.cc
+// Description: PF_BgWriter class implementation
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "pf_bgwriter.h"
+
+using namespace std;
+
+PF_BgWriter::PF_BgWriter(int pageSize, int numFrames)
+    : pageSize(pageSize), frames((size_t)numFrames * pageSize),
+      numWriting(0), writeErrno(0), bStop(false)
+{
+    for (int i = numFrames - 1; i >= 0; --i)
+        freeFrames.push_back(i);
+    worker = thread(&PF_BgWriter::Work, this);
+}
+
+PF_BgWriter::~PF_BgWriter()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        bStop = true;
+    }
+    hasWork.notify_all();
+    worker.join();
+}
+
+bool PF_BgWriter::Enqueue(int fd, PageNum pageNum, const char *pData, bool bWait)
+{
+    unique_lock<mutex> lock(mtx);
+    if (freeFrames.empty())
+    {
+        if (!bWait)
+            return false;
+        progress.wait(lock, [this] { return !freeFrames.empty(); });
+    }
+
+    int frame = freeFrames.back();
+    freeFrames.pop_back();
+    memcpy(&frames[(size_t)frame * pageSize], pData, pageSize);
+    queue.push_back(Job{fd, pageNum, frame});
+    pending[Key(fd, pageNum)]++;
+
+    lock.unlock();
+    hasWork.notify_one();
+    return true;
+}
+
+void PF_BgWriter::EnqueueSync(int fd)
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        queue.push_back(Job{fd, 0, -1});
+    }
+    hasWork.notify_one();
+}
+
+bool PF_BgWriter::IsPending(int fd, PageNum pageNum)
+{
+    lock_guard<mutex> lock(mtx);
+    return pending.find(Key(fd, pageNum)) != pending.end();
+}
+
+void PF_BgWriter::WaitFor(int fd, PageNum pageNum)
+{
+    unique_lock<mutex> lock(mtx);
+    uint64_t key = Key(fd, pageNum);
+    progress.wait(lock, [this, key] { return pending.find(key) == pending.end(); });
+}
+
+RC PF_BgWriter::Drain()
+{
+    unique_lock<mutex> lock(mtx);
+    progress.wait(lock, [this] { return queue.empty() && numWriting == 0; });
+    if (writeErrno == 0)
+        return (0);
+    errno = writeErrno;
+    writeErrno = 0;
+    return (PF_UNIX);
+}
+
+//
+// Work
+//
+/* Steps:
+    1) Wait for jobs, and take all of them at once
+    2) Write them, outside the lock
+    3) Free their frames and wake up whoever waits for them
+*/
+void PF_BgWriter::Work()
+{
+    unique_lock<mutex> lock(mtx);
+    while (true)
+    {
+        // 1) Take the queue
+        hasWork.wait(lock, [this] { return bStop || !queue.empty(); });
+        if (queue.empty())
+            return;
+        vector<Job> jobs(queue.begin(), queue.end());
+        queue.clear();
+        numWriting = jobs.size();
+
+        // 2) Write
+        lock.unlock();
+        int error = Write(jobs);
+        lock.lock();
+        if (writeErrno == 0)
+            writeErrno = error;
+
+        // 3) Release
+        for (const Job &job : jobs)
+            if (job.frame >= 0)
+            {
+                freeFrames.push_back(job.frame);
+                auto it = pending.find(Key(job.fd, job.pageNum));
+                if (--it->second == 0)
+                    pending.erase(it);
+            }
+        numWriting = 0;
+        progress.notify_all();
+    }
+}
+
+//
+// Write
+//
+// Write a batch of jobs, outside the lock.  The pages queued between two
+// syncs are sorted by file and page, keeping the order of copies of one
+// page, and every run of consecutive pages is written by one pwritev.
+//
+int PF_BgWriter::Write(vector<Job> &jobs)
+{
+    int error = 0;
+    auto byPage = [](const Job &a, const Job &b) {
+        return a.fd != b.fd ? a.fd < b.fd : a.pageNum < b.pageNum;
+    };
+
+    size_t begin = 0;
+    while (begin < jobs.size())
+    {
+        // A sync follows the pages before it
+        if (jobs[begin].frame < 0)
+        {
+            if (fdatasync(jobs[begin].fd) < 0 && error == 0)
+                error = errno;
+            ++begin;
+            continue;
+        }
+
+        size_t end = begin;
+        while (end < jobs.size() && jobs[end].frame >= 0)
+            ++end;
+        stable_sort(jobs.begin() + begin, jobs.begin() + end, byPage);
+
+        // Write every run
+        vector<struct iovec> iov;
+        for (size_t i = begin; i < end;)
+        {
+            size_t j = i;
+            iov.clear();
+            do
+            {
+                struct iovec page;
+                page.iov_base = &frames[(size_t)jobs[j].frame * pageSize];
+                page.iov_len = pageSize;
+                iov.push_back(page);
+                ++j;
+            } while (j < end && (int)iov.size() < PF_AIO_MAX_IOV &&
+                     jobs[j].fd == jobs[j - 1].fd &&
+                     jobs[j].pageNum == jobs[j - 1].pageNum + 1);
+
+            off_t offset = jobs[i].pageNum * (off_t)pageSize + PF_FILE_HDR_SIZE;
+            ssize_t numBytes = pwritev(jobs[i].fd, iov.data(), iov.size(), offset);
+            if (numBytes != (ssize_t)(iov.size() * pageSize) && error == 0)
+                error = numBytes < 0 ? errno : EIO;
+            i = j;
+        }
+        begin = end;
+    }
+    return error;
+}
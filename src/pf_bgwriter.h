@@ -0,0 +1,80 @@
+//
+// File:        pf_bgwriter.h
+// Description: PF_BgWriter class interface, the background writer of
+//              dirty buffer pages
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#ifndef PF_BGWRITER_H
+#define PF_BGWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "pf_internal.h"
+
+//
+// PF_BgWriter: writes copies of dirty pages from a thread of its own
+//
+// The buffer manager never shares its tables with the thread.  It copies
+// a dirty page into one of the writer's frames and marks it clean, and
+// the thread writes the copy later, so the page may be evicted or written
+// again meanwhile.  A page must not be read from the file while a copy of
+// it is queued, which WaitFor ensures, and Drain must be called before
+// writing pages directly or closing a file.
+//
+class PF_BgWriter
+{
+public:
+    PF_BgWriter(int pageSize, int numFrames);
+    ~PF_BgWriter(); // Write what is queued and stop the thread
+
+    // Queue a copy of the page.  If all frames are taken, wait for one if
+    // bWait, or else return false.
+    bool Enqueue(int fd, PageNum pageNum, const char *pData, bool bWait);
+    // Queue an fdatasync of fd, after the pages queued before
+    void EnqueueSync(int fd);
+
+    // Is a copy of the page queued
+    bool IsPending(int fd, PageNum pageNum);
+    // Wait until no copy of the page is queued
+    void WaitFor(int fd, PageNum pageNum);
+    // Wait until everything queued is written.  Return PF_UNIX with errno
+    // set if a write failed since the last Drain.
+    RC Drain();
+
+private:
+    struct Job
+    {
+        int fd;
+        PageNum pageNum;
+        int frame; // frame of the copy, or -1 to sync fd
+    };
+
+    void Work();
+    int  Write(std::vector<Job> &jobs); // Return the first errno, or 0
+
+    static uint64_t Key(int fd, PageNum pageNum)
+    {
+        return ((uint64_t)(uint32_t)fd << 32) | (uint32_t)pageNum;
+    }
+
+    int pageSize;
+    std::vector<char> frames;     // numFrames copies of pages
+    std::vector<int> freeFrames;  // frames not in use
+
+    std::mutex mtx;
+    std::condition_variable hasWork, progress;
+    std::deque<Job> queue;                      // jobs not taken yet
+    int numWriting;                             // jobs taken, not done
+    std::unordered_map<uint64_t, int> pending;  // queued copies of a page
+    int writeErrno;                             // first failure, or 0
+    bool bStop;
+    std::thread worker;
+};
+
+#endif
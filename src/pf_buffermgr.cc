@@ -17,9 +17,16 @@
 // 2019: Letting the code run in 64-bit mode, change the type of PageNum
 //       to long long and correct the output of it. Close the log file
 //       when destructing the pfBufferManager.
+// 2025: Pages read ahead and the dirty pages of a flush go through an
+//       asynchronous I/O engine, io_uring where the kernel allows it.
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <iostream>
 #include "pf_buffermgr.h"
 
@@ -85,6 +92,48 @@ void WriteLog(const char *psMessage)
 }
 #endif
 
+//
+// AllocArena
+//
+// Desc: Allocate the memory of numPages buffer pages as one zeroed arena,
+//       aligned to PF_ARENA_ALIGN so that the kernel can back it with huge
+//       pages.  The mapping is made a little larger and trimmed to align.
+// In:   numPages - the number of pages
+// Out:  arenaSize - the size to pass to FreeArena
+// Ret:  The arena, or NULL if out of memory
+//
+static char *AllocArena(int numPages, size_t &arenaSize)
+{
+    size_t bytes = (size_t)numPages * (PF_PAGE_SIZE + sizeof(PF_PageHdr));
+    arenaSize = (bytes + PF_ARENA_ALIGN - 1) / PF_ARENA_ALIGN * PF_ARENA_ALIGN;
+
+    char *map = (char *)mmap(NULL, arenaSize + PF_ARENA_ALIGN, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    // Unmap the unaligned head and the rest of the tail
+    char *arena = (char *)(((uintptr_t)map + PF_ARENA_ALIGN - 1) & ~(uintptr_t)(PF_ARENA_ALIGN - 1));
+    if (arena != map)
+        munmap(map, arena - map);
+    munmap(arena + arenaSize, map + PF_ARENA_ALIGN - arena);
+
+#ifdef MADV_HUGEPAGE
+    madvise(arena, arenaSize, MADV_HUGEPAGE);
+#endif
+    return arena;
+}
+
+//
+// FreeArena
+//
+// Desc: Free an arena from AllocArena
+//
+static void FreeArena(char *arena, size_t arenaSize)
+{
+    munmap(arena, arenaSize);
+}
+
 //
 // PF_BufferMgr
 //
@@ -93,7 +142,8 @@ void WriteLog(const char *psMessage)
 //       it checks if it is in the buffer.  If so, it pins the page (pages
 //       can be pinned multiple times).  If not, it reads it from the file
 //       and pins it.  If the buffer is full and a new page needs to be
-//       inserted, an unpinned page is replaced according to an LRU
+//       inserted, an unpinned page is replaced according to the
+//       replacement policy, LRU by default.
 // In:   numPages - the number of pages in the buffer
 //
 // Note: The constructor will initialize the global pStatisticsMgr.  We
@@ -103,7 +153,7 @@ void WriteLog(const char *psMessage)
 // Aut2003
 // numPages changed to _numPages for to eliminate CC warnings
 
-PF_BufferMgr::PF_BufferMgr(int _numPages) : hashTable(PF_HASH_TBL_SIZE)
+PF_BufferMgr::PF_BufferMgr(int _numPages) : hashTable(_numPages)
 {
     // Initialize local variables
     this->numPages = _numPages;
@@ -121,27 +171,36 @@ PF_BufferMgr::PF_BufferMgr(int _numPages) : hashTable(PF_HASH_TBL_SIZE)
     WriteLog(psMessage);
 #endif
 
-    // Allocate memory for buffer page description table
-    bufTable = new PF_BufPageDesc[numPages];
-
-    // Initialize the buffer table and allocate memory for buffer pages.
-    // Initially, the free list contains all pages
-    for (int i = 0; i < numPages; i++)
+    // Allocate memory for the buffer pages and their description table
+    if ((pArena = AllocArena(numPages, arenaSize)) == NULL)
     {
-        if ((bufTable[i].pData = new char[pageSize]) == NULL)
-        {
-            cerr << "Not enough memory for buffer\n";
-            exit(1);
-        }
+        cerr << "Not enough memory for buffer\n";
+        exit(1);
+    }
+    bufTable = new PF_BufPageDesc[numPages];
+    InitBufTable();
 
-        memset((void *)bufTable[i].pData, 0, pageSize);
+    // Replace pages by the default policy
+    replacer = PF_NewReplacer(PF_REPLACER_NAMES[0], numPages);
 
-        bufTable[i].prev = i - 1;
-        bufTable[i].next = i + 1;
+    // Start the I/O engine asked for, or else the best one available
+    const char *psEngine = getenv(PF_AIO_ENGINE_ENV);
+    aio = psEngine != NULL ? PF_NewAsyncIO(psEngine) : NULL;
+    if (psEngine != NULL && aio == NULL)
+        cerr << "Cannot start I/O engine " << psEngine << ", using the default\n";
+    if (aio == NULL && (aio = PF_NewAsyncIO(NULL)) == NULL)
+    {
+        cerr << "Cannot start the I/O engine\n";
+        exit(1);
     }
-    bufTable[0].prev = bufTable[numPages - 1].next = INVALID_SLOT;
-    free = 0;
-    first = last = INVALID_SLOT;
+    readAhead.numPages = 0;
+
+    // Start the background writer unless asked not to
+    const char *psBgWriter = getenv(PF_BGWRITER_ENV);
+    bgWriter = (psBgWriter != NULL && strcmp(psBgWriter, "0") == 0) ?
+        NULL : new PF_BgWriter(pageSize, PF_BGWRITE_FRAMES);
+    lastCheckpoint = time(NULL);
+    numGetPage = 0;
 
 #ifdef PF_LOG
     WriteLog("Succesfully created the buffer manager.\n");
@@ -155,11 +214,16 @@ PF_BufferMgr::PF_BufferMgr(int _numPages) : hashTable(PF_HASH_TBL_SIZE)
 //
 PF_BufferMgr::~PF_BufferMgr()
 {
-    // Free up buffer pages and tables
-    for (int i = 0; i < this->numPages; i++)
-        delete[] bufTable[i].pData;
+    // Let the reads in flight finish before their pages go away
+    if (readAhead.numPages > 0)
+        FinishReadAhead();
+    delete aio;
+    delete bgWriter;
 
+    // Free up buffer pages and tables
+    FreeArena(pArena, arenaSize);
     delete[] bufTable;
+    delete replacer;
 
 #ifdef PF_STATS
     // Destroy the global statistics manager
@@ -179,16 +243,18 @@ PF_BufferMgr::~PF_BufferMgr()
 //       already in the buffer, (re)pin the page and return a pointer
 //       to it.  If the page is not in the buffer, read it from the file,
 //       pin it, and return a pointer to it.  If the buffer is full,
-//       replace an unpinned page.
+//       replace an unpinned page.  When the file is read in order, or
+//       by a scan, the pages after a page read are read ahead.
 // In:   fd - OS file descriptor of the file to read
 //       pageNum - number of the page to read
 //       bMultiplePins - if FALSE, it is an error to ask for a page that is
 //                       already pinned in the buffer.
+//       bScan - TRUE if the page is read by a sequential scan
 // Out:  ppBuffer - set *ppBuffer to point to the page in the buffer
 // Ret:  PF return code
 //
 RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
-                         int bMultiplePins)
+                         int bMultiplePins, int bScan)
 {
     RC rc;    // return code
     int slot; // buffer slot where page is located
@@ -203,6 +269,26 @@ RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
     pStatisticsMgr->Register(PF_GETPAGE, STAT_ADDONE);
 #endif
 
+    // Take a checkpoint when it's time, reading the clock now and then
+    if (bgWriter != NULL && ++numGetPage >= PF_CHECKPOINT_CHECK)
+    {
+        numGetPage = 0;
+        if (time(NULL) - lastCheckpoint >= PF_CHECKPOINT_SECONDS)
+            Checkpoint();
+    }
+
+    // Follow the sequential access of the file
+    PF_AccessRun &run = accessRuns[fd];
+    if (pageNum == run.lastPage + 1)
+        run.length++;
+    else if (pageNum != run.lastPage)
+        run.length = 0;
+    run.lastPage = pageNum;
+
+    // Wait for the page if it is being read ahead
+    if (IsReadingAhead(fd, pageNum))
+        FinishReadAhead();
+
     // Search for page in buffer
     if ((rc = hashTable.Find(fd, pageNum, slot)) &&
         (rc != PF_HASHNOTFOUND))
@@ -214,6 +300,7 @@ RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
 
 #ifdef PF_STATS
         pStatisticsMgr->Register(PF_PAGENOTFOUND, STAT_ADDONE);
+        pStatisticsMgr->Register(replacer->MissKey(), STAT_ADDONE);
 #endif
 
         // Allocate an empty page, this will also promote the newly allocated
@@ -225,7 +312,7 @@ RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
         // and initialize the page description entry
         if ((rc = ReadPage(fd, pageNum, bufTable[slot].pData)) ||
             (rc = hashTable.Insert(fd, pageNum, slot)) ||
-            (rc = InitPageDesc(fd, pageNum, slot)))
+            (rc = InitPageDesc(fd, pageNum, slot, bScan)))
         {
 
             // Put the slot back on the free list before returning the error
@@ -236,12 +323,16 @@ RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
 #ifdef PF_LOG
         WriteLog("Page not found in buffer. Loaded.\n");
 #endif
+
+        if (bScan || run.length >= PF_READAHEAD_TRIGGER)
+            ReadAhead(fd, pageNum);
     }
     else
     { // Page is in the buffer...
 
 #ifdef PF_STATS
         pStatisticsMgr->Register(PF_PAGEFOUND, STAT_ADDONE);
+        pStatisticsMgr->Register(replacer->HitKey(), STAT_ADDONE);
 #endif
 
         // Error if we don't want to get a pinned page
@@ -250,16 +341,26 @@ RC PF_BufferMgr::GetPage(int fd, PageNum pageNum, char **ppBuffer,
 
         // Page is alredy in memory, just increment pin count
         bufTable[slot].pinCount++;
+
+        // Count the page if it was read ahead
+        if (bufTable[slot].bPrefetched)
+        {
+            bufTable[slot].bPrefetched = FALSE;
+#ifdef PF_STATS
+            pStatisticsMgr->Register(PF_PREFETCHHIT, STAT_ADDONE);
+#endif
+        }
 #ifdef PF_LOG
         sprintf(psMessage, "Page found in buffer.  %d pin count.\n",
                 bufTable[slot].pinCount);
         WriteLog(psMessage);
 #endif
 
-        // Make this page the most recently used page
+        // Make this page the most recently used page, and tell the policy
         if ((rc = Unlink(slot)) ||
             (rc = LinkHead(slot)))
             return (rc);
+        replacer->Access(slot, bScan);
     }
 
     // cout << "Page pinned: " << pageNum << " count: " << bufTable[slot].pinCount << endl;
@@ -295,6 +396,10 @@ RC PF_BufferMgr::AllocatePage(int fd, PageNum pageNum, char **ppBuffer)
     WriteLog(psMessage);
 #endif
 
+    // A new page may be past the end of a read ahead
+    if (readAhead.numPages > 0)
+        FinishReadAhead();
+
     // If page is already in buffer, return an error
     if (!(rc = hashTable.Find(fd, pageNum, slot)))
         return (PF_PAGEINBUF);
@@ -358,6 +463,9 @@ RC PF_BufferMgr::MarkDirty(int fd, PageNum pageNum)
     WriteLog(psMessage);
 #endif
 
+    if (IsReadingAhead(fd, pageNum))
+        FinishReadAhead();
+
     // The page must be found and pinned in the buffer
     if ((rc = hashTable.Find(fd, pageNum, slot)))
     {
@@ -395,6 +503,9 @@ RC PF_BufferMgr::UnpinPage(int fd, PageNum pageNum)
     RC rc;    // return code
     int slot; // buffer slot where page is located
 
+    if (IsReadingAhead(fd, pageNum))
+        FinishReadAhead();
+
     // The page must be found and pinned in the buffer
     if ((rc = hashTable.Find(fd, pageNum, slot)))
     {
@@ -433,6 +544,22 @@ RC PF_BufferMgr::UnpinPage(int fd, PageNum pageNum)
     return (0);
 }
 
+//
+// HasPage
+//
+// Desc: Tell whether the buffer manager has a copy of a page that may
+//       be newer than the file, without touching it
+// In:   fd - OS file descriptor of the file of the page
+//       pageNum - number of the page
+// Ret:  true if the page is in the buffer or queued for writing
+//
+bool PF_BufferMgr::HasPage(int fd, PageNum pageNum) const
+{
+    int slot;
+    return hashTable.Find(fd, pageNum, slot) == 0 ||
+           (bgWriter != NULL && bgWriter->IsPending(fd, pageNum));
+}
+
 //
 // FlushPages
 //
@@ -440,6 +567,7 @@ RC PF_BufferMgr::UnpinPage(int fd, PageNum pageNum)
 //       Returns a warning if any of the file's pages are pinned.
 //       A linear search of the buffer is performed.
 //       A better method is not needed because # of buffers are small.
+//       The dirty pages are written as one batch first.
 // In:   fd - file descriptor
 // Ret:  PF_PAGEPINNED or other PF return code
 //
@@ -457,6 +585,29 @@ RC PF_BufferMgr::FlushPages(int fd)
     pStatisticsMgr->Register(PF_FLUSHPAGES, STAT_ADDONE);
 #endif
 
+    // The file is being closed, and its descriptor may be reused, so
+    // the pages written behind must be on disk first
+    accessRuns.erase(fd);
+    writtenFds.erase(fd);
+    if (readAhead.numPages > 0)
+        FinishReadAhead();
+    if (bgWriter != NULL && (rc = bgWriter->Drain()))
+        return (rc);
+
+    // Write the unpinned dirty pages of the file
+    vector<int> dirtySlots;
+    for (int slot = first; slot != INVALID_SLOT; slot = bufTable[slot].next)
+        if (bufTable[slot].fd == fd && bufTable[slot].pinCount == 0 && bufTable[slot].bDirty)
+        {
+#ifdef PF_LOG
+            sprintf(psMessage, "Page (%lld) is dirty\n", bufTable[slot].pageNum);
+            WriteLog(psMessage);
+#endif
+            dirtySlots.push_back(slot);
+        }
+    if ((rc = WritePages(dirtySlots)))
+        return (rc);
+
     // Do a linear scan of the buffer to find pages belonging to the file
     int slot = first;
     while (slot != INVALID_SLOT)
@@ -479,23 +630,12 @@ RC PF_BufferMgr::FlushPages(int fd)
             }
             else
             {
-                // Write the page if dirty
-                if (bufTable[slot].bDirty)
-                {
-#ifdef PF_LOG
-                    sprintf(psMessage, "Page (%lld) is dirty\n", bufTable[slot].pageNum);
-                    WriteLog(psMessage);
-#endif
-                    if ((rc = WritePage(fd, bufTable[slot].pageNum, bufTable[slot].pData)))
-                        return (rc);
-                    bufTable[slot].bDirty = FALSE;
-                }
-
                 // Remove page from the hash table and add the slot to the free list
                 if ((rc = hashTable.Delete(fd, bufTable[slot].pageNum)) ||
                     (rc = Unlink(slot)) ||
                     (rc = InsertFree(slot)))
                     return (rc);
+                replacer->Remove(slot);
             }
         }
         slot = next;
@@ -521,8 +661,11 @@ RC PF_BufferMgr::FlushPages(int fd)
 //
 RC PF_BufferMgr::ForcePages(int fd, PageNum pageNum)
 {
-    RC rc; // return codes
+    RC rc;
 
+    // Older copies written behind must not land after these
+    if (bgWriter != NULL && (rc = bgWriter->Drain()))
+        return (rc);
 #ifdef PF_LOG
     char psMessage[100];
     sprintf(psMessage, "Forcing page %lld for (%d).\n", pageNum, fd);
@@ -530,12 +673,9 @@ RC PF_BufferMgr::ForcePages(int fd, PageNum pageNum)
 #endif
 
     // Do a linear scan of the buffer to find the page for the file
-    int slot = first;
-    while (slot != INVALID_SLOT)
+    vector<int> dirtySlots;
+    for (int slot = first; slot != INVALID_SLOT; slot = bufTable[slot].next)
     {
-
-        int next = bufTable[slot].next;
-
         // If the page belongs to the passed-in file descriptor
         if (bufTable[slot].fd == fd &&
             (pageNum == ALL_PAGES || bufTable[slot].pageNum == pageNum))
@@ -553,15 +693,13 @@ RC PF_BufferMgr::ForcePages(int fd, PageNum pageNum)
                 sprintf(psMessage, "Page (%lld) is dirty\n", bufTable[slot].pageNum);
                 WriteLog(psMessage);
 #endif
-                if ((rc = WritePage(fd, bufTable[slot].pageNum, bufTable[slot].pData)))
-                    return (rc);
-                bufTable[slot].bDirty = FALSE;
+                dirtySlots.push_back(slot);
             }
         }
-        slot = next;
     }
 
-    return 0;
+    // Write them all at once
+    return (WritePages(dirtySlots));
 }
 
 //
@@ -610,23 +748,39 @@ RC PF_BufferMgr::PrintBuffer()
 //       comparison starting with an clean buffer.
 // In:   Nothing
 // Out:  Nothing
-// Ret:  Will return an error if a page is pinned and the Clear routine
-//       is called.
+//       Dirty pages are written first.  Pinned pages stay.
+// Ret:  PF return code
 RC PF_BufferMgr::ClearBuffer()
 {
     RC rc;
 
+    if (readAhead.numPages > 0)
+        FinishReadAhead();
+    if (bgWriter != NULL && (rc = bgWriter->Drain()))
+        return (rc);
+
+    // Write the unpinned dirty pages in one batch
+    vector<int> dirtySlots;
     int slot, next;
+    for (slot = first; slot != INVALID_SLOT; slot = bufTable[slot].next)
+        if (bufTable[slot].pinCount == 0 && bufTable[slot].bDirty)
+            dirtySlots.push_back(slot);
+    if ((rc = WritePages(dirtySlots)))
+        return (rc);
+
     slot = first;
     while (slot != INVALID_SLOT)
     {
         next = bufTable[slot].next;
         if (bufTable[slot].pinCount == 0)
+        {
             if ((rc = hashTable.Delete(bufTable[slot].fd,
                                        bufTable[slot].pageNum)) ||
                 (rc = Unlink(slot)) ||
                 (rc = InsertFree(slot)))
                 return (rc);
+            replacer->Remove(slot);
+        }
         slot = next;
     }
 
@@ -641,97 +795,95 @@ RC PF_BufferMgr::ClearBuffer()
 // In:   The new buffer size
 // Out:  Nothing
 // Ret:  0 for success or,
-//       Some other PF error (probably PF_NOBUF)
+//       PF_TOOSMALL if the size isn't positive,
+//       PF_PAGEPINNED if a page is pinned, since it can't move,
+//       Some other PF error (probably PF_NOMEM)
 //
-// Notes: This method attempts to copy all the old pages which I am
-// unable to kick out of the old buffer manager into the new buffer
-// manager.  This obviously cannot always be successfull!
+// Notes: All pages are written out and dropped, and the buffer starts
+// empty with the same replacement policy.
 //
 RC PF_BufferMgr::ResizeBuffer(int iNewSize)
 {
-    int i;
     RC rc;
 
-    // First try and clear out the old buffer!
-    ClearBuffer();
-
-    // Allocate memory for a new buffer table
-    PF_BufPageDesc *pNewBufTable = new PF_BufPageDesc[iNewSize];
+    if (iNewSize <= 0)
+        return (PF_TOOSMALL);
 
-    // Initialize the new buffer table and allocate memory for buffer
-    // pages.  Initially, the free list contains all pages
-    for (i = 0; i < iNewSize; i++)
+    // First try and clear out the old buffer!
+    if ((rc = ClearBuffer()))
+        return (rc);
+    if (first != INVALID_SLOT)
+        return (PF_PAGEPINNED);
+
+    // Allocate memory for the new buffer, keeping the old one on failure
+    size_t newArenaSize;
+    char *pNewArena = AllocArena(iNewSize, newArenaSize);
+    if (pNewArena == NULL)
+        return (PF_NOMEM);
+    if ((rc = hashTable.Resize(iNewSize)))
     {
-        if ((pNewBufTable[i].pData = new char[pageSize]) == NULL)
-        {
-            cerr << "Not enough memory for buffer\n";
-            exit(1);
-        }
-
-        memset((void *)pNewBufTable[i].pData, 0, pageSize);
-
-        pNewBufTable[i].prev = i - 1;
-        pNewBufTable[i].next = i + 1;
+        FreeArena(pNewArena, newArenaSize);
+        return (rc);
     }
-    pNewBufTable[0].prev = pNewBufTable[iNewSize - 1].next = INVALID_SLOT;
-
-    // Now we must remember the old first and last slots and (of course)
-    // the buffer table itself.  Then we use insert methods to insert
-    // each of the entries into the new buffertable
-    int oldFirst = first;
-    PF_BufPageDesc *pOldBufTable = bufTable;
+    PF_Replacer *pNewReplacer = PF_NewReplacer(replacer->Name(), iNewSize);
 
-    // Setup the new number of pages,  first, last and free
+    // Replace the old buffer
+    FreeArena(pArena, arenaSize);
+    delete[] bufTable;
+    delete replacer;
     numPages = iNewSize;
-    first = last = INVALID_SLOT;
-    free = 0;
-
-    // Setup the new buffer table
-    bufTable = pNewBufTable;
-
-    // We must first remove from the hashtable any possible entries
-    int slot, next, newSlot;
-    slot = oldFirst;
-    while (slot != INVALID_SLOT)
-    {
-        next = pOldBufTable[slot].next;
-
-        // Must remove the entry from the hashtable from the
-        if ((rc = hashTable.Delete(pOldBufTable[slot].fd, pOldBufTable[slot].pageNum)))
-            return (rc);
-        slot = next;
-    }
+    pArena = pNewArena;
+    arenaSize = newArenaSize;
+    bufTable = new PF_BufPageDesc[numPages];
+    replacer = pNewReplacer;
+    InitBufTable();
 
-    // Now we traverse through the old buffer table and copy any old
-    // entries into the new one
-    slot = oldFirst;
-    while (slot != INVALID_SLOT)
-    {
+    return 0;
+}
 
-        next = pOldBufTable[slot].next;
-        // Allocate a new slot for the old page
-        if ((rc = InternalAlloc(newSlot)))
-            return (rc);
+//
+// SetReplacer
+//
+// Desc: Switch to another replacement policy.  The pages in the buffer
+//       are handed to the new policy from the least to the most recently
+//       used, so they keep their order.
+//       This routine will be called via "set bufferpolicy".
+// In:   name - the name of the policy, see PF_REPLACER_NAMES
+// Ret:  PF_BADREPLACER if there is no such policy, 0 otherwise
+//
+RC PF_BufferMgr::SetReplacer(const char *name)
+{
+    PF_Replacer *pNewReplacer = PF_NewReplacer(name, numPages);
+    if (pNewReplacer == NULL)
+        return (PF_BADREPLACER);
 
-        // Insert the page into the hash table,
-        // and initialize the page description entry
-        if ((rc = hashTable.Insert(pOldBufTable[slot].fd,
-                                   pOldBufTable[slot].pageNum, newSlot)) ||
-            (rc = InitPageDesc(pOldBufTable[slot].fd,
-                               pOldBufTable[slot].pageNum, newSlot)))
-            return (rc);
+    delete replacer;
+    replacer = pNewReplacer;
+    for (int slot = last; slot != INVALID_SLOT; slot = bufTable[slot].prev)
+        replacer->Admit(slot, bufTable[slot].fd, bufTable[slot].pageNum, FALSE);
 
-        // Put the slot back on the free list before returning the error
-        Unlink(newSlot);
-        InsertFree(newSlot);
+    return (0);
+}
 
-        slot = next;
+//
+// InitBufTable
+//
+// Desc: Internal.  Point the slots of bufTable at their pages in the
+//       arena, and put them all on the free list
+//
+void PF_BufferMgr::InitBufTable()
+{
+    for (int i = 0; i < numPages; i++)
+    {
+        bufTable[i].pData = pArena + (size_t)i * pageSize;
+        bufTable[i].bDirty = FALSE;
+        bufTable[i].pinCount = 0;
+        bufTable[i].prev = i - 1;
+        bufTable[i].next = i + 1;
     }
-
-    // Finally, delete the old buffer table
-    delete[] pOldBufTable;
-
-    return 0;
+    bufTable[0].prev = bufTable[numPages - 1].next = INVALID_SLOT;
+    free = 0;
+    first = last = INVALID_SLOT;
 }
 
 //
@@ -819,8 +971,9 @@ RC PF_BufferMgr::Unlink(int slot)
 // Desc: Internal.  Allocate a buffer slot.  The slot is inserted at the
 //       head of the used list.  Here's how it chooses which slot to use:
 //       If there is something on the free list, then use it.
-//       Otherwise, choose a victim to replace.  If a victim cannot be
-//       chosen (because all the pages are pinned), then return an error.
+//       Otherwise, ask the replacement policy for a victim.  If a victim
+//       cannot be chosen (because all the pages are pinned), then return
+//       an error.
 // Out:  slot - set to newly-allocated slot
 // Ret:  PF_NOBUF if all pages are pinned, other PF return code otherwise
 //
@@ -837,31 +990,33 @@ RC PF_BufferMgr::InternalAlloc(int &slot)
     else
     {
 
-        // Choose the least-recently used page that is unpinned
-        for (slot = last; slot != INVALID_SLOT; slot = bufTable[slot].prev)
+        // Let the policy choose a page that is unpinned, waiting for the
+        // pages being read ahead if they hold the only slots left
+        slot = replacer->Victim(bufTable);
+        if (slot == INVALID_SLOT && readAhead.numPages > 0)
         {
-            if (bufTable[slot].pinCount == 0)
-                break;
+            FinishReadAhead();
+            slot = replacer->Victim(bufTable);
         }
 
         // Return error if all buffers were pinned
         if (slot == INVALID_SLOT)
             return (PF_NOBUF);
 
-        // Write out the page if it is dirty
-        if (bufTable[slot].bDirty)
+        // Write out the page if it is dirty, keeping it if that fails
+        if (bufTable[slot].bDirty && (rc = WriteBehind(slot, true)))
         {
-            if ((rc = WritePage(bufTable[slot].fd, bufTable[slot].pageNum,
-                                bufTable[slot].pData)))
-                return (rc);
-
-            bufTable[slot].bDirty = FALSE;
+            replacer->Admit(slot, bufTable[slot].fd, bufTable[slot].pageNum, FALSE);
+            return (rc);
         }
 
         // Remove page from the hash table and slot from the used buffer list
         if ((rc = hashTable.Delete(bufTable[slot].fd, bufTable[slot].pageNum)) ||
             (rc = Unlink(slot)))
             return (rc);
+
+        // Keep the next victims clean
+        Trickle();
     }
 
     // Link slot at the head of the used list
@@ -896,13 +1051,13 @@ RC PF_BufferMgr::ReadPage(int fd, PageNum pageNum, char *dest)
     pStatisticsMgr->Register(PF_READPAGE, STAT_ADDONE);
 #endif
 
-    // seek to the appropriate place (cast to long for PC's)
-    long offset = pageNum * (long)pageSize + PF_FILE_HDR_SIZE;
-    if (lseek(fd, offset, L_SET) < 0)
-        return (PF_UNIX);
+    // A copy of the page may still be on its way to the file
+    if (bgWriter != NULL)
+        bgWriter->WaitFor(fd, pageNum);
 
-    // Read the data
-    int numBytes = read(fd, dest, pageSize);
+    // Read the data at the page's place in the file
+    off_t offset = pageNum * (off_t)pageSize + PF_FILE_HDR_SIZE;
+    ssize_t numBytes = pread(fd, dest, pageSize, offset);
     if (numBytes < 0)
         return (PF_UNIX);
     else if (numBytes != pageSize)
@@ -932,15 +1087,12 @@ RC PF_BufferMgr::WritePage(int fd, PageNum pageNum, char *source)
 
 #ifdef PF_STATS
     pStatisticsMgr->Register(PF_WRITEPAGE, STAT_ADDONE);
+    pStatisticsMgr->Register(PF_WRITECALL, STAT_ADDONE);
 #endif
 
-    // seek to the appropriate place (cast to long for PC's)
-    long offset = pageNum * (long)pageSize + PF_FILE_HDR_SIZE;
-    if (lseek(fd, offset, L_SET) < 0)
-        return (PF_UNIX);
-
-    // Read the data
-    int numBytes = write(fd, source, pageSize);
+    // Write the data at the page's place in the file
+    off_t offset = pageNum * (off_t)pageSize + PF_FILE_HDR_SIZE;
+    ssize_t numBytes = pwrite(fd, source, pageSize, offset);
     if (numBytes < 0)
         return (PF_UNIX);
     else if (numBytes != pageSize)
@@ -949,22 +1101,295 @@ RC PF_BufferMgr::WritePage(int fd, PageNum pageNum, char *source)
         return (0);
 }
 
+//
+// WritePages
+//
+// Desc: Internal.  Write the pages in slots with one batch of requests,
+//       and mark the ones written clean.  Pages that follow each other
+//       in a file are written by one pwritev.
+// In:   slots - slots of dirty pages
+// Ret:  PF return code of the first page that failed
+//
+RC PF_BufferMgr::WritePages(const vector<int> &slots)
+{
+    int numSlots = slots.size();
+    if (numSlots == 0)
+        return (0);
+
+    // Order the pages by file and page number
+    vector<int> order(slots);
+    sort(order.begin(), order.end(), [this](int a, int b) {
+        return bufTable[a].fd != bufTable[b].fd ? bufTable[a].fd < bufTable[b].fd
+                                                : bufTable[a].pageNum < bufTable[b].pageNum;
+    });
+
+    // One request for every run of consecutive pages
+    vector<struct iovec> iov(numSlots);
+    vector<PF_IORequest> requests;
+    vector<int> runStart;
+    for (int i = 0; i < numSlots; i++)
+    {
+        const PF_BufPageDesc &desc = bufTable[order[i]];
+        iov[i].iov_base = desc.pData;
+        iov[i].iov_len = pageSize;
+        if (!requests.empty())
+        {
+            PF_IORequest &last = requests.back();
+            const PF_BufPageDesc &prev = bufTable[order[i - 1]];
+            if (desc.fd == prev.fd && desc.pageNum == prev.pageNum + 1 &&
+                last.iovcnt < PF_AIO_MAX_IOV)
+            {
+                last.iovcnt++;
+                continue;
+            }
+        }
+        PF_IORequest request;
+        request.fd = desc.fd;
+        request.offset = desc.pageNum * (off_t)pageSize + PF_FILE_HDR_SIZE;
+        request.iov = &iov[i];
+        request.iovcnt = 1;
+        request.bWrite = TRUE;
+        requests.push_back(request);
+        runStart.push_back(i);
+    }
+    int numRequests = requests.size();
+
+#ifdef PF_STATS
+    pStatisticsMgr->Register(PF_WRITEPAGE, STAT_ADDVALUE, &numSlots);
+    pStatisticsMgr->Register(PF_WRITECALL, STAT_ADDVALUE, &numRequests);
+#endif
+
+    aio->Submit(requests.data(), numRequests);
+    aio->Wait();
+
+    // Mark the whole pages written clean
+    RC rc = 0;
+    for (int r = 0; r < numRequests; r++)
+    {
+        const PF_IORequest &request = requests[r];
+        int numWritten = request.result > 0 ? (int)(request.result / pageSize) : 0;
+        for (int i = 0; i < numWritten; i++)
+            bufTable[order[runStart[r] + i]].bDirty = FALSE;
+
+        if (numWritten < request.iovcnt && rc == 0)
+        {
+            if (request.result < 0)
+            {
+                errno = -request.result;
+                rc = PF_UNIX;
+            }
+            else
+                rc = PF_INCOMPLETEWRITE;
+        }
+    }
+    return (rc);
+}
+
+//
+// WriteBehind
+//
+// Desc: Internal.  Hand a dirty page to the background writer and mark it
+//       clean, or write it now if there is no background writer
+// In:   slot - slot of the dirty page
+//       bWait - wait for room in the writer's queue, or else leave the
+//               page dirty if there is none
+// Ret:  PF return code
+//
+RC PF_BufferMgr::WriteBehind(int slot, bool bWait)
+{
+    RC rc;
+    PF_BufPageDesc &desc = bufTable[slot];
+
+    if (bgWriter == NULL)
+    {
+        if ((rc = WritePage(desc.fd, desc.pageNum, desc.pData)))
+            return (rc);
+    }
+    else
+    {
+        if (!bgWriter->Enqueue(desc.fd, desc.pageNum, desc.pData, bWait))
+            return (0);
+        writtenFds.insert(desc.fd);
+#ifdef PF_STATS
+        pStatisticsMgr->Register(PF_WRITEPAGE, STAT_ADDONE);
+        pStatisticsMgr->Register(PF_BGWRITEPAGE, STAT_ADDONE);
+#endif
+    }
+
+    desc.bDirty = FALSE;
+    return (0);
+}
+
+//
+// Trickle
+//
+// Desc: Internal.  Look at the PF_BGWRITE_SCAN least recently used pages
+//       and hand the unpinned dirty ones to the background writer, while
+//       it has room, so that replacing them later costs no write
+//
+void PF_BufferMgr::Trickle()
+{
+    if (bgWriter == NULL)
+        return;
+
+    int slot = last;
+    for (int i = 0; i < PF_BGWRITE_SCAN && slot != INVALID_SLOT; i++, slot = bufTable[slot].prev)
+    {
+        PF_BufPageDesc &desc = bufTable[slot];
+        if (desc.bDirty && desc.pinCount == 0 && desc.fd >= 0)
+        {
+            if (!bgWriter->Enqueue(desc.fd, desc.pageNum, desc.pData, false))
+                return;
+            writtenFds.insert(desc.fd);
+            desc.bDirty = FALSE;
+#ifdef PF_STATS
+            pStatisticsMgr->Register(PF_WRITEPAGE, STAT_ADDONE);
+            pStatisticsMgr->Register(PF_BGWRITEPAGE, STAT_ADDONE);
+#endif
+        }
+    }
+}
+
+//
+// Checkpoint
+//
+// Desc: Internal.  Hand every unpinned dirty page to the background
+//       writer, and have it sync every file written behind since the
+//       last checkpoint.  Pinned pages may be in the middle of a change,
+//       so they wait for the next checkpoint or their own flush.
+//
+void PF_BufferMgr::Checkpoint()
+{
+    for (int slot = first; slot != INVALID_SLOT; slot = bufTable[slot].next)
+        if (bufTable[slot].bDirty && bufTable[slot].pinCount == 0 && bufTable[slot].fd >= 0)
+            WriteBehind(slot, true);
+
+    for (int fd : writtenFds)
+        bgWriter->EnqueueSync(fd);
+    writtenFds.clear();
+    lastCheckpoint = time(NULL);
+
+#ifdef PF_STATS
+    pStatisticsMgr->Register(PF_CHECKPOINT, STAT_ADDONE);
+#endif
+}
+
+//
+// ReadAhead
+//
+// Desc: Internal.  Start reading the pages after pageNum that aren't in
+//       the buffer yet, up to the first one that is, into as many slots.
+//       The slots stay pinned until FinishReadAhead, which a request of
+//       one of the pages calls.  This is only a hint, so slots that can't
+//       be had or pages past the end of the file just shorten the read,
+//       and errors are ignored.
+// In:   fd - OS file descriptor
+//       pageNum - the page just read
+//
+void PF_BufferMgr::ReadAhead(int fd, PageNum pageNum)
+{
+    if (readAhead.numPages > 0)
+        FinishReadAhead();
+
+    // Take slots for the pages, leaving most of the buffer alone
+    int window = numPages / 4 < PF_READAHEAD_PAGES ? numPages / 4 : PF_READAHEAD_PAGES;
+    int numSlots = 0, slot;
+    while (numSlots < window &&
+           hashTable.Find(fd, pageNum + 1 + numSlots, slot) == PF_HASHNOTFOUND &&
+           InternalAlloc(slot) == 0)
+    {
+        if (hashTable.Insert(fd, pageNum + 1 + numSlots, slot) ||
+            InitPageDesc(fd, pageNum + 1 + numSlots, slot, TRUE))
+        {
+            Unlink(slot);
+            InsertFree(slot);
+            break;
+        }
+        if (bgWriter != NULL)
+            bgWriter->WaitFor(fd, pageNum + 1 + numSlots);
+        readAhead.slots[numSlots] = slot;
+        readAhead.iov[numSlots].iov_base = bufTable[slot].pData;
+        readAhead.iov[numSlots].iov_len = pageSize;
+        numSlots++;
+    }
+    if (numSlots == 0)
+        return;
+
+    // Read every chunk of pages with its own request
+    readAhead.fd = fd;
+    readAhead.firstPage = pageNum + 1;
+    readAhead.numPages = numSlots;
+    readAhead.numRequests = 0;
+    for (int i = 0; i < numSlots; i += PF_AIO_CHUNK_PAGES)
+    {
+        PF_IORequest &request = readAhead.requests[readAhead.numRequests++];
+        request.fd = fd;
+        request.offset = (pageNum + 1 + i) * (off_t)pageSize + PF_FILE_HDR_SIZE;
+        request.iov = &readAhead.iov[i];
+        request.iovcnt = numSlots - i < PF_AIO_CHUNK_PAGES ? numSlots - i : PF_AIO_CHUNK_PAGES;
+        request.bWrite = FALSE;
+    }
+    aio->Submit(readAhead.requests, readAhead.numRequests);
+}
+
+//
+// FinishReadAhead
+//
+// Desc: Internal.  Wait for the pages being read ahead.  The whole pages
+//       read are unpinned and marked prefetched, and the slots of the
+//       others are freed.
+//
+void PF_BufferMgr::FinishReadAhead()
+{
+    aio->Wait();
+
+    int numRead = 0;
+    for (int i = 0; i < readAhead.numPages; i++)
+    {
+        const PF_IORequest &request = readAhead.requests[i / PF_AIO_CHUNK_PAGES];
+        int numWhole = request.result > 0 ? (int)(request.result / pageSize) : 0;
+        int slot = readAhead.slots[i];
+        if (i % PF_AIO_CHUNK_PAGES < numWhole)
+        {
+            bufTable[slot].pinCount = 0;
+            bufTable[slot].bPrefetched = TRUE;
+            numRead++;
+        }
+        else
+        {
+            hashTable.Delete(readAhead.fd, readAhead.firstPage + i);
+            Unlink(slot);
+            InsertFree(slot);
+            replacer->Remove(slot);
+        }
+    }
+    readAhead.numPages = 0;
+
+#ifdef PF_STATS
+    pStatisticsMgr->Register(PF_PREFETCHPAGE, STAT_ADDVALUE, &numRead);
+#endif
+}
+
 //
 // InitPageDesc
 //
 // Desc: Internal.  Initialize PF_BufPageDesc to a newly-pinned page
-//       for a newly pinned page
+//       for a newly pinned page, and hand the page to the replacement
+//       policy
 // In:   fd - file descriptor
 //       pageNum - page number
+//       bScan - TRUE if the page is read by a sequential scan
 // Ret:  PF return code
 //
-RC PF_BufferMgr::InitPageDesc(int fd, PageNum pageNum, int slot)
+RC PF_BufferMgr::InitPageDesc(int fd, PageNum pageNum, int slot, int bScan)
 {
     // set the slot to refer to a newly-pinned page
     bufTable[slot].fd = fd;
     bufTable[slot].pageNum = pageNum;
     bufTable[slot].bDirty = FALSE;
     bufTable[slot].pinCount = 1;
+    bufTable[slot].bPrefetched = FALSE;
+    replacer->Admit(slot, fd, pageNum, bScan);
 
     // Return ok
     return (0);
@@ -15,8 +15,15 @@
 #ifndef PF_BUFFERMGR_H
 #define PF_BUFFERMGR_H
 
+#include <ctime>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "pf_internal.h"
+#include "pf_aio.h"
+#include "pf_bgwriter.h"
 #include "pf_hashtable.h"
+#include "pf_replacer.h"
 
 //
 // Defines
@@ -39,6 +46,30 @@ struct PF_BufPageDesc {
     short int  pinCount;    // pin count
     PageNum    pageNum;     // page number for this page
     int        fd;          // OS file descriptor of this page
+    int        bPrefetched; // TRUE if read ahead and not requested yet
+};
+
+//
+// PF_AccessRun - the last page requested from a file, and how many
+// requests in a row before it asked for the page after the previous one
+//
+struct PF_AccessRun {
+    PageNum    lastPage;
+    int        length;
+};
+
+//
+// PF_ReadAheadBatch - the pages being read ahead.  Their slots are pinned
+// until the reads finish, and one request reads PF_AIO_CHUNK_PAGES pages.
+//
+struct PF_ReadAheadBatch {
+    int           fd;
+    PageNum       firstPage;
+    int           numPages;     // 0 if nothing is being read
+    int           slots[PF_READAHEAD_PAGES];
+    struct iovec  iov[PF_READAHEAD_PAGES];
+    PF_IORequest  requests[(PF_READAHEAD_PAGES + PF_AIO_CHUNK_PAGES - 1) / PF_AIO_CHUNK_PAGES];
+    int           numRequests;
 };
 
 //
@@ -52,14 +83,18 @@ public:
     ~PF_BufferMgr    ();                         // Destructor
 
     // Read pageNum into buffer, point *ppBuffer to location
+    // bScan tells the replacement policy the read is part of a sequential scan
     RC  GetPage      (int fd, PageNum pageNum, char **ppBuffer,
-                      int bMultiplePins = TRUE);
+                      int bMultiplePins = TRUE, int bScan = FALSE);
     // Allocate a new page in the buffer, point *ppBuffer to its location
     RC  AllocatePage (int fd, PageNum pageNum, char **ppBuffer);
 
     RC  MarkDirty    (int fd, PageNum pageNum);  // Mark page dirty
     RC  UnpinPage    (int fd, PageNum pageNum);  // Unpin page from the buffer
     RC  FlushPages   (int fd);                   // Flush pages for file
+    bool HasPage     (int fd, PageNum pageNum) const; // Is the page in
+                                                  // the buffer or on its
+                                                  // way to the file
 
     // Force a page to the disk, but do not remove from the buffer pool
     RC ForcePages    (int fd, PageNum pageNum);
@@ -73,6 +108,9 @@ public:
     // Attempts to resize the buffer to the new size
     RC ResizeBuffer  (int iNewSize);
 
+    // Replace pages by the policy called name from now on
+    RC SetReplacer   (const char *name);
+
     // Three Methods for manipulating raw memory buffers.  These memory
     // locations are handled by the buffer manager, but are not
     // associated with a particular file.  These should be used if you
@@ -87,6 +125,7 @@ public:
     RC DisposeBlock  (char *buffer);
 
 private:
+    void InitBufTable();                         // Make every slot free
     RC  InsertFree   (int slot);                 // Insert slot at head of free
     RC  LinkHead     (int slot);                 // Insert slot at head of used
     RC  Unlink       (int slot);                 // Unlink slot
@@ -99,15 +138,53 @@ private:
     RC  WritePage    (int fd, PageNum pageNum, char *source);
 
     // Init the page desc entry
-    RC  InitPageDesc (int fd, PageNum pageNum, int slot);
-
+    RC  InitPageDesc (int fd, PageNum pageNum, int slot, int bScan = FALSE);
+
+    // Write the dirty pages in slots as one batch
+    RC  WritePages   (const std::vector<int> &slots);
+
+    // Hand the dirty page in slot to the background writer, or else
+    // write it now
+    RC  WriteBehind  (int slot, bool bWait);
+    // Hand the unpinned dirty pages at the LRU end to the background writer
+    void Trickle     ();
+    // Hand all unpinned dirty pages to the background writer and sync
+    // the files written since the last checkpoint
+    void Checkpoint  ();
+
+    // Start reading the pages after pageNum into spare slots
+    void ReadAhead   (int fd, PageNum pageNum);
+    // Wait for the pages being read ahead, and unpin the ones read
+    void FinishReadAhead();
+    // TRUE if pageNum of fd is being read ahead
+    bool IsReadingAhead(int fd, PageNum pageNum) const
+    {
+        return readAhead.numPages > 0 && readAhead.fd == fd &&
+               pageNum >= readAhead.firstPage &&
+               pageNum < readAhead.firstPage + readAhead.numPages;
+    }
+
+    char           *pArena;                       // memory of all buffer pages
+    size_t         arenaSize;                     // size of the arena
     PF_BufPageDesc *bufTable;                     // info on buffer pages
     PF_HashTable   hashTable;                     // Hash table object
+    PF_Replacer    *replacer;                     // Replacement policy
     int            numPages;                      // # of pages in the buffer
     int            pageSize;                      // Size of pages in the buffer
     int            first;                         // MRU page slot
     int            last;                          // LRU page slot
     int            free;                          // head of free list
+    std::unordered_map<int, PF_AccessRun> accessRuns; // sequential access
+                                                  // of every file
+    PF_AsyncIO     *aio;                          // Asynchronous I/O engine
+    PF_ReadAheadBatch readAhead;                  // Pages being read ahead
+    PF_BgWriter    *bgWriter;                     // Background writer, or
+                                                  // NULL to write inline
+    std::unordered_set<int> writtenFds;           // files written behind
+                                                  // since the checkpoint
+    time_t         lastCheckpoint;                // time of the checkpoint
+    int            numGetPage;                    // GetPage calls since the
+                                                  // clock was read
 };
 
 #endif
@@ -25,7 +25,8 @@ static char *PF_WarnMsg[] = {
   (char*)"page already unpinned",
   (char*)"end of file",
   (char*)"attempting to resize the buffer too small",
-  (char*)"invalid filename"
+  (char*)"unknown buffer replacement policy",
+  (char*)"page is mapped read-only"
 };
 
 static char *PF_ErrorMsg[] = {
@@ -11,6 +11,13 @@
 #include "pf_internal.h"
 #include "pf_buffermgr.h"
 
+#ifdef PF_STATS
+#include "statistics.h"
+
+// This is defined within pf_buffermgr.cc
+extern StatisticsMgr *pStatisticsMgr;
+#endif
+
 //
 // PF_FileHandle
 //
@@ -29,6 +36,7 @@ PF_FileHandle::PF_FileHandle()
     // Initialize local variables
     bFileOpen = FALSE;
     pBufferMgr = NULL;
+    pMap = NULL;
 }
 
 //
@@ -57,6 +65,7 @@ PF_FileHandle::PF_FileHandle(const PF_FileHandle &fileHandle)
     this->bFileOpen = fileHandle.bFileOpen;
     this->bHdrChanged = fileHandle.bHdrChanged;
     this->unixfd = fileHandle.unixfd;
+    this->pMap = fileHandle.pMap;
 }
 
 //
@@ -80,6 +89,7 @@ PF_FileHandle &PF_FileHandle::operator=(const PF_FileHandle &fileHandle)
         this->bFileOpen = fileHandle.bFileOpen;
         this->bHdrChanged = fileHandle.bHdrChanged;
         this->unixfd = fileHandle.unixfd;
+        this->pMap = fileHandle.pMap;
     }
 
     // Return a reference to this
@@ -200,12 +210,17 @@ RC PF_FileHandle::GetPrevPage(PageNum current, PF_PageHandle &pageHandle) const
 // Desc: Get a specific page in a file
 //       The file handle must refer to an open file
 // In:   pageNum - the number of the page to get
+//       bScan - TRUE if the page is read by a sequential scan, so the
+//               buffer manager may replace it early
 // Out:  pageHandle - becomes a handle to the this page of the file
 //                    this function modifies local var's in pageHandle
-//       The referenced page is pinned in the buffer pool.
+//       The referenced page is pinned in the buffer pool, or in the
+//       mapping of the file if it has one and the buffer doesn't hold
+//       a newer copy.
 // Ret:  PF return code
 //
-RC PF_FileHandle::GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle) const
+RC PF_FileHandle::GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle,
+                              int bScan) const
 {
     int rc;         // return code
     char *pPageBuf; // address of page in buffer pool
@@ -222,8 +237,25 @@ RC PF_FileHandle::GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle) const
         return (PF_INVALIDPAGE);
     }
 
+    // Read a mapped page in place
+    if (IsMapped(pageNum))
+    {
+        pPageBuf = pMap->Page(pageNum);
+#ifdef PF_STATS
+        pStatisticsMgr->Register(PF_MAPPAGE, STAT_ADDONE);
+#endif
+        if (((PF_PageHdr *)pPageBuf)->nextFree != PF_PAGE_USED)
+            return (PF_INVALIDPAGE);
+
+        pMap->pinCount[pageNum]++;
+        pMap->numPinned++;
+        pageHandle.pageNum = pageNum;
+        pageHandle.pPageData = pPageBuf + sizeof(PF_PageHdr);
+        return (0);
+    }
+
     // Get this page from the buffer manager
-    if ((rc = pBufferMgr->GetPage(unixfd, pageNum, &pPageBuf)))
+    if ((rc = pBufferMgr->GetPage(unixfd, pageNum, &pPageBuf, TRUE, bScan)))
         return (rc);
 
 #ifdef PF_LOG
@@ -343,6 +375,10 @@ RC PF_FileHandle::DisposePage(PageNum pageNum)
     if (!IsValidPageNum(pageNum))
         return (PF_INVALIDPAGE);
 
+    // A page pinned in the mapping counts as pinned
+    if (pMap && pageNum < pMap->numPages && pMap->pinCount[pageNum] > 0)
+        return (PF_PAGEPINNED);
+
     // Get the page (but don't re-pin it if it's already pinned)
     if ((rc = pBufferMgr->GetPage(unixfd,
                                   pageNum,
@@ -403,6 +439,10 @@ RC PF_FileHandle::MarkDirty(PageNum pageNum) const
     if (!IsValidPageNum(pageNum))
         return (PF_INVALIDPAGE);
 
+    // A page read from the mapping can't be written
+    if (IsMapped(pageNum))
+        return (PF_PAGEMAPPED);
+
     // Tell the buffer manager to mark the page dirty
     return (pBufferMgr->MarkDirty(unixfd, pageNum));
 }
@@ -432,6 +472,14 @@ RC PF_FileHandle::UnpinPage(PageNum pageNum) const
     if (!IsValidPageNum(pageNum))
         return (PF_INVALIDPAGE);
 
+    // Unpinning a mapped page is only bookkeeping
+    if (pMap && pageNum < pMap->numPages && pMap->pinCount[pageNum] > 0)
+    {
+        pMap->pinCount[pageNum]--;
+        pMap->numPinned--;
+        return (0);
+    }
+
     // Tell the buffer manager to unpin the page
     return (pBufferMgr->UnpinPage(unixfd, pageNum));
 }
@@ -454,14 +502,10 @@ RC PF_FileHandle::FlushPages() const
     if (bHdrChanged)
     {
 
-        // First seek to the appropriate place
-        if (lseek(unixfd, 0, L_SET) < 0)
-            return (PF_UNIX);
-
-        // Write header
-        int numBytes = write(unixfd,
-                             (char *)&hdr,
-                             sizeof(PF_FileHdr));
+        // Write header at the start of the file
+        ssize_t numBytes = pwrite(unixfd,
+                                  (char *)&hdr,
+                                  sizeof(PF_FileHdr), 0);
         if (numBytes < 0)
             return (PF_UNIX);
         if (numBytes != sizeof(PF_FileHdr))
@@ -497,14 +541,10 @@ RC PF_FileHandle::ForcePages(PageNum pageNum) const
     if (bHdrChanged)
     {
 
-        // First seek to the appropriate place
-        if (lseek(unixfd, 0, L_SET) < 0)
-            return (PF_UNIX);
-
-        // Write header
-        int numBytes = write(unixfd,
-                             (char *)&hdr,
-                             sizeof(PF_FileHdr));
+        // Write header at the start of the file
+        ssize_t numBytes = pwrite(unixfd,
+                                  (char *)&hdr,
+                                  sizeof(PF_FileHdr), 0);
         if (numBytes < 0)
             return (PF_UNIX);
         if (numBytes != sizeof(PF_FileHdr))
@@ -534,3 +574,21 @@ int PF_FileHandle::IsValidPageNum(PageNum pageNum) const
             pageNum >= 0 &&
             pageNum < hdr.numPages);
 }
+
+//
+// IsMapped
+//
+// Desc: Internal.  Return TRUE if pageNum is read from the mapping of
+//       the file, which is when the file is mapped up to the page, no
+//       writable handle of the file is open and the buffer doesn't hold
+//       the page
+// In:   pageNum - a valid page number
+// Ret:  TRUE or FALSE
+//
+int PF_FileHandle::IsMapped(PageNum pageNum) const
+{
+    return (pMap != NULL &&
+            pageNum < pMap->numPages &&
+            *pMap->pNumWriters == 0 &&
+            !pBufferMgr->HasPage(unixfd, pageNum));
+}
@@ -7,26 +7,58 @@
 
 #include "pf_internal.h"
 #include "pf_hashtable.h"
-#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <new>
+
+using namespace std;
+
+//
+// CapacityFor
+//
+// Desc: Internal.  The smallest power of two that keeps numEntries
+//       entries at most half full
+//
+static int CapacityFor(int numEntries)
+{
+    int capacity = PF_HASH_MIN_SIZE;
+    while (capacity < 2 * numEntries)
+        capacity *= 2;
+    return capacity;
+}
+
+//
+// AllocTable
+//
+// Desc: Internal.  Allocate a table of capacity unused entries
+// Ret:  The table, or NULL if out of memory
+//
+static PF_HashEntry *AllocTable(int capacity)
+{
+    PF_HashEntry *table = new (std::nothrow) PF_HashEntry[capacity];
+    if (table != NULL)
+        for (int i = 0; i < capacity; i++)
+            table[i].slot = PF_HASH_EMPTY;
+    return table;
+}
 
 //
 // PF_HashTable
 //
 // Desc: Constructor for PF_HashTable object, which allows search, insert,
 //       and delete of hash table entries.
-// In:   numBuckets - number of hash table buckets
+// In:   numEntries - number of entries expected, normally the number
+//       of pages in the buffer
 //
-PF_HashTable::PF_HashTable(int _numBuckets)
+PF_HashTable::PF_HashTable(int numEntries)
 {
-    // Initialize numBuckets local variable from parameter
-    this->numBuckets = _numBuckets;
-
-    // Allocate memory for hash table
-    hashTable = new PF_HashEntry *[numBuckets];
-
-    // Initialize all buckets to empty
-    for (int i = 0; i < numBuckets; i++)
-        hashTable[i] = NULL;
+    capacity = CapacityFor(numEntries);
+    numUsed = 0;
+    if ((hashTable = AllocTable(capacity)) == NULL)
+    {
+        cerr << "Not enough memory for buffer hash table\n";
+        exit(1);
+    }
 }
 
 //
@@ -36,22 +68,41 @@ PF_HashTable::PF_HashTable(int _numBuckets)
 //
 PF_HashTable::~PF_HashTable()
 {
-    // Clear out all buckets
-    for (int i = 0; i < numBuckets; i++)
-    {
+    delete[] hashTable;
+}
 
-        // Delete all entries in the bucket
-        PF_HashEntry *entry = hashTable[i];
-        while (entry != NULL)
-        {
-            PF_HashEntry *next = entry->next;
-            delete entry;
-            entry = next;
-        }
-    }
+//
+// Hash
+//
+// Desc: Internal.  Mix fd and pageNum into an index of the table.  The
+//       finalizer of MurmurHash3 spreads consecutive pages of a file
+//       over the whole table, which (fd + pageNum) would not.
+//
+int PF_HashTable::Hash(int fd, PageNum pageNum) const
+{
+    uint64_t key = ((uint64_t)(uint32_t)fd << 32) | (uint32_t)pageNum;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (int)(key & (uint64_t)(capacity - 1));
+}
 
-    // Finally delete the hash table
-    delete[] hashTable;
+//
+// Probe
+//
+// Desc: Internal.  Walk from the home entry of fd and pageNum to either
+//       their entry or the first unused one.  The table is never full,
+//       so the walk always ends.
+//
+int PF_HashTable::Probe(int fd, PageNum pageNum) const
+{
+    int i = Hash(fd, pageNum);
+    while (hashTable[i].slot != PF_HASH_EMPTY &&
+           (hashTable[i].fd != fd || hashTable[i].pageNum != pageNum))
+        i = (i + 1) & (capacity - 1);
+    return i;
 }
 
 //
@@ -63,36 +114,23 @@ PF_HashTable::~PF_HashTable()
 // Out:  slot - set to slot associated with fd and pageNum
 // Ret:  PF return code
 //
-RC PF_HashTable::Find(int fd, PageNum pageNum, int &slot)
+RC PF_HashTable::Find(int fd, PageNum pageNum, int &slot) const
 {
-    // Get which bucket it should be in
-    int bucket = Hash(fd, pageNum);
-
-    if (bucket < 0)
+    int i = Probe(fd, pageNum);
+    if (hashTable[i].slot == PF_HASH_EMPTY)
         return (PF_HASHNOTFOUND);
 
-    // Go through the linked list of this bucket
-    for (PF_HashEntry *entry = hashTable[bucket];
-         entry != NULL;
-         entry = entry->next)
-    {
-        if (entry->fd == fd && entry->pageNum == pageNum)
-        {
-
-            // Found it
-            slot = entry->slot;
-            return (0);
-        }
-    }
-
-    // Didn't find it
-    return (PF_HASHNOTFOUND);
+    // Found it
+    slot = hashTable[i].slot;
+    return (0);
 }
 
 //
 // Insert
 //
-// Desc: Insert a hash table entry
+// Desc: Insert a hash table entry.  The table grows when it would become
+//       more than half full, which only happens if it was built for
+//       fewer entries than are inserted.
 // In:   fd - file descriptor
 //       pagenum - page number
 //       slot - slot associated with fd and pageNum
@@ -100,36 +138,21 @@ RC PF_HashTable::Find(int fd, PageNum pageNum, int &slot)
 //
 RC PF_HashTable::Insert(int fd, PageNum pageNum, int slot)
 {
-    // Get which bucket it should be in
-    int bucket = Hash(fd, pageNum);
-
-    // Check entry doesn't already exist in the bucket
-    PF_HashEntry *entry;
-    for (entry = hashTable[bucket];
-         entry != NULL;
-         entry = entry->next)
-    {
-        if (entry->fd == fd && entry->pageNum == pageNum)
-        {
-            return (PF_HASHPAGEEXIST);
-        }
-    }
+    RC rc;
 
-    // Allocate memory for new hash entry
-    if ((entry = new PF_HashEntry) == NULL)
-    {
-        return (PF_NOMEM);
-    }
+    if (2 * (numUsed + 1) > capacity && (rc = Resize(numUsed + 1)))
+        return (rc);
+
+    // Check entry doesn't already exist
+    int i = Probe(fd, pageNum);
+    if (hashTable[i].slot != PF_HASH_EMPTY)
+        return (PF_HASHPAGEEXIST);
 
-    // Insert entry at head of list for this bucket
-    entry->fd = fd;
-    entry->pageNum = pageNum;
-    entry->slot = slot;
-    entry->next = hashTable[bucket];
-    entry->prev = NULL;
-    if (hashTable[bucket] != NULL)
-        hashTable[bucket]->prev = entry;
-    hashTable[bucket] = entry;
+    // Fill the unused entry that ended the probe
+    hashTable[i].fd = fd;
+    hashTable[i].pageNum = pageNum;
+    hashTable[i].slot = slot;
+    numUsed++;
 
     // Return ok
     return (0);
@@ -143,34 +166,70 @@ RC PF_HashTable::Insert(int fd, PageNum pageNum, int slot)
 //       pagenum - page number
 // Ret:  PF return code
 //
+/* Steps:
+    1) Find the entry, making it the hole
+    2) Walk the entries after the hole until an unused one. An entry whose
+       home is not cyclically in (hole, entry] would become unreachable, so
+       move it into the hole, and its old place becomes the hole
+    3) Mark the last hole unused
+*/
 RC PF_HashTable::Delete(int fd, PageNum pageNum)
 {
-    // Get which bucket it should be in
-    int bucket = Hash(fd, pageNum);
-
-    // Find the entry is in this bucket
-    PF_HashEntry *entry;
-    for (entry = hashTable[bucket];
-         entry != NULL;
-         entry = entry->next)
+    // 1) Find the entry
+    int hole = Probe(fd, pageNum);
+    if (hashTable[hole].slot == PF_HASH_EMPTY)
+        return (PF_HASHNOTFOUND);
+
+    // 2) Shift the following entries back
+    int mask = capacity - 1;
+    for (int i = (hole + 1) & mask;
+         hashTable[i].slot != PF_HASH_EMPTY;
+         i = (i + 1) & mask)
     {
-        if (entry->fd == fd && entry->pageNum == pageNum)
-            break;
+        int home = Hash(hashTable[i].fd, hashTable[i].pageNum);
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            hashTable[hole] = hashTable[i];
+            hole = i;
+        }
     }
 
-    // Did we find hash entry?
-    if (entry == NULL)
-        return (PF_HASHNOTFOUND);
+    // 3) Remove the entry
+    hashTable[hole].slot = PF_HASH_EMPTY;
+    numUsed--;
+
+    // Return ok
+    return (0);
+}
+
+//
+// Resize
+//
+// Desc: Rehash all entries into a table sized for numEntries entries, or
+//       for the entries in use if there are more of them
+// In:   numEntries - number of entries expected
+// Ret:  PF return code
+//
+RC PF_HashTable::Resize(int numEntries)
+{
+    int newCapacity = CapacityFor(numEntries > numUsed ? numEntries : numUsed);
+    if (newCapacity == capacity)
+        return (0);
+
+    PF_HashEntry *oldTable = hashTable;
+    int oldCapacity = capacity;
+    if ((hashTable = AllocTable(newCapacity)) == NULL)
+    {
+        hashTable = oldTable;
+        return (PF_NOMEM);
+    }
+    capacity = newCapacity;
 
-    // Remove this entry
-    if (entry == hashTable[bucket])
-        hashTable[bucket] = entry->next;
-    if (entry->prev != NULL)
-        entry->prev->next = entry->next;
-    if (entry->next != NULL)
-        entry->next->prev = entry->prev;
-    delete entry;
+    // Every key is distinct, so an entry goes to the end of its probe
+    for (int i = 0; i < oldCapacity; i++)
+        if (oldTable[i].slot != PF_HASH_EMPTY)
+            hashTable[Probe(oldTable[i].fd, oldTable[i].pageNum)] = oldTable[i];
 
-    // Return ook
+    delete[] oldTable;
     return (0);
 }
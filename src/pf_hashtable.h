@@ -11,35 +11,42 @@
 #include "pf_internal.h"
 
 //
-// HashEntry - Hash table bucket entries
+// HashEntry - Hash table entries, stored inline in the table
 //
 struct PF_HashEntry {
-    PF_HashEntry *next;   // next hash table element or NULL
-    PF_HashEntry *prev;   // prev hash table element or NULL
     int          fd;      // file descriptor
     PageNum      pageNum; // page number
-    int          slot;    // slot of this page in the buffer
+    int          slot;    // slot of this page in the buffer, or
+                          // PF_HASH_EMPTY if the entry is unused
 };
 
 //
 // PF_HashTable - allow search, insertion, and deletion of hash table entries
 //
+// The table uses open addressing with linear probing, and is kept at most
+// half full, so a lookup touches one or two adjacent entries on average.
+// Deletion shifts the following entries back instead of leaving tombstones.
+//
 class PF_HashTable {
 public:
-    PF_HashTable (int numBuckets);           // Constructor
+    PF_HashTable (int numEntries);           // Constructor
     ~PF_HashTable();                         // Destructor
-    RC  Find     (int fd, PageNum pageNum, int &slot);
+    RC  Find     (int fd, PageNum pageNum, int &slot) const;
                                              // Set slot to the hash table
                                              // entry for fd and pageNum
     RC  Insert   (int fd, PageNum pageNum, int slot);
                                              // Insert a hash table entry
     RC  Delete   (int fd, PageNum pageNum);  // Delete a hash table entry
+    RC  Resize   (int numEntries);           // Rehash to hold numEntries
 
 private:
-    int Hash     (int fd, PageNum pageNum) const
-      { return ((fd + pageNum) % numBuckets); }   // Hash function
-    int numBuckets;                               // Number of hash table buckets
-    PF_HashEntry **hashTable;                     // Hash table
+    int Hash     (int fd, PageNum pageNum) const;  // Hash function
+    int Probe    (int fd, PageNum pageNum) const;  // Entry of fd and pageNum,
+                                                   // or the empty one after
+    int capacity;                                  // Number of entries, a
+                                                   // power of two
+    int numUsed;                                   // Number of used entries
+    PF_HashEntry *hashTable;                       // Hash table
 };
 
 #endif
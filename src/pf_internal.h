@@ -11,13 +11,34 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
 #include "pf.h"
 
 //
 // Constants and defines
 //
-const int PF_BUFFER_SIZE = 40;   // Number of pages in the buffer
-const int PF_HASH_TBL_SIZE = 20; // Size of hash table
+const int PF_BUFFER_SIZE = 16384; // Default number of pages in the buffer
+const size_t PF_ARENA_ALIGN = 2 << 20; // Alignment of the buffer, one huge page
+#define PF_BUFFER_SIZE_ENV "PURPLEBASE_BUFFER_PAGES" // Overrides PF_BUFFER_SIZE
+const int PF_READAHEAD_PAGES = 32;  // Most pages read ahead at once
+const int PF_READAHEAD_TRIGGER = 2; // Requests of the next page in a row
+                                    // that start read-ahead
+const int PF_AIO_THREADS = 4;       // Threads of the thread pool I/O engine
+const int PF_AIO_QUEUE_DEPTH = 64;  // Most requests in flight on io_uring
+const int PF_AIO_CHUNK_PAGES = 8;   // Pages in one read-ahead request
+const int PF_AIO_MAX_IOV = 1024;    // Most buffers in one request, UIO_MAXIOV
+#define PF_AIO_ENGINE_ENV "PURPLEBASE_IO_ENGINE" // "uring", "threads" or "sync"
+const int PF_BGWRITE_FRAMES = 256;  // Pages queued for the background writer
+const int PF_BGWRITE_SCAN = 16;     // Pages from the LRU end looked at for
+                                    // dirty ones on every replacement
+const int PF_CHECKPOINT_SECONDS = 30; // Time between checkpoints
+const int PF_CHECKPOINT_CHECK = 4096; // GetPage calls between clock reads
+#define PF_BGWRITER_ENV "PURPLEBASE_BGWRITER" // "0" writes pages inline
+const int PF_HASH_MIN_SIZE = 16; // Minimum number of hash table entries
+const int PF_HASH_EMPTY = -1;    // Slot of an unused hash table entry
 
 #define CREATION_MASK 0600  // r/w privileges to owner only
 #define PF_PAGE_LIST_END -1 // end of list of free pages
@@ -44,4 +65,36 @@ struct PF_PageHdr
 // Justify the file header to the length of one page
 const int PF_FILE_HDR_SIZE = PF_PAGE_SIZE + sizeof(PF_PageHdr);
 
+//
+// PF_FileTable: the writable handles open in a PF_Manager, by the identity
+// of their files, since every handle has a file descriptor of its own
+//
+typedef std::pair<dev_t, ino_t> PF_FileId;
+
+struct PF_FileTable
+{
+    std::map<PF_FileId, int> numWriters; // writable handles open of a file
+    std::map<int, PF_FileId> writerFile; // the file of a writable handle, by fd
+};
+
+//
+// PF_FileMap: the read-only mapping of a file and the pins of its pages,
+// shared by the copies of a PF_FileHandle
+//
+struct PF_FileMap
+{
+    char *pData;                 // the whole file, header first
+    size_t size;                 // length of the mapping
+    PageNum numPages;            // pages in the mapping
+    int numPinned;               // pins of all mapped pages
+    std::vector<short> pinCount; // pins of every mapped page
+    const int *pNumWriters;      // writable handles open of the file
+
+    // The page pageNum in the mapping
+    char *Page(PageNum pageNum) const
+    {
+        return pData + PF_FILE_HDR_SIZE + pageNum * (PF_PAGE_SIZE + sizeof(PF_PageHdr));
+    }
+};
+
 #endif
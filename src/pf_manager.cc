@@ -8,6 +8,7 @@
 #include <cstdio>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include "pf_internal.h"
@@ -20,11 +21,34 @@
 //       Handles creation, deletion, opening and closing of files.
 //       It is associated with a PF_BufferMgr that manages the page
 //       buffer and executes the page replacement policies.
+//       The buffer has PF_BUFFER_SIZE pages, unless the environment
+//       variable PF_BUFFER_SIZE_ENV gives a positive number.
 //
 PF_Manager::PF_Manager()
 {
+   int numPages = PF_BUFFER_SIZE;
+   const char *psPages = getenv(PF_BUFFER_SIZE_ENV);
+   if (psPages != NULL && atoi(psPages) > 0)
+      numPages = atoi(psPages);
+
    // Create Buffer Manager
-   pBufferMgr = new PF_BufferMgr(PF_BUFFER_SIZE);
+   pBufferMgr = new PF_BufferMgr(numPages);
+   bMapping = FALSE;
+   pFiles = new PF_FileTable;
+}
+
+//
+// PF_Manager
+//
+// Desc: Constructor with the number of buffer pages
+// In:   numPages - the number of pages in the buffer
+//
+PF_Manager::PF_Manager(int numPages)
+{
+   // Create Buffer Manager
+   pBufferMgr = new PF_BufferMgr(numPages);
+   bMapping = FALSE;
+   pFiles = new PF_FileTable;
 }
 
 //
@@ -38,6 +62,7 @@ PF_Manager::~PF_Manager()
 {
    // Destroy the buffer manager objects
    delete pBufferMgr;
+   delete pFiles;
 }
 
 //
@@ -73,7 +98,7 @@ RC PF_Manager::CreateFile (const char *fileName)
    hdr->numPages = 0;
 
    // Write header to file
-   if((numBytes = write(fd, hdrBuf, PF_FILE_HDR_SIZE))
+   if((numBytes = pwrite(fd, hdrBuf, PF_FILE_HDR_SIZE, 0))
          != PF_FILE_HDR_SIZE) {
 
       // Error while writing: close and remove file
@@ -112,6 +137,40 @@ RC PF_Manager::DestroyFile (const char *fileName)
    return (0);
 }
 
+//
+// MapFile
+//
+// Desc: Internal.  Map the pages of an open file read-only
+// In:   fd - OS file descriptor
+//       numPages - number of pages in the file header
+// Ret:  The mapping, or NULL if the file has no pages or can't be mapped
+//
+static PF_FileMap *MapFile(int fd, PageNum numPages)
+{
+   // Map no more pages than the file holds
+   struct stat st;
+   if (fstat(fd, &st) < 0)
+      return (NULL);
+   PageNum numWhole = (st.st_size - PF_FILE_HDR_SIZE) / (PF_PAGE_SIZE + sizeof(PF_PageHdr));
+   if (numWhole < numPages)
+      numPages = numWhole;
+   if (numPages <= 0)
+      return (NULL);
+
+   size_t size = PF_FILE_HDR_SIZE + numPages * (PF_PAGE_SIZE + sizeof(PF_PageHdr));
+   void *pData = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+   if (pData == MAP_FAILED)
+      return (NULL);
+
+   PF_FileMap *pMap = new PF_FileMap;
+   pMap->pData = (char *)pData;
+   pMap->size = size;
+   pMap->numPages = numPages;
+   pMap->numPinned = 0;
+   pMap->pinCount.assign(numPages, 0);
+   return (pMap);
+}
+
 //
 // OpenFile
 //
@@ -122,14 +181,21 @@ RC PF_Manager::DestroyFile (const char *fileName)
 //       circumstances, crash the PF layer. Note that even if only one instance
 //       of a file is for writing, problems may occur because some writes may
 //       not be seen by a reader of another instance of the file.
+//       If mapping is on, a file opened read-only is mapped, and its
+//       pages are read from the mapping instead of the buffer.  Since
+//       the dirty pages of another handle of the file can't be seen
+//       there, the file isn't mapped while a writable handle of it is
+//       open.  Without a mapping the file is opened as usual.
 // In:   fileName - name of file to open
+//       bReadOnly - TRUE if no page will be written through fileHandle
 // Out:  fileHandle - refer to the open file
 //                    this function modifies local var's in fileHandle
 //       to point to the file data in the file table, and to point to the
 //       buffer manager object
 // Ret:  PF_FILEOPEN or other PF return code
 //
-RC PF_Manager::OpenFile (const char *fileName, PF_FileHandle &fileHandle)
+RC PF_Manager::OpenFile (const char *fileName, PF_FileHandle &fileHandle,
+                        int bReadOnly)
 {
    int rc;                   // return code
 
@@ -147,8 +213,8 @@ RC PF_Manager::OpenFile (const char *fileName, PF_FileHandle &fileHandle)
 
    // Read the file header
    {
-      int numBytes = read(fileHandle.unixfd, (char *)&fileHandle.hdr,
-            sizeof(PF_FileHdr));
+      int numBytes = pread(fileHandle.unixfd, (char *)&fileHandle.hdr,
+            sizeof(PF_FileHdr), 0);
       if (numBytes != sizeof(PF_FileHdr)) {
          rc = (numBytes < 0) ? PF_UNIX : PF_HDRREAD;
          goto err;
@@ -158,6 +224,27 @@ RC PF_Manager::OpenFile (const char *fileName, PF_FileHandle &fileHandle)
    // Set file header to be not changed
    fileHandle.bHdrChanged = FALSE;
 
+   // Count the writable handles of the file
+   {
+      struct stat st;
+      if (fstat(fileHandle.unixfd, &st) < 0) {
+         rc = PF_UNIX;
+         goto err;
+      }
+      PF_FileId fileId(st.st_dev, st.st_ino);
+      int &numWriters = pFiles->numWriters[fileId];
+      if (!bReadOnly) {
+         numWriters++;
+         pFiles->writerFile[fileHandle.unixfd] = fileId;
+      }
+
+      // Map the pages if allowed and no writable handle is open
+      fileHandle.pMap = (bReadOnly && bMapping && numWriters == 0) ?
+         MapFile(fileHandle.unixfd, fileHandle.hdr.numPages) : NULL;
+      if (fileHandle.pMap)
+         fileHandle.pMap->pNumWriters = &numWriters;
+   }
+
    // Set local variables in file handle object to refer to open file
    fileHandle.pBufferMgr = pBufferMgr;
    fileHandle.bFileOpen = TRUE;
@@ -194,10 +281,31 @@ RC PF_Manager::CloseFile(PF_FileHandle &fileHandle)
    if (!fileHandle.bFileOpen)
       return (PF_CLOSEDFILE);
 
+   // Mapped pages must be unpinned too
+   if (fileHandle.pMap && fileHandle.pMap->numPinned > 0)
+      return (PF_PAGEPINNED);
+
    // Flush all buffers for this file and write out the header
    if ((rc = fileHandle.FlushPages()))
       return (rc);
 
+   // Drop the mapping
+   if (fileHandle.pMap) {
+      munmap(fileHandle.pMap->pData, fileHandle.pMap->size);
+      delete fileHandle.pMap;
+      fileHandle.pMap = NULL;
+   }
+
+   // A writable handle no longer keeps the file from being mapped
+   {
+      std::map<int, PF_FileId>::iterator it =
+         pFiles->writerFile.find(fileHandle.unixfd);
+      if (it != pFiles->writerFile.end()) {
+         pFiles->numWriters[it->second]--;
+         pFiles->writerFile.erase(it);
+      }
+   }
+
    // Close the file
    if (close(fileHandle.unixfd) < 0)
       return (PF_UNIX);
@@ -258,6 +366,34 @@ RC PF_Manager::ResizeBuffer(int iNewSize)
    return pBufferMgr->ResizeBuffer(iNewSize);
 }
 
+//
+// SetReplacer
+//
+// Desc: Chooses the replacement policy of the buffer manager.
+//       This routine will be called via "set bufferpolicy".
+// In:   name - one of "lru", "clock", "lru2" and "2q"
+// Ret:  Returns the result of PF_BufferMgr::SetReplacer
+//       It is a code: 0 for success, PF_BADREPLACER when name is unknown.
+//
+RC PF_Manager::SetReplacer(const char *name)
+{
+   return pBufferMgr->SetReplacer(name);
+}
+
+//
+// SetMapping
+//
+// Desc: Choose whether files opened read-only from now on are mapped.
+//       This routine will be called via "set mmap".
+// In:   bMapping - TRUE to map them
+// Ret:  Always returns 0
+//
+RC PF_Manager::SetMapping(int bMapping)
+{
+   this->bMapping = bMapping;
+   return (0);
+}
+
 //------------------------------------------------------------------------------
 // Three Methods for manipulating raw memory buffers.  These memory
 // locations are handled by the buffer manager, but are not
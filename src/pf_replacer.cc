@@ -0,0 +1,433 @@
+//
+// File:        pf_replacer.cc
+// Description: PF_Replacer class implementation, with the LRU, CLOCK,
+//              LRU-2 and 2Q replacement policies
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <strings.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "pf_buffermgr.h"
+#include "pf_replacer.h"
+
+using namespace std;
+
+const char *const PF_REPLACER_NAMES[] = {"lru", "clock", "lru2", "2q"};
+const int PF_REPLACER_COUNT = sizeof(PF_REPLACER_NAMES) / sizeof(PF_REPLACER_NAMES[0]);
+
+const char *const PF_REPLACER_HIT_KEYS[] = {
+    "LRU_PAGEFOUND", "CLOCK_PAGEFOUND", "LRU2_PAGEFOUND", "2Q_PAGEFOUND"};
+const char *const PF_REPLACER_MISS_KEYS[] = {
+    "LRU_PAGENOTFOUND", "CLOCK_PAGENOTFOUND", "LRU2_PAGENOTFOUND", "2Q_PAGENOTFOUND"};
+
+// The index of the policy called name, or -1
+static int ReplacerIndex(const char *name)
+{
+    for (int i = 0; i < PF_REPLACER_COUNT; ++i)
+        if (strcasecmp(name, PF_REPLACER_NAMES[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char *PF_Replacer::HitKey() const
+{
+    return PF_REPLACER_HIT_KEYS[ReplacerIndex(Name())];
+}
+
+const char *PF_Replacer::MissKey() const
+{
+    return PF_REPLACER_MISS_KEYS[ReplacerIndex(Name())];
+}
+
+// The key of a page in the ghost lists
+static uint64_t PageKey(int fd, PageNum pageNum)
+{
+    return ((uint64_t)(uint32_t)fd << 32) | (uint32_t)pageNum;
+}
+
+//
+// PF_SlotQueue: a doubly linked list of slots, with the links kept in
+// arrays shared by all queues of a policy, since a slot is in one queue
+// at most
+//
+struct PF_SlotLinks
+{
+    vector<int> prev, next;
+    PF_SlotLinks(int numPages) : prev(numPages, INVALID_SLOT), next(numPages, INVALID_SLOT) {}
+};
+
+struct PF_SlotQueue
+{
+    int head = INVALID_SLOT; // most recent
+    int tail = INVALID_SLOT; // least recent
+    int size = 0;
+
+    void PushHead(PF_SlotLinks &links, int slot)
+    {
+        links.prev[slot] = INVALID_SLOT;
+        links.next[slot] = head;
+        if (head != INVALID_SLOT)
+            links.prev[head] = slot;
+        head = slot;
+        if (tail == INVALID_SLOT)
+            tail = slot;
+        ++size;
+    }
+
+    void PushTail(PF_SlotLinks &links, int slot)
+    {
+        links.next[slot] = INVALID_SLOT;
+        links.prev[slot] = tail;
+        if (tail != INVALID_SLOT)
+            links.next[tail] = slot;
+        tail = slot;
+        if (head == INVALID_SLOT)
+            head = slot;
+        ++size;
+    }
+
+    void Erase(PF_SlotLinks &links, int slot)
+    {
+        int prev = links.prev[slot], next = links.next[slot];
+        (prev != INVALID_SLOT ? links.next[prev] : head) = next;
+        (next != INVALID_SLOT ? links.prev[next] : tail) = prev;
+        links.prev[slot] = links.next[slot] = INVALID_SLOT;
+        --size;
+    }
+
+    // The least recent unpinned slot, or INVALID_SLOT
+    int LastUnpinned(const PF_SlotLinks &links, const PF_BufPageDesc *bufTable) const
+    {
+        int slot = tail;
+        while (slot != INVALID_SLOT && bufTable[slot].pinCount > 0)
+            slot = links.prev[slot];
+        return slot;
+    }
+};
+
+//
+// PF_LRUReplacer: replace the least recently used page.  Scanned pages
+// enter at the LRU end, and scan hits don't promote.
+//
+class PF_LRUReplacer : public PF_Replacer
+{
+public:
+    PF_LRUReplacer(int numPages) : links(numPages) {}
+
+    const char *Name() const { return "lru"; }
+
+    void Admit(int slot, int, PageNum, bool bScan)
+    {
+        if (bScan)
+            queue.PushTail(links, slot);
+        else
+            queue.PushHead(links, slot);
+    }
+
+    void Access(int slot, bool bScan)
+    {
+        if (bScan)
+            return;
+        queue.Erase(links, slot);
+        queue.PushHead(links, slot);
+    }
+
+    void Remove(int slot) { queue.Erase(links, slot); }
+
+    int Victim(const PF_BufPageDesc *bufTable)
+    {
+        int slot = queue.LastUnpinned(links, bufTable);
+        if (slot != INVALID_SLOT)
+            queue.Erase(links, slot);
+        return slot;
+    }
+
+private:
+    PF_SlotLinks links;
+    PF_SlotQueue queue;
+};
+
+//
+// PF_ClockReplacer: second chance.  The hand sweeps the slots, clearing
+// reference bits, and replaces the first unpinned page whose bit is clear.
+// Scanned pages enter without their bit set, and are replaced first, in
+// the order they came, as long as nothing else referenced them; otherwise
+// the sweeps would clear the bits of the other pages.
+//
+class PF_ClockReplacer : public PF_Replacer
+{
+public:
+    PF_ClockReplacer(int numPages)
+        : referenced(numPages, false), resident(numPages, false), scanned(numPages, false), hand(0) {}
+
+    const char *Name() const { return "clock"; }
+
+    void Admit(int slot, int, PageNum, bool bScan)
+    {
+        resident[slot] = true;
+        referenced[slot] = !bScan;
+        scanned[slot] = bScan;
+        if (bScan)
+            scanSlots.push_back(slot);
+    }
+
+    void Access(int slot, bool bScan)
+    {
+        if (!bScan)
+            referenced[slot] = true;
+    }
+
+    void Remove(int slot) { resident[slot] = referenced[slot] = scanned[slot] = false; }
+
+    // Two sweeps clear every bit, so a third can't find more
+    int Victim(const PF_BufPageDesc *bufTable)
+    {
+        // The oldest scanned page, unless it's pinned
+        while (!scanSlots.empty())
+        {
+            int slot = scanSlots.front();
+            if (!scanned[slot] || referenced[slot])
+            {
+                scanned[slot] = false;
+                scanSlots.pop_front();
+                continue;
+            }
+            if (bufTable[slot].pinCount > 0)
+                break;
+            scanSlots.pop_front();
+            resident[slot] = scanned[slot] = false;
+            return slot;
+        }
+
+        int numPages = (int)resident.size();
+        for (int step = 0; step < 2 * numPages; ++step)
+        {
+            int slot = hand;
+            hand = (hand + 1) % numPages;
+            if (!resident[slot] || bufTable[slot].pinCount > 0)
+                continue;
+            if (referenced[slot])
+                referenced[slot] = false;
+            else
+            {
+                resident[slot] = scanned[slot] = false;
+                return slot;
+            }
+        }
+        return INVALID_SLOT;
+    }
+
+private:
+    vector<bool> referenced;
+    vector<bool> resident;
+    vector<bool> scanned;
+    deque<int> scanSlots;
+    int hand;
+};
+
+//
+// PF_LRU2Replacer: LRU-K with K = 2.  Replace the page whose second most
+// recent access is the oldest; pages accessed once go first, in LRU order.
+// The last access of a replaced page is remembered for a while, so a page
+// read again soon counts as accessed twice.  Scanned pages enter as if
+// accessed long ago and leave no history.
+//
+class PF_LRU2Replacer : public PF_Replacer
+{
+public:
+    PF_LRU2Replacer(int numPages)
+        : last(numPages, 0), prev(numPages, 0), scanned(numPages, false),
+          keys(numPages, 0), now(0), historySize(numPages) {}
+
+    const char *Name() const { return "lru2"; }
+
+    void Admit(int slot, int fd, PageNum pageNum, bool bScan)
+    {
+        keys[slot] = PageKey(fd, pageNum);
+        scanned[slot] = bScan;
+        prev[slot] = 0;
+        last[slot] = bScan ? 0 : ++now;
+        auto it = bScan ? history.end() : history.find(keys[slot]);
+        if (it != history.end())
+        {
+            prev[slot] = it->second;
+            history.erase(it);
+        }
+        order.insert(Rank(slot));
+    }
+
+    void Access(int slot, bool bScan)
+    {
+        if (bScan)
+            return;
+        order.erase(Rank(slot));
+        prev[slot] = last[slot];
+        last[slot] = ++now;
+        scanned[slot] = false;
+        order.insert(Rank(slot));
+    }
+
+    void Remove(int slot) { order.erase(Rank(slot)); }
+
+    int Victim(const PF_BufPageDesc *bufTable)
+    {
+        for (auto it = order.begin(); it != order.end(); ++it)
+        {
+            int slot = it->second;
+            if (bufTable[slot].pinCount > 0)
+                continue;
+            order.erase(it);
+            if (!scanned[slot])
+                Remember(keys[slot], last[slot]);
+            return slot;
+        }
+        return INVALID_SLOT;
+    }
+
+private:
+    // Ordered by the backward 2-distance, largest first: the pages accessed
+    // once by their last access, then the others by their second last one
+    typedef pair<pair<bool, long long>, int> RankType;
+    RankType Rank(int slot) const
+    {
+        return {{prev[slot] != 0, prev[slot] != 0 ? prev[slot] : last[slot]}, slot};
+    }
+
+    // Keep the last access of a replaced page, forgetting the oldest ones
+    void Remember(uint64_t key, long long access)
+    {
+        if (history.insert({key, access}).second)
+            historyOrder.push_back(key);
+        while ((int)historyOrder.size() > historySize)
+        {
+            history.erase(historyOrder.front());
+            historyOrder.pop_front();
+        }
+    }
+
+    vector<long long> last, prev;
+    vector<bool> scanned;
+    vector<uint64_t> keys;
+    set<RankType> order;
+    long long now;
+    unordered_map<uint64_t, long long> history;
+    deque<uint64_t> historyOrder;
+    int historySize;
+};
+
+//
+// PF_2QReplacer: full 2Q.  A page read for the first time enters the FIFO
+// A1in; if it's replaced from there, its key goes to the ghost FIFO A1out.
+// A page read again while its key is in A1out enters the LRU Am.  A1in is
+// kept to a quarter of the buffer, so pages touched once don't push out
+// the ones touched again.  Scanned pages enter A1in and leave no ghost.
+//
+class PF_2QReplacer : public PF_Replacer
+{
+public:
+    PF_2QReplacer(int numPages)
+        : links(numPages), inAm(numPages, false), scanned(numPages, false), keys(numPages, 0),
+          maxIn(numPages / 4 > 0 ? numPages / 4 : 1), maxOut(numPages / 2 > 0 ? numPages / 2 : 1) {}
+
+    const char *Name() const { return "2q"; }
+
+    void Admit(int slot, int fd, PageNum pageNum, bool bScan)
+    {
+        keys[slot] = PageKey(fd, pageNum);
+        scanned[slot] = bScan;
+        auto it = bScan ? ghosts.end() : ghosts.find(keys[slot]);
+        inAm[slot] = it != ghosts.end();
+        if (inAm[slot])
+        {
+            ghosts.erase(it);
+            am.PushHead(links, slot);
+        }
+        else
+            a1in.PushHead(links, slot);
+    }
+
+    // Hits in A1in are correlated with the first access, so they don't count
+    void Access(int slot, bool bScan)
+    {
+        if (bScan || !inAm[slot])
+            return;
+        am.Erase(links, slot);
+        am.PushHead(links, slot);
+    }
+
+    void Remove(int slot) { (inAm[slot] ? am : a1in).Erase(links, slot); }
+
+    int Victim(const PF_BufPageDesc *bufTable)
+    {
+        int slot = INVALID_SLOT;
+        if (a1in.size > maxIn || am.size == 0)
+            slot = a1in.LastUnpinned(links, bufTable);
+        if (slot == INVALID_SLOT)
+            slot = am.LastUnpinned(links, bufTable);
+        if (slot == INVALID_SLOT)
+            slot = a1in.LastUnpinned(links, bufTable);
+        if (slot == INVALID_SLOT)
+            return INVALID_SLOT;
+
+        if (inAm[slot])
+            am.Erase(links, slot);
+        else
+        {
+            a1in.Erase(links, slot);
+            if (!scanned[slot])
+                Remember(keys[slot]);
+        }
+        return slot;
+    }
+
+private:
+    void Remember(uint64_t key)
+    {
+        if (ghosts.insert(key).second)
+            ghostOrder.push_back(key);
+        while ((int)ghostOrder.size() > maxOut)
+        {
+            ghosts.erase(ghostOrder.front());
+            ghostOrder.pop_front();
+        }
+    }
+
+    PF_SlotLinks links;
+    PF_SlotQueue a1in, am;
+    vector<bool> inAm;
+    vector<bool> scanned;
+    vector<uint64_t> keys;
+    int maxIn, maxOut;
+    unordered_set<uint64_t> ghosts;
+    deque<uint64_t> ghostOrder;
+};
+
+//
+// PF_NewReplacer
+//
+// Desc: Create a replacement policy by name, ignoring case
+// In:   name - one of PF_REPLACER_NAMES
+//       numPages - the number of slots in the buffer
+// Ret:  The new policy, or NULL if name is unknown
+//
+PF_Replacer *PF_NewReplacer(const char *name, int numPages)
+{
+    switch (ReplacerIndex(name))
+    {
+    case 0:
+        return new PF_LRUReplacer(numPages);
+    case 1:
+        return new PF_ClockReplacer(numPages);
+    case 2:
+        return new PF_LRU2Replacer(numPages);
+    case 3:
+        return new PF_2QReplacer(numPages);
+    default:
+        return NULL;
+    }
+}
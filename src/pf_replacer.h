@@ -0,0 +1,57 @@
+//
+// File:        pf_replacer.h
+// Description: PF_Replacer class interface, the replacement policies of
+//              the buffer manager
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#ifndef PF_REPLACER_H
+#define PF_REPLACER_H
+
+#include <vector>
+#include "pf_internal.h"
+
+struct PF_BufPageDesc;
+
+//
+// PF_Replacer: chooses the buffer slot to replace
+//
+// The buffer manager tells the policy about every page that enters or
+// leaves the buffer and about every hit, and asks it for a victim when no
+// slot is free.  Pages read by a sequential scan are flagged bScan, so a
+// policy can admit them cold and keep one scan from flushing the pool.
+//
+class PF_Replacer
+{
+public:
+    virtual ~PF_Replacer() {}
+
+    // The name of the policy, as given to "set bufferpolicy"
+    virtual const char *Name() const = 0;
+
+    // A page was read or allocated into slot
+    virtual void Admit(int slot, int fd, PageNum pageNum, bool bScan) = 0;
+    // The page in slot was found in the buffer
+    virtual void Access(int slot, bool bScan) = 0;
+    // The page in slot left the buffer without being a victim
+    virtual void Remove(int slot) = 0;
+    // Choose an unpinned slot and forget it, or return INVALID_SLOT
+    virtual int Victim(const PF_BufPageDesc *bufTable) = 0;
+
+    // The statistics keys of the hits and misses under this policy
+    const char *HitKey() const;
+    const char *MissKey() const;
+};
+
+// Create the policy called name for numPages slots, or return NULL if
+// there is no such policy
+PF_Replacer *PF_NewReplacer(const char *name, int numPages);
+
+// The names of all policies, the first being the default, and the
+// statistics keys of their hits and misses
+extern const char *const PF_REPLACER_NAMES[];
+extern const char *const PF_REPLACER_HIT_KEYS[];
+extern const char *const PF_REPLACER_MISS_KEYS[];
+extern const int PF_REPLACER_COUNT;
+
+#endif
@@ -12,8 +12,10 @@
 //
 #ifdef PF_STATS
 
+#include <cstdio>
 #include <iostream>
 #include "pf.h"
+#include "pf_replacer.h"
 #include "statistics.h"
 
 using namespace std;
@@ -29,6 +31,7 @@ void PF_Statistics()
    int *piPNF = pStatisticsMgr->Get(PF_PAGENOTFOUND);
    int *piRP = pStatisticsMgr->Get(PF_READPAGE);
    int *piWP = pStatisticsMgr->Get(PF_WRITEPAGE);
+   int *piWC = pStatisticsMgr->Get(PF_WRITECALL);
    int *piFP = pStatisticsMgr->Get(PF_FLUSHPAGES);
 
    cout << "PF Layer Statistics\n";
@@ -46,6 +49,8 @@ void PF_Statistics()
    if (piRP) cout << *piRP; else cout << "None";
    cout << "\nNumber of write requests: ";
    if (piWP) cout << *piWP; else cout << "None";
+   cout << "\n  Number of write calls: ";
+   if (piWC) cout << *piWC; else cout << "None";
    cout << "\n-------------------\n";
    cout << "Number of flushes: ";
    if (piFP) cout << *piFP; else cout << "None";
@@ -57,7 +62,46 @@ void PF_Statistics()
    delete piPNF;
    delete piRP;
    delete piWP;
+   delete piWC;
    delete piFP;
 }
 
+void PF_PrefetchStatistics()
+{
+   // Must delete the memory returned from StatisticsMgr::Get
+   int *piPP = pStatisticsMgr->Get(PF_PREFETCHPAGE);
+   int *piPH = pStatisticsMgr->Get(PF_PREFETCHHIT);
+   int iPP = piPP ? *piPP : 0, iPH = piPH ? *piPH : 0;
+   delete piPP;
+   delete piPH;
+
+   cout << "Number of pages read ahead: " << iPP;
+   cout << "\n  Number requested later: " << iPH;
+   if (iPP)
+      printf(" (%.2f%%)", 100.0 * iPH / iPP);
+   cout << "\n-------------------\n";
+}
+
+void PF_ReplacerStatistics()
+{
+   cout << "Buffer hit ratio by replacement policy\n";
+   cout << "-------------------\n";
+
+   for (int i = 0; i < PF_REPLACER_COUNT; i++)
+   {
+      // Must delete the memory returned from StatisticsMgr::Get
+      int *piHit = pStatisticsMgr->Get(PF_REPLACER_HIT_KEYS[i]);
+      int *piMiss = pStatisticsMgr->Get(PF_REPLACER_MISS_KEYS[i]);
+      int iHit = piHit ? *piHit : 0, iMiss = piMiss ? *piMiss : 0;
+      delete piHit;
+      delete piMiss;
+
+      if (iHit + iMiss == 0)
+         continue;
+      printf("%-6s %10d hits %10d misses  %6.2f%%\n", PF_REPLACER_NAMES[i],
+             iHit, iMiss, 100.0 * iHit / (iHit + iMiss));
+   }
+   cout << "-------------------\n";
+}
+
 #endif
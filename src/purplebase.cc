@@ -21,31 +21,42 @@ using namespace std;
 // main
 //
 /* Steps:
-    1) Initialize purplebase components
+    1) Read the options, and initialize purplebase components
     2) Open the database
     3) Call the parser
     4) Close the database
 */
 int main(int argc, char *argv[])
 {
-    // Look for 2 arguments.  The first is always the name of the program
-    // that was executed, and the second should be the name of the
-    // database.
-    if (argc != 2)
+    // Look for the name of the database, after the option "-b pages",
+    // which sets the number of pages in the buffer.  Without it, the
+    // default of PF_Manager is used.
+    int bufferPages = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:")) != -1)
     {
-        cerr << "Usage: " << argv[0] << " dbname \n";
+        if (opt != 'b' || (bufferPages = atoi(optarg)) <= 0)
+        {
+            cerr << "Usage: " << argv[0] << " [-b bufferpages] dbname \n";
+            exit(1);
+        }
+    }
+    if (optind != argc - 1)
+    {
+        cerr << "Usage: " << argv[0] << " [-b bufferpages] dbname \n";
         exit(1);
     }
 
-    // The database name is the second argument
-    char *dbname = argv[1];
+    // The database name is the last argument
+    char *dbname = argv[optind];
 
     // Initialize RedBase components
-    PF_Manager pfm;
+    unique_ptr<PF_Manager> pPfm(bufferPages > 0 ? new PF_Manager(bufferPages) : new PF_Manager());
+    PF_Manager &pfm = *pPfm;
     RM_Manager rmm(pfm);
     IX_Manager ixm(pfm);
-    SM_Manager smm(ixm, rmm);
-    QL_Manager qlm(smm, ixm, rmm);
+    SM_Manager smm(ixm, rmm, pfm);
+    QL_Manager qlm(smm, ixm, rmm, pfm);
 
     // Open the database
     Try_SM(smm.OpenDb(dbname));
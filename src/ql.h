@@ -17,13 +17,15 @@
 #include "sm.h"
 #include "printer.h"
 
+class QL_ScanOp;
+
 //
 // QL_Manager: query language (DML)
 //
 class QL_Manager
 {
 public:
-    QL_Manager(SM_Manager &smm, IX_Manager &ixm, RM_Manager &rmm);
+    QL_Manager(SM_Manager &smm, IX_Manager &ixm, RM_Manager &rmm, PF_Manager &pfm);
     ~QL_Manager(); // Destructor
 
     RC Select(int nSelAttrs,                 // # attrs in select clause
@@ -52,12 +54,14 @@ public:
     SM_Manager &smManager; // SM_Manager object
     IX_Manager &ixManager; // IX_Manager object
     RM_Manager &rmManager; // RM_Manager object
+    PF_Manager &pfManager; // PF_Manager object, for temporary files
 
     // Utilities
     SM_AttrcatRecord checkAttr(RelAttr &attr, int nRelations, const char *const relations[]);
     DataAttrInfo checkAttr(RelAttr &attr, const char *relName, int attrCount, DataAttrInfo attributes[]);
-    void scanRelations(int id, int nRelations, const char *const relations[], char *records[], int nConditions, Condition conditions[], int indexRelOfCondLHS[], int offsetOfCondLHS[], int indexRelOfCondRHS[], int offsetOfCondRHS[], int nSelAttrs, DataAttrInfo printAttrs[], int indexRelOfPrintAttr[], int offsetOfPrintAttr[], Printer &p, char *buf);
-    int indexOfRel(const char *relName, int nRelations, const char *const relations[]);
+    QL_ScanOp *scanOp(const char *relName, int attrCount, const DataAttrInfo attributes[], int nConditions, const Condition conditions[], bool pushed[]);
+    void joinOrder(int nRelations, const char *const relations[], QL_ScanOp *const scans[], const double cardinalities[],
+                   int nConditions, const Condition conditions[], int order[]);
     void printAttr(const char *relName, const char *attrName);
 };
 
@@ -83,7 +87,8 @@ void QL_PrintError(RC rc);
 #define QL_INSERT_TOO_LONG_STRING (START_QL_WARN + 13)
 #define QL_UPDATE_TOO_LONG_STRING (START_QL_WARN + 14)
 #define QL_INSERT_NOT_EXIST (START_QL_WARN + 15)
-#define QL_LASTWARN QL_INSERT_NOT_EXIST
+#define QL_EOF (START_QL_WARN + 16)
+#define QL_LASTWARN QL_EOF
 
 // Errors
 #define QL_RELS_SCAN_FAIL (START_QL_ERR - 0)
@@ -29,6 +29,7 @@ static char *QL_WarnMsg[] = {
     (char *)"QL_INSERT_TOO_LONG_STRING",                                          // QL_INSERT_TOO_LONG_STRING (START_QL_WARN + 13)
     (char *)"QL_UPDATE_TOO_LONG_STRING",                                          // QL_UPDATE_TOO_LONG_STRING (START_QL_WARN + 14)
     (char *)"Something's wrong when inserting, perhaps the table doesn't exist?", // QL_INSERT_NOT_EXIST (START_QL_WARN + 15)
+    (char *)"QL_EOF",                                                             // QL_EOF (START_QL_WARN + 16)
 };
 
 static char *QL_ErrorMsg[] = {
@@ -8,6 +8,9 @@
 #define QL_INTERNAL_H
 
 #include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
 #include <stdlib.h>
 #include <cstdio>
 #include <memory>
@@ -19,7 +22,7 @@
 #include "sm.h"
 #include "ql.h"
 
-bool QL_PrintRC(RC rc)
+inline bool QL_PrintRC(RC rc)
 {
     if (rc >= START_PF_WARN && rc <= END_PF_WARN || rc >= START_PF_ERR && rc <= END_PF_ERR)
     {
@@ -44,7 +47,7 @@ bool QL_PrintRC(RC rc)
     return true;
 }
 
-void QL_Try(RC rc, RC ql_rc)
+inline void QL_Try(RC rc, RC ql_rc)
 {
     if (rc)
     {
@@ -165,4 +168,456 @@ inline bool compare(AttrType type, CompOp op, const void *x, const void *y)
     }
 }
 
+//
+// QL_Op: a node of the physical operator tree (Volcano iterator model)
+//
+// 1) Every operator produces tuples of [tupleLength] bytes,
+//    whose layout is described by [attrs].
+//    The offsets in [attrs] are relative to the tuple of this operator.
+// 2) Open() prepares the iteration, GetNext() copies the next tuple into [tuple]
+//    and returns QL_EOF after the last one, Close() releases the resources.
+//    An operator could be opened again after it's closed.
+// 3) As elsewhere in QL, failures are thrown as RC.
+// 4) An operator owns its children and deletes them.
+class QL_Op
+{
+public:
+    virtual ~QL_Op() {}
+
+    virtual void Open() = 0;
+    virtual RC GetNext(char *tuple) = 0;
+    virtual void Close() = 0;
+
+    // Print the subtree rooted at this operator for the query plan
+    virtual void Print(std::ostream &c, int depth) const = 0;
+
+    int tupleLength;
+    std::vector<DataAttrInfo> attrs;
+
+    // The estimated number of tuples produced
+    double cardinality;
+
+    // Return the position of [attr] in [attrs], -1 if it's not produced here
+    int IndexOfAttr(const RelAttr &attr) const;
+};
+
+//
+// QL_ScanOp: the common part of the operators reading a relation
+//
+// Delete and Update use [rmFH], [rec] and [rid] to modify
+// the record which the last GetNext() returns, and set [forUpdate]
+// before Open() so that the file is opened for writing.
+class QL_ScanOp : public QL_Op
+{
+public:
+    QL_ScanOp(RM_Manager &rmm, const char *relName, int attrCount, const DataAttrInfo attributes[]);
+    virtual ~QL_ScanOp();
+
+    RM_FileHandle rmFH; // The file of the relation, valid while open
+    RM_Record rec;      // The last record returned
+    RID rid;            // RID of the last record returned
+    PageNum pageNum;    // The number of pages of the relation
+    bool forUpdate;     // Whether records are changed through rmFH
+
+protected:
+    RM_Manager &rmManager;
+    std::string relName;
+    bool open;
+
+    void OpenFile();
+    void CloseFile();
+};
+
+//
+// QL_FileScanOp: read the records of a relation by RM_FileScan
+//
+// A condition [attr op value] on the relation could be pushed down,
+// which is checked by RM_FileScan itself.
+class QL_FileScanOp : public QL_ScanOp
+{
+public:
+    QL_FileScanOp(SM_Manager &smm, RM_Manager &rmm, const char *relName, int attrCount, const DataAttrInfo attributes[],
+                  const Condition *cond = nullptr, int attrIndex = -1);
+    ~QL_FileScanOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    bool hasCond;
+    Condition cond;
+    int attrIndex; // The attribute of [cond] in [attrs]
+    RM_FileScan rmFS;
+};
+
+//
+// QL_IndexScanOp: read the records satisfying [attr op value] by IX_IndexScan
+//
+class QL_IndexScanOp : public QL_ScanOp
+{
+public:
+    QL_IndexScanOp(SM_Manager &smm, RM_Manager &rmm, IX_Manager &ixm, const char *relName, int attrCount, const DataAttrInfo attributes[],
+                   const Condition &cond, int attrIndex);
+    ~QL_IndexScanOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    IX_Manager &ixManager;
+    Condition cond;
+    int attrIndex;           // The indexed attribute in [attrs]
+    std::vector<char> value; // The key, zero-padded to the attribute length
+    IX_IndexHandle ixIH;     // Open while streaming
+    IX_IndexScan ixIS;
+    std::vector<RID> rids;   // The RIDs collected for update
+    size_t nextRID;
+};
+
+//
+// QL_FilterOp: pass the tuples of the child satisfying all the conditions
+//
+class QL_FilterOp : public QL_Op
+{
+public:
+    QL_FilterOp(SM_Manager &smm, QL_Op *child, int nConditions, const Condition conditions[]);
+    ~QL_FilterOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    QL_Op *child;
+    std::vector<Condition> conditions;
+    std::vector<int> offsetsLHS;
+    std::vector<int> offsetsRHS;
+    std::vector<int> lengthsLHS;
+    std::vector<int> lengthsRHS;
+};
+
+//
+// QL_ProjectOp: keep the selected attributes of the child, in order
+//
+// The output layout is the one Printer expects,
+// i.e. one more byte after every string.
+class QL_ProjectOp : public QL_Op
+{
+public:
+    QL_ProjectOp(QL_Op *child, int nSelAttrs, const RelAttr selAttrs[]);
+    ~QL_ProjectOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    QL_Op *child;
+    std::vector<int> offsetsInChild;
+    std::vector<char> childTuple;
+};
+
+//
+// QL_NestedLoopJoinOp: the cross product of two children
+//
+// For every left tuple the right child is scanned again,
+// the output tuple is the left tuple followed by the right one.
+class QL_NestedLoopJoinOp : public QL_Op
+{
+public:
+    QL_NestedLoopJoinOp(QL_Op *left, QL_Op *right);
+    ~QL_NestedLoopJoinOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    QL_Op *left;
+    QL_Op *right;
+    std::vector<char> leftTuple;
+    bool leftValid; // Whether [leftTuple] holds the current left tuple
+};
+
+// The memory for the hash table of a hash join, in bytes
+#define QL_JOIN_MEMORY (256 * PF_PAGE_SIZE)
+// The number of partitions when a hash join spills to disk
+#define QL_HASH_PARTITIONS 16
+
+//
+// QL_HashJoinOp: the equi-join of two children on [cond]
+//
+// 1) The child with fewer estimated tuples is the build side,
+//    which is read into an in-memory hash table, and the other one probes it.
+// 2) If the build side outgrows QL_JOIN_MEMORY, both sides are partitioned
+//    by the hash of the key into temporary RM files (grace hash join),
+//    then the partitions are joined pairwise.
+// 3) The output tuple is the left tuple followed by the right one,
+//    the same as QL_NestedLoopJoinOp.
+class QL_HashJoinOp : public QL_Op
+{
+public:
+    QL_HashJoinOp(SM_Manager &smm, RM_Manager &rmm, QL_Op *left, QL_Op *right, const Condition &cond);
+    ~QL_HashJoinOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    RM_Manager &rmManager;
+    QL_Op *left;
+    QL_Op *right;
+    Condition cond;
+
+    bool buildLeft; // Whether the left child is the build side
+    QL_Op *build;
+    QL_Op *probe;
+    int buildKey;    // Offset of the key in the build tuple
+    int probeKey;    // Offset of the key in the probe tuple
+    int buildLength; // Length of the key in the build tuple
+    int probeLength; // Length of the key in the probe tuple
+    AttrType keyType;
+
+    // The hash table: the build tuples stored one by one in [table],
+    // and [index] maps a key to the offsets of its tuples in [table].
+    std::vector<char> table;
+    std::unordered_multimap<std::string, int> index;
+
+    // The state of probing
+    std::vector<char> probeTuple;
+    bool probeValid;
+    std::unordered_multimap<std::string, int>::const_iterator matchCur, matchEnd;
+
+    // The partitions on disk
+    bool partitioned;
+    std::vector<std::string> buildFiles;
+    std::vector<std::string> probeFiles;
+    int curPartition;
+    bool partOpen; // Whether the probe partition is being scanned
+    RM_FileHandle partFH;
+    RM_FileScan partFS;
+
+    std::string Key(const char *tuple, int offset, int length) const;
+    void InsertTable(const char *tuple);
+    void CreatePartitions(std::vector<std::string> &files, std::vector<RM_FileHandle> &fileHandles, int recordSize);
+    void InsertPartition(std::vector<RM_FileHandle> &fileHandles, const char *tuple, int offset, int length);
+    void ClosePartitions(std::vector<RM_FileHandle> &fileHandles);
+    void DestroyPartitions();
+    void LoadPartition(int p);
+    bool NextProbe();
+};
+
+// The pages read by probing an index for one key:
+// a leaf and a data page, supposing the upper levels are buffered.
+#define QL_INDEX_PROBE_COST 2
+
+//
+// QL_IndexNestedLoopJoinOp: the equi-join of a child and a relation on [cond],
+// where the attribute of the relation is indexed
+//
+// For every left tuple, the index of the relation is probed with its key,
+// and the output tuple is the left tuple followed by the record.
+class QL_IndexNestedLoopJoinOp : public QL_Op
+{
+public:
+    QL_IndexNestedLoopJoinOp(SM_Manager &smm, RM_Manager &rmm, IX_Manager &ixm, QL_Op *left,
+                             const char *relName, int attrCount, const DataAttrInfo attributes[],
+                             const Condition &cond, int attrIndex);
+    ~QL_IndexNestedLoopJoinOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    RM_Manager &rmManager;
+    IX_Manager &ixManager;
+    QL_Op *left;
+    std::string relName;
+    Condition cond;
+    std::vector<DataAttrInfo> innerAttrs;
+    int innerLength; // The length of a record of the relation
+    int innerKey;    // The indexed attribute in [innerAttrs]
+    int leftKey;     // Offset of the key in the left tuple
+    int leftLength;  // Length of the key in the left tuple
+
+    bool open;
+    RM_FileHandle rmFH;
+    IX_IndexHandle ixIH;
+    IX_IndexScan ixIS;
+    std::vector<char> leftTuple;
+    std::vector<char> value; // The key, zero-padded to the attribute length
+    bool leftValid;          // Whether [ixIS] is probing for [leftTuple]
+};
+
+// The memory for sorting a run of an external sort, in bytes
+#define QL_SORT_MEMORY (256 * PF_PAGE_SIZE)
+// The most runs merged at once, each of which pins a page in the buffer pool
+#define QL_SORT_FANIN 16
+
+//
+// QL_Sorter: the external merge sort of tuples on some keys
+//
+// 1) Tuples are inserted into a buffer of QL_SORT_MEMORY bytes,
+//    and every time it's full it's sorted and written to a temporary PF file as a run.
+// 2) Sort() merges the runs QL_SORT_FANIN at a time, until at most QL_SORT_FANIN are left,
+//    which are merged on the fly by GetNext().
+//    Tuples that fit in the buffer never touch the disk.
+// 3) A run is a stream of tuples packed across its pages,
+//    so a tuple could be wider than a page.
+class QL_Sorter
+{
+public:
+    QL_Sorter(PF_Manager &pfm, int tupleLength, const std::vector<DataAttrInfo> &keys);
+    ~QL_Sorter();
+
+    void Insert(const char *tuple);
+    void Sort();
+    RC GetNext(char *tuple);
+    void Clear(); // Drop all the tuples and runs
+
+    // Compare two tuples on the keys, in the order of the keys
+    int Compare(const char *x, const char *y) const;
+
+private:
+    // A sorted run on disk
+    struct Run
+    {
+        std::string fileName;
+        int tupleNum;
+    };
+
+    // Read the tuples of a run one by one, pinning a page at a time
+    struct RunReader
+    {
+        PF_FileHandle fileHandle;
+        PageNum pageNum; // The pinned page, or -1
+        char *pageData;
+        int pos;      // Position in the pinned page
+        int tupleRem; // Tuples not read yet
+        bool open;
+        std::vector<char> tuple; // The current tuple
+
+        RunReader() : open(false) {}
+    };
+
+    PF_Manager &pfManager;
+    int tupleLength;
+    std::vector<DataAttrInfo> keys;
+
+    std::vector<char> buffer;
+    std::vector<const char *> sorted; // Tuples in [buffer] in order
+    int sortedPos;                    // The next tuple of [sorted] to return
+
+    std::vector<Run> runs;
+    std::vector<RunReader> readers; // Readers of the runs being merged
+    std::vector<int> heap;          // Min-heap of the readers by their tuples
+
+    // The run being written
+    bool writing;
+    PF_FileHandle writeFH;
+    PF_PageHandle writePage;
+    char *writeData;
+    int writePos; // Position in [writePage]
+
+    void WriteRun(); // Sort the buffer and write it as a run
+    void BeginRun();
+    void WriteTuple(const char *tuple);
+    void EndRun(int tupleNum);
+    void MergeRuns(int count); // Merge the first [count] runs into a new one
+    void OpenReaders(int count);
+    bool ReadTuple(RunReader &reader);
+    void CloseReaders();
+    void PushHeap(int reader);
+    int PopHeap();
+};
+
+//
+// QL_SortOp: sort the tuples of a child on some of its attributes
+//
+class QL_SortOp : public QL_Op
+{
+public:
+    QL_SortOp(PF_Manager &pfm, QL_Op *child, const std::vector<int> &keyAttrs);
+    ~QL_SortOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    QL_Op *child;
+    std::vector<int> keyAttrs; // Indexes of the keys in [attrs]
+    QL_Sorter sorter;
+};
+
+//
+// QL_SortMergeJoinOp: the equi-join of two children on [cond] by sorting both
+//
+// 1) Both children are sorted on their keys by QL_SortOp, which spills to disk if needed.
+// 2) For every group of right tuples with the same key, which is kept in memory,
+//    the left tuples of the key are joined with the whole group.
+// 3) The output tuple is the left tuple followed by the right one.
+class QL_SortMergeJoinOp : public QL_Op
+{
+public:
+    QL_SortMergeJoinOp(SM_Manager &smm, PF_Manager &pfm, QL_Op *left, QL_Op *right, const Condition &cond);
+    ~QL_SortMergeJoinOp();
+
+    void Open();
+    RC GetNext(char *tuple);
+    void Close();
+    void Print(std::ostream &c, int depth) const;
+
+private:
+    QL_Op *left;
+    QL_Op *right;
+    Condition cond;
+    DataAttrInfo leftKey;
+    DataAttrInfo rightKey;
+
+    std::vector<char> leftTuple;
+    bool leftValid;
+    std::vector<char> rightTuple; // The first right tuple after the group
+    bool rightValid;
+    std::vector<char> group; // Right tuples with the same key
+    int groupNum;
+    int groupPos; // The next tuple of the group to join with [leftTuple]
+};
+
+// The most relations whose join order is found by dynamic programming,
+// more relations are ordered greedily
+#define QL_DP_RELATIONS 12
+
+// Print the condition in one line, e.g. "r.a = 3"
+void QL_PrintCondition(std::ostream &c, const Condition &cond);
+
+// Compare two values of a type, where a string or date could be shorter than its length.
+// Return a negative number, 0, or a positive number as x < y, x = y, or x > y.
+int QL_Compare(AttrType type, const char *x, int xLength, const char *y, int yLength);
+
+// Copy a value of [length] bytes to [out] as a value of [attr].
+// Records and index keys are compared on the whole attribute,
+// so a string is cut to the attribute length or zero-padded up to it.
+void QL_CopyValue(const DataAttrInfo &attr, const char *data, int length, char *out);
+
+// The estimated fraction of tuples satisfying the condition,
+// by the statistics collected by analyze if any
+double QL_Selectivity(SM_Manager &smm, const Condition &cond);
+
+// A new name for a temporary file in the database,
+// which can't be the name of any relation or index.
+std::string QL_TempFileName();
+
 #endif
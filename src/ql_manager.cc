@@ -24,7 +24,7 @@ using namespace std;
 
 // Method: QL_Manager(SM_Manager &smm, IX_Manager &ixm, RM_Manager &rmm)
 // Constructor for the QL Manager
-QL_Manager::QL_Manager(SM_Manager &smm, IX_Manager &ixm, RM_Manager &rmm) : smManager(smm), ixManager(ixm), rmManager(rmm) {}
+QL_Manager::QL_Manager(SM_Manager &smm, IX_Manager &ixm, RM_Manager &rmm, PF_Manager &pfm) : smManager(smm), ixManager(ixm), rmManager(rmm), pfManager(pfm) {}
 
 // Method: ~QL_Manager()
 // Destructor for the QL Manager
@@ -59,13 +59,12 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
         }
 
         // Check if the relations exist
-        DataAttrInfo *attributes[nRelations];
-        SM_RelcatRecord rcRecord[nRelations];
+        vector<vector<DataAttrInfo>> attributes(nRelations);
         for (int i = 0; i < nRelations; ++i)
         {
-            rcRecord[i] = smManager.GetRelInfo(relations[i]);
-            attributes[i] = new DataAttrInfo[rcRecord[i].attrCount];
-            smManager.GetAttrInfo(relations[i], rcRecord[i].attrCount, (char *)attributes[i]);
+            SM_RelcatRecord rcRecord = smManager.GetRelInfo(relations[i]);
+            attributes[i].resize(rcRecord.attrCount);
+            smManager.GetAttrInfo(relations[i], rcRecord.attrCount, (char *)attributes[i].data());
         }
 
         // Check every relation is distinguishable
@@ -75,58 +74,21 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
                     throw QL_SAME_REL_APPEAR_AGAIN;
 
         // Validate the select attributes
-        RelAttr *changedSelAttrs;
+        vector<RelAttr> changedSelAttrs;
         if (nSelAttrs == 1 && strcmp(selAttrs[0].attrName, "*") == 0)
         {
             // In case of *, select all attributes
-            nSelAttrs = 0;
-            for (int i = 0; i < nRelations; i++)
-            {
-                nSelAttrs += rcRecord[i].attrCount;
-            }
-        }
-
-        // The informations of attributes
-        int indexRelOfPrintAttr[nSelAttrs];
-        int offsetOfPrintAttr[nSelAttrs]; // offset in the original record
-        DataAttrInfo printAttrs[nSelAttrs];
-
-        if (nSelAttrs >= 1 && strcmp(selAttrs[0].attrName, "*") == 0)
-        {
-            changedSelAttrs = new RelAttr[nSelAttrs];
-            for (int i = 0, k = 0; i < nRelations; ++i)
-            {
-                for (int j = 0; j < rcRecord[i].attrCount; ++j, ++k)
-                {
-                    changedSelAttrs[k] = RelAttr{
+            for (int i = 0; i < nRelations; ++i)
+                for (DataAttrInfo &attr : attributes[i])
+                    changedSelAttrs.push_back(RelAttr{
                         .relName = (char *)relations[i],
-                        .attrName = attributes[i][j].attrName};
-
-                    indexRelOfPrintAttr[k] = i;
-                    offsetOfPrintAttr[k] = attributes[i][j].offset;
-
-                    printAttrs[k] = attributes[i][j];
-                    printAttrs[k].offset = k == 0 ? 0 : printAttrs[k - 1].offset + printAttrs[k - 1].attrLength + (printAttrs[k - 1].attrType == STRING);
-                }
-            }
+                        .attrName = attr.attrName});
         }
         else
         {
-            changedSelAttrs = (RelAttr *)selAttrs;
-            for (int i = 0; i < nSelAttrs; ++i)
-            {
-                SM_AttrcatRecord acRecord = checkAttr(changedSelAttrs[i], nRelations, relations);
-
-                indexRelOfPrintAttr[i] = indexOfRel(acRecord.relName, nRelations, relations);
-                offsetOfPrintAttr[i] = acRecord.offset;
-
-                strcpy(printAttrs[i].relName, acRecord.relName);
-                strcpy(printAttrs[i].attrName, acRecord.attrName);
-                printAttrs[i].attrType = acRecord.attrType;
-                printAttrs[i].attrLength = acRecord.attrLength;
-                printAttrs[i].indexNo = acRecord.indexNo;
-                printAttrs[i].offset = i == 0 ? 0 : printAttrs[i - 1].offset + printAttrs[i - 1].attrLength + (printAttrs[i - 1].attrType == STRING);
-            }
+            changedSelAttrs.assign(selAttrs, selAttrs + nSelAttrs);
+            for (RelAttr &attr : changedSelAttrs)
+                checkAttr(attr, nRelations, relations);
         }
 
         if (smManager.bDebug)
@@ -134,11 +96,6 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
             printf("nConditions = %d\n", nConditions);
         }
 
-        int indexRelOfCondLHS[nConditions];
-        int indexRelOfCondRHS[nConditions];
-        int offsetOfCondLHS[nConditions];
-        int offsetOfCondRHS[nConditions];
-
         // Validate the conditions
         Condition changedConditions[nConditions];
         for (int i = 0; i < nConditions; ++i)
@@ -147,8 +104,6 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
 
             // Check whether LHS is a valid attribute
             SM_AttrcatRecord lrec = checkAttr(changedConditions[i].lhsAttr, nRelations, relations);
-            indexRelOfCondLHS[i] = indexOfRel(lrec.relName, nRelations, relations);
-            offsetOfCondLHS[i] = lrec.offset;
             AttrType lhsType = lrec.attrType;
 
             // If RHS is a attribute, check it
@@ -156,8 +111,6 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
             if (changedConditions[i].bRhsIsAttr)
             {
                 SM_AttrcatRecord rrec = checkAttr(changedConditions[i].rhsAttr, nRelations, relations);
-                indexRelOfCondRHS[i] = indexOfRel(rrec.relName, nRelations, relations);
-                offsetOfCondRHS[i] = rrec.offset;
                 rhsType = rrec.attrType;
             }
             else
@@ -173,15 +126,138 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
             changedConditions[i].rhsValue.type = lhsType;
         }
 
-        if (smManager.bDebug)
+        // Form the physical operator tree:
+        // 1) Every relation is scanned, perhaps with some condition on it.
+        // 2) The order of joins is chosen by the estimated cost, see joinOrder().
+        // 3) A relation joins by an equi-join condition if any, either probing its index
+        //    for every outer tuple or by hash, whichever reads fewer pages.
+        //    If both sides are too large to hash in memory, they're sorted and merged.
+        // 4) Every condition is checked as early as possible, i.e.
+        //    a condition on one relation is pushed down to its scan,
+        //    a condition between relations is checked right after they're joined.
+        auto relOf = [&](const RelAttr &attr) -> int {
+            for (int i = 0; i < nRelations; ++i)
+                if (strcmp(attr.relName, relations[i]) == 0)
+                    return i;
+            return -1;
+        };
+        vector<unique_ptr<QL_ScanOp>> scans(nRelations);
+        QL_ScanOp *scanPtrs[nRelations];
+        bool pushed[nRelations][nConditions];
+        double cardinalities[nRelations];
+        for (int i = 0; i < nRelations; ++i)
         {
-            // printf("Before building printer, indexRelOfPrintAttr[0] = %d\n", indexRelOfPrintAttr[0]);
+            scans[i].reset(scanOp(relations[i], attributes[i].size(), attributes[i].data(), nConditions, changedConditions, pushed[i]));
+            scanPtrs[i] = scans[i].get();
+            cardinalities[i] = scans[i]->cardinality;
+            for (int j = 0; j < nConditions; ++j)
+                if (!pushed[i][j] && relOf(changedConditions[j].lhsAttr) == i && (!changedConditions[j].bRhsIsAttr || relOf(changedConditions[j].rhsAttr) == i))
+                    cardinalities[i] *= QL_Selectivity(smManager, changedConditions[j]);
         }
+        int order[nRelations];
+        int position[nRelations]; // The position of a relation in [order]
+        joinOrder(nRelations, relations, scanPtrs, cardinalities, nConditions, changedConditions, order);
+        for (int k = 0; k < nRelations; ++k)
+            position[order[k]] = k;
+        auto posOf = [&](const RelAttr &attr) { return position[relOf(attr)]; };
+
+        bool placed[nConditions];
+        for (int i = 0; i < nConditions; ++i)
+            placed[i] = false;
+        unique_ptr<QL_Op> root;
+        for (int k = 0; k < nRelations; ++k)
+        {
+            int i = order[k];
+
+            // Find an equi-join condition between the relation and the joined ones
+            int joinCond = -1;
+            const RelAttr *innerKey = nullptr;
+            for (int j = 0; j < nConditions && root && joinCond == -1; ++j)
+            {
+                if (!placed[j] && changedConditions[j].bRhsIsAttr && changedConditions[j].op == EQ_OP)
+                {
+                    int lhsPos = posOf(changedConditions[j].lhsAttr);
+                    int rhsPos = posOf(changedConditions[j].rhsAttr);
+                    if ((lhsPos == k && rhsPos < k) || (rhsPos == k && lhsPos < k))
+                    {
+                        joinCond = j;
+                        innerKey = lhsPos == k ? &changedConditions[j].lhsAttr : &changedConditions[j].rhsAttr;
+                    }
+                }
+            }
+
+            QL_ScanOp *scan = scans[i].get();
+            unique_ptr<QL_Op> input(scans[i].release());
+
+            // Would it be cheaper to probe the index on the join attribute?
+            int innerAttr = joinCond == -1 ? -1 : scan->IndexOfAttr(*innerKey);
+            if (innerAttr != -1 && scan->attrs[innerAttr].indexNo != -1 && root->cardinality * QL_INDEX_PROBE_COST < scan->pageNum)
+            {
+                // All the conditions on the relation are checked after the join
+                input.reset();
+                root.reset(new QL_IndexNestedLoopJoinOp(smManager, rmManager, ixManager, root.release(), relations[i], attributes[i].size(), attributes[i].data(),
+                                                        changedConditions[joinCond], innerAttr));
+                placed[joinCond] = true;
+            }
+            else
+            {
+                // Check the other conditions on the relation right after the scan
+                vector<Condition> local;
+                for (int j = 0; j < nConditions; ++j)
+                {
+                    placed[j] = placed[j] || pushed[i][j];
+                    if (!placed[j] && relOf(changedConditions[j].lhsAttr) == i && (!changedConditions[j].bRhsIsAttr || relOf(changedConditions[j].rhsAttr) == i))
+                    {
+                        local.push_back(changedConditions[j]);
+                        placed[j] = true;
+                    }
+                }
+                if (!local.empty())
+                {
+                    input.reset(new QL_FilterOp(smManager, input.release(), local.size(), local.data()));
+                }
+
+                if (!root)
+                {
+                    root = move(input);
+                }
+                else if (joinCond != -1)
+                {
+                    // If both sides outgrow the memory of a hash table, sort them instead
+                    if (min(root->cardinality * root->tupleLength, input->cardinality * input->tupleLength) > QL_JOIN_MEMORY)
+                        root.reset(new QL_SortMergeJoinOp(smManager, pfManager, root.release(), input.release(), changedConditions[joinCond]));
+                    else
+                        root.reset(new QL_HashJoinOp(smManager, rmManager, root.release(), input.release(), changedConditions[joinCond]));
+                    placed[joinCond] = true;
+                }
+                else
+                {
+                    root.reset(new QL_NestedLoopJoinOp(root.release(), input.release()));
+                }
+            }
+
+            // Check the other conditions between the joined relations
+            vector<Condition> join;
+            for (int j = 0; j < nConditions; ++j)
+            {
+                if (!placed[j] && posOf(changedConditions[j].lhsAttr) <= k && (!changedConditions[j].bRhsIsAttr || posOf(changedConditions[j].rhsAttr) <= k))
+                {
+                    join.push_back(changedConditions[j]);
+                    placed[j] = true;
+                }
+            }
+            if (!join.empty())
+            {
+                root.reset(new QL_FilterOp(smManager, root.release(), join.size(), join.data()));
+            }
+        }
+        root.reset(new QL_ProjectOp(root.release(), changedSelAttrs.size(), changedSelAttrs.data()));
+
         if (bQueryPlans)
         {
             cout << "\x1B[31mSelect\033[0m\n";
-            cout << "  nSelAttrs = " << nSelAttrs << "\n";
-            for (int i = 0; i < nSelAttrs; i++)
+            cout << "  nSelAttrs = " << changedSelAttrs.size() << "\n";
+            for (int i = 0; i < (int)changedSelAttrs.size(); i++)
                 cout << "    selAttrs[" << i << "]:" << changedSelAttrs[i] << "\n";
             cout << "  nRelations = " << nRelations << "\n";
             for (int i = 0; i < nRelations; i++)
@@ -189,14 +265,21 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
             cout << "  nCondtions = " << nConditions << "\n";
             for (int i = 0; i < nConditions; i++)
                 cout << "    conditions[" << i << "]:" << changedConditions[i] << "\n";
+            cout << "  physical plan\n";
+            root->Print(cout, 2);
         }
 
-        Printer p(printAttrs, nSelAttrs);
+        // Get the tuples from the root node
+        Printer p(root->attrs.data(), root->attrs.size());
         p.PrintHeader(cout);
 
-        char buf[printAttrs[nSelAttrs - 1].offset + printAttrs[nSelAttrs - 1].attrLength];
-        char *records[nRelations];
-        scanRelations(0, nRelations, relations, records, nConditions, changedConditions, indexRelOfCondLHS, offsetOfCondLHS, indexRelOfCondRHS, offsetOfCondRHS, nSelAttrs, printAttrs, indexRelOfPrintAttr, offsetOfPrintAttr, p, buf);
+        vector<char> tuple(root->tupleLength);
+        root->Open();
+        while (root->GetNext(tuple.data()) != QL_EOF)
+        {
+            p.Print(cout, tuple.data());
+        }
+        root->Close();
 
         p.PrintFooter(cout);
     }
@@ -231,7 +314,7 @@ SM_AttrcatRecord QL_Manager::checkAttr(RelAttr &attr, int nRelations, const char
                 {
                     ans = acRecord;
                     ++cnt;
-                    attr.attrName = (char *)relations[j];
+                    attr.relName = (char *)relations[j];
                 }
                 else if (cnt == 1)
                 {
@@ -268,111 +351,217 @@ SM_AttrcatRecord QL_Manager::checkAttr(RelAttr &attr, int nRelations, const char
     return ans;
 }
 
-void QL_Manager::scanRelations(int id, int nRelations, const char *const relations[], char *records[], int nConditions, Condition conditions[], int indexRelOfCondLHS[], int offsetOfCondLHS[], int indexRelOfCondRHS[], int offsetOfCondRHS[], int nSelAttrs, DataAttrInfo printAttrs[], int indexRelOfPrintAttr[], int offsetOfPrintAttr[], Printer &p, char *buf)
+// Method: scanOp(const char *relName, int attrCount, const DataAttrInfo attributes[],
+//                int nConditions, const Condition conditions[], bool pushed[])
+// Choose the access path of a relation
+/* Steps:
+    1) Among the conditions [attr op value] on an indexed attribute of the relation,
+       where op is sargable, i.e. not NE_OP,
+       find the one with the least estimated matching records
+    2) If found, read the relation through the index,
+       unless the statistics of the attribute tell that it matches more records than the pages of the file,
+       since every matching record may cost a page read
+    3) Otherwise, scan the whole file,
+       and push a condition [attr op value] on the relation into the file scan
+    4) Mark the condition consumed by the scan in [pushed],
+       the others are left to the caller
+*/
+QL_ScanOp *QL_Manager::scanOp(const char *relName, int attrCount, const DataAttrInfo attributes[],
+                              int nConditions, const Condition conditions[], bool pushed[])
 {
-    if (smManager.bDebug)
+    int bestCond = -1;
+    int bestAttr = -1;
+    double bestSelectivity = 0;
+    int fileCond = -1;
+    int fileAttr = -1;
+    for (int i = 0; i < nConditions; ++i)
     {
-        // printf("Entering scanRelations, indexRelOfPrintAttr[0] = %d\n", indexRelOfPrintAttr[0]);
-        printf("scanRelations(%d)\n", id);
+        pushed[i] = false;
+        if (conditions[i].bRhsIsAttr || conditions[i].op == NO_OP || strcmp(conditions[i].lhsAttr.relName, relName) != 0)
+            continue;
+        for (int j = 0; j < attrCount; ++j)
+        {
+            if (strcmp(attributes[j].attrName, conditions[i].lhsAttr.attrName) != 0)
+                continue;
+            if (fileCond == -1)
+            {
+                fileCond = i;
+                fileAttr = j;
+            }
+            if (attributes[j].indexNo != -1 && conditions[i].op != NE_OP)
+            {
+                double selectivity = QL_Selectivity(smManager, conditions[i]);
+                if (bestCond == -1 || selectivity < bestSelectivity)
+                {
+                    bestCond = i;
+                    bestAttr = j;
+                    bestSelectivity = selectivity;
+                }
+            }
+        }
     }
 
-    // Open the relation RM file
-    RM_FileHandle rmFH;
-    QL_Try(rmManager.OpenFile(relations[id], rmFH), QL_RELS_SCAN_FAIL);
+    if (bestCond != -1)
+    {
+        unique_ptr<QL_IndexScanOp> indexScan(new QL_IndexScanOp(smManager, rmManager, ixManager, relName, attrCount, attributes, conditions[bestCond], bestAttr));
+        SM_AttrstatRecord stat;
+        if (!smManager.GetAttrStat(relName, attributes[bestAttr].attrName, stat) || indexScan->cardinality <= indexScan->pageNum)
+        {
+            pushed[bestCond] = true;
+            return indexScan.release();
+        }
+        fileCond = bestCond;
+        fileAttr = bestAttr;
+    }
+    if (fileCond != -1)
+    {
+        pushed[fileCond] = true;
+        return new QL_FileScanOp(smManager, rmManager, relName, attrCount, attributes, &conditions[fileCond], fileAttr);
+    }
+    else
+    {
+        return new QL_FileScanOp(smManager, rmManager, relName, attrCount, attributes);
+    }
+}
 
-    // Start the relcat file scan
-    RM_FileScan rmFS;
-    QL_Try(rmFS.OpenScan(rmFH, INT, 4, 0, NO_OP, NULL), QL_RELS_SCAN_FAIL);
+// The estimated pages read to join [inner] to [outerCard] tuples of [outerLength] bytes,
+// choosing the join method as Select does.
+// [innerAttr] is the attribute of [inner] in the equi-join condition, or -1 if there's none.
+static double JoinCost(double outerCard, int outerLength, const QL_ScanOp *inner, double innerCard, bool equiJoin, int innerAttr)
+{
+    // The inner relation is scanned again for every outer tuple
+    if (!equiJoin)
+        return outerCard * inner->pageNum;
+
+    if (innerAttr != -1 && inner->attrs[innerAttr].indexNo != -1 && outerCard * QL_INDEX_PROBE_COST < inner->pageNum)
+        return outerCard * QL_INDEX_PROBE_COST;
+
+    // Both sides are written to disk and read back if they don't fit in memory
+    double cost = inner->pageNum;
+    double outerBytes = outerCard * outerLength;
+    double innerBytes = innerCard * inner->tupleLength;
+    if (min(outerBytes, innerBytes) > QL_JOIN_MEMORY)
+        cost += 2 * (outerBytes + innerBytes) / PF_PAGE_SIZE;
+    return cost;
+}
 
-    RM_Record rec;
-    char *record;
-    for (int rc = OK_RC; rc != RM_EOF;)
+// Method: joinOrder(int nRelations, const char *const relations[], QL_ScanOp *const scans[],
+//                   const double cardinalities[], int nConditions, const Condition conditions[], int order[])
+// Choose the order in which the relations are joined, from left to right
+/* Steps:
+    1) The cost of a plan is the estimated number of pages read,
+       where [scans] gives the pages of the relations,
+       and [cardinalities] their tuples after the conditions on themselves.
+       A join multiplies the cardinalities by the selectivities of the conditions between them.
+    2) For at most QL_DP_RELATIONS relations, find the cheapest left-deep order
+       by dynamic programming over the subsets of relations (Selinger).
+    3) Otherwise, start from the relation with the fewest tuples,
+       and join the relation that is the cheapest to join every time.
+    4) Ties are broken by the order in the FROM clause.
+*/
+void QL_Manager::joinOrder(int nRelations, const char *const relations[], QL_ScanOp *const scans[], const double cardinalities[],
+                           int nConditions, const Condition conditions[], int order[])
+{
+    auto relOf = [&](const RelAttr &attr) -> int {
+        for (int i = 0; i < nRelations; ++i)
+            if (strcmp(attr.relName, relations[i]) == 0)
+                return i;
+        return -1;
+    };
+    vector<int> lhsRel(nConditions), rhsRel(nConditions);
+    vector<double> selectivities(nConditions);
+    for (int j = 0; j < nConditions; ++j)
     {
-        rc = rmFS.GetNextRec(rec);
+        lhsRel[j] = relOf(conditions[j].lhsAttr);
+        rhsRel[j] = conditions[j].bRhsIsAttr ? relOf(conditions[j].rhsAttr) : lhsRel[j];
+        selectivities[j] = QL_Selectivity(smManager, conditions[j]);
+    }
 
-        if (rc != 0 && rc != RM_EOF)
+    // The cost and cardinality of joining relation r to the relations in [set],
+    // which gives [card] tuples of [length] bytes
+    auto join = [&](unsigned long long set, double card, int length, int r, double &newCard) -> double {
+        newCard = card * cardinalities[r];
+        int equiJoin = -1;
+        for (int j = 0; j < nConditions; ++j)
         {
-            QL_PrintRC(rc);
-            throw QL_RELS_SCAN_FAIL;
+            if (lhsRel[j] == rhsRel[j])
+                continue;
+            int other = lhsRel[j] == r ? rhsRel[j] : rhsRel[j] == r ? lhsRel[j] : -1;
+            if (other == -1 || !(set >> other & 1))
+                continue;
+            newCard *= selectivities[j];
+            if (equiJoin == -1 && conditions[j].op == EQ_OP)
+                equiJoin = j;
         }
+        if (equiJoin == -1)
+            return JoinCost(card, length, scans[r], cardinalities[r], false, -1);
+        const RelAttr &key = lhsRel[equiJoin] == r ? conditions[equiJoin].lhsAttr : conditions[equiJoin].rhsAttr;
+        return JoinCost(card, length, scans[r], cardinalities[r], true, scans[r]->IndexOfAttr(key));
+    };
 
-        if (rc != RM_EOF)
+    if (nRelations > QL_DP_RELATIONS)
+    {
+        unsigned long long set = 0;
+        double card = 0;
+        int length = 0;
+        for (int k = 0; k < nRelations; ++k)
         {
-            QL_Try(rec.GetData(record), QL_RELS_SCAN_FAIL);
-            records[id] = record;
-
-            if (id + 1 == nRelations)
+            int best = -1;
+            double bestCost = 0, bestCard = 0;
+            for (int r = 0; r < nRelations; ++r)
             {
-                if (smManager.bDebug)
-                {
-                    printf("It's time to check condition.\n");
-                }
-                // Check condition
-                bool satisfied = true;
-                for (int i = 0; i < nConditions; ++i)
-                {
-                    if (smManager.bDebug)
-                    {
-                        printf("Check condition %d\n", i);
-                    }
-
-                    if (conditions[i].bRhsIsAttr)
-                    {
-                        if (!compare(conditions[i].rhsValue.type, conditions[i].op, records[indexRelOfCondLHS[i]] + offsetOfCondLHS[i], records[indexRelOfCondRHS[i]] + offsetOfCondRHS[i]))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        if (!compare(conditions[i].rhsValue.type, conditions[i].op, records[indexRelOfCondLHS[i]] + offsetOfCondLHS[i], conditions[i].rhsValue.data))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
-                }
-                if (!satisfied)
+                if (set >> r & 1)
                     continue;
-                if (smManager.bDebug)
+                double newCard = cardinalities[r];
+                double cost = k == 0 ? newCard : join(set, card, length, r, newCard);
+                if (best == -1 || cost < bestCost)
                 {
-                    printf("It's time to print!\n");
+                    best = r;
+                    bestCost = cost;
+                    bestCard = newCard;
                 }
-                // Print
-                for (int i = 0; i < nSelAttrs; ++i)
-                {
-                    if (smManager.bDebug)
-                    {
-                        printf("Select an attr (indexRel = %d, ", indexRelOfPrintAttr[i]);
-                        printf("offset = %d): ", offsetOfPrintAttr[i]);
-
-                        puts("");
-                    }
-
-                    memcpy(buf + printAttrs[i].offset, records[indexRelOfPrintAttr[i]] + offsetOfPrintAttr[i], printAttrs[i].attrLength);
-                }
-                if (smManager.bDebug)
-                {
-                    printf("It's printed!\n");
-                }
-                p.Print(cout, buf);
             }
-            else
+            order[k] = best;
+            set |= 1ull << best;
+            card = bestCard;
+            length += scans[best]->tupleLength;
+        }
+        return;
+    }
+
+    // The cheapest plan of every subset of relations, and the relation joined last in it
+    int nSets = 1 << nRelations;
+    vector<double> cost(nSets, -1), card(nSets, 0);
+    vector<int> length(nSets, 0), last(nSets, -1);
+    for (int r = 0; r < nRelations; ++r)
+    {
+        cost[1 << r] = scans[r]->pageNum;
+        card[1 << r] = cardinalities[r];
+        length[1 << r] = scans[r]->tupleLength;
+        last[1 << r] = r;
+    }
+    for (int set = 1; set < nSets; ++set)
+    {
+        if (last[set] == -1)
+            continue;
+        for (int r = 0; r < nRelations; ++r)
+        {
+            if (set >> r & 1)
+                continue;
+            double newCard;
+            double newCost = cost[set] + join(set, card[set], length[set], r, newCard);
+            int newSet = set | 1 << r;
+            if (last[newSet] == -1 || newCost < cost[newSet])
             {
-                scanRelations(id + 1, nRelations, relations, records, nConditions, conditions, indexRelOfCondLHS, offsetOfCondLHS, indexRelOfCondRHS, offsetOfCondRHS, nSelAttrs, printAttrs, indexRelOfPrintAttr, offsetOfPrintAttr, p, buf);
+                cost[newSet] = newCost;
+                card[newSet] = newCard;
+                length[newSet] = length[set] + scans[r]->tupleLength;
+                last[newSet] = r;
             }
         }
     }
-}
-
-int QL_Manager::indexOfRel(const char *relName, int nRelations, const char *const relations[])
-{
-    int i = 0;
-    for (; i < nRelations; ++i)
-        if (strcmp(relName, relations[i]) == 0)
-            return i;
-    return i;
+    for (int set = nSets - 1, k = nRelations - 1; k >= 0; set ^= 1 << last[set], --k)
+        order[k] = last[set];
 }
 
 /************ INSERT ************/
@@ -406,7 +595,7 @@ RC QL_Manager::Insert(const char *relName,
             return QL_DATABASE_CLOSED;
         }
 
-        if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0)
+        if (SM_IsCatalog(relName))
         {
             return QL_SYS_CAT;
         }
@@ -454,7 +643,9 @@ RC QL_Manager::Insert(const char *relName,
         char tupleData[rcRecord.tupleLength];
         memset(tupleData, 0, sizeof(tupleData));
         for (int i = 0; i < nValues; ++i)
-            memcpy(tupleData + attributes[i].offset, values[i].data, attributes[i].attrLength);
+        {
+            QL_CopyValue(attributes[i], (const char *)values[i].data, attributes[i].attrLength, tupleData + attributes[i].offset);
+        }
         QL_Try(rmFH.InsertRec(tupleData, rid), QL_INSERT_FAIL);
 
         // Close the RM file
@@ -467,7 +658,7 @@ RC QL_Manager::Insert(const char *relName,
             {
                 IX_IndexHandle ixIH;
                 QL_Try(ixManager.OpenIndex(relName, attributes[i].indexNo, ixIH), QL_INSERT_FAIL);
-                QL_Try(ixIH.InsertEntry(values[i].data, rid), QL_INSERT_FAIL);
+                QL_Try(ixIH.InsertEntry(tupleData + attributes[i].offset, rid), QL_INSERT_FAIL);
                 QL_Try(ixManager.CloseIndex(ixIH), QL_INSERT_FAIL);
             }
         }
@@ -529,7 +720,7 @@ RC QL_Manager::Delete(const char *relName,
         {
             return QL_NULLPTR_RELATION;
         }
-        if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0)
+        if (SM_IsCatalog(relName))
         {
             return QL_SYS_CAT;
         }
@@ -542,8 +733,6 @@ RC QL_Manager::Delete(const char *relName,
 
         // Validate the conditions
         Condition changedConditions[nConditions];
-        int offsetsLHS[nConditions];
-        int offsetsRHS[nConditions];
         for (int i = 0; i < nConditions; ++i)
         {
             changedConditions[i] = conditions[i];
@@ -551,14 +740,12 @@ RC QL_Manager::Delete(const char *relName,
             // Check whether LHS is a valid attribute
             DataAttrInfo attrInfo = checkAttr(changedConditions[i].lhsAttr, relName, rcRecord.attrCount, attributes);
             AttrType lhsType = attrInfo.attrType;
-            offsetsLHS[i] = attrInfo.offset;
 
             // If RHS is a attribute, check it
             AttrType rhsType;
             if (changedConditions[i].bRhsIsAttr)
             {
                 attrInfo = checkAttr(changedConditions[i].rhsAttr, relName, rcRecord.attrCount, attributes);
-                offsetsRHS[i] = attrInfo.offset;
                 rhsType = attrInfo.attrType;
             }
             else
@@ -583,18 +770,27 @@ RC QL_Manager::Delete(const char *relName,
                 cout << "    conditions[" << i << "]:" << conditions[i] << "\n";
         }
 
+        // Find the tuples to delete by a scan and a filter
+        bool pushed[nConditions];
+        QL_ScanOp *scan = scanOp(relName, attrCount, attributes, nConditions, changedConditions, pushed);
+        scan->forUpdate = true;
+        vector<Condition> rest;
+        for (int i = 0; i < nConditions; ++i)
+            if (!pushed[i])
+                rest.push_back(changedConditions[i]);
+        QL_FilterOp filter(smManager, scan, rest.size(), rest.data());
+        if (bQueryPlans)
+        {
+            cout << "  physical plan\n";
+            filter.Print(cout, 2);
+        }
+
         // Prepare the printer class
         cout << "Deleted tuples:" << endl;
         Printer p(attributes, attrCount);
         p.PrintHeader(cout);
 
-        // Open the RM file
-        RM_FileHandle rmFH;
-        QL_Try(rmManager.OpenFile(relName, rmFH), QL_DELETE_FAIL);
-
-        // Open a file scan
-        RM_FileScan rmFS;
-        QL_Try(rmFS.OpenScan(rmFH, INT, 4, 0, NO_OP, nullptr), QL_DELETE_FAIL);
+        filter.Open();
 
         // Open all the indexes
         IX_IndexHandle ixIHs[attrCount];
@@ -607,62 +803,23 @@ RC QL_Manager::Delete(const char *relName,
         }
 
         // Get the next record to delete
-        RM_Record rec;
-        RID rid;
-        char *recordData;
-        for (RC rc = OK_RC; rc != RM_EOF;)
+        char recordData[filter.tupleLength];
+        while (filter.GetNext(recordData) != QL_EOF)
         {
-            rc = rmFS.GetNextRec(rec);
-            if (rc != OK_RC && rc != RM_EOF)
-            {
-                RM_PrintError(rc);
+            // Delete the tuple
+            QL_Try(scan->rmFH.DeleteRec(scan->rid), QL_DELETE_FAIL);
 
-                throw QL_DELETE_FAIL;
-            }
-            if (rc != RM_EOF)
+            // Delete entries from all indexes
+            for (int i = 0; i < attrCount; ++i)
             {
-                QL_Try(rec.GetData(recordData), QL_DELETE_FAIL);
-                // Check if satisfies all conditions
-                bool satisfied = true;
-                for (int i = 0; i < nConditions; ++i)
-                {
-                    if (changedConditions[i].bRhsIsAttr)
-                    {
-                        if (!compare(changedConditions[i].rhsValue.type, changedConditions[i].op, recordData + offsetsLHS[i], recordData + offsetsRHS[i]))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        if (!compare(changedConditions[i].rhsValue.type, changedConditions[i].op, recordData + offsetsLHS[i], changedConditions[i].rhsValue.data))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
-                }
-                // If all conditions are satisfied
-                if (satisfied)
+                if (attributes[i].indexNo != -1)
                 {
-                    QL_Try(rec.GetRid(rid), QL_DELETE_FAIL);
-                    // Delete the tuple
-                    QL_Try(rmFH.DeleteRec(rid), QL_DELETE_FAIL);
-
-                    // Delete entries from all indexes
-                    for (int i = 0; i < attrCount; ++i)
-                    {
-                        if (attributes[i].indexNo != -1)
-                        {
-                            QL_Try(ixIHs[i].DeleteEntry(recordData + attributes[i].offset, rid), QL_DELETE_FAIL);
-                        }
-                    }
-
-                    // Print the deleted tuple
-                    p.Print(cout, recordData);
+                    QL_Try(ixIHs[i].DeleteEntry(recordData + attributes[i].offset, scan->rid), QL_DELETE_FAIL);
                 }
             }
+
+            // Print the deleted tuple
+            p.Print(cout, recordData);
         }
 
         // Close all the indexes
@@ -674,9 +831,8 @@ RC QL_Manager::Delete(const char *relName,
             }
         }
 
-        // Close the file scan and RM files
-        QL_Try(rmFS.CloseScan(), QL_DELETE_FAIL);
-        QL_Try(rmManager.CloseFile(rmFH), QL_DELETE_FAIL);
+        // Close the scan and the RM file
+        filter.Close();
 
         // Print the footer
         p.PrintFooter(cout);
@@ -741,7 +897,7 @@ RC QL_Manager::Update(const char *relName,
         {
             return QL_NULLPTR_RELATION;
         }
-        if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0)
+        if (SM_IsCatalog(relName))
         {
             return QL_SYS_CAT;
         }
@@ -799,22 +955,18 @@ RC QL_Manager::Update(const char *relName,
 
         // Validate the conditions
         Condition changedConditions[nConditions];
-        int offsetsLHS[nConditions];
-        int offsetsRHS[nConditions];
         for (int i = 0; i < nConditions; ++i)
         {
             changedConditions[i] = conditions[i];
 
             DataAttrInfo attrInfo = checkAttr(changedConditions[i].lhsAttr, relName, rcRecord.attrCount, attributes);
             AttrType lhsType = attrInfo.attrType;
-            offsetsLHS[i] = attrInfo.offset;
 
             // If RHS is a attribute, check it
             AttrType rhsType;
             if (changedConditions[i].bRhsIsAttr)
             {
                 attrInfo = checkAttr(changedConditions[i].rhsAttr, relName, rcRecord.attrCount, attributes);
-                offsetsRHS[i] = attrInfo.offset;
                 rhsType = attrInfo.attrType;
             }
             else
@@ -845,18 +997,27 @@ RC QL_Manager::Update(const char *relName,
                 cout << "    conditions[" << i << "]:" << conditions[i] << "\n";
         }
 
+        // Find the tuples to update by a scan and a filter
+        bool pushed[nConditions];
+        QL_ScanOp *scan = scanOp(relName, attrCount, attributes, nConditions, changedConditions, pushed);
+        scan->forUpdate = true;
+        vector<Condition> rest;
+        for (int i = 0; i < nConditions; ++i)
+            if (!pushed[i])
+                rest.push_back(changedConditions[i]);
+        QL_FilterOp filter(smManager, scan, rest.size(), rest.data());
+        if (bQueryPlans)
+        {
+            cout << "  physical plan\n";
+            filter.Print(cout, 2);
+        }
+
         // Prepare the printer class
         cout << "Updated tuples:" << endl;
         Printer p(attributes, attrCount);
         p.PrintHeader(cout);
 
-        // Open the RM file
-        RM_FileHandle rmFH;
-        QL_Try(rmManager.OpenFile(relName, rmFH), QL_UPDATE_FAIL);
-
-        // Open a file scan
-        RM_FileScan rmFS;
-        QL_Try(rmFS.OpenScan(rmFH, INT, 4, 0, NO_OP, nullptr), QL_UPDATE_FAIL);
+        filter.Open();
 
         // Open all the indexes
         IX_IndexHandle ixIHs[attrCount];
@@ -869,83 +1030,47 @@ RC QL_Manager::Update(const char *relName,
         }
 
         // Get the next record to update
-        RM_Record rec;
-        RID rid;
+        char tuple[filter.tupleLength];
         char *recordData;
-        for (RC rc = OK_RC; rc != RM_EOF;)
+        while (filter.GetNext(tuple) != QL_EOF)
         {
-            rc = rmFS.GetNextRec(rec);
-            if (rc != OK_RC && rc != RM_EOF)
-            {
-                RM_PrintError(rc);
+            // The record is modified in place and written back
+            QL_Try(scan->rec.GetData(recordData), QL_UPDATE_FAIL);
 
-                throw QL_UPDATE_FAIL;
-            }
-            if (rc != RM_EOF)
+            // Delete the entry of index
+            for (int i = 0; i < attrCount; ++i)
             {
-                QL_Try(rec.GetData(recordData), QL_UPDATE_FAIL);
-                // Check if satisfies all conditions
-                bool satisfied = true;
-                for (int i = 0; i < nConditions; ++i)
+                if (attributes[i].indexNo != -1)
                 {
-                    if (conditions[i].bRhsIsAttr)
-                    {
-                        if (!compare(conditions[i].rhsValue.type, conditions[i].op, recordData + offsetsLHS[i], recordData + offsetsRHS[i]))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        if (!compare(conditions[i].rhsValue.type, conditions[i].op, recordData + offsetsLHS[i], conditions[i].rhsValue.data))
-                        {
-                            satisfied = false;
-                            break;
-                        }
-                    }
+                    QL_Try(ixIHs[i].DeleteEntry(recordData + attributes[i].offset, scan->rid), QL_UPDATE_FAIL);
                 }
-                // If all conditions are satisfied
-                if (satisfied)
-                {
-                    QL_Try(rec.GetRid(rid), QL_UPDATE_FAIL);
-
-                    // Delete the entry of index
-                    for (int i = 0; i < attrCount; ++i)
-                    {
-                        if (attributes[i].indexNo != -1)
-                        {
-                            QL_Try(ixIHs[i].DeleteEntry(recordData + attributes[i].offset, rid), QL_UPDATE_FAIL);
-                        }
-                    }
-
-                    // Update the record
-                    memset(recordData + offsetLHS, 0, lengthLHS);
-                    if (bIsValue)
-                    {
-                        memcpy(recordData + offsetLHS, rhsValue.data, lengthRHS);
-                    }
-                    else
-                    {
-                        memcpy(recordData + offsetLHS, recordData + offsetRHS, lengthRHS);
-                    }
+            }
 
-                    // Update the tuple
-                    QL_Try(rmFH.UpdateRec(rec), QL_UPDATE_FAIL);
+            // Update the record
+            memset(recordData + offsetLHS, 0, lengthLHS);
+            if (bIsValue)
+            {
+                memcpy(recordData + offsetLHS, rhsValue.data, lengthRHS);
+            }
+            else
+            {
+                memcpy(recordData + offsetLHS, recordData + offsetRHS, lengthRHS);
+            }
 
-                    // Insert the entry of index
-                    for (int i = 0; i < attrCount; ++i)
-                    {
-                        if (attributes[i].indexNo != -1)
-                        {
-                            QL_Try(ixIHs[i].InsertEntry(recordData + attributes[i].offset, rid), QL_UPDATE_FAIL);
-                        }
-                    }
+            // Update the tuple
+            QL_Try(scan->rmFH.UpdateRec(scan->rec), QL_UPDATE_FAIL);
 
-                    // Print the updated tuple
-                    p.Print(cout, recordData);
+            // Insert the entry of index
+            for (int i = 0; i < attrCount; ++i)
+            {
+                if (attributes[i].indexNo != -1)
+                {
+                    QL_Try(ixIHs[i].InsertEntry(recordData + attributes[i].offset, scan->rid), QL_UPDATE_FAIL);
                 }
             }
+
+            // Print the updated tuple
+            p.Print(cout, recordData);
         }
 
         // Close all the indexes
@@ -957,9 +1082,8 @@ RC QL_Manager::Update(const char *relName,
             }
         }
 
-        // Close the file scan and RM files
-        QL_Try(rmFS.CloseScan(), QL_UPDATE_FAIL);
-        QL_Try(rmManager.CloseFile(rmFH), QL_UPDATE_FAIL);
+        // Close the scan and the RM file
+        filter.Close();
 
         // Print the footer
         p.PrintFooter(cout);
@@ -0,0 +1,1451 @@
+//
+// File:        ql_operator.cc
+// Description: Physical operators of the QL component
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unistd.h>
+#include "purplebase.h"
+#include "ql.h"
+#include "ql_internal.h"
+
+using namespace std;
+
+// Print the indent of a node in the query plan
+static void PrintIndent(ostream &c, int depth)
+{
+    for (int i = 0; i < depth; ++i)
+        c << "  ";
+}
+
+void QL_PrintCondition(ostream &c, const Condition &cond)
+{
+    c << cond.lhsAttr << cond.op << " ";
+    if (cond.bRhsIsAttr)
+    {
+        c << cond.rhsAttr;
+        return;
+    }
+    switch (cond.rhsValue.type)
+    {
+    case INT:
+        c << *(int *)cond.rhsValue.data;
+        break;
+    case FLOAT:
+        c << *(float *)cond.rhsValue.data;
+        break;
+    case STRING:
+        c << "'" << (char *)cond.rhsValue.data << "'";
+        break;
+    case DATE:
+        c << "'" << string((char *)cond.rhsValue.data, 10) << "'";
+        break;
+    }
+}
+
+int QL_Compare(AttrType type, const char *x, int xLength, const char *y, int yLength)
+{
+    switch (type)
+    {
+    case INT:
+        return *(int *)x < *(int *)y ? -1 : *(int *)x > *(int *)y;
+    case FLOAT:
+        return *(float *)x < *(float *)y ? -1 : *(float *)x > *(float *)y;
+    default:
+    {
+        // As strcmp(), but a string doesn't have to end with '\0'
+        xLength = strnlen(x, xLength);
+        yLength = strnlen(y, yLength);
+        int c = memcmp(x, y, min(xLength, yLength));
+        return c ? c : xLength - yLength;
+    }
+    }
+}
+
+void QL_CopyValue(const DataAttrInfo &attr, const char *data, int length, char *out)
+{
+    if (attr.attrType != STRING)
+    {
+        memcpy(out, data, attr.attrLength);
+        return;
+    }
+    int n = strnlen(data, min(length, attr.attrLength));
+    memcpy(out, data, n);
+    memset(out + n, 0, attr.attrLength - n);
+}
+
+// The default selectivities of System R, for a condition without statistics
+static double DefaultSelectivity(CompOp op)
+{
+    switch (op)
+    {
+    case EQ_OP:
+        return 0.1;
+    case NE_OP:
+        return 0.9;
+    case LT_OP:
+    case GT_OP:
+    case LE_OP:
+    case GE_OP:
+        return 1.0 / 3;
+    default:
+        return 1.0;
+    }
+}
+
+// The estimated fraction of values less than [value] by the histogram of [stat].
+// Within a bucket, numbers are interpolated linearly, and strings are assumed to lie in the middle.
+static double FractionBelow(const SM_AttrstatRecord &stat, const char *value)
+{
+    // The bounds keep SM_STAT_VALUE_LENGTH bytes, so is a string compared to them
+    auto compare = [&](int i) { return QL_Compare(stat.attrType, value, SM_STAT_VALUE_LENGTH, stat.bounds[i], SM_STAT_VALUE_LENGTH); };
+    int n = stat.bucketCount;
+    if (compare(0) <= 0)
+        return 0;
+    if (compare(n) > 0)
+        return 1;
+    int i = 0;
+    while (compare(i + 1) > 0)
+        ++i;
+
+    double fraction = 0.5;
+    if (stat.attrType == INT || stat.attrType == FLOAT)
+    {
+        double x, lo, hi;
+        if (stat.attrType == INT)
+            x = *(int *)value, lo = *(int *)stat.bounds[i], hi = *(int *)stat.bounds[i + 1];
+        else
+            x = *(float *)value, lo = *(float *)stat.bounds[i], hi = *(float *)stat.bounds[i + 1];
+        fraction = hi > lo ? (x - lo) / (hi - lo) : 1;
+    }
+    return (i + fraction) / n;
+}
+
+// Method: QL_Selectivity(SM_Manager &smm, const Condition &cond)
+// The estimated fraction of tuples satisfying the condition
+/* Steps:
+    1) Without statistics of the attributes, return the defaults of System R
+    2) [attr = attr] matches 1 / max(distinct values of both sides)
+    3) [attr = value] matches 1 / (distinct values) if the value is between the min and max, 0 otherwise
+    4) [attr < value] matches the fraction of values less than it by the histogram,
+       the other ranges are derived from it and the equality
+*/
+double QL_Selectivity(SM_Manager &smm, const Condition &cond)
+{
+    SM_AttrstatRecord lhs;
+    bool lhsKnown = smm.GetAttrStat(cond.lhsAttr.relName, cond.lhsAttr.attrName, lhs) && lhs.bucketCount > 0;
+    if (cond.bRhsIsAttr)
+    {
+        SM_AttrstatRecord rhs;
+        bool rhsKnown = smm.GetAttrStat(cond.rhsAttr.relName, cond.rhsAttr.attrName, rhs) && rhs.bucketCount > 0;
+        if ((cond.op != EQ_OP && cond.op != NE_OP) || (!lhsKnown && !rhsKnown))
+            return DefaultSelectivity(cond.op);
+        double distinct = max(lhsKnown ? lhs.distinctCount : 1, rhsKnown ? rhs.distinctCount : 1);
+        return cond.op == EQ_OP ? 1 / distinct : 1 - 1 / distinct;
+    }
+    if (!lhsKnown || cond.op == NO_OP)
+        return DefaultSelectivity(cond.op);
+
+    const char *value = (const char *)cond.rhsValue.data;
+    auto compare = [&](int i) { return QL_Compare(lhs.attrType, value, SM_STAT_VALUE_LENGTH, lhs.bounds[i], SM_STAT_VALUE_LENGTH); };
+    bool inRange = compare(0) >= 0 && compare(lhs.bucketCount) <= 0;
+    double equal = inRange ? 1.0 / max(lhs.distinctCount, 1) : 0;
+    double less = FractionBelow(lhs, value);
+    if (inRange)
+        less = min<double>(less, 1 - equal);
+    switch (cond.op)
+    {
+    case EQ_OP:
+        return equal;
+    case NE_OP:
+        return 1 - equal;
+    case LT_OP:
+        return less;
+    case GE_OP:
+        return 1 - less;
+    case LE_OP:
+        return less + equal;
+    case GT_OP:
+        return 1 - less - equal;
+    default:
+        return 1.0;
+    }
+}
+
+string QL_TempFileName()
+{
+    static int tempFileCount = 0;
+    return "#tmp." + to_string(getpid()) + "." + to_string(tempFileCount++);
+}
+
+/************ QL_Op ************/
+
+int QL_Op::IndexOfAttr(const RelAttr &attr) const
+{
+    for (int i = 0; i < (int)attrs.size(); ++i)
+        if ((attr.relName == nullptr || strcmp(attr.relName, attrs[i].relName) == 0) && strcmp(attr.attrName, attrs[i].attrName) == 0)
+            return i;
+    return -1;
+}
+
+/************ QL_ScanOp ************/
+
+QL_ScanOp::QL_ScanOp(RM_Manager &rmm, const char *relName, int attrCount, const DataAttrInfo attributes[])
+    : forUpdate(false), rmManager(rmm), relName(relName), open(false)
+{
+    tupleLength = 0;
+    for (int i = 0; i < attrCount; ++i)
+    {
+        attrs.push_back(attributes[i]);
+        tupleLength = max(tupleLength, attributes[i].offset + attributes[i].attrLength);
+    }
+
+    // The header of the file tells the number of records
+    RM_FileHandle fileHandle;
+    QL_Try(rmManager.OpenFile(relName, fileHandle), QL_RELS_SCAN_FAIL);
+    cardinality = fileHandle.GetRecordNum();
+    pageNum = fileHandle.GetPageNum();
+    QL_Try(rmManager.CloseFile(fileHandle), QL_RELS_SCAN_FAIL);
+}
+
+QL_ScanOp::~QL_ScanOp() {}
+
+void QL_ScanOp::OpenFile()
+{
+    QL_Try(rmManager.OpenFile(relName.c_str(), rmFH, !forUpdate), QL_RELS_SCAN_FAIL);
+    open = true;
+}
+
+void QL_ScanOp::CloseFile()
+{
+    open = false;
+    QL_Try(rmManager.CloseFile(rmFH), QL_RELS_SCAN_FAIL);
+}
+
+/************ QL_FileScanOp ************/
+
+QL_FileScanOp::QL_FileScanOp(SM_Manager &smm, RM_Manager &rmm, const char *relName, int attrCount, const DataAttrInfo attributes[],
+                             const Condition *cond, int attrIndex)
+    : QL_ScanOp(rmm, relName, attrCount, attributes), hasCond(cond != nullptr), attrIndex(attrIndex)
+{
+    if (hasCond)
+    {
+        this->cond = *cond;
+        cardinality *= QL_Selectivity(smm, *cond);
+    }
+}
+
+// An operator tree abandoned by an exception mustn't leave the file open
+QL_FileScanOp::~QL_FileScanOp()
+{
+    try
+    {
+        if (open)
+            Close();
+    }
+    catch (RC rc)
+    {
+    }
+}
+
+void QL_FileScanOp::Open()
+{
+    OpenFile();
+    if (hasCond)
+    {
+        const DataAttrInfo &attr = attrs[attrIndex];
+        QL_Try(rmFS.OpenScan(rmFH, attr.attrType, attr.attrLength, attr.offset, cond.op, cond.rhsValue.data), QL_RELS_SCAN_FAIL);
+    }
+    else
+    {
+        QL_Try(rmFS.OpenScan(rmFH, INT, 4, 0, NO_OP, nullptr), QL_RELS_SCAN_FAIL);
+    }
+}
+
+RC QL_FileScanOp::GetNext(char *tuple)
+{
+    RC rc = rmFS.GetNextRec(rec);
+    if (rc == RM_EOF)
+        return QL_EOF;
+    QL_Try(rc, QL_RELS_SCAN_FAIL);
+
+    char *data;
+    QL_Try(rec.GetData(data), QL_RELS_SCAN_FAIL);
+    QL_Try(rec.GetRid(rid), QL_RELS_SCAN_FAIL);
+    memcpy(tuple, data, tupleLength);
+    return OK_RC;
+}
+
+void QL_FileScanOp::Close()
+{
+    QL_Try(rmFS.CloseScan(), QL_RELS_SCAN_FAIL);
+    CloseFile();
+}
+
+void QL_FileScanOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "FileScan(" << relName;
+    if (hasCond)
+    {
+        c << ", ";
+        QL_PrintCondition(c, cond);
+    }
+    c << ")\n";
+}
+
+/************ QL_IndexScanOp ************/
+
+QL_IndexScanOp::QL_IndexScanOp(SM_Manager &smm, RM_Manager &rmm, IX_Manager &ixm, const char *relName, int attrCount, const DataAttrInfo attributes[],
+                               const Condition &cond, int attrIndex)
+    : QL_ScanOp(rmm, relName, attrCount, attributes), ixManager(ixm), cond(cond), attrIndex(attrIndex)
+{
+    cardinality *= QL_Selectivity(smm, cond);
+
+    const DataAttrInfo &attr = attrs[attrIndex];
+    value.assign(attr.attrLength + 1, 0);
+    QL_CopyValue(attr, (const char *)cond.rhsValue.data, attr.attrLength, value.data());
+}
+
+QL_IndexScanOp::~QL_IndexScanOp()
+{
+    try
+    {
+        if (open)
+            Close();
+    }
+    catch (RC rc)
+    {
+    }
+}
+
+// IX_IndexScan walks the leaves lazily, so the index stays open while scanning.
+// But Delete and Update modify the same index, and an updated entry could be
+// met again, so for them all the satisfied RIDs are collected when opening
+// and the index is closed at once.
+void QL_IndexScanOp::Open()
+{
+    OpenFile();
+    QL_Try(ixManager.OpenIndex(relName.c_str(), attrs[attrIndex].indexNo, ixIH), QL_RELS_SCAN_FAIL);
+    QL_Try(ixIS.OpenScan(ixIH, cond.op, value.data()), QL_RELS_SCAN_FAIL);
+    if (forUpdate)
+    {
+        rids.clear();
+        nextRID = 0;
+        RC rc;
+        while ((rc = ixIS.GetNextEntry(rid)) != IX_EOF)
+        {
+            QL_Try(rc, QL_RELS_SCAN_FAIL);
+            rids.push_back(rid);
+        }
+        QL_Try(ixIS.CloseScan(), QL_RELS_SCAN_FAIL);
+        QL_Try(ixManager.CloseIndex(ixIH), QL_RELS_SCAN_FAIL);
+    }
+}
+
+RC QL_IndexScanOp::GetNext(char *tuple)
+{
+    if (forUpdate)
+    {
+        if (nextRID == rids.size())
+            return QL_EOF;
+        rid = rids[nextRID++];
+    }
+    else
+    {
+        RC rc = ixIS.GetNextEntry(rid);
+        if (rc == IX_EOF)
+            return QL_EOF;
+        QL_Try(rc, QL_RELS_SCAN_FAIL);
+    }
+    QL_Try(rmFH.GetRec(rid, rec), QL_RELS_SCAN_FAIL);
+
+    char *data;
+    QL_Try(rec.GetData(data), QL_RELS_SCAN_FAIL);
+    memcpy(tuple, data, tupleLength);
+    return OK_RC;
+}
+
+void QL_IndexScanOp::Close()
+{
+    if (!forUpdate)
+    {
+        QL_Try(ixIS.CloseScan(), QL_RELS_SCAN_FAIL);
+        QL_Try(ixManager.CloseIndex(ixIH), QL_RELS_SCAN_FAIL);
+    }
+    rids.clear();
+    CloseFile();
+}
+
+void QL_IndexScanOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "IndexScan(" << relName << ", index " << attrs[attrIndex].indexNo << ", ";
+    QL_PrintCondition(c, cond);
+    c << ")\n";
+}
+
+/************ QL_FilterOp ************/
+
+QL_FilterOp::QL_FilterOp(SM_Manager &smm, QL_Op *child, int nConditions, const Condition conditions[])
+    : child(child), conditions(conditions, conditions + nConditions)
+{
+    tupleLength = child->tupleLength;
+    attrs = child->attrs;
+    cardinality = child->cardinality;
+    for (int i = 0; i < nConditions; ++i)
+    {
+        cardinality *= QL_Selectivity(smm, conditions[i]);
+        int lhs = child->IndexOfAttr(conditions[i].lhsAttr);
+        int rhs = conditions[i].bRhsIsAttr ? child->IndexOfAttr(conditions[i].rhsAttr) : 0;
+        if (lhs == -1 || rhs == -1)
+            throw QL_ATTR_OF_NO_REL;
+        offsetsLHS.push_back(attrs[lhs].offset);
+        offsetsRHS.push_back(conditions[i].bRhsIsAttr ? attrs[rhs].offset : -1);
+
+        // A string attribute as long as the attribute doesn't end with '\0', but a string value does
+        lengthsLHS.push_back(attrs[lhs].attrLength);
+        if (conditions[i].bRhsIsAttr)
+            lengthsRHS.push_back(attrs[rhs].attrLength);
+        else if (conditions[i].rhsValue.type == STRING)
+            lengthsRHS.push_back(strlen((const char *)conditions[i].rhsValue.data));
+        else
+            lengthsRHS.push_back(attrs[lhs].attrLength);
+    }
+}
+
+QL_FilterOp::~QL_FilterOp()
+{
+    delete child;
+}
+
+void QL_FilterOp::Open()
+{
+    child->Open();
+}
+
+RC QL_FilterOp::GetNext(char *tuple)
+{
+    while (child->GetNext(tuple) != QL_EOF)
+    {
+        bool satisfied = true;
+        for (int i = 0; i < (int)conditions.size() && satisfied; ++i)
+        {
+            const char *rhs = conditions[i].bRhsIsAttr ? tuple + offsetsRHS[i] : (const char *)conditions[i].rhsValue.data;
+            int c = QL_Compare(conditions[i].rhsValue.type, tuple + offsetsLHS[i], lengthsLHS[i], rhs, lengthsRHS[i]);
+            switch (conditions[i].op)
+            {
+            case EQ_OP:
+                satisfied = c == 0;
+                break;
+            case NE_OP:
+                satisfied = c != 0;
+                break;
+            case LT_OP:
+                satisfied = c < 0;
+                break;
+            case GT_OP:
+                satisfied = c > 0;
+                break;
+            case LE_OP:
+                satisfied = c <= 0;
+                break;
+            case GE_OP:
+                satisfied = c >= 0;
+                break;
+            default:
+                break;
+            }
+        }
+        if (satisfied)
+            return OK_RC;
+    }
+    return QL_EOF;
+}
+
+void QL_FilterOp::Close()
+{
+    child->Close();
+}
+
+void QL_FilterOp::Print(ostream &c, int depth) const
+{
+    // A filter without conditions passes everything, so it's not shown
+    if (conditions.empty())
+    {
+        child->Print(c, depth);
+        return;
+    }
+    PrintIndent(c, depth);
+    c << "Filter(";
+    for (int i = 0; i < (int)conditions.size(); ++i)
+    {
+        if (i)
+            c << " and ";
+        QL_PrintCondition(c, conditions[i]);
+    }
+    c << ")\n";
+    child->Print(c, depth + 1);
+}
+
+/************ QL_ProjectOp ************/
+
+QL_ProjectOp::QL_ProjectOp(QL_Op *child, int nSelAttrs, const RelAttr selAttrs[])
+    : child(child), childTuple(child->tupleLength)
+{
+    cardinality = child->cardinality;
+    tupleLength = 0;
+    for (int i = 0; i < nSelAttrs; ++i)
+    {
+        int k = child->IndexOfAttr(selAttrs[i]);
+        if (k == -1)
+            throw QL_ATTR_OF_NO_REL;
+        offsetsInChild.push_back(child->attrs[k].offset);
+        attrs.push_back(child->attrs[k]);
+        attrs.back().offset = tupleLength;
+        tupleLength += attrs.back().attrLength + (attrs.back().attrType == STRING);
+    }
+}
+
+QL_ProjectOp::~QL_ProjectOp()
+{
+    delete child;
+}
+
+void QL_ProjectOp::Open()
+{
+    child->Open();
+}
+
+RC QL_ProjectOp::GetNext(char *tuple)
+{
+    if (child->GetNext(childTuple.data()) == QL_EOF)
+        return QL_EOF;
+    for (int i = 0; i < (int)attrs.size(); ++i)
+        memcpy(tuple + attrs[i].offset, childTuple.data() + offsetsInChild[i], attrs[i].attrLength);
+    return OK_RC;
+}
+
+void QL_ProjectOp::Close()
+{
+    child->Close();
+}
+
+void QL_ProjectOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "Project(";
+    for (int i = 0; i < (int)attrs.size(); ++i)
+        c << (i ? ", " : "") << attrs[i].relName << "." << attrs[i].attrName;
+    c << ")\n";
+    child->Print(c, depth + 1);
+}
+
+/************ QL_NestedLoopJoinOp ************/
+
+QL_NestedLoopJoinOp::QL_NestedLoopJoinOp(QL_Op *left, QL_Op *right)
+    : left(left), right(right), leftTuple(left->tupleLength), leftValid(false)
+{
+    tupleLength = left->tupleLength + right->tupleLength;
+    cardinality = left->cardinality * right->cardinality;
+    attrs = left->attrs;
+    for (DataAttrInfo attr : right->attrs)
+    {
+        attr.offset += left->tupleLength;
+        attrs.push_back(attr);
+    }
+}
+
+QL_NestedLoopJoinOp::~QL_NestedLoopJoinOp()
+{
+    delete left;
+    delete right;
+}
+
+void QL_NestedLoopJoinOp::Open()
+{
+    left->Open();
+    leftValid = false;
+}
+
+RC QL_NestedLoopJoinOp::GetNext(char *tuple)
+{
+    while (true)
+    {
+        if (!leftValid)
+        {
+            if (left->GetNext(leftTuple.data()) == QL_EOF)
+                return QL_EOF;
+            leftValid = true;
+            right->Open();
+        }
+        if (right->GetNext(tuple + left->tupleLength) != QL_EOF)
+        {
+            memcpy(tuple, leftTuple.data(), left->tupleLength);
+            return OK_RC;
+        }
+        right->Close();
+        leftValid = false;
+    }
+}
+
+void QL_NestedLoopJoinOp::Close()
+{
+    if (leftValid)
+        right->Close();
+    leftValid = false;
+    left->Close();
+}
+
+void QL_NestedLoopJoinOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "NestedLoopJoin\n";
+    left->Print(c, depth + 1);
+    right->Print(c, depth + 1);
+}
+
+/************ QL_HashJoinOp ************/
+
+QL_HashJoinOp::QL_HashJoinOp(SM_Manager &smm, RM_Manager &rmm, QL_Op *left, QL_Op *right, const Condition &cond)
+    : rmManager(rmm), left(left), right(right), cond(cond), probeValid(false), partitioned(false), partOpen(false)
+{
+    tupleLength = left->tupleLength + right->tupleLength;
+    cardinality = left->cardinality * right->cardinality * QL_Selectivity(smm, cond);
+    attrs = left->attrs;
+    for (DataAttrInfo attr : right->attrs)
+    {
+        attr.offset += left->tupleLength;
+        attrs.push_back(attr);
+    }
+
+    // Find the key on both sides
+    int leftKey = left->IndexOfAttr(cond.lhsAttr);
+    int rightKey = right->IndexOfAttr(cond.rhsAttr);
+    if (leftKey == -1 || rightKey == -1)
+    {
+        leftKey = left->IndexOfAttr(cond.rhsAttr);
+        rightKey = right->IndexOfAttr(cond.lhsAttr);
+    }
+    if (leftKey == -1 || rightKey == -1)
+        throw QL_ATTR_OF_NO_REL;
+    keyType = left->attrs[leftKey].attrType;
+
+    // Build on the smaller side
+    buildLeft = left->cardinality <= right->cardinality;
+    build = buildLeft ? left : right;
+    probe = buildLeft ? right : left;
+    buildKey = buildLeft ? left->attrs[leftKey].offset : right->attrs[rightKey].offset;
+    probeKey = buildLeft ? right->attrs[rightKey].offset : left->attrs[leftKey].offset;
+    buildLength = buildLeft ? left->attrs[leftKey].attrLength : right->attrs[rightKey].attrLength;
+    probeLength = buildLeft ? right->attrs[rightKey].attrLength : left->attrs[leftKey].attrLength;
+    probeTuple.resize(probe->tupleLength);
+}
+
+QL_HashJoinOp::~QL_HashJoinOp()
+{
+    try
+    {
+        if (partOpen)
+        {
+            partFS.CloseScan();
+            rmManager.CloseFile(partFH);
+        }
+        DestroyPartitions();
+    }
+    catch (RC rc)
+    {
+    }
+    delete left;
+    delete right;
+}
+
+// The key in the hash table, in which equal values have equal bytes,
+// of the attribute of [length] bytes at [offset]
+string QL_HashJoinOp::Key(const char *tuple, int offset, int length) const
+{
+    const char *data = tuple + offset;
+    switch (keyType)
+    {
+    case FLOAT:
+    {
+        // 0.0 and -0.0 are equal
+        float value = *(float *)data;
+        if (value == 0)
+            value = 0;
+        return string((const char *)&value, sizeof(float));
+    }
+    case STRING:
+        return string(data, strnlen(data, length));
+    default:
+        return string(data, length);
+    }
+}
+
+void QL_HashJoinOp::InsertTable(const char *tuple)
+{
+    int offset = table.size();
+    table.insert(table.end(), tuple, tuple + build->tupleLength);
+    index.emplace(Key(tuple, buildKey, buildLength), offset);
+}
+
+void QL_HashJoinOp::CreatePartitions(vector<string> &files, vector<RM_FileHandle> &fileHandles, int recordSize)
+{
+    files.clear();
+    fileHandles.resize(QL_HASH_PARTITIONS);
+    for (int i = 0; i < QL_HASH_PARTITIONS; ++i)
+    {
+        files.push_back(QL_TempFileName());
+        QL_Try(rmManager.CreateFile(files[i].c_str(), recordSize), QL_RELS_SCAN_FAIL);
+        QL_Try(rmManager.OpenFile(files[i].c_str(), fileHandles[i]), QL_RELS_SCAN_FAIL);
+    }
+}
+
+// Partitions are chosen by other bits of the hash than the buckets of [index]
+void QL_HashJoinOp::InsertPartition(vector<RM_FileHandle> &fileHandles, const char *tuple, int offset, int length)
+{
+    unsigned long long hash = std::hash<string>()(Key(tuple, offset, length));
+    int p = (hash * 0x9E3779B97F4A7C15ull) >> 32 & (QL_HASH_PARTITIONS - 1);
+    RID rid;
+    QL_Try(fileHandles[p].InsertRec(tuple, rid), QL_RELS_SCAN_FAIL);
+}
+
+void QL_HashJoinOp::ClosePartitions(vector<RM_FileHandle> &fileHandles)
+{
+    for (RM_FileHandle &fileHandle : fileHandles)
+        QL_Try(rmManager.CloseFile(fileHandle), QL_RELS_SCAN_FAIL);
+}
+
+void QL_HashJoinOp::DestroyPartitions()
+{
+    for (const string &file : buildFiles)
+        QL_Try(rmManager.DestroyFile(file.c_str()), QL_RELS_SCAN_FAIL);
+    for (const string &file : probeFiles)
+        QL_Try(rmManager.DestroyFile(file.c_str()), QL_RELS_SCAN_FAIL);
+    buildFiles.clear();
+    probeFiles.clear();
+}
+
+void QL_HashJoinOp::Open()
+{
+    table.clear();
+    index.clear();
+    partitioned = false;
+    probeValid = false;
+
+    // Build the hash table, or the partitions of the build side if it's too large.
+    // A record of RM must be smaller than a page, so a wider tuple stays in memory.
+    vector<char> tuple(build->tupleLength);
+    vector<RM_FileHandle> buildFHs;
+    build->Open();
+    while (build->GetNext(tuple.data()) != QL_EOF)
+    {
+        if (partitioned)
+        {
+            InsertPartition(buildFHs, tuple.data(), buildKey, buildLength);
+            continue;
+        }
+        InsertTable(tuple.data());
+        if ((int)table.size() > QL_JOIN_MEMORY && build->tupleLength < PF_PAGE_SIZE && probe->tupleLength < PF_PAGE_SIZE)
+        {
+            partitioned = true;
+            CreatePartitions(buildFiles, buildFHs, build->tupleLength);
+            for (int offset = 0; offset < (int)table.size(); offset += build->tupleLength)
+                InsertPartition(buildFHs, table.data() + offset, buildKey, buildLength);
+            table.clear();
+            index.clear();
+        }
+    }
+    build->Close();
+    probe->Open();
+    if (!partitioned)
+        return;
+    ClosePartitions(buildFHs);
+
+    // Partition the probe side in the same way
+    vector<RM_FileHandle> probeFHs;
+    CreatePartitions(probeFiles, probeFHs, probe->tupleLength);
+    while (probe->GetNext(probeTuple.data()) != QL_EOF)
+        InsertPartition(probeFHs, probeTuple.data(), probeKey, probeLength);
+    probe->Close();
+    ClosePartitions(probeFHs);
+    curPartition = -1;
+}
+
+// Read the build partition [p] into the hash table
+void QL_HashJoinOp::LoadPartition(int p)
+{
+    table.clear();
+    index.clear();
+
+    RM_FileHandle fileHandle;
+    RM_FileScan fileScan;
+    RM_Record rec;
+    char *data;
+    QL_Try(rmManager.OpenFile(buildFiles[p].c_str(), fileHandle), QL_RELS_SCAN_FAIL);
+    QL_Try(fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr), QL_RELS_SCAN_FAIL);
+    for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF;)
+    {
+        QL_Try(rc, QL_RELS_SCAN_FAIL);
+        QL_Try(rec.GetData(data), QL_RELS_SCAN_FAIL);
+        InsertTable(data);
+    }
+    QL_Try(fileScan.CloseScan(), QL_RELS_SCAN_FAIL);
+    QL_Try(rmManager.CloseFile(fileHandle), QL_RELS_SCAN_FAIL);
+}
+
+// Get the next probe tuple into [probeTuple], return false if there's no more
+bool QL_HashJoinOp::NextProbe()
+{
+    if (!partitioned)
+        return probe->GetNext(probeTuple.data()) != QL_EOF;
+
+    while (true)
+    {
+        if (partOpen)
+        {
+            RM_Record rec;
+            RC rc = partFS.GetNextRec(rec);
+            if (rc != RM_EOF)
+            {
+                char *data;
+                QL_Try(rc, QL_RELS_SCAN_FAIL);
+                QL_Try(rec.GetData(data), QL_RELS_SCAN_FAIL);
+                memcpy(probeTuple.data(), data, probe->tupleLength);
+                return true;
+            }
+            partOpen = false;
+            QL_Try(partFS.CloseScan(), QL_RELS_SCAN_FAIL);
+            QL_Try(rmManager.CloseFile(partFH), QL_RELS_SCAN_FAIL);
+        }
+
+        // Go to the next pair of partitions, skip it if nothing to build
+        if (++curPartition == QL_HASH_PARTITIONS)
+            return false;
+        LoadPartition(curPartition);
+        if (table.empty())
+            continue;
+        QL_Try(rmManager.OpenFile(probeFiles[curPartition].c_str(), partFH), QL_RELS_SCAN_FAIL);
+        QL_Try(partFS.OpenScan(partFH, INT, 4, 0, NO_OP, nullptr), QL_RELS_SCAN_FAIL);
+        partOpen = true;
+    }
+}
+
+RC QL_HashJoinOp::GetNext(char *tuple)
+{
+    while (true)
+    {
+        // Output the next build tuple matching the probe tuple
+        for (; probeValid && matchCur != matchEnd; ++matchCur)
+        {
+            const char *buildTuple = table.data() + matchCur->second;
+            if (QL_Compare(keyType, buildTuple + buildKey, buildLength, probeTuple.data() + probeKey, probeLength) != 0)
+                continue;
+            const char *leftTuple = buildLeft ? buildTuple : probeTuple.data();
+            const char *rightTuple = buildLeft ? probeTuple.data() : buildTuple;
+            memcpy(tuple, leftTuple, left->tupleLength);
+            memcpy(tuple + left->tupleLength, rightTuple, right->tupleLength);
+            ++matchCur;
+            return OK_RC;
+        }
+
+        if (!NextProbe())
+        {
+            probeValid = false;
+            return QL_EOF;
+        }
+        auto matches = index.equal_range(Key(probeTuple.data(), probeKey, probeLength));
+        matchCur = matches.first;
+        matchEnd = matches.second;
+        probeValid = true;
+    }
+}
+
+void QL_HashJoinOp::Close()
+{
+    if (!partitioned)
+    {
+        probe->Close();
+    }
+    if (partOpen)
+    {
+        partOpen = false;
+        QL_Try(partFS.CloseScan(), QL_RELS_SCAN_FAIL);
+        QL_Try(rmManager.CloseFile(partFH), QL_RELS_SCAN_FAIL);
+    }
+    DestroyPartitions();
+    table.clear();
+    index.clear();
+    probeValid = false;
+}
+
+void QL_HashJoinOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "HashJoin(";
+    QL_PrintCondition(c, cond);
+    c << ", build " << (buildLeft ? "left" : "right") << ")\n";
+    left->Print(c, depth + 1);
+    right->Print(c, depth + 1);
+}
+
+/************ QL_IndexNestedLoopJoinOp ************/
+
+QL_IndexNestedLoopJoinOp::QL_IndexNestedLoopJoinOp(SM_Manager &smm, RM_Manager &rmm, IX_Manager &ixm, QL_Op *left,
+                                                   const char *relName, int attrCount, const DataAttrInfo attributes[],
+                                                   const Condition &cond, int attrIndex)
+    : rmManager(rmm), ixManager(ixm), left(left), relName(relName), cond(cond),
+      innerAttrs(attributes, attributes + attrCount), innerKey(attrIndex), open(false), leftValid(false)
+{
+    innerLength = 0;
+    for (const DataAttrInfo &attr : innerAttrs)
+        innerLength = max(innerLength, attr.offset + attr.attrLength);
+
+    tupleLength = left->tupleLength + innerLength;
+    attrs = left->attrs;
+    for (DataAttrInfo attr : innerAttrs)
+    {
+        attr.offset += left->tupleLength;
+        attrs.push_back(attr);
+    }
+
+    // The key of the left side is the other attribute of the condition
+    const RelAttr &leftAttr = strcmp(cond.lhsAttr.relName, relName) == 0 ? cond.rhsAttr : cond.lhsAttr;
+    int k = left->IndexOfAttr(leftAttr);
+    if (k == -1)
+        throw QL_ATTR_OF_NO_REL;
+    leftKey = left->attrs[k].offset;
+    leftLength = left->attrs[k].attrLength;
+
+    // Every left tuple matches the records of one key
+    RM_FileHandle fileHandle;
+    QL_Try(rmManager.OpenFile(relName, fileHandle), QL_RELS_SCAN_FAIL);
+    cardinality = left->cardinality * fileHandle.GetRecordNum() * QL_Selectivity(smm, cond);
+    QL_Try(rmManager.CloseFile(fileHandle), QL_RELS_SCAN_FAIL);
+
+    leftTuple.resize(left->tupleLength);
+    value.resize(innerAttrs[innerKey].attrLength + 1);
+}
+
+QL_IndexNestedLoopJoinOp::~QL_IndexNestedLoopJoinOp()
+{
+    try
+    {
+        if (open)
+            Close();
+    }
+    catch (RC rc)
+    {
+    }
+    delete left;
+}
+
+void QL_IndexNestedLoopJoinOp::Open()
+{
+    left->Open();
+    QL_Try(rmManager.OpenFile(relName.c_str(), rmFH, true), QL_RELS_SCAN_FAIL);
+    QL_Try(ixManager.OpenIndex(relName.c_str(), innerAttrs[innerKey].indexNo, ixIH), QL_RELS_SCAN_FAIL);
+    open = true;
+    leftValid = false;
+}
+
+RC QL_IndexNestedLoopJoinOp::GetNext(char *tuple)
+{
+    const DataAttrInfo &key = innerAttrs[innerKey];
+    while (true)
+    {
+        if (!leftValid)
+        {
+            if (left->GetNext(leftTuple.data()) == QL_EOF)
+                return QL_EOF;
+
+            QL_CopyValue(key, leftTuple.data() + leftKey, leftLength, value.data());
+            QL_Try(ixIS.OpenScan(ixIH, EQ_OP, value.data()), QL_RELS_SCAN_FAIL);
+            leftValid = true;
+        }
+
+        RID rid;
+        RC rc = ixIS.GetNextEntry(rid);
+        if (rc == IX_EOF)
+        {
+            QL_Try(ixIS.CloseScan(), QL_RELS_SCAN_FAIL);
+            leftValid = false;
+            continue;
+        }
+        QL_Try(rc, QL_RELS_SCAN_FAIL);
+
+        RM_Record rec;
+        char *data;
+        QL_Try(rmFH.GetRec(rid, rec), QL_RELS_SCAN_FAIL);
+        QL_Try(rec.GetData(data), QL_RELS_SCAN_FAIL);
+
+        // A string longer than the indexed one is cut when probing, so check again
+        if (QL_Compare(key.attrType, leftTuple.data() + leftKey, leftLength, data + key.offset, key.attrLength) != 0)
+            continue;
+        memcpy(tuple, leftTuple.data(), left->tupleLength);
+        memcpy(tuple + left->tupleLength, data, innerLength);
+        return OK_RC;
+    }
+}
+
+void QL_IndexNestedLoopJoinOp::Close()
+{
+    open = false;
+    if (leftValid)
+        QL_Try(ixIS.CloseScan(), QL_RELS_SCAN_FAIL);
+    leftValid = false;
+    left->Close();
+    QL_Try(ixManager.CloseIndex(ixIH), QL_RELS_SCAN_FAIL);
+    QL_Try(rmManager.CloseFile(rmFH), QL_RELS_SCAN_FAIL);
+}
+
+void QL_IndexNestedLoopJoinOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "IndexNestedLoopJoin(";
+    QL_PrintCondition(c, cond);
+    c << ")\n";
+    left->Print(c, depth + 1);
+    PrintIndent(c, depth + 1);
+    c << "IndexProbe(" << relName << ", index " << innerAttrs[innerKey].indexNo << ")\n";
+}
+
+/************ QL_Sorter ************/
+
+QL_Sorter::QL_Sorter(PF_Manager &pfm, int tupleLength, const vector<DataAttrInfo> &keys)
+    : pfManager(pfm), tupleLength(tupleLength), keys(keys), sortedPos(0), writing(false), writeData(nullptr)
+{
+    buffer.reserve(max(QL_SORT_MEMORY, tupleLength));
+}
+
+QL_Sorter::~QL_Sorter()
+{
+    try
+    {
+        Clear();
+    }
+    catch (RC rc)
+    {
+    }
+}
+
+int QL_Sorter::Compare(const char *x, const char *y) const
+{
+    for (const DataAttrInfo &key : keys)
+    {
+        int c = QL_Compare(key.attrType, x + key.offset, key.attrLength, y + key.offset, key.attrLength);
+        if (c)
+            return c;
+    }
+    return 0;
+}
+
+void QL_Sorter::Insert(const char *tuple)
+{
+    if (!buffer.empty() && (int)buffer.size() + tupleLength > QL_SORT_MEMORY)
+        WriteRun();
+    buffer.insert(buffer.end(), tuple, tuple + tupleLength);
+}
+
+void QL_Sorter::Sort()
+{
+    sorted.clear();
+    sortedPos = 0;
+    if (runs.empty())
+    {
+        // Everything is in memory
+        for (int offset = 0; offset < (int)buffer.size(); offset += tupleLength)
+            sorted.push_back(buffer.data() + offset);
+        std::sort(sorted.begin(), sorted.end(), [this](const char *x, const char *y) { return Compare(x, y) < 0; });
+        return;
+    }
+
+    if (!buffer.empty())
+        WriteRun();
+    while ((int)runs.size() > QL_SORT_FANIN)
+        MergeRuns(QL_SORT_FANIN);
+    OpenReaders(runs.size());
+}
+
+RC QL_Sorter::GetNext(char *tuple)
+{
+    if (readers.empty())
+    {
+        if (sortedPos == (int)sorted.size())
+            return QL_EOF;
+        memcpy(tuple, sorted[sortedPos++], tupleLength);
+        return OK_RC;
+    }
+
+    if (heap.empty())
+        return QL_EOF;
+    int r = PopHeap();
+    memcpy(tuple, readers[r].tuple.data(), tupleLength);
+    if (ReadTuple(readers[r]))
+        PushHeap(r);
+    return OK_RC;
+}
+
+void QL_Sorter::Clear()
+{
+    buffer.clear();
+    sorted.clear();
+    sortedPos = 0;
+    CloseReaders();
+    if (writing)
+    {
+        writing = false;
+        EndRun(0);
+    }
+    for (const Run &run : runs)
+        QL_Try(pfManager.DestroyFile(run.fileName.c_str()), QL_RELS_SCAN_FAIL);
+    runs.clear();
+}
+
+void QL_Sorter::WriteRun()
+{
+    for (int offset = 0; offset < (int)buffer.size(); offset += tupleLength)
+        sorted.push_back(buffer.data() + offset);
+    std::sort(sorted.begin(), sorted.end(), [this](const char *x, const char *y) { return Compare(x, y) < 0; });
+
+    BeginRun();
+    for (const char *tuple : sorted)
+        WriteTuple(tuple);
+    EndRun(sorted.size());
+    buffer.clear();
+    sorted.clear();
+}
+
+void QL_Sorter::BeginRun()
+{
+    runs.push_back(Run{QL_TempFileName(), 0});
+    QL_Try(pfManager.CreateFile(runs.back().fileName.c_str()), QL_RELS_SCAN_FAIL);
+    QL_Try(pfManager.OpenFile(runs.back().fileName.c_str(), writeFH), QL_RELS_SCAN_FAIL);
+    writing = true;
+    writeData = nullptr;
+    writePos = PF_PAGE_SIZE;
+}
+
+void QL_Sorter::WriteTuple(const char *tuple)
+{
+    for (int done = 0; done < tupleLength;)
+    {
+        if (writePos == PF_PAGE_SIZE)
+        {
+            if (writeData)
+            {
+                PageNum pageNum;
+                QL_Try(writePage.GetPageNum(pageNum), QL_RELS_SCAN_FAIL);
+                QL_Try(writeFH.MarkDirty(pageNum), QL_RELS_SCAN_FAIL);
+                QL_Try(writeFH.UnpinPage(pageNum), QL_RELS_SCAN_FAIL);
+                writeData = nullptr;
+            }
+            QL_Try(writeFH.AllocatePage(writePage), QL_RELS_SCAN_FAIL);
+            QL_Try(writePage.GetData(writeData), QL_RELS_SCAN_FAIL);
+            writePos = 0;
+        }
+        int n = min(tupleLength - done, PF_PAGE_SIZE - writePos);
+        memcpy(writeData + writePos, tuple + done, n);
+        writePos += n;
+        done += n;
+    }
+}
+
+void QL_Sorter::EndRun(int tupleNum)
+{
+    writing = false;
+    if (writeData)
+    {
+        PageNum pageNum;
+        QL_Try(writePage.GetPageNum(pageNum), QL_RELS_SCAN_FAIL);
+        QL_Try(writeFH.MarkDirty(pageNum), QL_RELS_SCAN_FAIL);
+        QL_Try(writeFH.UnpinPage(pageNum), QL_RELS_SCAN_FAIL);
+        writeData = nullptr;
+    }
+    QL_Try(pfManager.CloseFile(writeFH), QL_RELS_SCAN_FAIL);
+    runs.back().tupleNum = tupleNum;
+}
+
+void QL_Sorter::MergeRuns(int count)
+{
+    OpenReaders(count);
+    BeginRun();
+    int tupleNum = 0;
+    while (!heap.empty())
+    {
+        int r = PopHeap();
+        WriteTuple(readers[r].tuple.data());
+        ++tupleNum;
+        if (ReadTuple(readers[r]))
+            PushHeap(r);
+    }
+    EndRun(tupleNum);
+    CloseReaders();
+
+    for (int i = 0; i < count; ++i)
+        QL_Try(pfManager.DestroyFile(runs[i].fileName.c_str()), QL_RELS_SCAN_FAIL);
+    runs.erase(runs.begin(), runs.begin() + count);
+}
+
+void QL_Sorter::OpenReaders(int count)
+{
+    CloseReaders();
+    readers.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        RunReader &reader = readers[i];
+        reader.pageNum = -1;
+        reader.pageData = nullptr;
+        reader.pos = PF_PAGE_SIZE;
+        reader.tupleRem = runs[i].tupleNum;
+        reader.tuple.resize(tupleLength);
+        QL_Try(pfManager.OpenFile(runs[i].fileName.c_str(), reader.fileHandle), QL_RELS_SCAN_FAIL);
+        reader.open = true;
+        if (ReadTuple(reader))
+            PushHeap(i);
+    }
+}
+
+// Read the next tuple of the run into [reader.tuple], return false if there's no more
+bool QL_Sorter::ReadTuple(RunReader &reader)
+{
+    if (reader.tupleRem == 0)
+    {
+        if (reader.pageData)
+        {
+            QL_Try(reader.fileHandle.UnpinPage(reader.pageNum), QL_RELS_SCAN_FAIL);
+            reader.pageData = nullptr;
+        }
+        return false;
+    }
+
+    // The pages of a run are allocated in order from 0
+    for (int done = 0; done < tupleLength;)
+    {
+        if (reader.pos == PF_PAGE_SIZE)
+        {
+            if (reader.pageData)
+            {
+                QL_Try(reader.fileHandle.UnpinPage(reader.pageNum), QL_RELS_SCAN_FAIL);
+                reader.pageData = nullptr;
+            }
+            PF_PageHandle pageHandle;
+            QL_Try(reader.fileHandle.GetThisPage(reader.pageNum + 1, pageHandle), QL_RELS_SCAN_FAIL);
+            QL_Try(pageHandle.GetData(reader.pageData), QL_RELS_SCAN_FAIL);
+            ++reader.pageNum;
+            reader.pos = 0;
+        }
+        int n = min(tupleLength - done, PF_PAGE_SIZE - reader.pos);
+        memcpy(reader.tuple.data() + done, reader.pageData + reader.pos, n);
+        reader.pos += n;
+        done += n;
+    }
+    --reader.tupleRem;
+    return true;
+}
+
+void QL_Sorter::CloseReaders()
+{
+    for (RunReader &reader : readers)
+    {
+        if (reader.pageData)
+            QL_Try(reader.fileHandle.UnpinPage(reader.pageNum), QL_RELS_SCAN_FAIL);
+        if (reader.open)
+            QL_Try(pfManager.CloseFile(reader.fileHandle), QL_RELS_SCAN_FAIL);
+    }
+    readers.clear();
+    heap.clear();
+}
+
+// [heap] is a min-heap, so the comparison is reversed
+void QL_Sorter::PushHeap(int reader)
+{
+    heap.push_back(reader);
+    push_heap(heap.begin(), heap.end(), [this](int x, int y) { return Compare(readers[x].tuple.data(), readers[y].tuple.data()) > 0; });
+}
+
+int QL_Sorter::PopHeap()
+{
+    pop_heap(heap.begin(), heap.end(), [this](int x, int y) { return Compare(readers[x].tuple.data(), readers[y].tuple.data()) > 0; });
+    int reader = heap.back();
+    heap.pop_back();
+    return reader;
+}
+
+/************ QL_SortOp ************/
+
+static vector<DataAttrInfo> AttrsAt(const QL_Op *op, const vector<int> &indexes)
+{
+    vector<DataAttrInfo> result;
+    for (int i : indexes)
+        result.push_back(op->attrs[i]);
+    return result;
+}
+
+QL_SortOp::QL_SortOp(PF_Manager &pfm, QL_Op *child, const vector<int> &keyAttrs)
+    : child(child), keyAttrs(keyAttrs), sorter(pfm, child->tupleLength, AttrsAt(child, keyAttrs))
+{
+    tupleLength = child->tupleLength;
+    attrs = child->attrs;
+    cardinality = child->cardinality;
+}
+
+QL_SortOp::~QL_SortOp()
+{
+    delete child;
+}
+
+void QL_SortOp::Open()
+{
+    sorter.Clear();
+    vector<char> tuple(tupleLength);
+    child->Open();
+    while (child->GetNext(tuple.data()) != QL_EOF)
+        sorter.Insert(tuple.data());
+    child->Close();
+    sorter.Sort();
+}
+
+RC QL_SortOp::GetNext(char *tuple)
+{
+    return sorter.GetNext(tuple);
+}
+
+void QL_SortOp::Close()
+{
+    sorter.Clear();
+}
+
+void QL_SortOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "Sort(";
+    for (int i = 0; i < (int)keyAttrs.size(); ++i)
+        c << (i ? ", " : "") << attrs[keyAttrs[i]].relName << "." << attrs[keyAttrs[i]].attrName;
+    c << ")\n";
+    child->Print(c, depth + 1);
+}
+
+/************ QL_SortMergeJoinOp ************/
+
+QL_SortMergeJoinOp::QL_SortMergeJoinOp(SM_Manager &smm, PF_Manager &pfm, QL_Op *left, QL_Op *right, const Condition &cond)
+    : cond(cond), leftValid(false), rightValid(false), groupNum(0), groupPos(0)
+{
+    tupleLength = left->tupleLength + right->tupleLength;
+    cardinality = left->cardinality * right->cardinality * QL_Selectivity(smm, cond);
+    attrs = left->attrs;
+    for (DataAttrInfo attr : right->attrs)
+    {
+        attr.offset += left->tupleLength;
+        attrs.push_back(attr);
+    }
+
+    // Find the key on both sides
+    int leftIndex = left->IndexOfAttr(cond.lhsAttr);
+    int rightIndex = right->IndexOfAttr(cond.rhsAttr);
+    if (leftIndex == -1 || rightIndex == -1)
+    {
+        leftIndex = left->IndexOfAttr(cond.rhsAttr);
+        rightIndex = right->IndexOfAttr(cond.lhsAttr);
+    }
+    if (leftIndex == -1 || rightIndex == -1)
+    {
+        delete left;
+        delete right;
+        throw QL_ATTR_OF_NO_REL;
+    }
+    leftKey = left->attrs[leftIndex];
+    rightKey = right->attrs[rightIndex];
+
+    this->left = new QL_SortOp(pfm, left, vector<int>{leftIndex});
+    this->right = new QL_SortOp(pfm, right, vector<int>{rightIndex});
+    leftTuple.resize(left->tupleLength);
+    rightTuple.resize(right->tupleLength);
+}
+
+QL_SortMergeJoinOp::~QL_SortMergeJoinOp()
+{
+    delete left;
+    delete right;
+}
+
+void QL_SortMergeJoinOp::Open()
+{
+    left->Open();
+    right->Open();
+    leftValid = left->GetNext(leftTuple.data()) != QL_EOF;
+    rightValid = right->GetNext(rightTuple.data()) != QL_EOF;
+    group.clear();
+    groupNum = 0;
+    groupPos = 0;
+}
+
+RC QL_SortMergeJoinOp::GetNext(char *tuple)
+{
+    while (leftValid)
+    {
+        const char *key = leftTuple.data() + leftKey.offset;
+
+        // Join the left tuple with the group of its key
+        if (groupNum && QL_Compare(leftKey.attrType, key, leftKey.attrLength, group.data() + rightKey.offset, rightKey.attrLength) == 0)
+        {
+            if (groupPos < groupNum)
+            {
+                memcpy(tuple, leftTuple.data(), left->tupleLength);
+                memcpy(tuple + left->tupleLength, group.data() + groupPos * right->tupleLength, right->tupleLength);
+                ++groupPos;
+                return OK_RC;
+            }
+            leftValid = left->GetNext(leftTuple.data()) != QL_EOF;
+            groupPos = 0;
+            continue;
+        }
+
+        // Skip the right tuples with smaller keys
+        group.clear();
+        groupNum = 0;
+        groupPos = 0;
+        int c = -1;
+        while (rightValid && (c = QL_Compare(leftKey.attrType, key, leftKey.attrLength, rightTuple.data() + rightKey.offset, rightKey.attrLength)) > 0)
+            rightValid = right->GetNext(rightTuple.data()) != QL_EOF;
+        if (!rightValid)
+            return QL_EOF;
+
+        // Skip the left tuple if no right tuple matches, or collect the group of its key
+        if (c < 0)
+        {
+            leftValid = left->GetNext(leftTuple.data()) != QL_EOF;
+            continue;
+        }
+        while (rightValid && QL_Compare(leftKey.attrType, key, leftKey.attrLength, rightTuple.data() + rightKey.offset, rightKey.attrLength) == 0)
+        {
+            group.insert(group.end(), rightTuple.begin(), rightTuple.end());
+            ++groupNum;
+            rightValid = right->GetNext(rightTuple.data()) != QL_EOF;
+        }
+    }
+    return QL_EOF;
+}
+
+void QL_SortMergeJoinOp::Close()
+{
+    group.clear();
+    left->Close();
+    right->Close();
+}
+
+void QL_SortMergeJoinOp::Print(ostream &c, int depth) const
+{
+    PrintIndent(c, depth);
+    c << "SortMergeJoin(";
+    QL_PrintCondition(c, cond);
+    c << ")\n";
+    left->Print(c, depth + 1);
+    right->Print(c, depth + 1);
+}
@@ -31,6 +31,8 @@
 // RM_Record: RM Record interface
 //
 // When you set the viable true, you have to give data.
+// A record got by RM_FileScan doesn't own its data, but points into the page pinned by the scan,
+// so it's valid until the next GetNextRec() or CloseScan(); copy it to keep it longer.
 class RM_Record
 {
     friend class RM_FileHandle;
@@ -53,6 +55,7 @@ private:
     char *pData;  // Data in the record
     RID rid;      // RID of the record
     bool viable;  // Viability flag
+    bool owned;   // Whether pData is allocated by the record, or points into a pinned page
     int dataSize; // Data size
 
     // Release pData if viable
@@ -87,6 +90,10 @@ public:
     // from the buffer pool to disk.  Default value forces all pages.
     RC ForcePages(PageNum pageNum = ALL_PAGES);
 
+    // The number of records and data pages in the file
+    SlotNum GetRecordNum() const;
+    PageNum GetPageNum() const;
+
 private:
     PF_FileHandle pFFileHandle; // PF file handle
     bool open;                  // File handle open flag
@@ -98,9 +105,19 @@ private:
     std::vector<char> pageAvailable; // The list of available pages
     // Here, we use 1 to represent availability
     // which is opposite to the bitmap of slot
+    // The list goes on in FSM pages once the header page is full
+
+    std::vector<PageNum> freePages; // Every available page, the next one to insert into on top
+    std::vector<bool> fsmModified;  // Modified flag for every FSM page, the header page first
 
     bool headerModified; // Modified flag for the file header
 
+    // Where a data page or an FSM page is in the PF file,
+    // and which FSM page holds the bit of a data page
+    PageNum DataPage(PageNum pageNum) const;
+    static PageNum FSMPage(PageNum fsmNum);
+    static PageNum FSMNum(PageNum pageNum);
+
     // Information that needs calculation
     SlotNum slotNumPerPage;
 };
@@ -108,12 +125,17 @@ private:
 //
 // RM_FileScan: condition-based scan of records in the file
 //
+//
+// A page is pinned once and its slots are walked by the bitmap,
+// then it's unpinned when the scan moves to the next page.
 class RM_FileScan
 {
 public:
     RM_FileScan();
     ~RM_FileScan();
     // Copy of File Scan is weird, so here are no copy construction and overloaded =
+    RM_FileScan(const RM_FileScan &) = delete;
+    RM_FileScan &operator=(const RM_FileScan &) = delete;
 
     RC OpenScan(const RM_FileHandle &fileHandle,
                 AttrType attrType,
@@ -126,7 +148,7 @@ public:
     RC CloseScan();                            // Close the scan
 
 private:
-    RM_FileHandle rMFileHandle;
+    const RM_FileHandle *rMFileHandle;
     AttrType attrType;
     int attrLength;
     int attrOffset;
@@ -137,6 +159,12 @@ private:
 
     PageNum curPageNum;
     SlotNum curSlotNum;
+    PF_PageHandle pageHandle; // Handle of the current page
+    char *pageData;           // Data of the current page
+    bool pinned;              // Whether the current page is pinned
+
+    // Whether the record satisfies the condition of the scan
+    bool Satisfies(char *recData) const;
 };
 
 //
@@ -152,7 +180,9 @@ public:
 
     RC CreateFile(const char *fileName, int recordSize);
     RC DestroyFile(const char *fileName);
-    RC OpenFile(const char *fileName, RM_FileHandle &fileHandle);
+    // readOnly promises no record is changed through fileHandle, which
+    // lets the PF layer map the file
+    RC OpenFile(const char *fileName, RM_FileHandle &fileHandle, bool readOnly = false);
     RC CloseFile(RM_FileHandle &fileHandle);
 
 private:
@@ -0,0 +1,119 @@
+//
+// File:        rm_bench.cc
+// Description: Microbenchmark of the per-record paths of RM
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "purplebase.h"
+#include "pf.h"
+#include "rm.h"
+#include "util_internal.h"
+
+using namespace std;
+
+#define RM_BENCH_FILE "rm_bench.tmp"
+#define RM_BENCH_RECORD_SIZE 16
+
+// The nanoseconds per record of [n] records since [start]
+static double NanosPerRecord(chrono::steady_clock::time_point start, long long n)
+{
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return n ? elapsed.count() / n : 0;
+}
+
+//
+// main
+//
+/* Steps:
+    1) Insert [records] records into a temporary RM file
+    2) Scan them all by RM_FileScan, with and without a condition
+    3) Get every record by RID, then every slot of a half-deleted file,
+       where an empty slot returns RM_FILE_GET_NOT_FOUND
+    4) Print the nanoseconds per record of every step, and destroy the file
+*/
+int main(int argc, char *argv[])
+{
+    long long records = argc > 1 ? atoll(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (argc > 3 || records <= 0 || rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [records] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    PF_Manager pfm;
+    RM_Manager rmm(pfm);
+    RM_FileHandle fileHandle;
+    unlink(RM_BENCH_FILE);
+    Try_RM(rmm.CreateFile(RM_BENCH_FILE, RM_BENCH_RECORD_SIZE));
+    Try_RM(rmm.OpenFile(RM_BENCH_FILE, fileHandle));
+
+    // 1) Insert
+    char data[RM_BENCH_RECORD_SIZE];
+    vector<RID> rids(records);
+    auto start = chrono::steady_clock::now();
+    for (long long i = 0; i < records; ++i)
+    {
+        memset(data, 0, sizeof(data));
+        *(int *)data = (int)i;
+        Try_RM(fileHandle.InsertRec(data, rids[i]));
+    }
+    printf("InsertRec:              %8.1f ns/record\n", NanosPerRecord(start, records));
+
+    // 2) Scan
+    RM_FileScan fileScan;
+    RM_Record rec;
+    long long count = 0;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        Try_RM(fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr));
+        for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF; ++count)
+            Try_RM(rc);
+        Try_RM(fileScan.CloseScan());
+    }
+    printf("GetNextRec:             %8.1f ns/record\n", NanosPerRecord(start, count));
+
+    int half = (int)(records / 2);
+    count = 0;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        Try_RM(fileScan.OpenScan(fileHandle, INT, 4, 0, LT_OP, &half));
+        for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF;)
+            Try_RM(rc);
+        Try_RM(fileScan.CloseScan());
+        count += records;
+    }
+    printf("GetNextRec (a < n/2):   %8.1f ns/record\n", NanosPerRecord(start, count));
+
+    // 3) Get by RID
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (long long i = 0; i < records; ++i)
+            Try_RM(fileHandle.GetRec(rids[i], rec));
+    printf("GetRec:                 %8.1f ns/record\n", NanosPerRecord(start, records * rounds));
+
+    for (long long i = 0; i < records; i += 2)
+        Try_RM(fileHandle.DeleteRec(rids[i]));
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (long long i = 0; i < records; ++i)
+        {
+            RC rc = fileHandle.GetRec(rids[i], rec);
+            if (rc != RM_FILE_GET_NOT_FOUND)
+                Try_RM(rc);
+        }
+    printf("GetRec (half deleted):  %8.1f ns/record\n", NanosPerRecord(start, records * rounds));
+
+    // 4) Clean up
+    Try_RM(rmm.CloseFile(fileHandle));
+    Try_RM(rmm.DestroyFile(RM_BENCH_FILE));
+    return 0;
+}
@@ -29,6 +29,8 @@ RM_FileHandle::RM_FileHandle(const RM_FileHandle &fileHandle) : open(fileHandle.
         recordTot = fileHandle.recordTot;
         pageTot = fileHandle.pageTot;
         pageAvailable = fileHandle.pageAvailable;
+        freePages = fileHandle.freePages;
+        fsmModified = fileHandle.fsmModified;
         headerModified = fileHandle.headerModified;
         slotNumPerPage = fileHandle.slotNumPerPage;
     }
@@ -43,54 +45,41 @@ RM_FileHandle::RM_FileHandle(const RM_FileHandle &fileHandle) : open(fileHandle.
 // Ret:     RM return code
 RC RM_FileHandle::GetRec(const RID &rid, RM_Record &rec) const
 {
-    try
-    {
-        if (!open)
-            throw RC{RM_FILE_HANDLE_CLOSED};
-
-        // First, we need to extract information of pages and slots from rid.
-        PageNum pageNum;
-        SlotNum slotNum;
-        RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_GET_FAIL);
-        RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_GET_FAIL);
-        if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
-            throw RC{RM_FILE_GET_ILLEGAL_RID};
-
-#ifdef RM_LOG
-            // printf("To get record at RID(%lld, %d)\n", pageNum, slotNum);
-#endif
-
-        // Fetch the data of the destination page
-        PF_PageHandle pFPageHandle;
-        char *pageData;
-        RM_ChangeRC(pFFileHandle.GetThisPage(pageNum + 1, pFPageHandle), RM_FILE_GET_FAIL);
-        RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_GET_FAIL_UNPIN_FAIL, RM_FILE_GET_FAIL, pFFileHandle, pageNum + 1);
-        if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
-        {
-            RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_GET_NOT_FOUND_UNPIN_FAIL);
-            throw RC{RM_FILE_GET_NOT_FOUND};
-        }
-
-        rec.releaseData();
-        rec.pData = new char[recordSize];
-        rec.rid = rid;
-        rec.viable = true;
-        rec.dataSize = recordSize;
-        memcpy(rec.pData, pageData + (slotNumPerPage + 7) / 8 + slotNum * recordSize, recordSize);
-
-#ifdef RM_LOG
-        // printf("Get: ");
-        // for (int i = 0; i < recordSize; ++i) putchar(rec.pData[i]);
-        // printf(", num = %d\n", *(int *)(rec.pData + 32));
-#endif
-
-        RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_GET_BUT_UNPIN_FAIL);
-        throw RC{OK_RC};
-    }
-    catch (RC rc)
-    {
+    RC rc;
+    if (!open)
+        return RM_FILE_HANDLE_CLOSED;
+
+    // First, we need to extract information of pages and slots from rid.
+    PageNum pageNum;
+    SlotNum slotNum;
+    if ((rc = RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_GET_FAIL)) ||
+        (rc = RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_GET_FAIL)))
+        return rc;
+    if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
+        return RM_FILE_GET_ILLEGAL_RID;
+
+    // Fetch the data of the destination page
+    PF_PageHandle pFPageHandle;
+    char *pageData;
+    if ((rc = RM_ChangeRC(pFFileHandle.GetThisPage(DataPage(pageNum), pFPageHandle), RM_FILE_GET_FAIL)) ||
+        (rc = RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_GET_FAIL_UNPIN_FAIL, RM_FILE_GET_FAIL, pFFileHandle, DataPage(pageNum))))
         return rc;
+    if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
+    {
+        if ((rc = RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_GET_NOT_FOUND_UNPIN_FAIL)))
+            return rc;
+        return RM_FILE_GET_NOT_FOUND;
     }
+
+    rec.releaseData();
+    rec.pData = new char[recordSize];
+    rec.rid = rid;
+    rec.viable = true;
+    rec.owned = true;
+    rec.dataSize = recordSize;
+    memcpy(rec.pData, pageData + (slotNumPerPage + 7) / 8 + slotNum * recordSize, recordSize);
+
+    return RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_GET_BUT_UNPIN_FAIL);
 }
 
 //
@@ -103,174 +92,112 @@ RC RM_FileHandle::GetRec(const RID &rid, RM_Record &rec) const
 // In:      A fragment of data which needs recording
 // Out:     A RID
 // Ret:     RM return code
+/* Steps:
+    1) Take the available page on top of [freePages], if any
+    2) Otherwise allocate a new page, and an FSM page in front of it
+       if its bit doesn't fit in the last one
+    3) Insert into the first empty slot,
+       and take the page off [freePages] if it becomes full
+*/
 RC RM_FileHandle::InsertRec(const char *pData, RID &rid)
 {
-    try
-    {
-#ifdef RM_LOG
-        // puts("----- Try insert ------");
-#endif
-
-        // Check if open, which is a general enter condition of all functions
-        if (!open)
-            throw RC{RM_FILE_HANDLE_CLOSED};
-
-#ifdef RM_LOG
-            // printf("Insert: ");
-            // for (int i = 0; i < 50; ++i)
-            // {
-            //     printf("%d: %c\n", i, pData[i]);
-            // }
-            // puts("");
-#endif
-
-        // Declare three variables that will be used often later.
-        PF_PageHandle pFPageHandle;
-        char *pageData;
-        PageNum pageNum;
-        vector<char>::iterator pageAvailableIterator;
-
-        // The actual insertion step
-        auto insertAt = [this, &pageNum, &pData, &rid, &pageData, &pageAvailableIterator](SlotNum slotNum) {
-#ifdef RM_LOG
-        // printf("insert at (%lld, %d)\n", pageNum, slotNum);
-#endif
-            // The exactly RID is found.
-            rid = RID(pageNum, slotNum);
-
-            // Actually insert the data into the available old page.
-            pageData[slotNum / 8] |= 1 << slotNum % 8;
-            memcpy(pageData + (slotNumPerPage + 7) / 8 + recordSize * slotNum, pData, recordSize);
-
-            // If this insertion make a page unavailable, we need update the information of heade page
-            if ([pageData, this]() {
-                    for (SlotNum slotNumIt = 0; slotNumIt < slotNumPerPage; ++slotNumIt)
-                        if (~pageData[slotNumIt / 8] >> slotNumIt % 8 & 1)
-                            return 0;
-                    return 1;
-                }())
-            {
-#ifdef RM_LOG
-                // printf("Page %lld is not available now.\n", pageNum);
-#endif
-
-                *pageAvailableIterator = *pageAvailableIterator & ~(1 << pageNum % 8);
-
-#ifdef RM_LOG
-                // printf("Now, pageAvailableIterator = ");
-                // for (int i = 0; i < 8; ++i)
-                //     putchar('0' ^ (*pageAvailableIterator >> i & 1));
-                // puts("");
-#endif
-            }
-            ++recordTot;
-            headerModified = true;
-
-            // Unpin the page after insertion
-            RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_ERROR_FILE_INSERT_BUT_UNPIN_FAIL);
-
-            throw RC{OK_RC};
-        };
-
-        // Firstly, we try to find if there's an available slot in existing old pages.
-        pageNum = 0;
-        for (pageAvailableIterator = pageAvailable.begin(); pageNum < pageTot; pageNum += 8, ++pageAvailableIterator)
-            if (*pageAvailableIterator)
-            {
-                while (~*pageAvailableIterator >> pageNum % 8 & 1)
-                    ++pageNum;
-                // Because the page that we have not created is marked as available
-                // So here's a special check.
-                if (pageNum == pageTot)
-                    break;
-                    // I've managed to find an available page!
-
-#ifdef RM_LOG
-                    // printf("Try to get page %lld\n", pageNum);
-#endif
-
-                // Get the available page.
-                RM_ChangeRC(pFFileHandle.GetThisPage(pageNum + 1, pFPageHandle), RM_FILE_INSERT_OLD_FAIL);
-
-#ifdef RM_LOG
-                // printf("Got page %lld\n", pageNum);
-#endif
-
-                // Get data from the availabe page.
-                RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, pageNum + 1);
-
-#ifdef RM_LOG
-                // printf("Got page %lld.\n", pageNum);
-#endif
-
-                // Mark darty before any solid modification
-                RM_TryElseUnpin(pFFileHandle.MarkDirty(pageNum + 1), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, pageNum + 1);
-
-                for (SlotNum slotNum = 0; slotNum < slotNumPerPage; ++slotNum)
-                    // Find an available slot
-                    if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
-                    {
-#ifdef RM_LOG
-                        // puts("Find available old page!");
-#endif
-
-                        insertAt(slotNum);
-                    }
-
-#ifdef RM_LOG
-                    // printf("\nTry to insert (num = %d)\n", *(int *)(pData + 32));
-                    // printf("bitmap of the page (slotNumPerPage = %d): ", slotNumPerPage);
-                    // for (SlotNum slotNum = 0; slotNum < slotNumPerPage; ++slotNum)
-                    //     putchar('0' ^ (pageData[slotNum / 8] >> slotNum % 8 & 1));
-                    // puts("");
-#endif
-
-                throw RC{RM_FILE_INSERT_NO_AVAILABLE_SLOT_IN_AVAILABLE_PAGES};
-            }
-
-#ifdef RM_LOG
-            // printf("No, we have to insert a new page at %lld\n", pageTot);
-            // printf("At this time, num = %d\n", *(int *)(pData + 32));
-#endif
-
-        // If there's no available page.
-        pageNum = pageTot;
-
-        // Allocate a new page, and get data from it!
-        RM_ChangeRC(pFFileHandle.AllocatePage(pFPageHandle), RM_FILE_INSERT_NEW_PAGE_FAIL);
-        RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_INSERT_NEW_FAIL_UNPIN_FAIL, RM_FILE_INSERT_NEW_PAGE_FAIL, pFFileHandle, pageNum);
-        RM_TryElseUnpin(pFFileHandle.MarkDirty(pageNum + 1), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, pageNum + 1);
-
-#ifdef RM_LOG
-        // puts("A new page is allocated.");
-#endif
-
-        // Update the information of header page
-        headerModified = true;
-        if (pageTot++ % 8 == 0)
+    RC rc;
+
+    // Check if open, which is a general enter condition of all functions
+    if (!open)
+        return RM_FILE_HANDLE_CLOSED;
+
+    // Declare three variables that will be used often later.
+    PF_PageHandle pFPageHandle;
+    char *pageData;
+    PageNum pageNum;
+
+    // The actual insertion step
+    auto insertAt = [this, &pageNum, &pData, &rid, &pageData](SlotNum slotNum) -> RC {
+        // The exactly RID is found.
+        rid = RID(pageNum, slotNum);
+
+        // Actually insert the data into the available old page.
+        pageData[slotNum / 8] |= 1 << slotNum % 8;
+        memcpy(pageData + (slotNumPerPage + 7) / 8 + recordSize * slotNum, pData, recordSize);
+
+        // If this insertion make a page unavailable, we need update the information of heade page
+        if ([pageData, this]() {
+                for (SlotNum slotNumIt = 0; slotNumIt < slotNumPerPage; ++slotNumIt)
+                    if (~pageData[slotNumIt / 8] >> slotNumIt % 8 & 1)
+                        return 0;
+                return 1;
+            }())
         {
-            // The page is available after just insertion.
-            pageAvailable.push_back(char(255));
+            pageAvailable[pageNum / 8] &= ~(1 << pageNum % 8);
+            freePages.pop_back();
+            fsmModified[FSMNum(pageNum)] = true;
         }
+        ++recordTot;
+        headerModified = true;
 
-        pageAvailableIterator = --pageAvailable.end();
+        // Unpin the page after insertion
+        return RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_ERROR_FILE_INSERT_BUT_UNPIN_FAIL);
+    };
 
-        // Initialize the bitmap at the head of the page
-        memset(pageData, 0, (slotNumPerPage + 7) / 8);
+    // 1) Firstly, we try to find if there's an available slot in existing old pages.
+    if (!freePages.empty())
+    {
+        pageNum = freePages.back();
 
-#ifdef RM_LOG
-        // puts("Insert to a new page!");
-#endif
+        // Get data from it, and mark dirty before any solid modification
+        if ((rc = RM_ChangeRC(pFFileHandle.GetThisPage(DataPage(pageNum), pFPageHandle), RM_FILE_INSERT_OLD_FAIL)) ||
+            (rc = RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, DataPage(pageNum))) ||
+            (rc = RM_TryElseUnpin(pFFileHandle.MarkDirty(DataPage(pageNum)), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, DataPage(pageNum))))
+            return rc;
 
-        // Insert! Now!
-        insertAt(0);
+        // Find an available slot
+        for (SlotNum slotNum = 0; slotNum < slotNumPerPage; ++slotNum)
+            if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
+                return insertAt(slotNum);
 
-        throw RC{OK_RC};
+        return RM_FILE_INSERT_NO_AVAILABLE_SLOT_IN_AVAILABLE_PAGES;
     }
-    catch (RC rc)
+
+    // 2) If there's no available page.
+    pageNum = pageTot;
+
+    // The first page of a new group needs an empty FSM page in front of it
+    if (FSMNum(pageNum) == (PageNum)fsmModified.size())
     {
+        PF_PageHandle fSMPageHandle;
+        char *fSMPageData;
+        PageNum fSMPageNum = FSMPage(fsmModified.size());
+        if ((rc = RM_ChangeRC(pFFileHandle.AllocatePage(fSMPageHandle), RM_FILE_INSERT_NEW_PAGE_FAIL)) ||
+            (rc = RM_TryElseUnpin(fSMPageHandle.GetData(fSMPageData), RM_FILE_INSERT_NEW_FAIL_UNPIN_FAIL, RM_FILE_INSERT_NEW_PAGE_FAIL, pFFileHandle, fSMPageNum)))
+            return rc;
+        memset(fSMPageData, 0, PF_PAGE_SIZE);
+        if ((rc = RM_ChangeRC(pFFileHandle.UnpinPage(fSMPageNum), RM_FILE_INSERT_NEW_FAIL_UNPIN_FAIL)))
+            return rc;
+        fsmModified.push_back(true);
+    }
+
+    // Allocate a new page, and get data from it!
+    if ((rc = RM_ChangeRC(pFFileHandle.AllocatePage(pFPageHandle), RM_FILE_INSERT_NEW_PAGE_FAIL)) ||
+        (rc = RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_INSERT_NEW_FAIL_UNPIN_FAIL, RM_FILE_INSERT_NEW_PAGE_FAIL, pFFileHandle, DataPage(pageNum))) ||
+        (rc = RM_TryElseUnpin(pFFileHandle.MarkDirty(DataPage(pageNum)), RM_FILE_INSERT_NEW_FAIL_UNPIN_FAIL, RM_FILE_INSERT_NEW_FAIL, pFFileHandle, DataPage(pageNum))))
         return rc;
+
+    // Update the information of header page
+    headerModified = true;
+    if (pageTot++ % 8 == 0)
+    {
+        // The page is available after just insertion.
+        pageAvailable.push_back(char(255));
     }
+    freePages.push_back(pageNum);
+    fsmModified[FSMNum(pageNum)] = true;
+
+    // Initialize the bitmap at the head of the page
+    memset(pageData, 0, (slotNumPerPage + 7) / 8);
+
+    // 3) Insert! Now!
+    return insertAt(0);
 }
 
 //
@@ -283,48 +210,47 @@ RC RM_FileHandle::InsertRec(const char *pData, RID &rid)
 // Ret:     RM return code
 RC RM_FileHandle::DeleteRec(const RID &rid)
 {
-    try
+    RC rc;
+    if (!open)
+        return RM_FILE_HANDLE_CLOSED;
+
+    // First, we need to extract information of pages and slots from rid.
+    PageNum pageNum;
+    SlotNum slotNum;
+    if ((rc = RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_DELETE_FAIL)) ||
+        (rc = RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_DELETE_FAIL)))
+        return rc;
+    if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
+        return RM_FILE_DELETE_ILLEGAL_RID;
+
+    // Fetch the data of the destination page
+    PF_PageHandle pFPageHandle;
+    char *pageData;
+    if ((rc = RM_ChangeRC(pFFileHandle.GetThisPage(DataPage(pageNum), pFPageHandle), RM_FILE_DELETE_FAIL)) ||
+        (rc = RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_DELETE_FAIL_UNPIN_FAIL, RM_FILE_DELETE_FAIL, pFFileHandle, DataPage(pageNum))) ||
+        (rc = RM_TryElseUnpin(pFFileHandle.MarkDirty(DataPage(pageNum)), RM_FILE_DELETE_FAIL_UNPIN_FAIL, RM_FILE_DELETE_FAIL, pFFileHandle, DataPage(pageNum))))
+        return rc;
+    if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
     {
-        if (!open)
-            throw RC{RM_FILE_HANDLE_CLOSED};
-
-        // First, we need to extract information of pages and slots from rid.
-        PageNum pageNum;
-        SlotNum slotNum;
-        RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_DELETE_FAIL);
-        RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_DELETE_FAIL);
-        if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
-            throw RC{RM_FILE_DELETE_ILLEGAL_RID};
-
-        // Fetch the data of the destination page
-        PF_PageHandle pFPageHandle;
-        char *pageData;
-        RM_ChangeRC(pFFileHandle.GetThisPage(pageNum + 1, pFPageHandle), RM_FILE_DELETE_FAIL);
-        RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_DELETE_FAIL_UNPIN_FAIL, RM_FILE_DELETE_FAIL, pFFileHandle, pageNum + 1);
-        RM_TryElseUnpin(pFFileHandle.MarkDirty(pageNum + 1), RM_FILE_INSERT_OLD_FAIL_UNPIN_FAIL, RM_FILE_INSERT_OLD_FAIL, pFFileHandle, pageNum + 1);
-        if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
-        {
-            RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_DELETE_NOT_FOUND_UNPIN_FAIL);
-            throw RC{RM_FILE_DELETE_NOT_FOUND};
-        }
-
-        // Update the header of a page
-        pageData[slotNum / 8] &= ~(1 << slotNum % 8);
-
-        // Update the header page
-        if (~pageAvailable[pageNum / 8] >> pageNum % 8 & 1)
-            pageAvailable[pageNum / 8] |= 1 << pageNum % 8;
-        --recordTot;
-        headerModified = true;
+        if ((rc = RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_DELETE_NOT_FOUND_UNPIN_FAIL)))
+            return rc;
+        return RM_FILE_DELETE_NOT_FOUND;
+    }
 
-        RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_DELETE_BUT_UNPIN_FAIL);
+    // Update the header of a page
+    pageData[slotNum / 8] &= ~(1 << slotNum % 8);
 
-        throw RC{OK_RC};
-    }
-    catch (RC rc)
+    // Update the header page, where a full page becomes available again
+    if (~pageAvailable[pageNum / 8] >> pageNum % 8 & 1)
     {
-        return rc;
+        pageAvailable[pageNum / 8] |= 1 << pageNum % 8;
+        freePages.push_back(pageNum);
+        fsmModified[FSMNum(pageNum)] = true;
     }
+    --recordTot;
+    headerModified = true;
+
+    return RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_DELETE_BUT_UNPIN_FAIL);
 }
 
 //
@@ -335,48 +261,44 @@ RC RM_FileHandle::DeleteRec(const RID &rid)
 // Ret:     RM return code
 RC RM_FileHandle::UpdateRec(const RM_Record &rec)
 {
-    try
+    RC rc;
+    if (!open)
+        return RM_FILE_HANDLE_CLOSED;
+    if (rec.dataSize != recordSize)
+        return RM_FILE_UPDATE_SIZE_NEQ;
+
+    // Parse rec
+    char *recData;
+    RID rid;
+    PageNum pageNum;
+    SlotNum slotNum;
+    if ((rc = RM_ChangeRC(rec.GetRid(rid), RM_FILE_UPDATE_FAIL)) ||
+        (rc = RM_ChangeRC(rec.GetData(recData), RM_FILE_UPDATE_FAIL)) ||
+        (rc = RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_UPDATE_FAIL)) ||
+        (rc = RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_UPDATE_FAIL)))
+        return rc;
+    if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
+        return RM_FILE_UPDATE_ILLEGAL_RID;
+
+    // Get data from the page
+    PF_PageHandle pFPageHandle;
+    char *pageData;
+    if ((rc = RM_ChangeRC(pFFileHandle.GetThisPage(DataPage(pageNum), pFPageHandle), RM_FILE_UPDATE_FAIL)) ||
+        (rc = RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_UPDATE_FAIL_UNPIN_FAIL, RM_FILE_UPDATE_FAIL, pFFileHandle, DataPage(pageNum))) ||
+        (rc = RM_TryElseUnpin(pFFileHandle.MarkDirty(DataPage(pageNum)), RM_FILE_UPDATE_FAIL_UNPIN_FAIL, RM_FILE_UPDATE_FAIL, pFFileHandle, DataPage(pageNum))))
+        return rc;
+    if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
     {
-        if (!open)
-            throw RC{RM_FILE_HANDLE_CLOSED};
-        if (rec.dataSize != recordSize)
-            throw RC{RM_FILE_UPDATE_SIZE_NEQ};
-
-        // Parse rec
-        char *recData;
-        RID rid;
-        PageNum pageNum;
-        SlotNum slotNum;
-        RM_ChangeRC(rec.GetRid(rid), RM_FILE_UPDATE_FAIL);
-        RM_ChangeRC(rec.GetData(recData), RM_FILE_UPDATE_FAIL);
-        RM_ChangeRC(rid.GetPageNum(pageNum), RM_FILE_UPDATE_FAIL);
-        RM_ChangeRC(rid.GetSlotNum(slotNum), RM_FILE_UPDATE_FAIL);
-        if (pageNum < 0 || pageNum >= pageTot || slotNum < 0 || slotNum >= slotNumPerPage)
-            throw RC{RM_FILE_UPDATE_ILLEGAL_RID};
-
-        // Get data from the page
-        PF_PageHandle pFPageHandle;
-        char *pageData;
-        RM_ChangeRC(pFFileHandle.GetThisPage(pageNum + 1, pFPageHandle), RM_FILE_UPDATE_FAIL);
-        RM_TryElseUnpin(pFPageHandle.GetData(pageData), RM_FILE_UPDATE_FAIL_UNPIN_FAIL, RM_FILE_UPDATE_FAIL, pFFileHandle, pageNum + 1);
-        RM_TryElseUnpin(pFFileHandle.MarkDirty(pageNum + 1), RM_FILE_UPDATE_FAIL_UNPIN_FAIL, RM_FILE_UPDATE_FAIL, pFFileHandle, pageNum + 1);
-        if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
-        {
-            RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_UPDATE_NOT_FOUND_UNPIN_FAIL);
-            throw RC{RM_FILE_UPDATE_NOT_FOUND};
-        }
+        if ((rc = RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_UPDATE_NOT_FOUND_UNPIN_FAIL)))
+            return rc;
+        return RM_FILE_UPDATE_NOT_FOUND;
+    }
 
-        // Update
-        memcpy(pageData + (slotNumPerPage + 7) / 8 + slotNum * recordSize, recData, recordSize);
+    // Update, where the record may be a view of this very page got by RM_FileScan
+    memmove(pageData + (slotNumPerPage + 7) / 8 + slotNum * recordSize, recData, recordSize);
 
-        // Unpin and finish
-        RM_ChangeRC(pFFileHandle.UnpinPage(pageNum + 1), RM_FILE_UPDATE_BUT_UNPIN_FAIL);
-        throw RC{OK_RC};
-    }
-    catch (RC rc)
-    {
-        return rc;
-    }
+    // Unpin and finish
+    return RM_ChangeRC(pFFileHandle.UnpinPage(DataPage(pageNum)), RM_FILE_UPDATE_BUT_UNPIN_FAIL);
 }
 
 //
@@ -388,17 +310,67 @@ RC RM_FileHandle::UpdateRec(const RM_Record &rec)
 // Ret:         RM return code
 RC RM_FileHandle::ForcePages(PageNum pageNum)
 {
-    try
-    {
-        if (!open)
-            throw RC{RM_FILE_HANDLE_CLOSED};
+    if (!open)
+        return RM_FILE_HANDLE_CLOSED;
 
-        RM_ChangeRC(pFFileHandle.ForcePages(pageNum), RM_FILE_FORCE_FAIL);
+    return RM_ChangeRC(pFFileHandle.ForcePages(pageNum), RM_FILE_FORCE_FAIL);
+}
 
-        throw RC{OK_RC};
-    }
-    catch (RC rc)
-    {
-        return rc;
-    }
-}
\ No newline at end of file
+//
+// GetRecordNum
+//
+// Desc:        Get the number of records in the file
+// Ret:         The number of records
+// Note:        [recordTot] starts from 1 when the file is created.
+SlotNum RM_FileHandle::GetRecordNum() const
+{
+    return recordTot - 1;
+}
+
+//
+// GetPageNum
+//
+// Desc:        Get the number of data pages in the file, the header page excluded
+// Ret:         The number of pages
+PageNum RM_FileHandle::GetPageNum() const
+{
+    return pageTot;
+}
+
+//
+// DataPage
+//
+// Desc:        Get the number of a data page in the PF file,
+//              skipping the header page and the FSM pages in front of it
+// In:          The number of the data page
+// Ret:         The number of the PF page
+PageNum RM_FileHandle::DataPage(PageNum pageNum) const
+{
+    return pageNum + 1 + FSMNum(pageNum);
+}
+
+//
+// FSMPage
+//
+// Desc:        Get the number of an FSM page in the PF file, 0 for the header page
+// In:          The number of the FSM page
+// Ret:         The number of the PF page
+PageNum RM_FileHandle::FSMPage(PageNum fsmNum)
+{
+    if (fsmNum == 0)
+        return 0;
+    return 1 + RM_HEADER_FSM_PAGES + (fsmNum - 1) * (RM_FSM_PAGES + 1);
+}
+
+//
+// FSMNum
+//
+// Desc:        Get the FSM page which holds the bit of a data page, 0 for the header page
+// In:          The number of the data page
+// Ret:         The number of the FSM page
+PageNum RM_FileHandle::FSMNum(PageNum pageNum)
+{
+    if (pageNum < RM_HEADER_FSM_PAGES)
+        return 0;
+    return (pageNum - RM_HEADER_FSM_PAGES) / RM_FSM_PAGES + 1;
+}
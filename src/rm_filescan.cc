@@ -10,10 +10,15 @@
 using namespace std;
 
 // Constructor
-RM_FileScan::RM_FileScan() : open(false) {}
+RM_FileScan::RM_FileScan() : value(nullptr), open(false), pinned(false) {}
 
 // Destructor
-RM_FileScan::~RM_FileScan() {}
+// A scan abandoned by an exception mustn't leave its page pinned
+RM_FileScan::~RM_FileScan()
+{
+    if (open)
+        CloseScan();
+}
 
 // Open a scan
 RC RM_FileScan::OpenScan(const RM_FileHandle &fileHandle, AttrType attrType, int attrLength, int attrOffset, CompOp compOp, const void *value, ClientHint pinHint)
@@ -25,9 +30,10 @@ RC RM_FileScan::OpenScan(const RM_FileHandle &fileHandle, AttrType attrType, int
     printf("=== OpenScan ===\n");
 #endif
 
-    this->rMFileHandle = fileHandle;
+    this->rMFileHandle = &fileHandle;
     this->attrType = attrType;
-    this->attrLength = attrLength;
+    // A date is compared by its 10 characters
+    this->attrLength = attrType == DATE ? 10 : attrLength;
     this->attrOffset = attrOffset;
     this->compOp = compOp;
 
@@ -55,172 +61,162 @@ RC RM_FileScan::OpenScan(const RM_FileHandle &fileHandle, AttrType attrType, int
     }
 
     open = true;
+    pinned = false;
 
     curPageNum = 0;
     curSlotNum = 0;
 
-#ifdef RM_LOG
-    printf("scanvalue = ");
-    putchar('\n');
-#endif
-
     return OK_RC;
 }
 
-// This is the core of the File Scan
-RC RM_FileScan::GetNextRec(RM_Record &rec)
+// Check the condition of the scan on the record in place
+bool RM_FileScan::Satisfies(char *recData) const
 {
-    try
-    {
-        if (!open)
-            throw RC{RM_SCAN_CLOSED};
-        for (RC tmp_rc;;)
-            switch ((tmp_rc = rMFileHandle.GetRec(RID(curPageNum, curSlotNum), rec)))
-            {
-            case OK_RC:
-#ifdef RM_LOG
-                // printf("Scan find something at (%lld, %d)\n", curPageNum, curSlotNum);
-#endif
-
-                nextSlot(curPageNum, curSlotNum, rMFileHandle.slotNumPerPage);
-
-#ifdef RM_LOG
-                // puts("Gone to next slot!");
-#endif
-
-                // Check if this record is satisfied.
-                if ([this, &rec]() -> bool {
-                        if (compOp == NO_OP)
-                            return true;
+    if (compOp == NO_OP)
+        return true;
 
-                        char *pData;
-                        RM_ChangeRC(rec.GetData(pData), RM_SCAN_NEXT_FAIL);
-
-#ifdef RM_LOG
-                    // printf("pData[1: 50) = \n");
-                    // puts("");
-                    // for (int i = 0; i < 10; ++i)
-                    //     printf("%d: %c\n", i, pData[i]);
-                    // for (int i = 25; i < 35; ++i)
-                    //     printf("%d: %c\n", i, pData[i]);
-                    // puts("");
-#endif
-                        switch (attrType)
-                        {
-                        case INT:
-                        {
-                            int recData = *(int *)(pData + attrOffset), scanData = *(int *)value;
-
-#ifdef RM_LOG
-                        // printf("%d\n", recData);
-#endif
-
-                            switch (compOp)
-                            {
-                            case NO_OP:
-                                return true;
-                            case EQ_OP:
-                                return recData == scanData;
-                            case NE_OP:
-                                return recData != scanData;
-                            case LT_OP:
-                                return recData < scanData;
-                            case GT_OP:
-                                return recData > scanData;
-                            case LE_OP:
-                                return recData <= scanData;
-                            case GE_OP:
-                                return recData >= scanData;
-                            }
-                            break;
-                        }
-                        case FLOAT:
-                        {
-                            float recData = *(float *)(pData + attrOffset), scanData = *(float *)value;
-
-#ifdef RM_LOG
-                        // printf("%f\n", recData);
-#endif
+    switch (attrType)
+    {
+    case INT:
+    {
+        int recValue = *(int *)(recData + attrOffset), scanValue = *(int *)value;
+        switch (compOp)
+        {
+        case EQ_OP:
+            return recValue == scanValue;
+        case NE_OP:
+            return recValue != scanValue;
+        case LT_OP:
+            return recValue < scanValue;
+        case GT_OP:
+            return recValue > scanValue;
+        case LE_OP:
+            return recValue <= scanValue;
+        case GE_OP:
+            return recValue >= scanValue;
+        default:
+            return true;
+        }
+    }
+    case FLOAT:
+    {
+        float recValue = *(float *)(recData + attrOffset), scanValue = *(float *)value;
+        switch (compOp)
+        {
+        case EQ_OP:
+            return recValue == scanValue;
+        case NE_OP:
+            return recValue != scanValue;
+        case LT_OP:
+            return recValue < scanValue;
+        case GT_OP:
+            return recValue > scanValue;
+        case LE_OP:
+            return recValue <= scanValue;
+        case GE_OP:
+            return recValue >= scanValue;
+        default:
+            return true;
+        }
+    }
+    case DATE:
+    case STRING:
+    {
+        int c = strcmp(attrLength, recData + attrOffset, (char *)value);
+        switch (compOp)
+        {
+        case EQ_OP:
+            return c == 0;
+        case NE_OP:
+            return c != 0;
+        case LT_OP:
+            return c < 0;
+        case GT_OP:
+            return c > 0;
+        case LE_OP:
+            return c <= 0;
+        case GE_OP:
+            return c >= 0;
+        default:
+            return true;
+        }
+    }
+    }
+    // The following statement is added to avoid warning,
+    // which is supposed to not reach
+    return false;
+}
 
-                            switch (compOp)
-                            {
-                            case NO_OP:
-                                return true;
-                            case EQ_OP:
-                                return recData == scanData;
-                            case NE_OP:
-                                return recData != scanData;
-                            case LT_OP:
-                                return recData < scanData;
-                            case GT_OP:
-                                return recData > scanData;
-                            case LE_OP:
-                                return recData <= scanData;
-                            case GE_OP:
-                                return recData >= scanData;
-                            }
-                            break;
-                        }
-                        case DATE:
-                            attrLength = 10;
-                        case STRING:
-                        {
-                            char *recData = pData + attrOffset, *scanData = (char *)value;
+//
+// GetNextRec
+//
+// Desc:    Get the next record satisfying the condition.
+//          The record points into the pinned page, see RM_Record.
+// Out:     A record
+// Ret:     RM_EOF after the last record
+/* Steps:
+    1) Pin the current page if it isn't pinned, or return RM_EOF after the last page
+    2) Walk the slot bitmap of the page from the current slot,
+       skipping a byte of empty slots at a time
+    3) Check the condition on every record in place, and return the first satisfying one
+    4) Unpin the page after its last slot, and go on with the next page
+*/
+RC RM_FileScan::GetNextRec(RM_Record &rec)
+{
+    if (!open)
+        return RM_SCAN_CLOSED;
 
-#ifdef RM_LOG
-                        // puts("");
-                        // for (int i = 0; i < 50; ++i)
-                        //     printf("%d: %c\n", i, pData[i]);
-                        // puts("");
-#endif
+    const RM_FileHandle &fileHandle = *rMFileHandle;
+    SlotNum slotNumPerPage = fileHandle.slotNumPerPage;
+    int bitmapSize = (slotNumPerPage + 7) / 8;
+    for (RC rc;;)
+    {
+        if (!pinned)
+        {
+            if (curPageNum >= fileHandle.pageTot)
+                return RM_EOF;
+            if ((rc = fileHandle.pFFileHandle.GetThisPage(fileHandle.DataPage(curPageNum), pageHandle, TRUE)) ||
+                (rc = pageHandle.GetData(pageData)))
+            {
+                PF_PrintError(rc);
+                return RM_SCAN_NEXT_FAIL;
+            }
+            pinned = true;
+            curSlotNum = 0;
+        }
+
+        while (curSlotNum < slotNumPerPage)
+        {
+            SlotNum slotNum = curSlotNum++;
+            if (slotNum % 8 == 0 && pageData[slotNum / 8] == 0)
+            {
+                curSlotNum = slotNum + 8;
+                continue;
+            }
+            if (~pageData[slotNum / 8] >> slotNum % 8 & 1)
+                continue;
 
-                            switch (compOp)
-                            {
-                            case NO_OP:
-                                return true;
-                            case EQ_OP:
-                                return strcmp(attrLength, recData, scanData) == 0;
-                            case NE_OP:
-                                return strcmp(attrLength, recData, scanData) != 0;
-                            case LT_OP:
-                                return strcmp(attrLength, recData, scanData) < 0;
-                            case GT_OP:
-                                return strcmp(attrLength, recData, scanData) > 0;
-                            case LE_OP:
-                                return strcmp(attrLength, recData, scanData) <= 0;
-                            case GE_OP:
-                                return strcmp(attrLength, recData, scanData) >= 0;
-                            }
-                            break;
-                        }
-                        }
-                        // The following statement is added to avoid warning,
-                        // which is supposed to not reach
-                        return false;
-                    }())
-                {
-                    throw RC{OK_RC};
-                }
-                break;
-            case RM_FILE_GET_NOT_FOUND:
-                // There's no record at this rid,
-                // because the record at this slot is deleted.
-                nextSlot(curPageNum, curSlotNum, rMFileHandle.slotNumPerPage);
-                break;
-            case RM_FILE_GET_ILLEGAL_RID:
-                throw RC{RM_EOF};
-                break;
-            default:
-                RM_PrintError(tmp_rc);
-                throw RC{RM_SCAN_NEXT_FAIL};
+            char *recData = pageData + bitmapSize + slotNum * fileHandle.recordSize;
+            if (Satisfies(recData))
+            {
+                rec.releaseData();
+                rec.pData = recData;
+                rec.rid = RID(curPageNum, slotNum);
+                rec.viable = true;
+                rec.owned = false;
+                rec.dataSize = fileHandle.recordSize;
+                return OK_RC;
             }
-        // Even though the following statement won't run
-        // if everything is right. I add it to prevent unnecessary warning.
-        throw RC{OK_RC};
-    }
-    catch (RC rc)
-    {
-        return rc;
+        }
+
+        // Move on to the next page
+        pinned = false;
+        if ((rc = fileHandle.pFFileHandle.UnpinPage(fileHandle.DataPage(curPageNum))))
+        {
+            PF_PrintError(rc);
+            return RM_SCAN_NEXT_FAIL;
+        }
+        ++curPageNum;
     }
 }
 
@@ -232,7 +228,19 @@ RC RM_FileScan::CloseScan()
     if (value != nullptr)
     {
         delete[](char *) value;
+        value = nullptr;
+    }
+
+    if (pinned)
+    {
+        pinned = false;
+        RC rc = rMFileHandle->pFFileHandle.UnpinPage(rMFileHandle->DataPage(curPageNum));
+        if (rc)
+        {
+            PF_PrintError(rc);
+            return RM_SCAN_NEXT_FAIL;
+        }
     }
 
     return OK_RC;
-}
\ No newline at end of file
+}
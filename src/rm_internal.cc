@@ -10,40 +10,29 @@
 // If the first rc is not equal to 0,
 // then print error, and return the next rc.
 //
-void RM_ChangeRC(RC pf_rc, RC rm_rc)
+RC RM_ChangeRC(RC pf_rc, RC rm_rc)
 {
     if (pf_rc)
     {
         PF_PrintError(pf_rc);
-        throw RC{rm_rc};
+        return rm_rc;
     }
+    return OK_RC;
 }
 
 //
 // Try to do something, if fail,
 // then try to unpin some page
 //
-void RM_TryElseUnpin(RC pf_rc, RC unpin_rc, RC rm_rc, const PF_FileHandle &file, const PageNum &pageNum)
+RC RM_TryElseUnpin(RC pf_rc, RC unpin_rc, RC rm_rc, const PF_FileHandle &file, const PageNum &pageNum)
 {
     if (pf_rc)
     {
         PF_PrintError(pf_rc);
-        RM_ChangeRC(file.UnpinPage(pageNum), unpin_rc);
-        throw RC{rm_rc};
+        RC rc = RM_ChangeRC(file.UnpinPage(pageNum), unpin_rc);
+        return rc ? rc : rm_rc;
     }
-}
-
-//
-// Calculate next slot
-// Availibility doesn't count here
-//
-void nextSlot(PageNum &pageNum, SlotNum &slotNum, SlotNum slotNumPerPage) {
-    if (slotNum + 1 == slotNumPerPage) {
-        ++pageNum;
-        slotNum = 0;
-    }
-    else
-        ++slotNum;
+    return OK_RC;
 }
 
 //
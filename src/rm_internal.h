@@ -9,12 +9,19 @@
 
 #include "rm.h"
 
-// Some wrappers for code-convenient
-void RM_ChangeRC(RC pf_rc, RC rm_rc);
-void RM_TryElseUnpin(RC pf_rc, RC unpin_rc, RC rm_rc, const PF_FileHandle &file, const PageNum &pageNum);
+// The free space map (FSM) is the list of available pages, a bit per data page.
+// The bits of the first RM_HEADER_FSM_PAGES data pages follow the header in page 0,
+// and those of every next RM_FSM_PAGES data pages fill an FSM page in front of them.
+const int RM_HEADER_SIZE = sizeof(int) + sizeof(SlotNum) + sizeof(PageNum);
+const PageNum RM_HEADER_FSM_PAGES = (PF_PAGE_SIZE - RM_HEADER_SIZE) * 8;
+const PageNum RM_FSM_PAGES = PF_PAGE_SIZE * 8;
+
+// Some wrappers for code-convenient, which return OK_RC if [pf_rc] is OK_RC.
+// They return rather than throw, since they're on the path of every record.
+RC RM_ChangeRC(RC pf_rc, RC rm_rc);
+RC RM_TryElseUnpin(RC pf_rc, RC unpin_rc, RC rm_rc, const PF_FileHandle &file, const PageNum &pageNum);
 
 // Some functions for convenience
-void nextSlot(PageNum &pageNum, SlotNum &slotNum, SlotNum slotNumPerPage);
 int strcmp(int length, char *s1, char *s2);
 
 #endif
\ No newline at end of file
@@ -14,138 +14,172 @@ RM_Manager::RM_Manager(PF_Manager &pfm): pFManager(pfm) {}
 RM_Manager::~RM_Manager() {}
 
 RC RM_Manager::CreateFile(const char *fileName, int recordSize) {
-    try
-    {
-        // Is my size too large?
-        if (recordSize >= PF_PAGE_SIZE)
-            throw RC{RM_MANAGER_RECORDSIZE_TOO_LARGE};
-        
-        // Create file
-        RM_ChangeRC(pFManager.CreateFile(fileName), RM_MANAGER_CREATE_FAIL);
-
-        // Allocate header page
-        PF_FileHandle pFFileHandle;
-        pFManager.OpenFile(fileName, pFFileHandle);
-        PF_PageHandle headerPage;
-        RM_ChangeRC(pFFileHandle.AllocatePage(headerPage), RM_MANAGER_CREATE_FAIL);
+    RC rc;
 
-        // Write header page
-        char *headerPageData;
-        RM_TryElseUnpin(headerPage.GetData(headerPageData), RM_MANAGER_CREATE_FAIL_UNPIN_FAIL, RM_MANAGER_CREATE_FAIL, pFFileHandle, 0ll);
-        RM_TryElseUnpin(pFFileHandle.MarkDirty(0ll), RM_MANAGER_CREATE_FAIL_UNPIN_FAIL, RM_MANAGER_CREATE_FAIL, pFFileHandle, 0ll);
+    // Is my size too large?
+    if (recordSize >= PF_PAGE_SIZE)
+        return RM_MANAGER_RECORDSIZE_TOO_LARGE;
 
-        // There're four variables to write into the header page.
-        // recordSize is an input argument
-        char *headerPageDataPtr = headerPageData;
-        *(int *)(headerPageDataPtr) = recordSize;
-        // recordTot is equal to 1
-        headerPageDataPtr += sizeof(int);
-        *(SlotNum *)headerPageDataPtr = 1;
-        // pageTot is equal to 0
-        headerPageDataPtr += sizeof(SlotNum);
-        *(PageNum *)headerPageDataPtr = 0ll;
-        // pageAvailable is just empty.
+    // Create file
+    if ((rc = RM_ChangeRC(pFManager.CreateFile(fileName), RM_MANAGER_CREATE_FAIL)))
+        return rc;
 
-        // Header page is written and being unpinned
-        RM_ChangeRC(pFFileHandle.UnpinPage(0ll), RM_MANAGER_CREATE_BUT_UNPIN_FAIL);
-        RM_ChangeRC(pFManager.CloseFile(pFFileHandle), RM_MANAGER_CREATE_BUT_CLOSE_FAIL);
-        throw RC{OK_RC};
-    }
-    catch (RC rc) { return rc; }
+    // Allocate header page
+    PF_FileHandle pFFileHandle;
+    PF_PageHandle headerPage;
+    char *headerPageData;
+    if ((rc = RM_ChangeRC(pFManager.OpenFile(fileName, pFFileHandle), RM_MANAGER_CREATE_FAIL)) ||
+        (rc = RM_ChangeRC(pFFileHandle.AllocatePage(headerPage), RM_MANAGER_CREATE_FAIL)) ||
+        (rc = RM_TryElseUnpin(headerPage.GetData(headerPageData), RM_MANAGER_CREATE_FAIL_UNPIN_FAIL, RM_MANAGER_CREATE_FAIL, pFFileHandle, 0ll)) ||
+        (rc = RM_TryElseUnpin(pFFileHandle.MarkDirty(0ll), RM_MANAGER_CREATE_FAIL_UNPIN_FAIL, RM_MANAGER_CREATE_FAIL, pFFileHandle, 0ll)))
+        return rc;
+
+    // There're four variables to write into the header page.
+    // recordSize is an input argument
+    char *headerPageDataPtr = headerPageData;
+    *(int *)(headerPageDataPtr) = recordSize;
+    // recordTot is equal to 1
+    headerPageDataPtr += sizeof(int);
+    *(SlotNum *)headerPageDataPtr = 1;
+    // pageTot is equal to 0
+    headerPageDataPtr += sizeof(SlotNum);
+    *(PageNum *)headerPageDataPtr = 0ll;
+    // pageAvailable is just empty.
+
+    // Header page is written and being unpinned
+    if ((rc = RM_ChangeRC(pFFileHandle.UnpinPage(0ll), RM_MANAGER_CREATE_BUT_UNPIN_FAIL)))
+        return rc;
+    return RM_ChangeRC(pFManager.CloseFile(pFFileHandle), RM_MANAGER_CREATE_BUT_CLOSE_FAIL);
 }
 
 RC RM_Manager::DestroyFile(const char *fileName) {
-    try {
-        RM_ChangeRC(pFManager.DestroyFile(fileName), RM_MANAGER_DESTROY_FAIL);
-        throw RC{OK_RC};
-    }
-    catch (RC rc) {
+    return RM_ChangeRC(pFManager.DestroyFile(fileName), RM_MANAGER_DESTROY_FAIL);
+}
+
+RC RM_Manager::OpenFile(const char *fileName, RM_FileHandle &fileHandle, bool readOnly) {
+    RC rc;
+
+    // Open PF File
+    if ((rc = RM_ChangeRC(pFManager.OpenFile(fileName, fileHandle.pFFileHandle, readOnly), RM_MANAGER_OPEN_FAIL)))
+        return rc;
+
+    // Read header file
+    PF_PageHandle headerPage;
+    char *headerPageData;
+    if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.GetFirstPage(headerPage), RM_MANAGER_OPEN_FAIL)) ||
+        (rc = RM_TryElseUnpin(headerPage.GetData(headerPageData), RM_MANAGER_OPEN_BUT_UNPIN_FAIL, RM_MANAGER_OPEN_FAIL, fileHandle.pFFileHandle, 0ll)))
+        return rc;
+
+    // Read from data
+    // Similar to the situation of output
+    char *headerPageDataPtr = headerPageData;
+    fileHandle.recordSize = *(int *)headerPageDataPtr;
+    headerPageDataPtr += sizeof(int);
+    fileHandle.recordTot = *(SlotNum *)headerPageDataPtr;
+    headerPageDataPtr += sizeof(SlotNum);
+    fileHandle.pageTot = *(PageNum *)headerPageDataPtr;
+    headerPageDataPtr += sizeof(PageNum);
+    fileHandle.pageAvailable.assign((fileHandle.pageTot + 7) / 8, 0);
+    PageNum headerBytes = min(RM_HEADER_FSM_PAGES / 8, (PageNum)fileHandle.pageAvailable.size());
+    copy(headerPageDataPtr, headerPageDataPtr + headerBytes, fileHandle.pageAvailable.begin());
+
+    // After read, you need to unpin
+    if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(0ll), RM_MANAGER_OPEN_BUT_UNPIN_FAIL)))
         return rc;
+
+    // The rest of the list is in the FSM pages
+    fileHandle.fsmModified.assign(fileHandle.pageTot ? RM_FileHandle::FSMNum(fileHandle.pageTot - 1) + 1 : 1, false);
+    for (PageNum fsmNum = 1, offset = headerBytes; fsmNum < (PageNum)fileHandle.fsmModified.size(); ++fsmNum, offset += RM_FSM_PAGES / 8) {
+        PF_PageHandle fSMPage;
+        char *fSMPageData;
+        PageNum fSMPageNum = RM_FileHandle::FSMPage(fsmNum);
+        PageNum bytes = min(RM_FSM_PAGES / 8, (PageNum)fileHandle.pageAvailable.size() - offset);
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.GetThisPage(fSMPageNum, fSMPage), RM_MANAGER_OPEN_FAIL)) ||
+            (rc = RM_TryElseUnpin(fSMPage.GetData(fSMPageData), RM_MANAGER_OPEN_BUT_UNPIN_FAIL, RM_MANAGER_OPEN_FAIL, fileHandle.pFFileHandle, fSMPageNum)))
+            return rc;
+        copy(fSMPageData, fSMPageData + bytes, fileHandle.pageAvailable.begin() + offset);
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(fSMPageNum), RM_MANAGER_OPEN_BUT_UNPIN_FAIL)))
+            return rc;
     }
+
+    // Stack the available pages, the lowest on top
+    fileHandle.freePages.clear();
+    for (PageNum pageNum = fileHandle.pageTot; pageNum--;)
+        if (fileHandle.pageAvailable[pageNum / 8] >> pageNum % 8 & 1)
+            fileHandle.freePages.push_back(pageNum);
+
+    // Some information needed to be set or calculated
+    fileHandle.open = true;
+    fileHandle.headerModified = false;
+    fileHandle.slotNumPerPage = 1;
+    while((fileHandle.slotNumPerPage + 1) * fileHandle.recordSize + (fileHandle.slotNumPerPage + 1 + 7) / 8 <= PF_PAGE_SIZE)
+        ++fileHandle.slotNumPerPage;
+
+    return OK_RC;
 }
 
-RC RM_Manager::OpenFile(const char *fileName, RM_FileHandle &fileHandle) {
-    try
-    {
-        // Open PF File
-        RM_ChangeRC(pFManager.OpenFile(fileName, fileHandle.pFFileHandle), RM_MANAGER_OPEN_FAIL);
-        
-        // Read header file
+RC RM_Manager::CloseFile(RM_FileHandle &fileHandle) {
+    RC rc;
+
+    // You can't close closed file.
+    if (!fileHandle.open)
+        return RM_MANAGER_CLOSE_CLOSED_FILE;
+
+    // If need, write back header page
+    if (fileHandle.headerModified) {
+        // Get Data
+        // Differently, dirty mark is needed here
         PF_PageHandle headerPage;
         char *headerPageData;
-        RM_ChangeRC(fileHandle.pFFileHandle.GetFirstPage(headerPage), RM_MANAGER_OPEN_FAIL);
-        RM_ChangeRC(headerPage.GetData(headerPageData), RM_MANAGER_OPEN_FAIL);
-        
-        // Read from data
-        // Similar to the situation of output
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.GetFirstPage(headerPage), RM_MANAGER_CLOSE_FAIL)) ||
+            (rc = RM_TryElseUnpin(headerPage.GetData(headerPageData), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, 0ll)) ||
+            (rc = RM_TryElseUnpin(fileHandle.pFFileHandle.MarkDirty(0ll), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, 0ll)))
+            return rc;
+
+        // Write the information into data
         char *headerPageDataPtr = headerPageData;
-        fileHandle.recordSize = *(int *)headerPageDataPtr;
+        *(int *)(headerPageDataPtr) = fileHandle.recordSize;
         headerPageDataPtr += sizeof(int);
-        fileHandle.recordTot = *(SlotNum *)headerPageDataPtr;
+        *(SlotNum *)headerPageDataPtr = fileHandle.recordTot;
         headerPageDataPtr += sizeof(SlotNum);
-        fileHandle.pageTot = *(PageNum *)headerPageDataPtr;
+        *(PageNum *)headerPageDataPtr = fileHandle.pageTot;
         headerPageDataPtr += sizeof(PageNum);
-        fileHandle.pageAvailable.clear();
-        for (PageNum pageID = (fileHandle.pageTot + 7) / 8; pageID--; ++headerPageDataPtr)
-            fileHandle.pageAvailable.push_back(*headerPageDataPtr);
-
-        // After read, you need to unpin
-        RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(0ll), RM_MANAGER_OPEN_BUT_UNPIN_FAIL);
+        PageNum headerBytes = min(RM_HEADER_FSM_PAGES / 8, (PageNum)fileHandle.pageAvailable.size());
+        copy(fileHandle.pageAvailable.begin(), fileHandle.pageAvailable.begin() + headerBytes, headerPageDataPtr);
 
-        // Some information needed to be set or calculated
-        fileHandle.open = true;
-        fileHandle.headerModified = false;
-        fileHandle.slotNumPerPage = 1;
-        while((fileHandle.slotNumPerPage + 1) * fileHandle.recordSize + (fileHandle.slotNumPerPage + 1 + 7) / 8 <= PF_PAGE_SIZE)
-            ++fileHandle.slotNumPerPage;
-
-        throw RC{OK_RC};
+        // Unpin after write
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(0ll), RM_MANAGER_CLOSE_BUT_UNPIN_FAIL)))
+            return rc;
     }
-    catch (RC rc) { return rc; }
-}
 
-RC RM_Manager::CloseFile(RM_FileHandle &fileHandle) {
-    try
-    {
-        // You can't close closed file.
-        if (!fileHandle.open)
-            throw RC{RM_MANAGER_CLOSE_CLOSED_FILE};
-
-        // If need, write back header page
-        if (fileHandle.headerModified) {
-            // Get Data
-            PF_PageHandle headerPage;
-            char *headerPageData;
-            RM_ChangeRC(fileHandle.pFFileHandle.GetFirstPage(headerPage), RM_MANAGER_CLOSE_FAIL);
-            RM_TryElseUnpin(headerPage.GetData(headerPageData), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, 0ll);
-            // Differently, dirty mark is needed here
-            RM_TryElseUnpin(fileHandle.pFFileHandle.MarkDirty(0ll), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, 0ll);
-
-            // Write the information into data
-            char *headerPageDataPtr = headerPageData;
-            *(int *)(headerPageDataPtr) = fileHandle.recordSize;
-            headerPageDataPtr += sizeof(int);
-            *(SlotNum *)headerPageDataPtr = fileHandle.recordTot;
-            headerPageDataPtr += sizeof(SlotNum);
-            *(PageNum *)headerPageDataPtr = fileHandle.pageTot;
-            headerPageDataPtr += sizeof(PageNum);
-            for (char pageID : fileHandle.pageAvailable)
-                *(headerPageDataPtr++) = pageID;
-            
-            // Unpin after write
-            RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(0ll), RM_MANAGER_CLOSE_BUT_UNPIN_FAIL);
-        }
-
-        // Close
-        RM_ChangeRC(pFManager.CloseFile(fileHandle.pFFileHandle), RM_MANAGER_CLOSE_FAIL);
-
-        // Do some destruction
-        // For safety this is necessary
-        fileHandle.open = false;
-        fileHandle.headerModified = false;
-        fileHandle.pageAvailable.clear();
-
-        throw RC{OK_RC};
+    // Write back the modified FSM pages
+    for (PageNum fsmNum = 1, offset = RM_HEADER_FSM_PAGES / 8; fsmNum < (PageNum)fileHandle.fsmModified.size(); ++fsmNum, offset += RM_FSM_PAGES / 8) {
+        if (!fileHandle.fsmModified[fsmNum])
+            continue;
+        PF_PageHandle fSMPage;
+        char *fSMPageData;
+        PageNum fSMPageNum = RM_FileHandle::FSMPage(fsmNum);
+        PageNum bytes = min(RM_FSM_PAGES / 8, (PageNum)fileHandle.pageAvailable.size() - offset);
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.GetThisPage(fSMPageNum, fSMPage), RM_MANAGER_CLOSE_FAIL)) ||
+            (rc = RM_TryElseUnpin(fSMPage.GetData(fSMPageData), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, fSMPageNum)) ||
+            (rc = RM_TryElseUnpin(fileHandle.pFFileHandle.MarkDirty(fSMPageNum), RM_MANAGER_CLOSE_FAIL_UNPIN_FAIL, RM_MANAGER_CLOSE_FAIL, fileHandle.pFFileHandle, fSMPageNum)))
+            return rc;
+        copy(fileHandle.pageAvailable.begin() + offset, fileHandle.pageAvailable.begin() + offset + bytes, fSMPageData);
+        if ((rc = RM_ChangeRC(fileHandle.pFFileHandle.UnpinPage(fSMPageNum), RM_MANAGER_CLOSE_BUT_UNPIN_FAIL)))
+            return rc;
     }
-    catch (RC rc) { return rc; }
-}
\ No newline at end of file
+
+    // Close
+    if ((rc = RM_ChangeRC(pFManager.CloseFile(fileHandle.pFFileHandle), RM_MANAGER_CLOSE_FAIL)))
+        return rc;
+
+    // Do some destruction
+    // For safety this is necessary
+    fileHandle.open = false;
+    fileHandle.headerModified = false;
+    fileHandle.pageAvailable.clear();
+    fileHandle.freePages.clear();
+    fileHandle.fsmModified.clear();
+
+    return OK_RC;
+}
@@ -9,7 +9,7 @@
 #include "rm_rid.h"
 
 // Default constructor
-RM_Record::RM_Record() : viable(false) {}
+RM_Record::RM_Record() : viable(false), owned(false) {}
 
 // Destructor
 RM_Record::~RM_Record()
@@ -19,7 +19,7 @@ RM_Record::~RM_Record()
 }
 
 // Copy constructor
-RM_Record::RM_Record(const RM_Record &rec) : rid(rec.rid), viable(rec.viable), dataSize(rec.dataSize)
+RM_Record::RM_Record(const RM_Record &rec) : rid(rec.rid), viable(false), owned(false), dataSize(rec.dataSize)
 {
     // Copy data
     copyData(rec);
@@ -100,7 +100,8 @@ void RM_Record::releaseData()
 {
     if (viable)
     {
-        delete[] pData;
+        if (owned)
+            delete[] pData;
         viable = false;
     }
 }
@@ -118,5 +119,6 @@ void RM_Record::copyData(const RM_Record &rec)
         this->pData = new char[rec.dataSize];
         memcpy(pData, rec.pData, sizeof(char) * rec.dataSize);
         viable = true;
+        owned = true;
     }
 }
\ No newline at end of file
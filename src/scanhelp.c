@@ -111,6 +111,10 @@ static int get_id(char *s)
         return yylval.ival = RW_SET;
     if (!strcmp(string, "desc"))
         return yylval.ival = RW_DESC;
+    if (!strcmp(string, "analyze"))
+        return yylval.ival = RW_ANALYZE;
+    if (!strcmp(string, "compact"))
+        return yylval.ival = RW_COMPACT;
 
     if (!strcmp(string, "and"))
         return yylval.ival = RW_AND;
@@ -60,9 +60,59 @@ struct SM_AttrcatRecord
     SM_AttrcatRecord() {}
 };
 
+// SM_RelstatRecord - Records stored in the relstat relation, made by analyze
+/* Stores the following:
+    1) relName - name of the relation - char*
+    2) recordCount - number of records - integer
+    3) pageCount - number of pages - integer
+*/
+struct SM_RelstatRecord
+{
+    char relName[MAXNAME + 1]; // + 1 for coding convenience
+    int recordCount;
+    int pageCount;
+};
+
+// The bytes of a value kept in the statistics, longer strings are cut
+#define SM_STAT_VALUE_LENGTH 16
+// The number of buckets of a histogram
+#define SM_HISTOGRAM_BUCKETS 10
+
+// SM_AttrstatRecord - Records stored in the attrstat relation, made by analyze
+/* Stores the following:
+    1) relName - name of the relation - char*
+    2) attrName - name of the attribute - char*
+    3) distinctCount - estimated number of distinct values - integer
+    4) bucketCount - number of buckets of the histogram, 0 if the relation is empty - integer
+    5) attrType - type of the attribute - AttrType
+    6) bounds - the bounds of the buckets of an equi-depth histogram,
+       each of which holds the same number of records.
+       bounds[0] is the min, and bounds[bucketCount] is the max.
+*/
+struct SM_AttrstatRecord
+{
+    char relName[MAXNAME + 1];  // + 1 for coding convenience
+    char attrName[MAXNAME + 1]; // + 1 for coding convenience
+    int distinctCount;
+    int bucketCount;
+    AttrType attrType;
+    char bounds[SM_HISTOGRAM_BUCKETS + 1][SM_STAT_VALUE_LENGTH];
+};
+
 // Constants
 #define SM_RELCAT_ATTR_COUNT 4
 #define SM_ATTRCAT_ATTR_COUNT 6
+#define SM_RELSTAT_ATTR_COUNT 3
+#define SM_ATTRSTAT_ATTR_COUNT 4
+
+// Whether the relation is a system catalog, which can't be changed by users
+inline bool SM_IsCatalog(const char *relName)
+{
+    return strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0 ||
+           strcmp(relName, "relstat") == 0 || strcmp(relName, "attrstat") == 0;
+}
+
+class SM_CatalogCache;
 
 //
 // SM_Manager: provides data management
@@ -72,7 +122,7 @@ class SM_Manager
     friend class QL_Manager;
 
 public:
-    SM_Manager(IX_Manager &ixm, RM_Manager &rmm);
+    SM_Manager(IX_Manager &ixm, RM_Manager &rmm, PF_Manager &pfm);
     ~SM_Manager(); // Destructor
 
     RC OpenDb(const char *dbName); // Open the database
@@ -87,6 +137,8 @@ public:
 
     RC DropIndex(const char *relName,   // destroy index on
                  const char *attrName); //   relName.attrName
+    RC CompactIndex(const char *relName,   // rebuild the nodes of the
+                    const char *attrName); //   index on relName.attrName
     RC Load(const char *relName,        // load relName from
             const char *fileName);      //   fileName
     RC Help();                          // Print relations in db
@@ -94,22 +146,33 @@ public:
 
     RC Print(const char *relName); // print relName contents
 
+    RC Analyze(const char *relName); // collect the statistics of relName
+
     RC Set(const char *paramName, // set parameter to
            const char *value);    //   value
 
     IX_Manager &iXManager; // IX_Manager object
     RM_Manager &rMManager; // RM_Manager object
+    PF_Manager &pFManager; // PF_Manager object, for the buffer parameters
 
     RM_FileHandle relcatRMFH;  // RM file handle for relcat
     RM_FileHandle attrcatRMFH; // RM file handle for attrcat
+    RM_FileHandle relstatRMFH;  // RM file handle for relstat
+    RM_FileHandle attrstatRMFH; // RM file handle for attrstat
+    SM_CatalogCache *catalog;   // In-memory relcat and attrcat of the open database
     bool open;                 // Flag whether the database is open
 
     // Utilities
     void GetAttrInfo(const char *relName, int attrCount, void *_attributes);
     SM_AttrcatRecord GetAttrInfo(const char *relName, const char *attrName);
     SM_RelcatRecord GetRelInfo(const char *relName);
+    bool GetRelStat(const char *relName, SM_RelstatRecord &stat);
+    bool GetAttrStat(const char *relName, const char *attrName, SM_AttrstatRecord &stat);
+    void DeleteStat(const char *relName);
+    void FlushStat();
 
     bool bDebug = false;
+    int fillFactor = IX_DEFAULT_FILL_FACTOR; // Percent of a node filled by bulk loading
 };
 
 //
@@ -151,7 +214,12 @@ void SM_PrintError(RC rc);
 #define SM_LOAD_STRING_TOO_LONG (START_SM_WARN + 30)
 #define SM_LOAD_BAD_INT (START_SM_WARN + 31)
 #define SM_LOAD_BAD_FLOAT (START_SM_WARN + 32)
-#define SM_LASTWARN SM_LOAD_BAD_FLOAT
+#define SM_ANALYZE_CLOSED (START_SM_WARN + 33)
+#define SM_SET_MMAP_INVALID (START_SM_WARN + 34)
+#define SM_SET_FILL_FACTOR_INVALID (START_SM_WARN + 35)
+#define SM_COMPACT_INDEX_CLOSED (START_SM_WARN + 36)
+#define SM_COMPACT_INDEX_FAIL (START_SM_WARN + 37)
+#define SM_LASTWARN SM_COMPACT_INDEX_FAIL
 
 // Errors
 #define SM_INVALID_DATABASE_NAME (START_SM_ERR - 0) // Invalid database file name
@@ -194,8 +262,15 @@ void SM_PrintError(RC rc);
 #define SM_LOAD_DATE_INV_LEN (START_SM_ERR - 37)
 #define SM_LOAD_DATE_INV_FORMAT (START_SM_ERR - 38)
 
+#define SM_OPEN_RELSTAT_FAIL (START_SM_ERR - 39)
+#define SM_OPEN_ATTRSTAT_FAIL (START_SM_ERR - 40)
+#define SM_CLOSE_RELSTAT_FAIL (START_SM_ERR - 41)
+#define SM_CLOSE_ATTRSTAT_FAIL (START_SM_ERR - 42)
+#define SM_ANALYZE_FAIL (START_SM_ERR - 43)
+#define SM_STAT_SCAN_FAIL (START_SM_ERR - 44)
+
 // Error in UNIX system call or library routine
-#define SM_UNIX (START_SM_ERR - 39) // Unix error
+#define SM_UNIX (START_SM_ERR - 45) // Unix error
 #define SM_LASTERROR SM_UNIX
 
 #endif
@@ -0,0 +1,113 @@
+//
+// File:        sm_catalog.cc
+// Description: In-memory cache of the system catalogs
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "purplebase.h"
+#include "sm.h"
+#include "sm_internal.h"
+using namespace std;
+
+// Method: Load(RM_FileHandle &relcatFH, RM_FileHandle &attrcatFH)
+// Read the whole relcat and attrcat into the cache
+/* Steps:
+    1) Scan relcat for the relations
+    2) Scan attrcat, and append every attribute to its relation
+    3) Sort the attributes of every relation by their offsets
+*/
+void SM_CatalogCache::Load(RM_FileHandle &relcatFH, RM_FileHandle &attrcatFH)
+{
+    Clear();
+    RM_FileScan fileScan;
+    RM_Record rec;
+    char *recordData;
+
+    SM_Try_RM(fileScan.OpenScan(relcatFH, STRING, MAXNAME, 0, NO_OP, nullptr), SM_OPEN_RELCAT_FAIL);
+    for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF;)
+    {
+        SM_Try_RM_Or_Close_Scan(rc, fileScan, SM_OPEN_RELCAT_FAIL, SM_OPEN_RELCAT_FAIL);
+        SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), fileScan, SM_OPEN_RELCAT_FAIL, SM_OPEN_RELCAT_FAIL);
+        const SM_RelcatRecord &rcRecord = *(SM_RelcatRecord *)recordData;
+        relations[rcRecord.relName].rcRecord = rcRecord;
+    }
+    SM_Try_RM(fileScan.CloseScan(), SM_OPEN_RELCAT_FAIL);
+
+    SM_Try_RM(fileScan.OpenScan(attrcatFH, STRING, MAXNAME, 0, NO_OP, nullptr), SM_OPEN_ATTRCAT_FAIL);
+    for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF;)
+    {
+        SM_Try_RM_Or_Close_Scan(rc, fileScan, SM_OPEN_ATTRCAT_FAIL, SM_OPEN_ATTRCAT_FAIL);
+        SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), fileScan, SM_OPEN_ATTRCAT_FAIL, SM_OPEN_ATTRCAT_FAIL);
+        const SM_AttrcatRecord &acRecord = *(SM_AttrcatRecord *)recordData;
+        auto it = relations.find(acRecord.relName);
+        if (it != relations.end())
+            it->second.acRecords.push_back(acRecord);
+    }
+    SM_Try_RM(fileScan.CloseScan(), SM_OPEN_ATTRCAT_FAIL);
+
+    for (auto &entry : relations)
+    {
+        Relation &relation = entry.second;
+        stable_sort(relation.acRecords.begin(), relation.acRecords.end(),
+                    [](const SM_AttrcatRecord &x, const SM_AttrcatRecord &y) { return x.offset < y.offset; });
+        for (int i = 0; i < (int)relation.acRecords.size(); ++i)
+            relation.positions[relation.acRecords[i].attrName] = i;
+    }
+}
+
+void SM_CatalogCache::Clear()
+{
+    relations.clear();
+}
+
+// Add a relation with its rcRecord.attrCount attributes in [acRecords]
+void SM_CatalogCache::InsertRel(const SM_RelcatRecord &rcRecord, const SM_AttrcatRecord acRecords[])
+{
+    Relation &relation = relations[rcRecord.relName];
+    relation.rcRecord = rcRecord;
+    relation.acRecords.assign(acRecords, acRecords + rcRecord.attrCount);
+    stable_sort(relation.acRecords.begin(), relation.acRecords.end(),
+                [](const SM_AttrcatRecord &x, const SM_AttrcatRecord &y) { return x.offset < y.offset; });
+    relation.positions.clear();
+    for (int i = 0; i < (int)relation.acRecords.size(); ++i)
+        relation.positions[relation.acRecords[i].attrName] = i;
+}
+
+void SM_CatalogCache::DeleteRel(const char *relName)
+{
+    relations.erase(relName);
+}
+
+SM_RelcatRecord *SM_CatalogCache::FindRel(const char *relName)
+{
+    auto it = relations.find(relName);
+    return it == relations.end() ? nullptr : &it->second.rcRecord;
+}
+
+SM_AttrcatRecord *SM_CatalogCache::FindAttr(const char *relName, const char *attrName)
+{
+    auto it = relations.find(relName);
+    if (it == relations.end())
+        return nullptr;
+    auto pos = it->second.positions.find(attrName);
+    return pos == it->second.positions.end() ? nullptr : &it->second.acRecords[pos->second];
+}
+
+int SM_CatalogCache::PositionOfAttr(const char *relName, const char *attrName)
+{
+    auto it = relations.find(relName);
+    if (it == relations.end())
+        return -1;
+    auto pos = it->second.positions.find(attrName);
+    return pos == it->second.positions.end() ? -1 : pos->second;
+}
+
+const vector<SM_AttrcatRecord> *SM_CatalogCache::FindAttrs(const char *relName)
+{
+    auto it = relations.find(relName);
+    return it == relations.end() ? nullptr : &it->second.acRecords;
+}
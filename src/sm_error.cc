@@ -46,6 +46,11 @@ static char *SM_WarnMsg[] = {
     (char *)"A value (string) is too long to load.",                                                                                                                       // SM_LOAD_STRING_TOO_LONG (START_SM_WARN + 30)
     (char *)"A value (int) is not in the correct format to load.",                                                                                                         // SM_LOAD_BAD_INT (START_SM_WARN + 31)
     (char *)"A value (float) is not in the correct format to load.",                                                                                                       // SM_LOAD_BAD_INT (START_SM_WARN + 31)
+    (char *)"Trying to analyze a relation in a closed database.",                                                                                                          // SM_ANALYZE_CLOSED (START_SM_WARN + 33)
+    (char *)"Usage: set mmap [TRUE | FALSE]",                                                                                                                              // SM_SET_MMAP_INVALID (START_SM_WARN + 34)
+    (char *)"Usage: set fillfactor [10 - 100]",                                                                                                                            // SM_SET_FILL_FACTOR_INVALID (START_SM_WARN + 35)
+    (char *)"Trying to compact an index in a closed database.",                                                                                                            // SM_COMPACT_INDEX_CLOSED (START_SM_WARN + 36)
+    (char *)"Failed to compact an index.",                                                                                                                                 // SM_COMPACT_INDEX_FAIL (START_SM_WARN + 37)
 };
 
 static char *SM_ErrorMsg[] = {
@@ -88,6 +93,12 @@ static char *SM_ErrorMsg[] = {
     (char *)"SM_PRINT_SCAN_FAIL",                                 // SM_PRINT_SCAN_FAIL (START_SM_ERR - 36)
     (char *)"SM_LOAD_DATE_INV_LEN",                               // SM_LOAD_DATE_INV_LEN (START_SM_ERR - 37)
     (char *)"SM_LOAD_DATE_INV_FORMAT",                            // SM_LOAD_DATE_INV_FORMAT (START_SM_ERR - 38)
+    (char *)"Fail to open relstat, when opening a database.",     // SM_OPEN_RELSTAT_FAIL (START_SM_ERR - 39)
+    (char *)"Fail to open attrstat, when opening a database.",    // SM_OPEN_ATTRSTAT_FAIL (START_SM_ERR - 40)
+    (char *)"SM_CLOSE_RELSTAT_FAIL",                              // SM_CLOSE_RELSTAT_FAIL (START_SM_ERR - 41)
+    (char *)"SM_CLOSE_ATTRSTAT_FAIL",                             // SM_CLOSE_ATTRSTAT_FAIL (START_SM_ERR - 42)
+    (char *)"SM_ANALYZE_FAIL",                                    // SM_ANALYZE_FAIL (START_SM_ERR - 43)
+    (char *)"SM_STAT_SCAN_FAIL",                                  // SM_STAT_SCAN_FAIL (START_SM_ERR - 44)
 };
 
 //
@@ -7,10 +7,67 @@
 #ifndef SM_INTERNAL_H
 #define SM_INTERNAL_H
 
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include "rm.h"
 #include "ix.h"
 #include "sm.h"
 
+// The number of values sampled by analyze for the histograms
+#define SM_STAT_SAMPLE 10000
+// The bits of the hash choosing a register of HyperLogLog,
+// the standard error is about 1.04 / sqrt(2 ^ SM_HLL_BITS)
+#define SM_HLL_BITS 10
+
+//
+// SM_HyperLogLog: estimate the number of distinct values in constant memory
+//
+class SM_HyperLogLog
+{
+public:
+    SM_HyperLogLog();
+
+    void Add(const char *data, int length);
+    double Estimate() const;
+
+private:
+    std::vector<unsigned char> registers;
+};
+
+//
+// SM_CatalogCache: an in-memory copy of relcat and attrcat, hashed by the names
+//
+// It's loaded when the database is opened, and changed along with the catalogs by DDL,
+// so that looking up a relation or an attribute doesn't scan the catalogs.
+// The attributes of a relation are kept in the order of their offsets.
+class SM_CatalogCache
+{
+public:
+    void Load(RM_FileHandle &relcatFH, RM_FileHandle &attrcatFH);
+    void Clear();
+
+    void InsertRel(const SM_RelcatRecord &rcRecord, const SM_AttrcatRecord acRecords[]);
+    void DeleteRel(const char *relName);
+
+    // Return nullptr if not found
+    SM_RelcatRecord *FindRel(const char *relName);
+    SM_AttrcatRecord *FindAttr(const char *relName, const char *attrName);
+    // The position of the attribute in the relation, or -1 if not found
+    int PositionOfAttr(const char *relName, const char *attrName);
+    // The attributes of a relation, or nullptr if not found
+    const std::vector<SM_AttrcatRecord> *FindAttrs(const char *relName);
+
+private:
+    struct Relation
+    {
+        SM_RelcatRecord rcRecord;
+        std::vector<SM_AttrcatRecord> acRecords;
+        std::unordered_map<std::string, int> positions; // attrName -> index in acRecords
+    };
+    std::unordered_map<std::string, Relation> relations;
+};
+
 // A wrapper to execute the API of RM.
 inline void SM_Try_RM(RC rm_rc, RC sm_rc)
 {
@@ -31,7 +88,7 @@ inline void SM_Try_IX(RC ix_rc, RC sm_rc)
     }
 }
 
-inline void SM_Try_RM_Or_Close_Scan(RC rm_rc, RM_FileScan rmfs, RC succ_rc, RC fail_rc, RC aim_rm_rc = OK_RC)
+inline void SM_Try_RM_Or_Close_Scan(RC rm_rc, RM_FileScan &rmfs, RC succ_rc, RC fail_rc, RC aim_rm_rc = OK_RC)
 {
     if (rm_rc != aim_rm_rc)
     {
@@ -41,7 +98,7 @@ inline void SM_Try_RM_Or_Close_Scan(RC rm_rc, RM_FileScan rmfs, RC succ_rc, RC f
     }
 }
 
-inline void SM_Try_IX_Or_Close_Scan(RC ix_rc, RM_FileScan rmfs, RC succ_rc, RC fail_rc)
+inline void SM_Try_IX_Or_Close_Scan(RC ix_rc, RM_FileScan &rmfs, RC succ_rc, RC fail_rc)
 {
     if (ix_rc)
     {
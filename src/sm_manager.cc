@@ -126,14 +126,14 @@ SM_AttrcatRecord::SM_AttrcatRecord(const char *_relName, const char *_attrName,
 }
 
 // Constructor
-SM_Manager::SM_Manager(IX_Manager &ixm, RM_Manager &rmm) : iXManager(ixm), rMManager(rmm), open(false)
+SM_Manager::SM_Manager(IX_Manager &ixm, RM_Manager &rmm, PF_Manager &pfm) : iXManager(ixm), rMManager(rmm), pFManager(pfm), catalog(new SM_CatalogCache), open(false)
 {
 }
 
 // Destructor
 SM_Manager::~SM_Manager()
 {
-    // Nothing to free
+    delete catalog;
 }
 
 // Method: OpenDb(const char *dbName)
@@ -142,7 +142,8 @@ SM_Manager::~SM_Manager()
     1) Check if the database is already open
     2) Change to the database directory
     3) Open the system catalogs
-    4) Update flag
+    4) Load relcat and attrcat into the catalog cache
+    5) Update flag
 */
 RC SM_Manager::OpenDb(const char *dbName)
 {
@@ -167,6 +168,11 @@ RC SM_Manager::OpenDb(const char *dbName)
         // Open the system catalogs
         SM_Try_RM(rMManager.OpenFile("relcat", relcatRMFH), SM_OPEN_RELCAT_FAIL);
         SM_Try_RM(rMManager.OpenFile("attrcat", attrcatRMFH), SM_OPEN_ATTRCAT_FAIL);
+        SM_Try_RM(rMManager.OpenFile("relstat", relstatRMFH), SM_OPEN_RELSTAT_FAIL);
+        SM_Try_RM(rMManager.OpenFile("attrstat", attrstatRMFH), SM_OPEN_ATTRSTAT_FAIL);
+
+        // Load the catalog cache
+        catalog->Load(relcatRMFH, attrcatRMFH);
     }
     catch (RC rc)
     {
@@ -200,6 +206,9 @@ RC SM_Manager::CloseDb()
         // Close the system catalogs
         SM_Try_RM(rMManager.CloseFile(relcatRMFH), SM_CLOSE_RELCAT_FAIL);
         SM_Try_RM(rMManager.CloseFile(attrcatRMFH), SM_CLOSE_ATTRCAT_FAIL);
+        SM_Try_RM(rMManager.CloseFile(relstatRMFH), SM_CLOSE_RELSTAT_FAIL);
+        SM_Try_RM(rMManager.CloseFile(attrstatRMFH), SM_CLOSE_ATTRSTAT_FAIL);
+        catalog->Clear();
     }
     catch (RC rc)
     {
@@ -226,7 +235,7 @@ RC SM_Manager::CloseDb()
     2) Check whether the table already exists
     3) Update the system catalogs
     4) Create a RM file for the relation
-    5) Flush the system catalogs
+    5) Flush the system catalogs, and add the relation to the catalog cache
 */
 RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attributes)
 {
@@ -242,18 +251,16 @@ RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attribu
             throw RC{SM_CREATE_TABLE_CLOSED};
         }
 
-        { // 2) Check whether the table already exists
-            RM_FileScan rmfs;
-            SM_Try_RM(rmfs.OpenScan(relcatRMFH, STRING, MAXNAME, offsetof(SM_RelcatRecord, relName), EQ_OP, relName), SM_CREATE_TABLE_FAIL);
-            {
-                RM_Record rec;
-                SM_Try_RM_Or_Close_Scan(rmfs.GetNextRec(rec), rmfs, SM_CREATE_TABLE_EXIST, SM_CREATE_TABLE_SCAN_FAIL_CLOSE_SCAN_FAIL, RM_EOF);
-            }
-            SM_Try_RM(rmfs.CloseScan(), SM_CREATE_TABLE_FAIL);
+        // 2) Check whether the table already exists
+        if (catalog->FindRel(relName) != nullptr)
+        {
+            throw RC{SM_CREATE_TABLE_EXIST};
         }
 
         // 3) Update the system catalogs
         int recordSize = 0;
+        vector<SM_AttrcatRecord> acRecords;
+        SM_RelcatRecord rcRecord;
         {
             RID rid;
             int offset = 0;
@@ -269,11 +276,12 @@ RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attribu
                     attributes[i].attrLength,
                     -1);
                 SM_Try_RM(attrcatRMFH.InsertRec((char *)&acRecord, rid), SM_CREATE_TABLE_INSERT_ATTR_CAT_FAIL);
+                acRecords.push_back(acRecord);
             }
 
             // 3.2) The new relation should be added to relcat
             recordSize = offset;
-            SM_RelcatRecord rcRecord = SM_RelcatRecord(relName, recordSize, attrCount, 0);
+            rcRecord = SM_RelcatRecord(relName, recordSize, attrCount, 0);
             SM_Try_RM(relcatRMFH.InsertRec((char *)&rcRecord, rid), SM_CREATE_TABLE_INSERT_ATTR_CAT_FAIL);
         }
 
@@ -283,6 +291,7 @@ RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attribu
         // Flush the system catalogs
         SM_Try_RM(relcatRMFH.ForcePages(), SM_CREATE_TABLE_FAIL);
         SM_Try_RM(attrcatRMFH.ForcePages(), SM_CREATE_TABLE_FAIL);
+        catalog->InsertRel(rcRecord, acRecords.data());
     }
     catch (RC rc)
     {
@@ -299,6 +308,8 @@ RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attribu
     3) Scan through attrcat
         - Destroy the indexes and delete the entries
     4) Destroy the RM file for the relation
+    5) Delete the statistics of the relation
+    6) Remove the relation from the catalog cache
 */
 RC SM_Manager::DropTable(const char *relName)
 {
@@ -376,9 +387,16 @@ RC SM_Manager::DropTable(const char *relName)
         // 4) Destroy the RM file for the relation
         SM_Try_RM(rMManager.DestroyFile(relName), SM_DROP_TABLE_FAIL);
 
+        // 5) Delete the statistics of the relation
+        DeleteStat(relName);
+        FlushStat();
+
         // Flush the system catalogs
         SM_Try_RM(relcatRMFH.ForcePages(), SM_DROP_TABLE_FAIL);
         SM_Try_RM(attrcatRMFH.ForcePages(), SM_DROP_TABLE_FAIL);
+
+        // 6) Remove the relation from the catalog cache
+        catalog->DeleteRel(relName);
     }
     catch (RC rc)
     {
@@ -392,9 +410,11 @@ RC SM_Manager::DropTable(const char *relName)
 /* Steps:
     1) Check that the database is open
     2) Check whether the index exists
-    3) Create and open the index file
-    4) Scan all the tuples and insert in the index
-    5) Close the index file
+    3) Update the system catalogs and the catalog cache,
+       where the number of the index is the position of the attribute in the relation
+    4) Create and open the index file
+    5) Scan all the tuples and bulk load the index from their entries
+    6) Close the index file
 */
 RC SM_Manager::CreateIndex(const char *relName, const char *attrName)
 {
@@ -439,8 +459,8 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName)
         // Update attrcat
         RM_FileScan attrcatFS;
         SM_Try_RM(attrcatFS.OpenScan(attrcatRMFH, STRING, MAXNAME, 0, EQ_OP, relName), SM_CREATE_INDEX_ATTR_CAT_SCAN_FAIL);
-        int position = 0;
-        for (RC rc = OK_RC; rc != RM_EOF; ++position)
+        int position = catalog->PositionOfAttr(relName, attrName);
+        for (RC rc = OK_RC; rc != RM_EOF;)
         {
             rc = attrcatFS.GetNextRec(rec);
             if (rc != 0 && rc != RM_EOF)
@@ -469,11 +489,15 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName)
         // Flush the system catalogs
         SM_Try_RM(relcatRMFH.ForcePages(), SM_CREATE_INDEX_FAIL);
         SM_Try_RM(attrcatRMFH.ForcePages(), SM_CREATE_INDEX_FAIL);
+        ++catalog->FindRel(relName)->indexCount;
+        catalog->FindAttr(relName, attrName)->indexNo = position;
 
         // Create and open the index file
         SM_Try_IX(iXManager.CreateIndex(relName, position, attrType, attrLength), SM_CREATE_INDEX_FAIL);
         IX_IndexHandle ixIH;
         SM_Try_IX(iXManager.OpenIndex(relName, position, ixIH), SM_CREATE_INDEX_FAIL);
+        IX_BulkLoader ixBL;
+        SM_Try_IX(ixBL.Open(ixIH, fillFactor), SM_CREATE_INDEX_FAIL);
 
         // Scan all the tuples in the relation
         RM_FileHandle rmFH;
@@ -497,12 +521,15 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName)
                 SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), rmFS, SM_CREATE_INDEX_RM_SCAN_FAIL, SM_CREATE_INDEX_RM_SCAN_FAIL_CLOSE_SCAN_FAIL);
                 SM_Try_RM_Or_Close_Scan(rec.GetRid(rid), rmFS, SM_CREATE_INDEX_RM_SCAN_FAIL, SM_CREATE_INDEX_RM_SCAN_FAIL_CLOSE_SCAN_FAIL);
 
-                // Insert the attribute value in the index
-                SM_Try_IX_Or_Close_Scan(ixIH.InsertEntry(recordData + offset, rid), rmFS, SM_CREATE_INDEX_RM_SCAN_FAIL, SM_CREATE_INDEX_RM_SCAN_FAIL_CLOSE_SCAN_FAIL);
+                // Add the attribute value to the bulk loader
+                SM_Try_IX_Or_Close_Scan(ixBL.AddEntry(recordData + offset, rid), rmFS, SM_CREATE_INDEX_RM_SCAN_FAIL, SM_CREATE_INDEX_RM_SCAN_FAIL_CLOSE_SCAN_FAIL);
             }
         }
         SM_Try_RM(rmFS.CloseScan(), SM_CREATE_INDEX_RM_SCAN_FAIL);
 
+        // Sort the entries and build the B+ tree
+        SM_Try_IX(ixBL.Finish(), SM_CREATE_INDEX_FAIL);
+
         // Close the files
         SM_Try_RM(rMManager.CloseFile(rmFH), SM_CREATE_INDEX_RM_SCAN_FAIL);
         SM_Try_IX(iXManager.CloseIndex(ixIH), SM_CREATE_INDEX_RM_SCAN_FAIL);
@@ -519,7 +546,7 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName)
 /* Steps:
     1) Check that the database is open
     2) Check whether the index exists
-    3) Update and flush the system catalogs
+    3) Update and flush the system catalogs, and the catalog cache
     4) Destroy the index file
 */
 RC SM_Manager::DropIndex(const char *relName, const char *attrName)
@@ -596,6 +623,54 @@ RC SM_Manager::DropIndex(const char *relName, const char *attrName)
         // Flush the system catalogs
         SM_Try_RM(relcatRMFH.ForcePages(), SM_DROP_INDEX_FAIL);
         SM_Try_RM(attrcatRMFH.ForcePages(), SM_DROP_INDEX_FAIL);
+        --catalog->FindRel(relName)->indexCount;
+        catalog->FindAttr(relName, attrName)->indexNo = -1;
+    }
+    catch (RC rc)
+    {
+        return rc;
+    }
+    return OK_RC;
+}
+
+// Method: CompactIndex(const char *relName, const char *attrName)
+// Rebuild the nodes of the index on relName.attrName in place,
+// filled to the fill factor, dropping the keys without RIDs
+/* Steps:
+    1) Check that the database is open
+    2) Check whether the index exists
+    3) Compact the index
+*/
+RC SM_Manager::CompactIndex(const char *relName, const char *attrName)
+{
+    try
+    {
+        if (relName == nullptr)
+        {
+            throw RC{SM_NULLPTR_REL_NAME};
+        }
+        if (attrName == nullptr)
+        {
+            throw RC{SM_NULLPTR_ATTR_NAME};
+        }
+        if (!open)
+        {
+            throw RC{SM_COMPACT_INDEX_CLOSED};
+        }
+
+        // Check whether the index exists
+        SM_AttrcatRecord attrRecord = GetAttrInfo(relName, attrName);
+        if (attrRecord.indexNo == -1)
+        {
+            throw RC{SM_INDEX_DOES_NOT_EXIST};
+        }
+
+        // Compact the index
+        IX_IndexHandle ixIH;
+        SM_Try_IX(iXManager.OpenIndex(relName, attrRecord.indexNo, ixIH), SM_COMPACT_INDEX_FAIL);
+        RC rc = ixIH.Compact(fillFactor);
+        SM_Try_IX(iXManager.CloseIndex(ixIH), SM_COMPACT_INDEX_FAIL);
+        SM_Try_IX(rc, SM_COMPACT_INDEX_FAIL);
     }
     catch (RC rc)
     {
@@ -610,12 +685,14 @@ RC SM_Manager::DropIndex(const char *relName, const char *attrName)
     1) Check the parameters
     2) Check whether the database is open
     2) Obtain attribute information for the relation
-    3) Open the RM file and each index file
+    3) Open the RM file and each index file,
+       and if the relation is empty, bulk load the empty indexes
     4) Open the data file
     5) Read the tuples from the file
         - Insert the tuple in the relation
-        - Insert the entries in the indexes
-    6) Close the files
+        - Insert the entries in the indexes, or add them to the bulk loaders
+    6) Build the bulk loaded indexes
+    7) Close the files
 */
 RC SM_Manager::Load(const char *relName, const char *fileName)
 {
@@ -630,7 +707,7 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
         {
             throw RC{SM_NULLPTR_FILE_NAME};
         }
-        if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0)
+        if (SM_IsCatalog(relName))
         {
             return SM_LOAD_SYSTEM_CAT;
         }
@@ -675,6 +752,16 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
             }
         }
 
+        // Bulk load the indexes of an empty relation, unless some entry is left
+        // in them, and insert the entries one by one otherwise
+        IX_BulkLoader ixBL[attrCount];
+        bool bulk[attrCount];
+        for (int i = 0; i < attrCount; ++i)
+        {
+            bulk[i] = attributes[i].indexNo != -1 && rmFH.GetRecordNum() == 0 &&
+                      ixBL[i].Open(ixIH[i], fillFactor) == OK_RC;
+        }
+
         // Read each line of the file
         string line;
         while (getline(dataFile, line))
@@ -683,14 +770,12 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
 
             char tupleData[tupleLength];
             memset(tupleData, 0, sizeof(tupleData));
-            string dataValues[attrCount];
 
             for (int i = 0, pos = -1; i < attrCount; ++i)
             {
                 // Parse the line
                 int next_pos = line.find('|', pos + 1);
                 string dataValue = line.substr(pos + 1, next_pos - pos - 1);
-                dataValues[i] = dataValue;
                 pos = next_pos;
 
                 // Build the tuple of the relation
@@ -762,6 +847,10 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
                 {
                     if (attributes[i].indexNo != -1)
                     {
+                        if (bulk[i])
+                        {
+                            ixBL[i].Finish(); // Index the tuples loaded so far
+                        }
                         SM_Try_IX(iXManager.CloseIndex(ixIH[i]), SM_LOAD_FAIL_CLOSE_FAIL);
                     }
                 }
@@ -774,29 +863,9 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
             {
                 if (attributes[i].indexNo != -1)
                 {
-                    void *value;
-                    int valueINT;
-                    float valueFLOAT;
-                    switch (attributes[i].attrType)
-                    {
-                    case INT:
-                        valueINT = stoi(dataValues[i]);
-                        value = &valueINT;
-                        break;
-                    case FLOAT:
-                        valueFLOAT = stof(dataValues[i]);
-                        value = &valueFLOAT;
-                        break;
-                    case STRING:
-                        value = malloc(attributes[i].attrLength + 1);
-                        strcpy((char *)value, dataValues[i].c_str());
-                        break;
-                    case DATE:
-                        value = malloc(10);
-                        strncpy((char *)value, dataValues[i].c_str(), 10);
-                        break;
-                    }
-                    if ((rc = ixIH[i].InsertEntry(value, rid)))
+                    // The value in the tuple is the key, zero padded as the index wants
+                    const char *value = tupleData + attributes[i].offset;
+                    if ((rc = bulk[i] ? ixBL[i].AddEntry(value, rid) : ixIH[i].InsertEntry(value, rid)))
                     {
                         IX_PrintError(rc);
 
@@ -805,6 +874,10 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
                         {
                             if (attributes[i].indexNo != -1)
                             {
+                                if (bulk[i])
+                                {
+                                    ixBL[i].Finish(); // Index the tuples loaded so far
+                                }
                                 SM_Try_IX(iXManager.CloseIndex(ixIH[i]), SM_LOAD_FAIL_CLOSE_FAIL);
                             }
                         }
@@ -826,6 +899,15 @@ RC SM_Manager::Load(const char *relName, const char *fileName)
             }
         }
 
+        // Build the bulk loaded indexes
+        for (int i = 0; i < attrCount; ++i)
+        {
+            if (bulk[i])
+            {
+                SM_Try_IX(ixBL[i].Finish(), SM_LOAD_FAIL);
+            }
+        }
+
         // Close the RM file
         SM_Try_RM(rMManager.CloseFile(rmFH), SM_LOAD_FAIL);
 
@@ -1088,10 +1170,38 @@ RC SM_Manager::Print(const char *relName)
 // Method: Set(const char *paramName, const char *value)
 // Set parameter to value
 /* System parameters:
+    debug           "TRUE" or "FALSE"
+    bufferpolicy    the replacement policy of the buffer pool, one of
+                    "lru", "clock", "lru2" and "2q"
+    bufferpages     the number of pages in the buffer pool
+    mmap            "TRUE" or "FALSE", whether relations read by queries
+                    are mapped instead of read into the buffer pool
+    fillfactor      the percent, from 10 to 100, of every node filled when
+                    an index is bulk loaded
 */
 RC SM_Manager::Set(const char *paramName, const char *value)
 {
-    if (strcmp(paramName, "debug") == 0)
+    if (strcmp(paramName, "bufferpages") == 0)
+    {
+        RC rc = pFManager.ResizeBuffer(atoi(value));
+        if (rc != OK_RC)
+        {
+            return rc;
+        }
+
+        printf("[[bufferpages]] is set %d.\n", atoi(value));
+    }
+    else if (strcmp(paramName, "bufferpolicy") == 0)
+    {
+        RC rc = pFManager.SetReplacer(value);
+        if (rc != OK_RC)
+        {
+            return rc;
+        }
+
+        printf("[[bufferpolicy]] is set %s.\n", value);
+    }
+    else if (strcmp(paramName, "debug") == 0)
     {
         if (strcmp(value, "TRUE") == 0)
         {
@@ -1110,14 +1220,44 @@ RC SM_Manager::Set(const char *paramName, const char *value)
             return SM_SET_DEBUG_INVALID;
         }
     }
+    else if (strcmp(paramName, "mmap") == 0)
+    {
+        if (strcmp(value, "TRUE") == 0)
+        {
+            pFManager.SetMapping(TRUE);
+
+            printf("[[mmap]] is set true.\n");
+        }
+        else if (strcmp(value, "FALSE") == 0)
+        {
+            pFManager.SetMapping(FALSE);
+
+            printf("[[mmap]] is set false.\n");
+        }
+        else
+        {
+            return SM_SET_MMAP_INVALID;
+        }
+    }
+    else if (strcmp(paramName, "fillfactor") == 0)
+    {
+        int percent = atoi(value);
+        if (percent < 10 || percent > 100)
+        {
+            return SM_SET_FILL_FACTOR_INVALID;
+        }
+        fillFactor = percent;
+
+        printf("[[fillfactor]] is set %d.\n", percent);
+    }
     return OK_RC; // Nothing to set yet
 }
 
 // Method: GetAttrInfo(const char* relName, int attrCount, DataAttrInfo* attributes)
-// Get the attribute info about a relation from attrcat
+// Get the attribute info about a relation from the catalog cache
 /* Steps:
-    1) Start file scan of attrcat for relName
-    2) For each record, fill attributes array
+    1) Find the attributes of relName
+    2) For each attribute, fill attributes array
 */
 void SM_Manager::GetAttrInfo(const char *relName, int attrCount, void *_attributes)
 {
@@ -1131,72 +1271,32 @@ void SM_Manager::GetAttrInfo(const char *relName, int attrCount, void *_attribut
         throw RC{SM_INCORRECT_ATTRCOUNT};
     }
 
-    RC rc;
-    RM_FileScan attrcatFS;
-    RM_Record rec;
-    char *recordData;
-    SM_AttrcatRecord *acRecord;
-    DataAttrInfo *attributes = (DataAttrInfo *)_attributes;
-
-    // Start file scan
-    if (bDebug)
+    const vector<SM_AttrcatRecord> *acRecords = catalog->FindAttrs(relName);
+    if (acRecords == nullptr)
     {
-        // printf("At GetAttrInfo, openscan with %s\n", relName);
+        throw RC{SM_GET_ALL_ATTR_INFO_FAIL};
     }
-
-    SM_Try_RM(attrcatFS.OpenScan(attrcatRMFH, STRING, MAXNAME, 0, EQ_OP, relName), SM_GET_ALL_ATTR_INFO_SCAN_FAIL);
-
-    // Get all the attribute tuples
-    if (bDebug)
+    if ((int)acRecords->size() > attrCount)
     {
-        // cout << "GetAttrInfo(" << relName << ", " << attrCount << ")\n";
+        throw RC{SM_INCORRECT_ATTRCOUNT};
     }
-    for (int i = 0; rc != RM_EOF; ++i)
-    {
-        rc = attrcatFS.GetNextRec(rec);
-        if (rc != 0 && rc != RM_EOF)
-        {
-            RM_PrintError(rc);
-            SM_Try_RM(attrcatFS.CloseScan(), SM_GET_ALL_ATTR_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-            throw RC{SM_PRINT_SCAN_FAIL};
-        }
-
-        if (rc != RM_EOF)
-        {
-            if (bDebug)
-            {
-                // cout << "GetAttrInfo(" << relName << ", " << attrCount << "): Now attributes[" << i << "]\n";
-            }
 
-            if (i == attrCount)
-            {
-                throw SM_INCORRECT_ATTRCOUNT;
-            }
-
-            SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), attrcatFS, SM_GET_ALL_ATTR_INFO_SCAN_FAIL, SM_GET_ALL_ATTR_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-            acRecord = (SM_AttrcatRecord *)recordData;
-
-            // Fill the attributes array
-            strcpy(attributes[i].relName, acRecord->relName);
-            strcpy(attributes[i].attrName, acRecord->attrName);
-            attributes[i].offset = acRecord->offset;
-            attributes[i].attrType = acRecord->attrType;
-            attributes[i].attrLength = acRecord->attrLength;
-            attributes[i].indexNo = acRecord->indexNo;
-        }
+    // Fill the attributes array
+    DataAttrInfo *attributes = (DataAttrInfo *)_attributes;
+    for (int i = 0; i < (int)acRecords->size(); ++i)
+    {
+        const SM_AttrcatRecord &acRecord = (*acRecords)[i];
+        strcpy(attributes[i].relName, acRecord.relName);
+        strcpy(attributes[i].attrName, acRecord.attrName);
+        attributes[i].offset = acRecord.offset;
+        attributes[i].attrType = acRecord.attrType;
+        attributes[i].attrLength = acRecord.attrLength;
+        attributes[i].indexNo = acRecord.indexNo;
     }
-
-    // Close the scan
-    SM_Try_RM(attrcatFS.CloseScan(), SM_GET_ALL_ATTR_INFO_SCAN_FAIL);
 }
 
 // Method: GetAttrInfo(const char* relName, const char* attrName, SM_AttrcatRecord* attributeData)
-// Get an attribute info about an attribute of a relation from attrcat
-/* Steps:
-    1) Start file scan of attrcat for relName
-    2) For each record, check whether the required attribute
-    3) Fill the attribute structure
-*/
+// Get an attribute info about an attribute of a relation from the catalog cache
 SM_AttrcatRecord SM_Manager::GetAttrInfo(const char *relName, const char *attrName)
 {
     // Check the parameters
@@ -1209,80 +1309,28 @@ SM_AttrcatRecord SM_Manager::GetAttrInfo(const char *relName, const char *attrNa
         throw RC{SM_NULLPTR_ATTR_NAME};
     }
 
-    RC rc;
-    RM_FileScan attrcatFS;
-    RM_Record rec;
-    char *recordData;
-
-    // Start file scan
-    SM_Try_RM(attrcatFS.OpenScan(attrcatRMFH, STRING, MAXNAME, 0, EQ_OP, relName), SM_GET_ATTR_INFO_SCAN_FAIL);
-
-    // Get all the attribute tuples
-    for (int i = 0; rc != RM_EOF; ++i)
+    SM_AttrcatRecord *acRecord = catalog->FindAttr(relName, attrName);
+    if (acRecord == nullptr)
     {
-        rc = attrcatFS.GetNextRec(rec);
-        if (rc != 0 && rc != RM_EOF)
-        {
-            RM_PrintError(rc);
-            SM_Try_RM(attrcatFS.CloseScan(), SM_GET_ATTR_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-            throw RC{SM_PRINT_SCAN_FAIL};
-        }
-        if (rc != RM_EOF)
-        {
-            SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), attrcatFS, SM_GET_ATTR_INFO_SCAN_FAIL, SM_GET_ATTR_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-            SM_AttrcatRecord acRecord = *(SM_AttrcatRecord *)recordData;
-
-            // Check for the required attribute
-            if (strcmp(acRecord.attrName, attrName) == 0)
-            {
-                SM_Try_RM(attrcatFS.CloseScan(), SM_GET_ATTR_INFO_FAIL);
-
-                return acRecord;
-            }
-        }
+        throw RC{SM_GET_ATTR_INFO_FAIL};
     }
-
-    // Close the scan
-    SM_Try_RM(attrcatFS.CloseScan(), SM_GET_ATTR_INFO_SCAN_FAIL);
-
-    throw RC{SM_GET_ATTR_INFO_FAIL};
+    return *acRecord;
 }
 
 // Method: GetRelInfo(const char* relName, SM_RelcatRecord* relationData)
-// Get the relation info from relcat
-/* Steps:
-    1) Start file scan of relcat for relName
-    2) Fill relation data
-*/
+// Get the relation info from the catalog cache
 SM_RelcatRecord SM_Manager::GetRelInfo(const char *relName)
 {
     // Check the parameters
     if (relName == nullptr)
     {
-        throw SM_NULLPTR_REL_NAME;
+        throw RC{SM_NULLPTR_REL_NAME};
     }
 
-    RM_FileScan relcatFS;
-    RM_Record rec;
-    char *recordData;
-
-    // Start file scan
-    SM_Try_RM(relcatFS.OpenScan(relcatRMFH, STRING, MAXNAME, 0, EQ_OP, relName), SM_GET_REL_INFO_SCAN_FAIL);
-
-    // Get the relation tuple
-    SM_Try_RM_Or_Close_Scan(relcatFS.GetNextRec(rec), relcatFS, SM_GET_REL_INFO_SCAN_FAIL, SM_GET_REL_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-    SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), relcatFS, SM_GET_REL_INFO_SCAN_FAIL, SM_GET_REL_INFO_SCAN_FAIL_CLOSE_SCAN_FAIL);
-
-    SM_RelcatRecord rcRecord = *(SM_RelcatRecord *)recordData;
-
-    // Close the scan
-    SM_Try_RM(relcatFS.CloseScan(), SM_GET_REL_INFO_FAIL);
-
-    if (bDebug)
+    SM_RelcatRecord *rcRecord = catalog->FindRel(relName);
+    if (rcRecord == nullptr)
     {
-        // printf("Successfully GetRelInfo!\n");
+        throw RC{SM_GET_REL_INFO_SCAN_FAIL};
     }
-
-    // Fill the relation data
-    return rcRecord;
-}
\ No newline at end of file
+    return *rcRecord;
+}
@@ -0,0 +1,340 @@
+//
+// File:        sm_statistics.cc
+// Description: Statistics of relations, collected by analyze
+// Authors:     Xingyu Xie (xiexy17@mails.tsinghua.edu.cn)
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "purplebase.h"
+#include "sm.h"
+#include "sm_internal.h"
+#include "printer.h"
+using namespace std;
+
+/************ SM_HyperLogLog ************/
+
+SM_HyperLogLog::SM_HyperLogLog() : registers(1 << SM_HLL_BITS, 0)
+{
+}
+
+// FNV-1a, followed by the finalizer of MurmurHash3 to spread the bits
+static unsigned long long Hash(const char *data, int length)
+{
+    unsigned long long h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < length; ++i)
+    {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+void SM_HyperLogLog::Add(const char *data, int length)
+{
+    unsigned long long h = Hash(data, length);
+
+    // The first bits choose the register,
+    // which keeps the longest run of leading zeros of the rest, plus one
+    int r = h >> (64 - SM_HLL_BITS);
+    h <<= SM_HLL_BITS;
+    int rank = 1;
+    while (rank <= 64 - SM_HLL_BITS && !(h >> 63))
+    {
+        ++rank;
+        h <<= 1;
+    }
+    registers[r] = max<int>(registers[r], rank);
+}
+
+double SM_HyperLogLog::Estimate() const
+{
+    int m = registers.size();
+    double sum = 0;
+    int zeros = 0;
+    for (unsigned char rank : registers)
+    {
+        sum += ldexp(1.0, -rank);
+        zeros += rank == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    // Linear counting is more accurate for small cardinalities
+    if (estimate <= 2.5 * m && zeros)
+        estimate = m * log((double)m / zeros);
+    return estimate;
+}
+
+/************ Statistics ************/
+
+// Compare two values of the statistics, where a string could be shorter than its length
+static int CompareValue(AttrType type, const char *x, const char *y, int length)
+{
+    switch (type)
+    {
+    case INT:
+        return *(int *)x < *(int *)y ? -1 : *(int *)x > *(int *)y;
+    case FLOAT:
+        return *(float *)x < *(float *)y ? -1 : *(float *)x > *(float *)y;
+    default:
+        return strncmp(x, y, length);
+    }
+}
+
+static void PrintValue(ostream &c, AttrType type, const char *value)
+{
+    switch (type)
+    {
+    case INT:
+        c << *(int *)value;
+        break;
+    case FLOAT:
+        c << *(float *)value;
+        break;
+    default:
+        c << "'" << string(value, strnlen(value, SM_STAT_VALUE_LENGTH)) << "'";
+        break;
+    }
+}
+
+// Method: Analyze(const char *relName)
+// Collect the statistics of relName, and replace the old ones in relstat and attrstat
+/* Steps:
+    1) Check that the database is open and the relation exists
+    2) Scan the relation, and for each attribute,
+        - keep the min and the max
+        - add the value to a HyperLogLog sketch for the number of distinct values
+        - keep a uniform sample of SM_STAT_SAMPLE values (reservoir sampling)
+    3) Sort the samples, and take the bounds of equi-depth histograms from them
+    4) Replace the statistics of the relation in the catalogs
+    5) Print the statistics
+*/
+RC SM_Manager::Analyze(const char *relName)
+{
+    try
+    {
+        if (relName == nullptr)
+        {
+            throw RC{SM_NULLPTR_REL_NAME};
+        }
+        // 1) Check that the database is open and the relation exists
+        if (!open)
+        {
+            throw RC{SM_ANALYZE_CLOSED};
+        }
+        SM_RelcatRecord rcRecord = GetRelInfo(relName);
+        vector<DataAttrInfo> attributes(rcRecord.attrCount);
+        GetAttrInfo(relName, rcRecord.attrCount, attributes.data());
+
+        // 2) Scan the relation
+        int attrCount = rcRecord.attrCount;
+        vector<SM_AttrstatRecord> stats(attrCount);
+        vector<SM_HyperLogLog> sketches(attrCount);
+        vector<vector<char>> samples(attrCount); // Values of SM_STAT_VALUE_LENGTH bytes
+        mt19937 random(0);
+        int recordCount = 0;
+        int pageCount;
+        {
+            RM_FileHandle fileHandle;
+            RM_FileScan fileScan;
+            RM_Record rec;
+            char *data;
+            char value[SM_STAT_VALUE_LENGTH];
+            SM_Try_RM(rMManager.OpenFile(relName, fileHandle), SM_ANALYZE_FAIL);
+            pageCount = fileHandle.GetPageNum();
+            SM_Try_RM(fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr), SM_ANALYZE_FAIL);
+            for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF; ++recordCount)
+            {
+                SM_Try_RM_Or_Close_Scan(rc, fileScan, SM_ANALYZE_FAIL, SM_ANALYZE_FAIL);
+                SM_Try_RM_Or_Close_Scan(rec.GetData(data), fileScan, SM_ANALYZE_FAIL, SM_ANALYZE_FAIL);
+
+                // The sample replaces a random value with the k-th one with probability SM_STAT_SAMPLE / k
+                int slot = recordCount < SM_STAT_SAMPLE ? recordCount : uniform_int_distribution<int>(0, recordCount)(random);
+                for (int i = 0; i < attrCount; ++i)
+                {
+                    const DataAttrInfo &attr = attributes[i];
+                    const char *field = data + attr.offset;
+                    memset(value, 0, sizeof(value));
+                    if (attr.attrType == INT || attr.attrType == FLOAT)
+                    {
+                        memcpy(value, field, 4);
+                        // 0.0 and -0.0 are the same value
+                        if (attr.attrType == FLOAT && *(float *)value == 0)
+                            *(float *)value = 0;
+                        sketches[i].Add(value, 4);
+                    }
+                    else
+                    {
+                        int length = strnlen(field, attr.attrLength);
+                        memcpy(value, field, min(length, SM_STAT_VALUE_LENGTH));
+                        sketches[i].Add(field, length);
+                    }
+
+                    char *bounds = stats[i].bounds[0];
+                    char *maxBound = stats[i].bounds[SM_HISTOGRAM_BUCKETS];
+                    if (recordCount == 0 || CompareValue(attr.attrType, value, bounds, SM_STAT_VALUE_LENGTH) < 0)
+                        memcpy(bounds, value, SM_STAT_VALUE_LENGTH);
+                    if (recordCount == 0 || CompareValue(attr.attrType, value, maxBound, SM_STAT_VALUE_LENGTH) > 0)
+                        memcpy(maxBound, value, SM_STAT_VALUE_LENGTH);
+
+                    if (recordCount < SM_STAT_SAMPLE)
+                        samples[i].insert(samples[i].end(), value, value + SM_STAT_VALUE_LENGTH);
+                    else if (slot < SM_STAT_SAMPLE)
+                        memcpy(samples[i].data() + slot * SM_STAT_VALUE_LENGTH, value, SM_STAT_VALUE_LENGTH);
+                }
+            }
+            SM_Try_RM(fileScan.CloseScan(), SM_ANALYZE_FAIL);
+            SM_Try_RM(rMManager.CloseFile(fileHandle), SM_ANALYZE_FAIL);
+        }
+
+        // 3) Make the histograms
+        for (int i = 0; i < attrCount; ++i)
+        {
+            SM_AttrstatRecord &stat = stats[i];
+            memset(stat.relName, 0, sizeof(stat.relName));
+            memset(stat.attrName, 0, sizeof(stat.attrName));
+            strcpy(stat.relName, relName);
+            strcpy(stat.attrName, attributes[i].attrName);
+            stat.attrType = attributes[i].attrType;
+            stat.distinctCount = min<double>(round(sketches[i].Estimate()), recordCount);
+            stat.bucketCount = recordCount ? SM_HISTOGRAM_BUCKETS : 0;
+            if (recordCount == 0)
+            {
+                memset(stat.bounds, 0, sizeof(stat.bounds));
+                continue;
+            }
+
+            int n = samples[i].size() / SM_STAT_VALUE_LENGTH;
+            vector<const char *> sorted(n);
+            for (int k = 0; k < n; ++k)
+                sorted[k] = samples[i].data() + k * SM_STAT_VALUE_LENGTH;
+            AttrType type = stat.attrType;
+            sort(sorted.begin(), sorted.end(), [type](const char *x, const char *y) {
+                return CompareValue(type, x, y, SM_STAT_VALUE_LENGTH) < 0;
+            });
+
+            // The min and the max are exact, the others are the quantiles of the sample
+            for (int b = 1; b < SM_HISTOGRAM_BUCKETS; ++b)
+                memcpy(stat.bounds[b], sorted[(long long)b * (n - 1) / SM_HISTOGRAM_BUCKETS], SM_STAT_VALUE_LENGTH);
+        }
+
+        // 4) Replace the statistics in the catalogs
+        DeleteStat(relName);
+        RID rid;
+        SM_RelstatRecord relStat;
+        memset(&relStat, 0, sizeof(relStat));
+        strcpy(relStat.relName, relName);
+        relStat.recordCount = recordCount;
+        relStat.pageCount = pageCount;
+        SM_Try_RM(relstatRMFH.InsertRec((char *)&relStat, rid), SM_ANALYZE_FAIL);
+        for (const SM_AttrstatRecord &stat : stats)
+            SM_Try_RM(attrstatRMFH.InsertRec((char *)&stat, rid), SM_ANALYZE_FAIL);
+        FlushStat();
+
+        // 5) Print the statistics
+        cout << relName << ": " << recordCount << " record(s) in " << pageCount << " page(s)\n";
+        for (const SM_AttrstatRecord &stat : stats)
+        {
+            cout << "  " << stat.attrName << ": " << stat.distinctCount << " distinct";
+            if (stat.bucketCount)
+            {
+                cout << ", min ";
+                PrintValue(cout, stat.attrType, stat.bounds[0]);
+                cout << ", max ";
+                PrintValue(cout, stat.attrType, stat.bounds[stat.bucketCount]);
+            }
+            cout << "\n";
+        }
+    }
+    catch (RC rc)
+    {
+        return rc;
+    }
+    return OK_RC;
+}
+
+// Method: GetRelStat(const char *relName, SM_RelstatRecord &stat)
+// Get the statistics of a relation from relstat
+// Return false if the relation isn't analyzed
+bool SM_Manager::GetRelStat(const char *relName, SM_RelstatRecord &stat)
+{
+    RM_FileScan relstatFS;
+    RM_Record rec;
+    char *recordData;
+    SM_Try_RM(relstatFS.OpenScan(relstatRMFH, STRING, MAXNAME, offsetof(SM_RelstatRecord, relName), EQ_OP, relName), SM_STAT_SCAN_FAIL);
+    RC rc = relstatFS.GetNextRec(rec);
+    if (rc != RM_EOF)
+    {
+        SM_Try_RM_Or_Close_Scan(rc, relstatFS, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+        SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), relstatFS, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+        stat = *(SM_RelstatRecord *)recordData;
+    }
+    SM_Try_RM(relstatFS.CloseScan(), SM_STAT_SCAN_FAIL);
+    return rc != RM_EOF;
+}
+
+// Method: GetAttrStat(const char *relName, const char *attrName, SM_AttrstatRecord &stat)
+// Get the statistics of an attribute from attrstat
+// Return false if the relation isn't analyzed
+bool SM_Manager::GetAttrStat(const char *relName, const char *attrName, SM_AttrstatRecord &stat)
+{
+    RM_FileScan attrstatFS;
+    RM_Record rec;
+    char *recordData;
+    bool found = false;
+    SM_Try_RM(attrstatFS.OpenScan(attrstatRMFH, STRING, MAXNAME, offsetof(SM_AttrstatRecord, relName), EQ_OP, relName), SM_STAT_SCAN_FAIL);
+    for (RC rc; !found && (rc = attrstatFS.GetNextRec(rec)) != RM_EOF;)
+    {
+        SM_Try_RM_Or_Close_Scan(rc, attrstatFS, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+        SM_Try_RM_Or_Close_Scan(rec.GetData(recordData), attrstatFS, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+        if (strcmp(((SM_AttrstatRecord *)recordData)->attrName, attrName) == 0)
+        {
+            stat = *(SM_AttrstatRecord *)recordData;
+            found = true;
+        }
+    }
+    SM_Try_RM(attrstatFS.CloseScan(), SM_STAT_SCAN_FAIL);
+    return found;
+}
+
+// Method: DeleteStat(const char *relName)
+// Delete the statistics of a relation from relstat and attrstat
+void SM_Manager::DeleteStat(const char *relName)
+{
+    RM_FileHandle *fileHandles[] = {&relstatRMFH, &attrstatRMFH};
+    for (RM_FileHandle *fileHandle : fileHandles)
+    {
+        // Both catalogs begin with relName
+        RM_FileScan fileScan;
+        RM_Record rec;
+        RID rid;
+        SM_Try_RM(fileScan.OpenScan(*fileHandle, STRING, MAXNAME, 0, EQ_OP, relName), SM_STAT_SCAN_FAIL);
+        for (RC rc; (rc = fileScan.GetNextRec(rec)) != RM_EOF;)
+        {
+            SM_Try_RM_Or_Close_Scan(rc, fileScan, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+            SM_Try_RM_Or_Close_Scan(rec.GetRid(rid), fileScan, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+            SM_Try_RM_Or_Close_Scan(fileHandle->DeleteRec(rid), fileScan, SM_STAT_SCAN_FAIL, SM_STAT_SCAN_FAIL);
+        }
+        SM_Try_RM(fileScan.CloseScan(), SM_STAT_SCAN_FAIL);
+    }
+}
+
+// Method: FlushStat()
+// Write relstat and attrstat to disk, so that they could be read by other file handles
+// The catalogs are reopened, since the header of a RM file is written only when it's closed.
+void SM_Manager::FlushStat()
+{
+    SM_Try_RM(rMManager.CloseFile(relstatRMFH), SM_CLOSE_RELSTAT_FAIL);
+    SM_Try_RM(rMManager.CloseFile(attrstatRMFH), SM_CLOSE_ATTRSTAT_FAIL);
+    SM_Try_RM(rMManager.OpenFile("relstat", relstatRMFH), SM_OPEN_RELSTAT_FAIL);
+    SM_Try_RM(rMManager.OpenFile("attrstat", attrstatRMFH), SM_OPEN_ATTRSTAT_FAIL);
+}
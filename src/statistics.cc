@@ -31,7 +31,13 @@ const char *PF_PAGEFOUND = "PAGEFOUND";
 const char *PF_PAGENOTFOUND = "PAGENOTFOUND";
 const char *PF_READPAGE = "READPAGE";           // IO
 const char *PF_WRITEPAGE = "WRITEPAGE";         // IO
+const char *PF_WRITECALL = "WRITECALL";         // IO
 const char *PF_FLUSHPAGES = "FLUSHPAGES";
+const char *PF_PREFETCHPAGE = "PREFETCHPAGE";   // IO
+const char *PF_PREFETCHHIT = "PREFETCHHIT";
+const char *PF_MAPPAGE = "MAPPAGE";
+const char *PF_BGWRITEPAGE = "BGWRITEPAGE";     // IO
+const char *PF_CHECKPOINT = "CHECKPOINT";
 
 //
 // Statistic class
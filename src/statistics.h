@@ -135,7 +135,19 @@ extern const char *PF_PAGEFOUND;
 extern const char *PF_PAGENOTFOUND;
 extern const char *PF_READPAGE;         // IO
 extern const char *PF_WRITEPAGE;        // IO
+extern const char *PF_WRITECALL;        // IO, calls writing one or more pages
 extern const char *PF_FLUSHPAGES;
+extern const char *PF_PREFETCHPAGE;     // IO
+extern const char *PF_PREFETCHHIT;
+extern const char *PF_MAPPAGE;          // pages read from a mapped file
+extern const char *PF_BGWRITEPAGE;      // IO, pages written in background
+extern const char *PF_CHECKPOINT;
+
+// Print the hit ratio of the buffer under each replacement policy that
+// has served a GetPage, and how many of the pages read ahead were used.
+// This is defined within pf_statistics.cc
+void PF_ReplacerStatistics();
+void PF_PrefetchStatistics();
 
 #endif
 